@@ -155,7 +155,8 @@ unsigned int si_isa_read_vreg(struct si_work_item_t *work_item, int vreg)
 	/* Statistics */
 	work_item->work_group->vreg_read_count++;
 
-	return work_item->vreg[vreg].as_uint;
+	return work_item->wavefront->vreg[vreg]
+		[work_item->id_in_wavefront].as_uint;
 }
 
 void si_isa_write_vreg(struct si_work_item_t *work_item, int vreg, 
@@ -163,7 +164,8 @@ void si_isa_write_vreg(struct si_work_item_t *work_item, int vreg,
 {
 	assert(vreg >= 0);
 	assert(vreg < 256);
-	work_item->vreg[vreg].as_uint = value;
+	work_item->wavefront->vreg[vreg][work_item->id_in_wavefront].as_uint = 
+		value;
 
 	/* Statistics */
 	work_item->work_group->vreg_write_count++;
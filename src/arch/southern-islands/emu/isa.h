@@ -114,6 +114,11 @@ union si_reg_t;
 typedef void (*si_isa_inst_func_t)(struct si_work_item_t *work_item, struct si_inst_t *inst);
 extern si_isa_inst_func_t *si_isa_inst_func;
 
+/* Wavefront-wide implementation of vector ALU instructions */
+struct si_wavefront_t;
+int si_isa_execute_wavefront(struct si_wavefront_t *wavefront,
+	struct si_inst_t *inst);
+
 /* FIXME
  * Some older compilers need the 'union' type to be not only declared but 
  * also defined to allow for the declaration below. This forces us to 
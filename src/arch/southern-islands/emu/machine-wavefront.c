@@ -0,0 +1,931 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <limits.h>
+#include <math.h>
+
+#include <lib/util/debug.h>
+#include <lib/util/misc.h>
+
+#include "emu.h"
+#include "isa.h"
+#include "wavefront.h"
+#include "work-group.h"
+#include "work-item.h"
+
+
+/*
+ * Wavefront-wide execution of vector ALU instructions.
+ *
+ * Vector registers are stored in the wavefront as one row per register, so
+ * the functions below execute an instruction for all work-items at once, as
+ * plain loops over rows that the compiler turns into SIMD code. Results are
+ * computed for every lane and merged into the destination with the EXEC
+ * mask. Instructions not listed here are emulated one work-item at a time by
+ * the functions in 'machine.c', which produce the same register values and
+ * statistics.
+ */
+
+#define SI_ISA_FOREACH_LANE(LANE) \
+	for ((LANE) = 0; (LANE) < SI_WAVEFRONT_MAX_SIZE; (LANE)++)
+
+struct si_isa_wavefront_t
+{
+	struct si_wavefront_t *wavefront;
+	struct si_work_group_t *work_group;
+	struct si_inst_t *inst;
+
+	/* Active work-items */
+	unsigned long long exec;
+	unsigned int mask[SI_WAVEFRONT_MAX_SIZE];  /* 0 or 0xffffffff */
+	int active;
+
+	/* Scalar sources broadcast to all lanes */
+	union si_reg_t scalar[3][SI_WAVEFRONT_MAX_SIZE];
+
+	/* Results. 'carry' holds one bit per lane for instructions writing
+	 * a lane mask in addition to a vector register. */
+	union si_reg_t result[SI_WAVEFRONT_MAX_SIZE];
+	union si_reg_t carry[SI_WAVEFRONT_MAX_SIZE];
+};
+
+
+/* Return the values of source operand 'src' for all lanes. Vector registers
+ * are returned in place, while scalar registers and literal constants are
+ * broadcast into scalar buffer 'index'. */
+static union si_reg_t *si_isa_wavefront_src(struct si_isa_wavefront_t *ctx,
+	int index, int src, int has_lit, unsigned int lit_cnst)
+{
+	union si_reg_t *row;
+	unsigned int value;
+	int lane;
+
+	/* Vector register */
+	if (src >= 256)
+	{
+		ctx->work_group->vreg_read_count += ctx->active;
+		return ctx->wavefront->vreg[src - 256];
+	}
+
+	/* Literal constant or scalar register */
+	if (has_lit && src == 0xFF)
+	{
+		value = lit_cnst;
+	}
+	else
+	{
+		value = si_isa_read_sreg(ctx->wavefront->scalar_work_item, src);
+		ctx->work_group->sreg_read_count += ctx->active - 1;
+	}
+	row = ctx->scalar[index];
+	SI_ISA_FOREACH_LANE(lane)
+		row[lane].as_uint = value;
+	return row;
+}
+
+
+static union si_reg_t *si_isa_wavefront_vreg(struct si_isa_wavefront_t *ctx,
+	int vreg)
+{
+	return si_isa_wavefront_src(ctx, 0, vreg + 256, 0, 0);
+}
+
+
+/* Broadcast to all lanes the bit of the lane mask stored in scalar register
+ * pair 'sreg', as read with 'si_isa_read_bitmask_sreg'. */
+static union si_reg_t *si_isa_wavefront_bitmask_src(
+	struct si_isa_wavefront_t *ctx, int index, int sreg)
+{
+	struct si_work_item_t *work_item;
+	union si_reg_t *row;
+	unsigned long long bits;
+	int reads;
+	int lane;
+
+	bits = 0;
+	reads = 0;
+	work_item = ctx->wavefront->scalar_work_item;
+	if ((unsigned int) ctx->exec)
+	{
+		bits |= si_isa_read_sreg(work_item, sreg);
+		reads++;
+	}
+	if (ctx->exec >> 32)
+	{
+		bits |= (unsigned long long) si_isa_read_sreg(work_item,
+			sreg + 1) << 32;
+		reads++;
+	}
+	ctx->work_group->sreg_read_count += ctx->active - reads;
+
+	row = ctx->scalar[index];
+	SI_ISA_FOREACH_LANE(lane)
+		row[lane].as_uint = (bits >> lane) & 1;
+	return row;
+}
+
+
+/* Merge 'result' into vector register 'vdst' for active lanes */
+static void si_isa_wavefront_write_vreg(struct si_isa_wavefront_t *ctx,
+	int vdst, union si_reg_t *result)
+{
+	union si_reg_t *dst;
+	int lane;
+
+	dst = ctx->wavefront->vreg[vdst];
+	SI_ISA_FOREACH_LANE(lane)
+		dst[lane].as_uint = (result[lane].as_uint & ctx->mask[lane]) |
+			(dst[lane].as_uint & ~ctx->mask[lane]);
+	ctx->work_group->vreg_write_count += ctx->active;
+}
+
+
+/* Merge the lane mask given by the boolean values in 'result' into scalar
+ * register pair 'sreg' for active lanes, as 'si_isa_bitmask_sreg' would do
+ * one work-item at a time. */
+static void si_isa_wavefront_write_bitmask(struct si_isa_wavefront_t *ctx,
+	int sreg, union si_reg_t *result)
+{
+	struct si_work_item_t *work_item;
+	unsigned long long bits;
+	unsigned long long value;
+	int writes;
+	int lane;
+
+	bits = 0;
+	SI_ISA_FOREACH_LANE(lane)
+		bits |= (unsigned long long) !!result[lane].as_uint << lane;
+
+	value = ctx->wavefront->sreg[sreg].as_uint |
+		(unsigned long long) ctx->wavefront->sreg[sreg + 1].as_uint << 32;
+	value = (value & ~ctx->exec) | (bits & ctx->exec);
+
+	writes = 0;
+	work_item = ctx->wavefront->scalar_work_item;
+	if ((unsigned int) ctx->exec)
+	{
+		si_isa_write_sreg(work_item, sreg, value);
+		writes++;
+	}
+	if (ctx->exec >> 32)
+	{
+		si_isa_write_sreg(work_item, sreg + 1, value >> 32);
+		writes++;
+	}
+
+	/* One read and one write per work-item */
+	ctx->work_group->sreg_read_count += ctx->active;
+	ctx->work_group->sreg_write_count += ctx->active - writes;
+}
+
+
+/* Return TRUE if scalar source 'src' changes while the lane mask in register
+ * pair 'sreg' is written one work-item at a time. The per-work-item
+ * emulation is used in this case, since each work-item reads the value
+ * left by the previous one. */
+static int si_isa_wavefront_bitmask_hazard(int src, int sreg)
+{
+	return src == sreg || src == sreg + 1 || src == SI_VCCZ ||
+		src == SI_EXECZ;
+}
+
+
+/* Writing EXEC would change the set of work-items executing the rest of the
+ * instruction. */
+static int si_isa_wavefront_bitmask_dst_valid(int sreg)
+{
+	return sreg + 1 < SI_EXEC || sreg > SI_EXEC + 1;
+}
+
+
+
+
+/*
+ * VOP1
+ */
+
+#define INST SI_INST_VOP1
+static int si_isa_wavefront_vop1(struct si_isa_wavefront_t *ctx)
+{
+	struct si_inst_t *inst = ctx->inst;
+	union si_reg_t *s0;
+	union si_reg_t *r;
+
+	float fvalue;
+	int lane;
+
+	switch (inst->info->inst)
+	{
+	case SI_INST_V_MOV_B32:
+	case SI_INST_V_NOT_B32:
+	case SI_INST_V_CVT_F32_I32:
+	case SI_INST_V_CVT_F32_U32:
+	case SI_INST_V_CVT_I32_F32:
+	case SI_INST_V_TRUNC_F32:
+	case SI_INST_V_RCP_F32:
+		break;
+
+	default:
+		return 0;
+	}
+
+	/* Load operand */
+	s0 = si_isa_wavefront_src(ctx, 0, INST.src0, 1, INST.lit_cnst);
+	r = ctx->result;
+
+	switch (inst->info->inst)
+	{
+	case SI_INST_V_MOV_B32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = s0[lane].as_uint;
+		break;
+
+	case SI_INST_V_NOT_B32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = ~s0[lane].as_uint;
+		break;
+
+	case SI_INST_V_CVT_F32_I32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = (float) s0[lane].as_int;
+		break;
+
+	case SI_INST_V_CVT_F32_U32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = (float) s0[lane].as_uint;
+		break;
+
+	case SI_INST_V_CVT_I32_F32:
+		SI_ISA_FOREACH_LANE(lane)
+		{
+			fvalue = s0[lane].as_float;
+			if ((isinf(fvalue) && fvalue > 0.0f) || fvalue >= INT_MAX)
+				r[lane].as_int = INT_MAX;
+			else if (isinf(fvalue) || fvalue < INT_MIN)
+				r[lane].as_int = INT_MIN;
+			else if (isnan(fvalue) || fvalue == 0.0f)
+				r[lane].as_int = 0;
+			else
+				r[lane].as_int = (int) fvalue;
+		}
+		break;
+
+	case SI_INST_V_TRUNC_F32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = (float) ((int) s0[lane].as_float);
+		break;
+
+	case SI_INST_V_RCP_F32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = 1.0f / s0[lane].as_float;
+		break;
+
+	default:
+		panic("%s: invalid instruction", __FUNCTION__);
+	}
+
+	/* Write the results */
+	si_isa_wavefront_write_vreg(ctx, INST.vdst, r);
+	return 1;
+}
+#undef INST
+
+
+
+
+/*
+ * VOP2
+ */
+
+#define INST SI_INST_VOP2
+static int si_isa_wavefront_vop2(struct si_isa_wavefront_t *ctx)
+{
+	struct si_inst_t *inst = ctx->inst;
+	union si_reg_t *s0;
+	union si_reg_t *s1;
+	union si_reg_t *s2;
+	union si_reg_t *r;
+	union si_reg_t *c;
+
+	int lane;
+
+	switch (inst->info->inst)
+	{
+	case SI_INST_V_CNDMASK_B32:
+	case SI_INST_V_ADD_F32:
+	case SI_INST_V_SUB_F32:
+	case SI_INST_V_SUBREV_F32:
+	case SI_INST_V_MUL_LEGACY_F32:
+	case SI_INST_V_MUL_F32:
+	case SI_INST_V_MUL_I32_I24:
+	case SI_INST_V_MIN_F32:
+	case SI_INST_V_MAX_F32:
+	case SI_INST_V_MAX_I32:
+	case SI_INST_V_MIN_U32:
+	case SI_INST_V_MAX_U32:
+	case SI_INST_V_LSHL_B32:
+	case SI_INST_V_AND_B32:
+	case SI_INST_V_OR_B32:
+	case SI_INST_V_XOR_B32:
+	case SI_INST_V_MAC_F32:
+	case SI_INST_V_MADMK_F32:
+		break;
+
+	/* Shift amounts given as literals are checked by 'machine.c' */
+	case SI_INST_V_LSHRREV_B32:
+	case SI_INST_V_ASHRREV_I32:
+	case SI_INST_V_LSHLREV_B32:
+		if (INST.src0 == 0xFF && INST.lit_cnst >= 32)
+			return 0;
+		break;
+
+	/* Carry is written to VCC */
+	case SI_INST_V_ADD_I32:
+	case SI_INST_V_SUB_I32:
+	case SI_INST_V_SUBREV_I32:
+		if (si_isa_wavefront_bitmask_hazard(INST.src0, SI_VCC))
+			return 0;
+		break;
+
+	default:
+		return 0;
+	}
+
+	/* Load operands. V_MADMK_F32 uses the literal constant as a third
+	 * operand instead. */
+	if (inst->info->inst == SI_INST_V_MADMK_F32)
+		s0 = si_isa_wavefront_src(ctx, 0, INST.src0, 0, 0);
+	else
+		s0 = si_isa_wavefront_src(ctx, 0, INST.src0, 1, INST.lit_cnst);
+	s1 = si_isa_wavefront_vreg(ctx, INST.vsrc1);
+	r = ctx->result;
+	c = ctx->carry;
+
+	switch (inst->info->inst)
+	{
+	case SI_INST_V_CNDMASK_B32:
+		s2 = si_isa_wavefront_bitmask_src(ctx, 2, SI_VCC);
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = s2[lane].as_uint ?
+				s1[lane].as_uint : s0[lane].as_uint;
+		break;
+
+	case SI_INST_V_ADD_F32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s0[lane].as_float + s1[lane].as_float;
+		break;
+
+	case SI_INST_V_SUB_F32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s0[lane].as_float - s1[lane].as_float;
+		break;
+
+	case SI_INST_V_SUBREV_F32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s1[lane].as_float - s0[lane].as_float;
+		break;
+
+	case SI_INST_V_MUL_LEGACY_F32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s0[lane].as_float == 0.0f ||
+				s1[lane].as_float == 0.0f ? 0.0f :
+				s0[lane].as_float * s1[lane].as_float;
+		break;
+
+	case SI_INST_V_MUL_F32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s0[lane].as_float * s1[lane].as_float;
+		break;
+
+	case SI_INST_V_MUL_I32_I24:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = SEXT32(s0[lane].as_uint, 24) *
+				SEXT32(s1[lane].as_uint, 24);
+		break;
+
+	case SI_INST_V_MIN_F32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s0[lane].as_float < s1[lane].as_float ?
+				s0[lane].as_float : s1[lane].as_float;
+		break;
+
+	case SI_INST_V_MAX_F32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s0[lane].as_float > s1[lane].as_float ?
+				s0[lane].as_float : s1[lane].as_float;
+		break;
+
+	case SI_INST_V_MAX_I32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_int = s0[lane].as_int > s1[lane].as_int ?
+				s0[lane].as_int : s1[lane].as_int;
+		break;
+
+	case SI_INST_V_MIN_U32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = s0[lane].as_uint < s1[lane].as_uint ?
+				s0[lane].as_uint : s1[lane].as_uint;
+		break;
+
+	case SI_INST_V_MAX_U32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = s0[lane].as_uint > s1[lane].as_uint ?
+				s0[lane].as_uint : s1[lane].as_uint;
+		break;
+
+	case SI_INST_V_LSHRREV_B32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = s1[lane].as_uint >>
+				(s0[lane].as_uint & 0x1F);
+		break;
+
+	case SI_INST_V_ASHRREV_I32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_int = s1[lane].as_int >>
+				(s0[lane].as_uint & 0x1F);
+		break;
+
+	case SI_INST_V_LSHL_B32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = s0[lane].as_uint <<
+				(s1[lane].as_uint & 0x1F);
+		break;
+
+	case SI_INST_V_LSHLREV_B32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = s1[lane].as_uint <<
+				(s0[lane].as_uint & 0x1F);
+		break;
+
+	case SI_INST_V_AND_B32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = s0[lane].as_uint & s1[lane].as_uint;
+		break;
+
+	case SI_INST_V_OR_B32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = s0[lane].as_uint | s1[lane].as_uint;
+		break;
+
+	case SI_INST_V_XOR_B32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = s0[lane].as_uint ^ s1[lane].as_uint;
+		break;
+
+	case SI_INST_V_MAC_F32:
+		s2 = si_isa_wavefront_vreg(ctx, INST.vdst);
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s0[lane].as_float * s1[lane].as_float +
+				s2[lane].as_float;
+		break;
+
+	case SI_INST_V_MADMK_F32:
+		s2 = si_isa_wavefront_src(ctx, 2, 0xFF, 1, INST.lit_cnst);
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s0[lane].as_float * s2[lane].as_float +
+				s1[lane].as_float;
+		break;
+
+	case SI_INST_V_ADD_I32:
+		SI_ISA_FOREACH_LANE(lane)
+		{
+			r[lane].as_uint = s0[lane].as_uint + s1[lane].as_uint;
+			c[lane].as_uint = !!(((long long) s0[lane].as_int +
+				(long long) s1[lane].as_int) >> 32);
+		}
+		break;
+
+	case SI_INST_V_SUB_I32:
+		SI_ISA_FOREACH_LANE(lane)
+		{
+			r[lane].as_uint = s0[lane].as_uint - s1[lane].as_uint;
+			c[lane].as_uint = s1[lane].as_int > s0[lane].as_int;
+		}
+		break;
+
+	case SI_INST_V_SUBREV_I32:
+		SI_ISA_FOREACH_LANE(lane)
+		{
+			r[lane].as_uint = s1[lane].as_uint - s0[lane].as_uint;
+			c[lane].as_uint = s0[lane].as_int > s1[lane].as_int;
+		}
+		break;
+
+	default:
+		panic("%s: invalid instruction", __FUNCTION__);
+	}
+
+	/* Write the results */
+	si_isa_wavefront_write_vreg(ctx, INST.vdst, r);
+	switch (inst->info->inst)
+	{
+	case SI_INST_V_ADD_I32:
+	case SI_INST_V_SUB_I32:
+	case SI_INST_V_SUBREV_I32:
+		si_isa_wavefront_write_bitmask(ctx, SI_VCC, c);
+		break;
+
+	default:
+		break;
+	}
+	return 1;
+}
+#undef INST
+
+
+
+
+/*
+ * VOPC
+ */
+
+/* Comparison of operands 's0' and 's1' into the boolean values in 'r' */
+#define SI_ISA_WAVEFRONT_CMP(EXPR) \
+	if (r) \
+		SI_ISA_FOREACH_LANE(lane) \
+			r[lane].as_uint = (EXPR)
+
+#define SI_ISA_CMP_LT(F) (s0[lane].F < s1[lane].F)
+#define SI_ISA_CMP_EQ(F) (s0[lane].F == s1[lane].F)
+#define SI_ISA_CMP_LE(F) (s0[lane].F <= s1[lane].F)
+#define SI_ISA_CMP_GT(F) (s0[lane].F > s1[lane].F)
+#define SI_ISA_CMP_NE(F) (s0[lane].F != s1[lane].F)
+#define SI_ISA_CMP_GE(F) (s0[lane].F >= s1[lane].F)
+
+/* Evaluate in 'r' the comparison for instruction 'opcode', shared by VOPC and
+ * VOP3a encodings. Return FALSE if the comparison is not supported. If 'r'
+ * is NULL, only check whether it is. */
+static int si_isa_wavefront_cmp(int opcode, union si_reg_t *s0,
+	union si_reg_t *s1, union si_reg_t *r)
+{
+	int lane;
+
+	switch (opcode)
+	{
+	case SI_INST_V_CMP_LT_F32:
+	case SI_INST_V_CMP_LT_F32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_LT(as_float));
+		break;
+
+	case SI_INST_V_CMP_EQ_F32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_EQ(as_float));
+		break;
+
+	case SI_INST_V_CMP_GT_F32:
+	case SI_INST_V_CMP_GT_F32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_GT(as_float));
+		break;
+
+	case SI_INST_V_CMP_NGT_F32:
+		SI_ISA_WAVEFRONT_CMP(!SI_ISA_CMP_GT(as_float));
+		break;
+
+	case SI_INST_V_CMP_NEQ_F32:
+	case SI_INST_V_CMP_NEQ_F32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(!SI_ISA_CMP_EQ(as_float));
+		break;
+
+	case SI_INST_V_CMP_NLT_F32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(!SI_ISA_CMP_LT(as_float));
+		break;
+
+	case SI_INST_V_CMP_LT_I32:
+	case SI_INST_V_CMP_LT_I32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_LT(as_int));
+		break;
+
+	case SI_INST_V_CMP_EQ_I32:
+	case SI_INST_V_CMP_EQ_I32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_EQ(as_int));
+		break;
+
+	case SI_INST_V_CMP_LE_I32:
+	case SI_INST_V_CMP_LE_I32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_LE(as_int));
+		break;
+
+	case SI_INST_V_CMP_GT_I32:
+	case SI_INST_V_CMP_GT_I32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_GT(as_int));
+		break;
+
+	case SI_INST_V_CMP_NE_I32:
+	case SI_INST_V_CMP_NE_I32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_NE(as_int));
+		break;
+
+	case SI_INST_V_CMP_GE_I32:
+	case SI_INST_V_CMP_GE_I32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_GE(as_int));
+		break;
+
+	case SI_INST_V_CMP_LT_U32:
+	case SI_INST_V_CMP_LT_U32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_LT(as_uint));
+		break;
+
+	case SI_INST_V_CMP_LE_U32:
+	case SI_INST_V_CMP_LE_U32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_LE(as_uint));
+		break;
+
+	case SI_INST_V_CMP_GT_U32:
+	case SI_INST_V_CMP_GT_U32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_GT(as_uint));
+		break;
+
+	case SI_INST_V_CMP_LG_U32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_NE(as_uint));
+		break;
+
+	case SI_INST_V_CMP_GE_U32_VOP3a:
+		SI_ISA_WAVEFRONT_CMP(SI_ISA_CMP_GE(as_uint));
+		break;
+
+	default:
+		return 0;
+	}
+
+	return 1;
+}
+
+
+#define INST SI_INST_VOPC
+static int si_isa_wavefront_vopc(struct si_isa_wavefront_t *ctx)
+{
+	struct si_inst_t *inst = ctx->inst;
+	union si_reg_t *s0;
+	union si_reg_t *s1;
+
+	/* Result is written to VCC */
+	if (!si_isa_wavefront_cmp(inst->info->inst, NULL, NULL, NULL))
+		return 0;
+	if (si_isa_wavefront_bitmask_hazard(INST.src0, SI_VCC))
+		return 0;
+
+	/* Load operands */
+	s0 = si_isa_wavefront_src(ctx, 0, INST.src0, 1, INST.lit_cnst);
+	s1 = si_isa_wavefront_vreg(ctx, INST.vsrc1);
+
+	/* Compare and write the results */
+	si_isa_wavefront_cmp(inst->info->inst, s0, s1, ctx->result);
+	si_isa_wavefront_write_bitmask(ctx, SI_VCC, ctx->result);
+	return 1;
+}
+#undef INST
+
+
+
+
+/*
+ * VOP3a
+ */
+
+#define INST SI_INST_VOP3a
+static int si_isa_wavefront_vop3a(struct si_isa_wavefront_t *ctx)
+{
+	struct si_inst_t *inst = ctx->inst;
+	union si_reg_t *s0;
+	union si_reg_t *s1;
+	union si_reg_t *s2;
+	union si_reg_t *r;
+
+	unsigned int width;
+	unsigned int offset;
+	int lane;
+
+	/* Input and output modifiers are applied by 'machine.c' */
+	if (INST.abs || INST.neg || INST.clamp || INST.omod)
+		return 0;
+
+	/* Comparisons */
+	if (si_isa_wavefront_cmp(inst->info->inst, NULL, NULL, NULL))
+	{
+		if (!si_isa_wavefront_bitmask_dst_valid(INST.vdst) ||
+				si_isa_wavefront_bitmask_hazard(INST.src0,
+					INST.vdst) ||
+				si_isa_wavefront_bitmask_hazard(INST.src1,
+					INST.vdst))
+			return 0;
+
+		s0 = si_isa_wavefront_src(ctx, 0, INST.src0, 0, 0);
+		s1 = si_isa_wavefront_src(ctx, 1, INST.src1, 0, 0);
+		si_isa_wavefront_cmp(inst->info->inst, s0, s1, ctx->result);
+		si_isa_wavefront_write_bitmask(ctx, INST.vdst, ctx->result);
+		return 1;
+	}
+
+	switch (inst->info->inst)
+	{
+	case SI_INST_V_ADD_F32_VOP3a:
+	case SI_INST_V_SUBREV_F32_VOP3a:
+	case SI_INST_V_MUL_F32_VOP3a:
+	case SI_INST_V_MUL_I32_I24_VOP3a:
+	case SI_INST_V_MAX_F32_VOP3a:
+	case SI_INST_V_MUL_LO_U32:
+	case SI_INST_V_MUL_HI_U32:
+	case SI_INST_V_MUL_LO_I32:
+		s2 = NULL;
+		break;
+
+	case SI_INST_V_MAD_F32:
+	case SI_INST_V_MAD_U32_U24:
+	case SI_INST_V_BFE_U32:
+	case SI_INST_V_BFE_I32:
+	case SI_INST_V_BFI_B32:
+		s2 = ctx->scalar[2];
+		break;
+
+	/* Lane mask given in 'src2' */
+	case SI_INST_V_CNDMASK_B32_VOP3a:
+		if (INST.src2 >= 256)
+			return 0;
+		s2 = ctx->scalar[2];
+		break;
+
+	default:
+		return 0;
+	}
+
+	/* Load operands */
+	s0 = si_isa_wavefront_src(ctx, 0, INST.src0, 0, 0);
+	s1 = si_isa_wavefront_src(ctx, 1, INST.src1, 0, 0);
+	if (inst->info->inst == SI_INST_V_CNDMASK_B32_VOP3a)
+		s2 = si_isa_wavefront_bitmask_src(ctx, 2, INST.src2);
+	else if (s2)
+		s2 = si_isa_wavefront_src(ctx, 2, INST.src2, 0, 0);
+	r = ctx->result;
+
+	switch (inst->info->inst)
+	{
+	case SI_INST_V_CNDMASK_B32_VOP3a:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = s2[lane].as_uint ?
+				s1[lane].as_uint : s0[lane].as_uint;
+		break;
+
+	case SI_INST_V_ADD_F32_VOP3a:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s0[lane].as_float + s1[lane].as_float;
+		break;
+
+	case SI_INST_V_SUBREV_F32_VOP3a:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s1[lane].as_float - s0[lane].as_float;
+		break;
+
+	case SI_INST_V_MUL_F32_VOP3a:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s0[lane].as_float * s1[lane].as_float;
+		break;
+
+	case SI_INST_V_MUL_I32_I24_VOP3a:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = SEXT32(s0[lane].as_uint, 24) *
+				SEXT32(s1[lane].as_uint, 24);
+		break;
+
+	case SI_INST_V_MAX_F32_VOP3a:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s0[lane].as_float > s1[lane].as_float ?
+				s0[lane].as_float : s1[lane].as_float;
+		break;
+
+	case SI_INST_V_MUL_LO_U32:
+	case SI_INST_V_MUL_LO_I32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = s0[lane].as_uint * s1[lane].as_uint;
+		break;
+
+	case SI_INST_V_MUL_HI_U32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = ((unsigned long long) s0[lane].as_uint *
+				(unsigned long long) s1[lane].as_uint) >> 32;
+		break;
+
+	case SI_INST_V_MAD_F32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_float = s0[lane].as_float * s1[lane].as_float +
+				s2[lane].as_float;
+		break;
+
+	case SI_INST_V_MAD_U32_U24:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = (s0[lane].as_uint & 0x00FFFFFF) *
+				(s1[lane].as_uint & 0x00FFFFFF) +
+				s2[lane].as_uint;
+		break;
+
+	case SI_INST_V_BFE_U32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = (s0[lane].as_uint >>
+				(s1[lane].as_uint & 0x1F)) &
+				((1u << (s2[lane].as_uint & 0x1F)) - 1);
+		break;
+
+	case SI_INST_V_BFE_I32:
+		SI_ISA_FOREACH_LANE(lane)
+		{
+			offset = s1[lane].as_uint & 0x1F;
+			width = s2[lane].as_uint & 0x1F;
+			if (!width)
+				r[lane].as_int = 0;
+			else if (width + offset < 32)
+				r[lane].as_int = (s0[lane].as_int <<
+					(32 - offset - width)) >> (32 - width);
+			else
+				r[lane].as_int = s0[lane].as_int >> offset;
+		}
+		break;
+
+	case SI_INST_V_BFI_B32:
+		SI_ISA_FOREACH_LANE(lane)
+			r[lane].as_uint = (s0[lane].as_uint & s1[lane].as_uint) |
+				(~s0[lane].as_uint & s2[lane].as_uint);
+		break;
+
+	default:
+		panic("%s: invalid instruction", __FUNCTION__);
+	}
+
+	/* Write the results */
+	si_isa_wavefront_write_vreg(ctx, INST.vdst, r);
+	return 1;
+}
+#undef INST
+
+
+
+
+/*
+ * Public Functions
+ */
+
+/* Execute vector ALU instruction 'inst' on all active work-items of
+ * 'wavefront'. Return FALSE if the instruction has no wavefront-wide
+ * implementation, in which case the caller runs the per-work-item function
+ * for each active work-item. */
+int si_isa_execute_wavefront(struct si_wavefront_t *wavefront,
+	struct si_inst_t *inst)
+{
+	struct si_isa_wavefront_t ctx;
+
+	int lane;
+
+	/* Instructions are dumped one work-item at a time when debugging */
+	if (debug_status(si_isa_debug_category))
+		return 0;
+
+	/* Active work-items */
+	ctx.wavefront = wavefront;
+	ctx.work_group = wavefront->work_group;
+	ctx.inst = inst;
+	ctx.exec = wavefront->sreg[SI_EXEC].as_uint |
+		(unsigned long long) wavefront->sreg[SI_EXEC + 1].as_uint << 32;
+	if (si_emu_wavefront_size < SI_WAVEFRONT_MAX_SIZE)
+		ctx.exec &= (1ull << si_emu_wavefront_size) - 1;
+	ctx.active = 0;
+	SI_ISA_FOREACH_LANE(lane)
+	{
+		ctx.mask[lane] = -((ctx.exec >> lane) & 1);
+		ctx.active += ctx.mask[lane] & 1;
+	}
+
+	/* Nothing to do with an empty mask */
+	if (!ctx.active)
+		return 1;
+
+	switch (inst->info->fmt)
+	{
+	case SI_FMT_VOP1:
+		return si_isa_wavefront_vop1(&ctx);
+
+	case SI_FMT_VOP2:
+		return si_isa_wavefront_vop2(&ctx);
+
+	case SI_FMT_VOPC:
+		return si_isa_wavefront_vopc(&ctx);
+
+	case SI_FMT_VOP3a:
+		return si_isa_wavefront_vop3a(&ctx);
+
+	default:
+		return 0;
+	}
+}
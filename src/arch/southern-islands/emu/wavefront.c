@@ -52,6 +52,10 @@ struct si_wavefront_t *si_wavefront_create(int wavefront_id,
 	wavefront->pred = bit_map_create(si_emu_wavefront_size);
 	si_wavefront_sreg_init(wavefront);
 
+	/* Vector register file */
+	assert(si_emu_wavefront_size <= SI_WAVEFRONT_MAX_SIZE);
+	wavefront->vreg = xcalloc(256, sizeof *wavefront->vreg);
+
 	/* Create work items */
 	wavefront->work_items = xcalloc(si_emu_wavefront_size, sizeof(void *));
 	SI_FOREACH_WORK_ITEM_IN_WAVEFRONT(wavefront, work_item_id)
@@ -108,6 +112,7 @@ void si_wavefront_free(struct si_wavefront_t *wavefront)
 	bit_map_free(wavefront->pred);
 
 	free(wavefront->work_items);
+	free(wavefront->vreg);
 
 	memset(wavefront, 0, sizeof(struct si_wavefront_t));
 	free(wavefront);
@@ -355,14 +360,18 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		wavefront->vector_alu_inst_count++;
 	
 		/* Execute the instruction */
-		SI_FOREACH_WORK_ITEM_IN_WAVEFRONT(wavefront, work_item_id)
+		if (!si_isa_execute_wavefront(wavefront, inst))
 		{
-			work_item = wavefront->work_items[work_item_id];
-			if(si_wavefront_work_item_active(wavefront, 
-				work_item->id_in_wavefront))
+			SI_FOREACH_WORK_ITEM_IN_WAVEFRONT(wavefront, 
+				work_item_id)
 			{
-				(*si_isa_inst_func[inst->info->inst])(work_item,
-					inst);
+				work_item = wavefront->work_items[work_item_id];
+				if(si_wavefront_work_item_active(wavefront, 
+					work_item->id_in_wavefront))
+				{
+					(*si_isa_inst_func[inst->info->inst])(
+						work_item, inst);
+				}
 			}
 		}
 
@@ -421,7 +430,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 				}
 			}
 		}
-		else
+		else if (!si_isa_execute_wavefront(wavefront, inst))
 		{
 			/* Execute the instruction */
 			SI_FOREACH_WORK_ITEM_IN_WAVEFRONT(wavefront, 
@@ -461,14 +470,18 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		wavefront->vector_alu_inst_count++;
 	
 		/* Execute the instruction */
-		SI_FOREACH_WORK_ITEM_IN_WAVEFRONT(wavefront, work_item_id)
+		if (!si_isa_execute_wavefront(wavefront, inst))
 		{
-			work_item = wavefront->work_items[work_item_id];
-			if(si_wavefront_work_item_active(wavefront, 
-				work_item->id_in_wavefront))
+			SI_FOREACH_WORK_ITEM_IN_WAVEFRONT(wavefront, 
+				work_item_id)
 			{
-				(*si_isa_inst_func[inst->info->inst])(work_item,
-					inst);
+				work_item = wavefront->work_items[work_item_id];
+				if(si_wavefront_work_item_active(wavefront, 
+					work_item->id_in_wavefront))
+				{
+					(*si_isa_inst_func[inst->info->inst])(
+						work_item, inst);
+				}
 			}
 		}
 
@@ -496,14 +509,18 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		wavefront->vector_alu_inst_count++;
 	
 		/* Execute the instruction */
-		SI_FOREACH_WORK_ITEM_IN_WAVEFRONT(wavefront, work_item_id)
+		if (!si_isa_execute_wavefront(wavefront, inst))
 		{
-			work_item = wavefront->work_items[work_item_id];
-			if(si_wavefront_work_item_active(wavefront, 
-				work_item->id_in_wavefront))
+			SI_FOREACH_WORK_ITEM_IN_WAVEFRONT(wavefront, 
+				work_item_id)
 			{
-				(*si_isa_inst_func[inst->info->inst])(work_item,
-					inst);
+				work_item = wavefront->work_items[work_item_id];
+				if(si_wavefront_work_item_active(wavefront, 
+					work_item->id_in_wavefront))
+				{
+					(*si_isa_inst_func[inst->info->inst])(
+						work_item, inst);
+				}
 			}
 		}
 
@@ -23,6 +23,10 @@
 #include <arch/southern-islands/asm/asm.h>
 
 
+/* Maximum number of work-items in a wavefront, used to size the per-lane
+ * rows of the vector register file. */
+#define SI_WAVEFRONT_MAX_SIZE  64
+
 struct si_wavefront_t
 {
 	/* ID */
@@ -51,6 +55,10 @@ struct si_wavefront_t
 	/* Scalar registers */
 	union si_reg_t sreg[256];
 
+	/* Vector registers of all work-items, stored as one row per register
+	 * with one element per work-item: vreg[register][id_in_wavefront] */
+	union si_reg_t (*vreg)[SI_WAVEFRONT_MAX_SIZE];
+
 	/* Predicate mask */
 	struct bit_map_t *pred;  /* work_item_count elements */
 
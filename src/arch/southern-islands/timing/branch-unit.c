@@ -70,7 +70,8 @@ void si_branch_unit_complete(struct si_branch_unit_t *branch_unit)
 
 		/* Statistics */
 		branch_unit->inst_count++;
-		si_gpu->last_complete_cycle = arch_southern_islands->cycle;
+		branch_unit->compute_unit->last_complete_cycle =
+			arch_southern_islands->cycle;
 	}
 }
 
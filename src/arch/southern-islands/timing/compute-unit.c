@@ -18,6 +18,7 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
 #include <arch/common/arch.h>
 #include <arch/southern-islands/emu/emu.h>
@@ -40,6 +41,33 @@
 
 #include "cycle-interval-report.h"
 
+
+/* Record an action on shared state, performed later by
+ * 'si_compute_unit_commit_actions' */
+static struct si_compute_unit_action_t *si_compute_unit_add_action(
+	struct si_compute_unit_t *compute_unit,
+	enum si_compute_unit_action_kind_t kind)
+{
+	struct si_compute_unit_action_t *action;
+
+	/* Grow array */
+	if (compute_unit->action_count == compute_unit->action_size)
+	{
+		compute_unit->action_size = compute_unit->action_size ?
+			compute_unit->action_size * 2 : 64;
+		compute_unit->actions = xrealloc(compute_unit->actions,
+			compute_unit->action_size *
+			sizeof(struct si_compute_unit_action_t));
+	}
+
+	/* New action */
+	action = &compute_unit->actions[compute_unit->action_count++];
+	memset(action, 0, sizeof(struct si_compute_unit_action_t));
+	action->kind = kind;
+	return action;
+}
+
+
 /*
  * Compute Unit
  */
@@ -231,6 +259,7 @@ void si_compute_unit_free(struct si_compute_unit_t *compute_unit)
 	free(compute_unit->wavefront_pools);
 	free(compute_unit->fetch_buffers);
 	free(compute_unit->work_groups);  /* List of mapped work-groups */
+	free(compute_unit->actions);
 	mod_free(compute_unit->lds_module);
 	free(compute_unit);
 }
@@ -295,27 +324,14 @@ void si_compute_unit_map_work_group(struct si_compute_unit_t *compute_unit,
 }
 
 
-void si_compute_unit_unmap_work_group(struct si_compute_unit_t *compute_unit,
+/* Return the work-group to the emulator and the compute unit to the list of
+ * available compute units */
+static void si_compute_unit_release_work_group(
+	struct si_compute_unit_t *compute_unit,
 	struct si_work_group_t *work_group)
 {
 	long work_group_id;
 
-	/* Add work group register access statistics to compute unit */
-	compute_unit->sreg_read_count += work_group->sreg_read_count;
-	compute_unit->sreg_write_count += work_group->sreg_write_count;
-	compute_unit->vreg_read_count += work_group->vreg_read_count;
-	compute_unit->vreg_write_count += work_group->vreg_write_count;
-
-	/* Reset mapped work-group */
-	assert(compute_unit->work_group_count > 0);
-	assert(compute_unit->work_groups[work_group->id_in_compute_unit]);
-	compute_unit->work_groups[work_group->id_in_compute_unit] = NULL;
-	compute_unit->work_group_count--;
-
-	/* Unmap wavefronts from instruction buffer */
-	si_wavefront_pool_unmap_wavefronts(work_group->wavefront_pool,
-		work_group);
-
 	work_group_id = work_group->id;
 	assert(list_index_of(si_emu->running_work_groups, 
 		(void*)work_group_id) >= 0);
@@ -346,6 +362,39 @@ void si_compute_unit_unmap_work_group(struct si_compute_unit_t *compute_unit,
 	si_work_group_free(work_group);
 }
 
+
+void si_compute_unit_unmap_work_group(struct si_compute_unit_t *compute_unit,
+	struct si_work_group_t *work_group)
+{
+	struct si_compute_unit_action_t *action;
+
+	/* Add work group register access statistics to compute unit */
+	compute_unit->sreg_read_count += work_group->sreg_read_count;
+	compute_unit->sreg_write_count += work_group->sreg_write_count;
+	compute_unit->vreg_read_count += work_group->vreg_read_count;
+	compute_unit->vreg_write_count += work_group->vreg_write_count;
+
+	/* Reset mapped work-group */
+	assert(compute_unit->work_group_count > 0);
+	assert(compute_unit->work_groups[work_group->id_in_compute_unit]);
+	compute_unit->work_groups[work_group->id_in_compute_unit] = NULL;
+	compute_unit->work_group_count--;
+
+	/* Unmap wavefronts from instruction buffer */
+	si_wavefront_pool_unmap_wavefronts(work_group->wavefront_pool,
+		work_group);
+
+	/* Release work-group */
+	if (compute_unit->deferred)
+	{
+		action = si_compute_unit_add_action(compute_unit,
+			si_compute_unit_action_release_work_group);
+		action->work_group = work_group;
+		return;
+	}
+	si_compute_unit_release_work_group(compute_unit, work_group);
+}
+
 void si_compute_unit_fetch(struct si_compute_unit_t *compute_unit, 
 	int active_fb)
 {
@@ -1350,18 +1399,15 @@ void si_compute_unit_issue_first(struct si_compute_unit_t *compute_unit,
 	}
 }
 
-/* Advance one cycle in the compute unit by running every stage from 
- * last to first */
-void si_compute_unit_run(struct si_compute_unit_t *compute_unit)
+/* Run the execution units and the issue stage. Actions on shared state are
+ * deferred if 'compute_unit->deferred' is set, so that this function can
+ * run in parallel for different compute units. */
+void si_compute_unit_run_units(struct si_compute_unit_t *compute_unit)
 {
 	int i;
 	int num_simd_units;
 	int active_fetch_buffer;  
 
-	/* Return if no work groups are mapped to this compute unit */
-	if (!compute_unit->work_group_count)
-		return;
-
 	/* Fetch buffer chosen to issue this cycle */
 	active_fetch_buffer = arch_southern_islands->cycle % 
 		compute_unit->num_wavefront_pools;
@@ -1399,9 +1445,17 @@ void si_compute_unit_run(struct si_compute_unit_t *compute_unit)
 				compute_unit, i);
 		}
 	}
+}
+
+
+/* Fetch stage, which emulates the fetched instructions. It always runs
+ * sequentially in compute unit order. */
+void si_compute_unit_run_fetch(struct si_compute_unit_t *compute_unit)
+{
+	int i;
 
 	/* Fetch */
-	for (i = 0; i < num_simd_units; i++)
+	for (i = 0; i < compute_unit->num_wavefront_pools; i++)
 		si_compute_unit_fetch(compute_unit, i);
 
 	/* Stats */
@@ -1411,3 +1465,92 @@ void si_compute_unit_run(struct si_compute_unit_t *compute_unit)
 		si_cu_interval_update(compute_unit);
 }
 
+
+/* Advance one cycle in the compute unit by running every stage from 
+ * last to first */
+void si_compute_unit_run(struct si_compute_unit_t *compute_unit)
+{
+	/* Return if no work groups are mapped to this compute unit */
+	if (!compute_unit->work_group_count)
+		return;
+
+	si_compute_unit_run_units(compute_unit);
+	si_compute_unit_run_fetch(compute_unit);
+}
+
+
+void si_compute_unit_mem_access(struct si_compute_unit_t *compute_unit,
+	struct mod_t *mod, enum mod_access_kind_t access_kind,
+	unsigned int addr, int *witness_ptr)
+{
+	struct si_compute_unit_action_t *action;
+
+	/* Access memory hierarchy now */
+	if (!compute_unit->deferred)
+	{
+		mod_access(mod, access_kind, addr, witness_ptr,
+			NULL, NULL, NULL);
+		return;
+	}
+
+	/* Defer access */
+	action = si_compute_unit_add_action(compute_unit,
+		si_compute_unit_action_mem_access);
+	action->mod = mod;
+	action->access_kind = access_kind;
+	action->addr = addr;
+	action->witness_ptr = witness_ptr;
+}
+
+
+/* The uop repository is shared by all compute units */
+void si_compute_unit_defer_uop_free(struct si_compute_unit_t *compute_unit,
+	struct si_uop_t *uop)
+{
+	struct si_compute_unit_action_t *action;
+
+	assert(compute_unit->deferred);
+	action = si_compute_unit_add_action(compute_unit,
+		si_compute_unit_action_free_uop);
+	action->uop = uop;
+}
+
+
+/* Perform deferred actions in the order they were recorded */
+void si_compute_unit_commit_actions(struct si_compute_unit_t *compute_unit)
+{
+	struct si_compute_unit_action_t *action;
+	int i;
+
+	assert(!compute_unit->deferred);
+	for (i = 0; i < compute_unit->action_count; i++)
+	{
+		action = &compute_unit->actions[i];
+		switch (action->kind)
+		{
+
+		case si_compute_unit_action_mem_access:
+
+			mod_access(action->mod, action->access_kind,
+				action->addr, action->witness_ptr,
+				NULL, NULL, NULL);
+			break;
+
+		case si_compute_unit_action_release_work_group:
+
+			si_compute_unit_release_work_group(compute_unit,
+				action->work_group);
+			break;
+
+		case si_compute_unit_action_free_uop:
+
+			si_uop_free(action->uop);
+			break;
+
+		default:
+
+			panic("%s: invalid action", __FUNCTION__);
+		}
+	}
+	compute_unit->action_count = 0;
+}
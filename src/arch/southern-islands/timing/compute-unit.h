@@ -20,6 +20,8 @@
 #ifndef ARCH_SOUTHERN_ISLANDS_TIMING_COMPUTE_UNIT_H
 #define ARCH_SOUTHERN_ISLANDS_TIMING_COMPUTE_UNIT_H
 
+#include <mem-system/module.h>
+
 #include "branch-unit.h"
 #include "lds-unit.h"
 #include "scalar-unit.h"
@@ -45,6 +47,34 @@ void si_reg_file_inverse_rename(struct si_compute_unit_t *compute_unit,
 
 
 
+struct si_uop_t;
+
+/* Action of a compute unit on state shared with the rest of the GPU. While
+ * compute units run in parallel, these actions are recorded and performed
+ * at the end of the cycle, in the same order a sequential run would. */
+enum si_compute_unit_action_kind_t
+{
+	si_compute_unit_action_invalid = 0,
+	si_compute_unit_action_mem_access,
+	si_compute_unit_action_release_work_group,
+	si_compute_unit_action_free_uop
+};
+
+struct si_compute_unit_action_t
+{
+	enum si_compute_unit_action_kind_t kind;
+
+	/* Memory access */
+	struct mod_t *mod;
+	enum mod_access_kind_t access_kind;
+	unsigned int addr;
+	int *witness_ptr;
+
+	/* Work-group or uop released */
+	struct si_work_group_t *work_group;
+	struct si_uop_t *uop;
+};
+
 struct si_compute_unit_t
 {
 	/* IDs */
@@ -68,8 +98,15 @@ struct si_compute_unit_t
 	struct si_vector_mem_unit_t vector_mem_unit;
 	struct si_lds_t lds_unit;
 
+	/* Deferred actions on shared state */
+	int deferred;
+	int action_count;
+	int action_size;
+	struct si_compute_unit_action_t *actions;
+
 	/* Statistics */
 	long long cycle;
+	long long last_complete_cycle;
 	long long mapped_work_groups;
 	long long wavefront_count;
 	long long inst_count; /* Total instructions */
@@ -107,6 +144,15 @@ void si_compute_unit_unmap_work_group(struct si_compute_unit_t *compute_unit,
 	struct si_work_group_t *work_group);
 struct si_wavefront_t *si_compute_unit_schedule(struct si_compute_unit_t *compute_unit);
 void si_compute_unit_run(struct si_compute_unit_t *compute_unit);
+void si_compute_unit_run_units(struct si_compute_unit_t *compute_unit);
+void si_compute_unit_run_fetch(struct si_compute_unit_t *compute_unit);
+
+void si_compute_unit_mem_access(struct si_compute_unit_t *compute_unit,
+	struct mod_t *mod, enum mod_access_kind_t access_kind,
+	unsigned int addr, int *witness_ptr);
+void si_compute_unit_defer_uop_free(struct si_compute_unit_t *compute_unit,
+	struct si_uop_t *uop);
+void si_compute_unit_commit_actions(struct si_compute_unit_t *compute_unit);
 
 struct si_wavefront_pool_t *si_wavefront_pool_create();
 void si_wavefront_pool_free(struct si_wavefront_pool_t *wavefront_pool);
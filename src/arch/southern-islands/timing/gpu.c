@@ -18,6 +18,7 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 
 #include <arch/common/arch.h>
 #include <arch/southern-islands/emu/ndrange.h>
@@ -70,6 +71,14 @@ char *si_gpu_config_help =
 	"      Frequency for the Southern Islands GPU in MHz.\n"
 	"  NumComputeUnits = <num> (Default = 32)\n"
 	"      Number of compute units in the GPU.\n"
+	"  SimThreads = <num> (Default = 1)\n"
+	"      Number of host threads simulating the compute units in parallel.\n"
+	"      Each cycle, the execution units and issue stage of busy compute\n"
+	"      units run concurrently, while memory accesses, work-group\n"
+	"      completion, and instruction fetch and emulation are performed\n"
+	"      afterwards in compute unit order. Results are the same as with\n"
+	"      a single thread. Tracing and spatial reports force sequential\n"
+	"      simulation.\n"
 	"\n"
 	"Section '[ ComputeUnit ]': parameters for the Compute Units.\n"
 	"\n"
@@ -330,6 +339,7 @@ enum si_gpu_register_alloc_granularity_t si_gpu_register_alloc_granularity;
 
 /* Device parameters */
 int si_gpu_num_compute_units = 32;
+int si_gpu_sim_threads = 1;
 
 /* Compute unit parameters */
 int si_gpu_num_wavefront_pools = 4; /* Per CU */
@@ -411,6 +421,20 @@ int si_gpu_lds_num_ports = 2;
 
 struct si_gpu_t *si_gpu;
 
+/* Host threads simulating compute units in parallel */
+static struct
+{
+	pthread_t *threads;
+	pthread_barrier_t start_barrier;
+	pthread_barrier_t end_barrier;
+	int done;
+
+	/* Compute units running in the current cycle */
+	int compute_unit_count;
+	struct si_compute_unit_t **compute_units;
+} si_gpu_pool;
+
+
 /*
  * Private Functions
  */
@@ -451,6 +475,125 @@ static void si_gpu_device_init(void)
 		si_gpu_num_compute_units);
 }
 
+/* Thread 'thread_id' runs every 'si_gpu_sim_threads'-th compute unit of
+ * the current cycle. Thread 0 is the main simulation thread. */
+static void si_gpu_pool_run_units(int thread_id)
+{
+	int i;
+
+	for (i = thread_id; i < si_gpu_pool.compute_unit_count;
+			i += si_gpu_sim_threads)
+		si_compute_unit_run_units(si_gpu_pool.compute_units[i]);
+}
+
+
+static void *si_gpu_pool_thread(void *arg)
+{
+	int thread_id = (long) arg;
+
+	for (;;)
+	{
+		pthread_barrier_wait(&si_gpu_pool.start_barrier);
+		if (si_gpu_pool.done)
+			break;
+		si_gpu_pool_run_units(thread_id);
+		pthread_barrier_wait(&si_gpu_pool.end_barrier);
+	}
+	return NULL;
+}
+
+
+static void si_gpu_pool_init(void)
+{
+	long thread_id;
+
+	if (si_gpu_sim_threads < 2)
+		return;
+
+	si_gpu_pool.compute_units = xcalloc(si_gpu_num_compute_units,
+		sizeof(void *));
+	si_gpu_pool.threads = xcalloc(si_gpu_sim_threads, sizeof(pthread_t));
+	pthread_barrier_init(&si_gpu_pool.start_barrier, NULL,
+		si_gpu_sim_threads);
+	pthread_barrier_init(&si_gpu_pool.end_barrier, NULL,
+		si_gpu_sim_threads);
+	for (thread_id = 1; thread_id < si_gpu_sim_threads; thread_id++)
+	{
+		if (pthread_create(&si_gpu_pool.threads[thread_id], NULL,
+				si_gpu_pool_thread, (void *) thread_id))
+			fatal("%s: cannot create simulation thread",
+				__FUNCTION__);
+	}
+}
+
+
+static void si_gpu_pool_done(void)
+{
+	int thread_id;
+
+	if (!si_gpu_pool.threads)
+		return;
+
+	/* Wake up threads to let them exit */
+	si_gpu_pool.done = 1;
+	pthread_barrier_wait(&si_gpu_pool.start_barrier);
+	for (thread_id = 1; thread_id < si_gpu_sim_threads; thread_id++)
+		pthread_join(si_gpu_pool.threads[thread_id], NULL);
+
+	pthread_barrier_destroy(&si_gpu_pool.start_barrier);
+	pthread_barrier_destroy(&si_gpu_pool.end_barrier);
+	free(si_gpu_pool.threads);
+	free(si_gpu_pool.compute_units);
+	memset(&si_gpu_pool, 0, sizeof si_gpu_pool);
+}
+
+
+/* Run one cycle of the busy compute units in parallel. Their memory
+ * accesses, completed work-groups, and freed uops are deferred, and then
+ * replayed one compute unit at a time, followed by its fetch stage. Shared
+ * state is thus updated in the same order as in a sequential cycle. */
+static void si_gpu_run_compute_units_parallel(void)
+{
+	struct si_compute_unit_t *compute_unit;
+
+	int compute_unit_id;
+	int i;
+
+	/* Busy compute units */
+	si_gpu_pool.compute_unit_count = 0;
+	SI_GPU_FOREACH_COMPUTE_UNIT(compute_unit_id)
+	{
+		compute_unit = si_gpu->compute_units[compute_unit_id];
+		if (!compute_unit->work_group_count)
+			continue;
+		compute_unit->deferred = 1;
+		si_gpu_pool.compute_units[si_gpu_pool.compute_unit_count++] =
+			compute_unit;
+	}
+
+	/* Execution units and issue stage */
+	if (si_gpu_pool.compute_unit_count > 1)
+	{
+		pthread_barrier_wait(&si_gpu_pool.start_barrier);
+		si_gpu_pool_run_units(0);
+		pthread_barrier_wait(&si_gpu_pool.end_barrier);
+	}
+	else if (si_gpu_pool.compute_unit_count)
+	{
+		si_compute_unit_run_units(si_gpu_pool.compute_units[0]);
+	}
+
+	/* Deferred actions and fetch, in compute unit order */
+	for (i = 0; i < si_gpu_pool.compute_unit_count; i++)
+	{
+		compute_unit = si_gpu_pool.compute_units[i];
+		compute_unit->deferred = 0;
+		si_compute_unit_commit_actions(compute_unit);
+		si_compute_unit_run_fetch(compute_unit);
+	}
+}
+
+
 void si_gpu_map_ndrange(struct si_ndrange_t *ndrange)
 {
 	/* Assign current ND-Range */
@@ -492,6 +635,7 @@ void si_config_dump(FILE *f)
 	fprintf(f, "[ Config.Device ]\n");
 	fprintf(f, "Frequency = %d\n", arch_southern_islands->frequency);
 	fprintf(f, "NumComputeUnits = %d\n", si_gpu_num_compute_units);
+	fprintf(f, "SimThreads = %d\n", si_gpu_sim_threads);
 	fprintf(f, "\n");
 
 	/* Compute Unit */
@@ -652,6 +796,20 @@ void si_gpu_read_config(void)
 		fatal("%s: invalid value for 'NumComputeUnits'.\n%s", 
 			si_gpu_config_file_name, err_note);
 
+	si_gpu_sim_threads = config_read_int(gpu_config, section,
+			"SimThreads", si_gpu_sim_threads);
+	if (si_gpu_sim_threads < 1)
+		fatal("%s: invalid value for 'SimThreads'.\n%s", 
+			si_gpu_config_file_name, err_note);
+#ifdef MHANDLE
+	if (si_gpu_sim_threads > 1)
+	{
+		warning("%s: 'SimThreads' ignored, memory debugging is not "
+			"thread-safe", si_gpu_config_file_name);
+		si_gpu_sim_threads = 1;
+	}
+#endif
+
 	/* Compute Unit */
 	section = "ComputeUnit";
 
@@ -1118,6 +1276,7 @@ void si_gpu_init(void)
 	/* Initializations */
 	si_gpu_device_init();
 	si_uop_init();
+	si_gpu_pool_init();
 }
 
 
@@ -1126,6 +1285,9 @@ void si_gpu_done(void)
 	struct si_compute_unit_t *compute_unit;
 	int compute_unit_id;
 
+	/* Simulation threads */
+	si_gpu_pool_done();
+
 	/* GPU pipeline report */
 	si_gpu_dump_report();
 
@@ -1352,13 +1514,29 @@ int si_gpu_run(void)
 	if (!list_count(si_emu->waiting_work_groups))
 		opencl_si_request_work();
 
-	/* Run one loop iteration on each busy compute unit */
+	/* Run one loop iteration on each busy compute unit. Trace and
+	 * spatial report output require sequential simulation. */
+	if (si_gpu_pool.threads && !si_tracing() && !si_spatial_report_active)
+	{
+		si_gpu_run_compute_units_parallel();
+	}
+	else
+	{
+		SI_GPU_FOREACH_COMPUTE_UNIT(compute_unit_id)
+		{
+			compute_unit = si_gpu->compute_units[compute_unit_id];
+
+			/* Run one cycle */
+			si_compute_unit_run(compute_unit);
+		}
+	}
+
+	/* Last cycle when an instruction completed */
 	SI_GPU_FOREACH_COMPUTE_UNIT(compute_unit_id)
 	{
 		compute_unit = si_gpu->compute_units[compute_unit_id];
-
-		/* Run one cycle */
-		si_compute_unit_run(compute_unit);
+		si_gpu->last_complete_cycle = MAX(si_gpu->last_complete_cycle,
+			compute_unit->last_complete_cycle);
 	}
 
 	/* Still running */
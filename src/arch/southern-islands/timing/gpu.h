@@ -114,6 +114,7 @@ extern enum si_gpu_register_alloc_granularity_t
 
 extern int si_gpu_frequency;
 extern int si_gpu_num_compute_units;
+extern int si_gpu_sim_threads;
 extern int si_gpu_max_wavefronts_per_workgroup;
 
 extern int si_gpu_num_vector_registers;
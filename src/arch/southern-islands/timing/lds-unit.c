@@ -73,7 +73,8 @@ void si_lds_complete(struct si_lds_t *lds)
 
 		/* Statistics */
 		lds->inst_count++;
-		si_gpu->last_complete_cycle = arch_southern_islands->cycle;
+		lds->compute_unit->last_complete_cycle =
+			arch_southern_islands->cycle;
 	}
 }
 
@@ -232,10 +233,11 @@ void si_lds_mem(struct si_lds_t *lds)
 						work_item->lds_access_type[j]);
 				}
 
-				mod_access(lds->compute_unit->lds_module, 
+				si_compute_unit_mem_access(lds->compute_unit,
+					lds->compute_unit->lds_module, 
 					access_type, 
 					work_item_uop->lds_access_addr[j],
-					&uop->lds_witness, NULL, NULL, NULL);
+					&uop->lds_witness);
 				uop->lds_witness--;
 			}
 		}
@@ -181,7 +181,8 @@ void si_scalar_unit_complete(struct si_scalar_unit_t *scalar_unit)
 
 		/* Statistics */
 		scalar_unit->inst_count++;
-		si_gpu->last_complete_cycle = arch_southern_islands->cycle;
+		scalar_unit->compute_unit->last_complete_cycle =
+			arch_southern_islands->cycle;
 	}
 }
 
@@ -372,9 +373,10 @@ void si_scalar_unit_execute(struct si_scalar_unit_t *scalar_unit)
 			uop->global_mem_access_addr =
 				uop->wavefront->scalar_work_item->
 				global_mem_access_addr;
-			mod_access(scalar_unit->compute_unit->scalar_cache,
+			si_compute_unit_mem_access(scalar_unit->compute_unit,
+				scalar_unit->compute_unit->scalar_cache,
 				mod_access_load, uop->global_mem_access_addr,
-				&uop->global_mem_witness, NULL, NULL, NULL);
+				&uop->global_mem_witness);
 
 			/* Transfer the uop to the execution buffer */
 			list_remove(scalar_unit->read_buffer, uop);
@@ -67,7 +67,8 @@ void si_simd_complete(struct si_simd_t *simd)
 
 		/* Statistics */
 		simd->inst_count++;
-		si_gpu->last_complete_cycle = arch_southern_islands->cycle;
+		simd->compute_unit->last_complete_cycle =
+			arch_southern_islands->cycle;
 	}
 }
 
@@ -21,6 +21,7 @@
 #include <lib/util/list.h>
 #include <lib/util/repos.h>
 
+#include "compute-unit.h"
 #include "uop.h"
 
 
@@ -107,6 +108,14 @@ void si_uop_free(struct si_uop_t *gpu_uop)
 {
 	if (!gpu_uop)
 		return;
+
+	/* Compute units running in parallel return their uops to the
+	 * repository at the end of the cycle */
+	if (gpu_uop->compute_unit && gpu_uop->compute_unit->deferred)
+	{
+		si_compute_unit_defer_uop_free(gpu_uop->compute_unit, gpu_uop);
+		return;
+	}
 	repos_free_object(gpu_uop_repos, gpu_uop);
 }
 
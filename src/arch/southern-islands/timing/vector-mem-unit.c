@@ -73,7 +73,8 @@ void si_vector_mem_complete(struct si_vector_mem_unit_t *vector_mem)
 
 		/* Statistics */
 		vector_mem->inst_count++;
-		si_gpu->last_complete_cycle = arch_southern_islands->cycle;
+		vector_mem->compute_unit->last_complete_cycle =
+			arch_southern_islands->cycle;
 	}
 }
 
@@ -242,10 +243,11 @@ void si_vector_mem_mem(struct si_vector_mem_unit_t *vector_mem)
 			work_item_uop = 
 				&uop->work_item_uop[work_item->id_in_wavefront];
 
-			mod_access(vector_mem->compute_unit->vector_cache, 
+			si_compute_unit_mem_access(vector_mem->compute_unit,
+				vector_mem->compute_unit->vector_cache, 
 				access_kind, 
 				work_item_uop->global_mem_access_addr,
-				&uop->global_mem_witness, NULL, NULL, NULL);
+				&uop->global_mem_witness);
 			uop->global_mem_witness--;
 		}
 
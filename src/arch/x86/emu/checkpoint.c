@@ -22,9 +22,13 @@
 #include <stdarg.h>
 #include <zlib.h>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <arch/common/arch.h>
+#include <arch/x86/timing/cpu.h>
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/bin-config.h>
 #include <lib/util/debug.h>
@@ -32,8 +36,10 @@
 #include <lib/util/list.h>
 #include <lib/util/misc.h>
 #include <lib/util/string.h>
+#include <mem-system/mem-system.h>
 #include <mem-system/memory.h>
 
+#include "checkpoint.h"
 #include "context.h"
 #include "emu.h"
 #include "file-desc.h"
@@ -55,8 +61,11 @@ static void load_memory(struct mem_t *mem);
 static void save_memory(struct mem_t *mem);
 static void load_memory_data(struct mem_t *mem);
 static void save_memory_data(struct mem_t *mem);
+static void load_memory_ranges(struct mem_t *mem);
 static void load_memory_range(struct mem_t *mem);
+static void load_memory_page(struct mem_page_t *page);
 static void save_memory_page(struct mem_page_t *page);
+static int save_memory_blob(unsigned char *data);
 static void load_fds(struct x86_file_desc_table_t *fdt);
 static void load_fd(struct x86_file_desc_table_t *fdt);
 static void save_fds(struct x86_file_desc_table_t *fdt);
@@ -65,6 +74,8 @@ static void save_threads(struct x86_ctx_t *ctx);
 static void save_thread(struct x86_ctx_t *ctx);
 static void load_regs(struct x86_regs_t *regs);
 static void save_regs(struct x86_regs_t *regs);
+static void load_warm_state();
+static void save_warm_state();
 
 /* Configuration element stack */
 
@@ -91,7 +102,6 @@ static char * load_str_or_dflt(char *key, char *dflt);
 static struct linked_list_t *load_str_list(char *key);
 
 static void save_value(char *key, void *value, int size);
-static void save_value_no_dup(char *key, void *value, int size);
 static void save_int16(char *key, int16_t value);
 static void save_int32(char *key, int32_t value);
 static void save_str(char *key, char *str);
@@ -102,6 +112,15 @@ static void save_raw_str(char *var);
 static void check();
 static int index_of(int *array, int value, int n);
 
+/* Binary file */
+
+struct x86_checkpoint_header_t;
+
+static void file_load_init(int fd, struct x86_checkpoint_header_t *header);
+static void file_save_init(int fd);
+static void file_save_done(struct x86_checkpoint_header_t *header);
+static void file_write(void *buf, size_t size);
+
 /* Pointer to the whole checkpoint */
 struct bin_config_t *ckp;
 
@@ -118,34 +137,182 @@ static void cfg_stack_elem_free();
 struct list_t *cfg_stack;
 static int cfg_unique_num;
 
+
+/*
+ * Checkpoint file:
+ *   - Header, padded to the size of a memory page.
+ *   - Contents of all distinct non-zero memory pages, raw or compressed.
+ *   - Table of contents: one entry for every mapped page of every process,
+ *     followed by one entry for every distinct contents.
+ *   - Compressed tree with the rest of the state ('ckp'), where each process
+ *     refers to a range of entries in the table of contents.
+ * Pages are not read when loading, the file is mapped and the contents of a
+ * page are copied into its 'mem_t' on its first access.
+ */
+
+#define X86_CHECKPOINT_MAGIC  "m2s-ckp2"
+
+/* Compress page contents when saving */
+int x86_checkpoint_compress;
+
+/* Save caches, directories, prefetchers and branch predictors in detailed
+ * simulation, in element 'warm_state' */
+int x86_checkpoint_warm_state;
+
+struct x86_checkpoint_header_t
+{
+	char magic[8];
+	int num_pages;
+	int num_blobs;
+	long long toc_offset;
+	long long meta_offset;
+};
+
+/* Entry in table of contents for a mapped page */
+struct x86_checkpoint_page_t
+{
+	unsigned int addr;
+	int perm;
+	int blob;  /* Index of contents, -1 if zero */
+	int pad;
+};
+
+/* Entry in table of contents for page contents */
+struct x86_checkpoint_blob_t
+{
+	long long offset;
+	int size;  /* Less than MEM_PAGE_SIZE if compressed */
+	int pad;
+};
+
+/* Contents of a page not faulted in yet */
+struct x86_checkpoint_lazy_t
+{
+	unsigned char *data;
+	int size;
+};
+
+/* Loaded checkpoint file, mapped in memory until the end of the simulation */
+struct x86_checkpoint_image_t
+{
+	unsigned char *map;
+	size_t size;
+
+	struct x86_checkpoint_page_t *pages;
+	int num_pages;
+
+	struct x86_checkpoint_lazy_t *lazy;
+};
+
+static struct list_t *x86_checkpoint_image_list;
+
+/* Checkpoint file being loaded */
+static struct x86_checkpoint_image_t *ckp_image;
+
+/* Checkpoint file being saved */
+static struct
+{
+	int fd;
+	long long offset;
+
+	/* Table of contents */
+	struct x86_checkpoint_page_t *pages;
+	int num_pages;
+	int max_pages;
+	struct x86_checkpoint_blob_t *blobs;
+	int num_blobs;
+	int max_blobs;
+
+	/* Hash table of page contents, with indexes of 'blobs', or -1 */
+	unsigned char **blob_data;
+	unsigned int *blob_hash;
+	int *hash_table;
+	int hash_table_size;
+} ckp_file;
+
 void x86_checkpoint_load(char *file_name)
 {
+	struct x86_checkpoint_header_t header;
+	int fd;
+
 	ckp = bin_config_create(file_name);
-	bin_config_load(ckp);
+
+	/* Checkpoints in the previous format only have the compressed tree */
+	fd = open(file_name, O_RDONLY);
+	if (fd < 0)
+		fatal("%s: cannot open checkpoint", file_name);
+	if (read(fd, &header, sizeof header) == sizeof header &&
+			!memcmp(header.magic, X86_CHECKPOINT_MAGIC, sizeof header.magic))
+	{
+		file_load_init(fd, &header);
+		if (lseek(fd, header.meta_offset, SEEK_SET) != header.meta_offset)
+			fatal("%s: invalid checkpoint", file_name);
+		bin_config_load_fd(ckp, fd);
+	}
+	else
+	{
+		bin_config_load(ckp);
+	}
+	close(fd);
 	check();
 	cfg_init();
 
 	load_processes();
+	load_warm_state();
 
 	cfg_done();
 	bin_config_free(ckp);
 	ckp = NULL;
+	ckp_image = NULL;
 }
 
 void x86_checkpoint_save(char *file_name)
 {
+	struct x86_checkpoint_header_t header;
+	int fd;
+
 	ckp = bin_config_create(file_name);
+	fd = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		fatal("%s: cannot create checkpoint", file_name);
+	file_save_init(fd);
 	cfg_init();
 
 	save_processes();
+	save_warm_state();
 
-	bin_config_save(ckp);
+	/* Table of contents, tree, and header */
+	file_save_done(&header);
+	header.meta_offset = ckp_file.offset;
+	bin_config_save_fd(ckp, fd);
 	check();
+	if (pwrite(fd, &header, sizeof header, 0) != sizeof header || close(fd))
+		fatal("%s: cannot write checkpoint", file_name);
+
 	cfg_done();
 	bin_config_free(ckp);
 	ckp = NULL;
 }
 
+/* Release the checkpoint files mapped in memory. Must be called after
+ * freeing all memory images restored from them. */
+void x86_checkpoint_done(void)
+{
+	struct x86_checkpoint_image_t *image;
+
+	if (!x86_checkpoint_image_list)
+		return;
+	while (list_count(x86_checkpoint_image_list))
+	{
+		image = list_pop(x86_checkpoint_image_list);
+		munmap(image->map, image->size);
+		free(image->lazy);
+		free(image);
+	}
+	list_free(x86_checkpoint_image_list);
+	x86_checkpoint_image_list = NULL;
+}
+
 static void load_processes()
 {
 	cfg_descend("processes");
@@ -267,36 +434,53 @@ static void save_memory(struct mem_t *mem)
 
 static void load_memory_data(struct mem_t *mem)
 {
-	int old_mem_safe;
-
-	cfg_descend("ranges");
+	struct x86_checkpoint_page_t *ckp_page;
+	struct mem_page_t *page;
 
-	/* Inhibit access permission errors */
-	old_mem_safe = mem->safe;
-	mem->safe = 0;
+	int first;
+	int count;
+	int i;
 
-	while(cfg_next_child()) {
-		load_memory_range(mem);
-		cfg_pop();
+	/* Previous format */
+	if (!key_exists("num_pages"))
+	{
+		load_memory_ranges(mem);
+		return;
 	}
 
-	mem->safe = old_mem_safe;
+	first = load_int32("first_page");
+	count = load_int32("num_pages");
+	if (!ckp_image || first < 0 || count < 0 || first + count > ckp_image->num_pages)
+		fatal("Checkpoint element %s: invalid range of pages", cfg_path());
 
-	cfg_pop();
+	/* Map pages, leaving contents to be read on first access */
+	for (i = first; i < first + count; i++)
+	{
+		ckp_page = &ckp_image->pages[i];
+		if (ckp_page->addr % MEM_PAGE_SIZE)
+			fatal("Checkpoint element %s: page 0x%x not aligned",
+				cfg_path(), ckp_page->addr);
+		if (mem_page_get(mem, ckp_page->addr))
+			fatal("Checkpoint element %s duplicates "
+				"memory data for addr 0x%x",
+				cfg_path(), ckp_page->addr);
+
+		mem_map(mem, ckp_page->addr, MEM_PAGE_SIZE, ckp_page->perm);
+		if (ckp_page->blob < 0)
+			continue;
+		page = mem_page_get(mem, ckp_page->addr);
+		page->load = load_memory_page;
+		page->load_data = &ckp_image->lazy[ckp_page->blob];
+	}
 }
 
 static void save_memory_data(struct mem_t *mem)
 {
-	int old_mem_safe;
+	int first;
 	int i;
 
-	cfg_push("ranges");
-
-	/* Inhibit access permission errors */
-	old_mem_safe = mem->safe;
-	mem->safe = 0;
-
 	/* Iterate over memory pages */
+	first = ckp_file.num_pages;
 	for (i = 0; i < MEM_PAGE_COUNT; i++)
 	{
 		struct mem_page_t *page;
@@ -305,6 +489,25 @@ static void save_memory_data(struct mem_t *mem)
 			save_memory_page(page);
 	}
 
+	save_int32("first_page", first);
+	save_int32("num_pages", ckp_file.num_pages - first);
+}
+
+static void load_memory_ranges(struct mem_t *mem)
+{
+	int old_mem_safe;
+
+	cfg_descend("ranges");
+
+	/* Inhibit access permission errors */
+	old_mem_safe = mem->safe;
+	mem->safe = 0;
+
+	while(cfg_next_child()) {
+		load_memory_range(mem);
+		cfg_pop();
+	}
+
 	mem->safe = old_mem_safe;
 
 	cfg_pop();
@@ -349,17 +552,124 @@ static void load_memory_range(struct mem_t *mem)
 	}
 }
 
+/* Fill in the contents of a page on its first access */
+static void load_memory_page(struct mem_page_t *page)
+{
+	struct x86_checkpoint_lazy_t *lazy = page->load_data;
+	uLongf size;
+
+	assert(!page->data);
+	page->data = xmalloc(MEM_PAGE_SIZE);
+	if (lazy->size == MEM_PAGE_SIZE)
+	{
+		memcpy(page->data, lazy->data, MEM_PAGE_SIZE);
+		return;
+	}
+
+	size = MEM_PAGE_SIZE;
+	if (uncompress(page->data, &size, lazy->data, lazy->size) != Z_OK ||
+			size != MEM_PAGE_SIZE)
+		fatal("Checkpoint: corrupted contents of page 0x%x", page->tag);
+}
+
 static void save_memory_page(struct mem_page_t *page)
 {
-	cfg_push_unique();
+	struct x86_checkpoint_page_t *ckp_page;
+
+	if (ckp_file.num_pages == ckp_file.max_pages)
+	{
+		ckp_file.max_pages = MAX(ckp_file.max_pages * 2, 1024);
+		ckp_file.pages = xrealloc(ckp_file.pages, ckp_file.max_pages *
+			sizeof(struct x86_checkpoint_page_t));
+	}
 
-	save_int32("addr", page->tag);
-	save_int32("size", MEM_PAGE_SIZE);
-	save_int32("perm", page->perm);
-	if (page->data)
-		save_value_no_dup("data", page->data, MEM_PAGE_SIZE);
+	mem_page_load(page);
+	ckp_page = &ckp_file.pages[ckp_file.num_pages++];
+	ckp_page->addr = page->tag;
+	ckp_page->perm = page->perm;
+	ckp_page->blob = page->data ? save_memory_blob(page->data) : -1;
+}
 
-	cfg_pop();
+/* Return the index of the contents of a page in the table of contents, writing
+ * them if they are new. Zero pages have no contents (-1). */
+static int save_memory_blob(unsigned char *data)
+{
+	static unsigned char buf[2 * MEM_PAGE_SIZE];
+
+	struct x86_checkpoint_blob_t *blob;
+
+	unsigned int hash;
+	uLongf size;
+	int index;
+	int i;
+
+	/* Zero page */
+	for (i = 0; i < MEM_PAGE_SIZE; i++)
+		if (data[i])
+			break;
+	if (i == MEM_PAGE_SIZE)
+		return -1;
+
+	/* Identical to previous contents */
+	hash = 2166136261u;
+	for (i = 0; i < MEM_PAGE_SIZE; i++)
+		hash = (hash ^ data[i]) * 16777619u;
+	for (i = hash & (ckp_file.hash_table_size - 1); ckp_file.hash_table[i] >= 0;
+			i = (i + 1) & (ckp_file.hash_table_size - 1))
+	{
+		index = ckp_file.hash_table[i];
+		if (ckp_file.blob_hash[index] == hash &&
+				!memcmp(ckp_file.blob_data[index], data, MEM_PAGE_SIZE))
+			return index;
+	}
+
+	/* Grow table of contents and hash table */
+	if (ckp_file.num_blobs == ckp_file.max_blobs)
+	{
+		ckp_file.max_blobs *= 2;
+		ckp_file.blobs = xrealloc(ckp_file.blobs, ckp_file.max_blobs *
+			sizeof(struct x86_checkpoint_blob_t));
+		ckp_file.blob_data = xrealloc(ckp_file.blob_data, ckp_file.max_blobs *
+			sizeof(unsigned char *));
+		ckp_file.blob_hash = xrealloc(ckp_file.blob_hash, ckp_file.max_blobs *
+			sizeof(unsigned int));
+
+		free(ckp_file.hash_table);
+		ckp_file.hash_table_size = ckp_file.max_blobs * 2;
+		ckp_file.hash_table = xmalloc(ckp_file.hash_table_size * sizeof(int));
+		memset(ckp_file.hash_table, -1, ckp_file.hash_table_size * sizeof(int));
+		for (index = 0; index < ckp_file.num_blobs; index++)
+		{
+			for (i = ckp_file.blob_hash[index] & (ckp_file.hash_table_size - 1);
+					ckp_file.hash_table[i] >= 0;
+					i = (i + 1) & (ckp_file.hash_table_size - 1));
+			ckp_file.hash_table[i] = index;
+		}
+		for (i = hash & (ckp_file.hash_table_size - 1); ckp_file.hash_table[i] >= 0;
+				i = (i + 1) & (ckp_file.hash_table_size - 1));
+	}
+
+	/* New contents, compressed if smaller */
+	index = ckp_file.num_blobs++;
+	ckp_file.hash_table[i] = index;
+	ckp_file.blob_data[index] = data;
+	ckp_file.blob_hash[index] = hash;
+	blob = &ckp_file.blobs[index];
+	blob->offset = ckp_file.offset;
+	blob->size = MEM_PAGE_SIZE;
+	blob->pad = 0;
+	size = sizeof buf;
+	if (x86_checkpoint_compress && compress2(buf, &size, data,
+			MEM_PAGE_SIZE, Z_BEST_SPEED) == Z_OK && size < MEM_PAGE_SIZE)
+	{
+		blob->size = size;
+		file_write(buf, size);
+	}
+	else
+	{
+		file_write(data, MEM_PAGE_SIZE);
+	}
+	return index;
 }
 
 static void load_fds(struct x86_file_desc_table_t *fdt)
@@ -688,6 +998,139 @@ static int index_of(int *array, int value, int n)
 	return -1;
 }
 
+static void file_load_init(int fd, struct x86_checkpoint_header_t *header)
+{
+	struct x86_checkpoint_blob_t *blobs;
+	struct stat st;
+
+	long long size;
+	int i;
+
+	/* Map file */
+	if (fstat(fd, &st))
+		fatal("%s: cannot read checkpoint", ckp->file_name);
+	ckp_image = xcalloc(1, sizeof(struct x86_checkpoint_image_t));
+	ckp_image->size = st.st_size;
+	ckp_image->map = mmap(NULL, ckp_image->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (ckp_image->map == MAP_FAILED)
+		fatal("%s: cannot map checkpoint", ckp->file_name);
+	if (!x86_checkpoint_image_list)
+		x86_checkpoint_image_list = list_create();
+	list_add(x86_checkpoint_image_list, ckp_image);
+
+	/* Table of contents */
+	size = (long long) header->num_pages * sizeof(struct x86_checkpoint_page_t) +
+		(long long) header->num_blobs * sizeof(struct x86_checkpoint_blob_t);
+	if (header->num_pages < 0 || header->num_blobs < 0 ||
+			header->toc_offset < sizeof(struct x86_checkpoint_header_t) ||
+			header->toc_offset + size > header->meta_offset ||
+			header->meta_offset > ckp_image->size)
+		fatal("%s: invalid checkpoint", ckp->file_name);
+	ckp_image->pages = (void *) (ckp_image->map + header->toc_offset);
+	ckp_image->num_pages = header->num_pages;
+	blobs = (void *) (ckp_image->pages + header->num_pages);
+
+	/* Page contents */
+	ckp_image->lazy = xcalloc(header->num_blobs + 1, sizeof(struct x86_checkpoint_lazy_t));
+	for (i = 0; i < header->num_blobs; i++)
+	{
+		if (blobs[i].size <= 0 || blobs[i].size > MEM_PAGE_SIZE ||
+				blobs[i].offset < MEM_PAGE_SIZE ||
+				blobs[i].offset + blobs[i].size > header->toc_offset)
+			fatal("%s: invalid checkpoint", ckp->file_name);
+		ckp_image->lazy[i].data = ckp_image->map + blobs[i].offset;
+		ckp_image->lazy[i].size = blobs[i].size;
+	}
+	for (i = 0; i < header->num_pages; i++)
+		if (ckp_image->pages[i].blob >= header->num_blobs)
+			fatal("%s: invalid checkpoint", ckp->file_name);
+}
+
+static void file_save_init(int fd)
+{
+	memset(&ckp_file, 0, sizeof ckp_file);
+	ckp_file.fd = fd;
+	ckp_file.max_blobs = 1024;
+	ckp_file.blobs = xmalloc(ckp_file.max_blobs * sizeof(struct x86_checkpoint_blob_t));
+	ckp_file.blob_data = xmalloc(ckp_file.max_blobs * sizeof(unsigned char *));
+	ckp_file.blob_hash = xmalloc(ckp_file.max_blobs * sizeof(unsigned int));
+	ckp_file.hash_table_size = ckp_file.max_blobs * 2;
+	ckp_file.hash_table = xmalloc(ckp_file.hash_table_size * sizeof(int));
+	memset(ckp_file.hash_table, -1, ckp_file.hash_table_size * sizeof(int));
+
+	/* Page contents start after the header */
+	ckp_file.offset = MEM_PAGE_SIZE;
+	if (lseek(fd, ckp_file.offset, SEEK_SET) != ckp_file.offset)
+		fatal("%s: cannot write checkpoint", ckp->file_name);
+}
+
+static void file_save_done(struct x86_checkpoint_header_t *header)
+{
+	memset(header, 0, sizeof(struct x86_checkpoint_header_t));
+	memcpy(header->magic, X86_CHECKPOINT_MAGIC, sizeof header->magic);
+	header->num_pages = ckp_file.num_pages;
+	header->num_blobs = ckp_file.num_blobs;
+	header->toc_offset = ckp_file.offset;
+	file_write(ckp_file.pages, ckp_file.num_pages * sizeof(struct x86_checkpoint_page_t));
+	file_write(ckp_file.blobs, ckp_file.num_blobs * sizeof(struct x86_checkpoint_blob_t));
+
+	free(ckp_file.pages);
+	free(ckp_file.blobs);
+	free(ckp_file.blob_data);
+	free(ckp_file.blob_hash);
+	free(ckp_file.hash_table);
+}
+
+static void file_write(void *buf, size_t size)
+{
+	ssize_t count;
+
+	while (size)
+	{
+		count = write(ckp_file.fd, buf, size);
+		if (count <= 0)
+			fatal("%s: cannot write checkpoint", ckp->file_name);
+		buf += count;
+		size -= count;
+		ckp_file.offset += count;
+	}
+}
+
+static void load_warm_state()
+{
+	/* Only restored in detailed simulation */
+	if (arch_x86->sim_kind != arch_sim_kind_detailed || !cfg_try_descend("warm_state"))
+		return;
+
+	cfg_descend("mem_system");
+	mem_system_load_state(ckp, cfg_top()->elem);
+	cfg_pop();
+
+	cfg_descend("cpu");
+	x86_cpu_load_state(ckp, cfg_top()->elem);
+	cfg_pop();
+
+	cfg_pop();
+}
+
+static void save_warm_state()
+{
+	if (!x86_checkpoint_warm_state || arch_x86->sim_kind != arch_sim_kind_detailed)
+		return;
+
+	cfg_push("warm_state");
+
+	cfg_push("mem_system");
+	mem_system_save_state(ckp, cfg_top()->elem);
+	cfg_pop();
+
+	cfg_push("cpu");
+	x86_cpu_save_state(ckp, cfg_top()->elem);
+	cfg_pop();
+
+	cfg_pop();
+}
+
 static void cfg_init()
 {
 	cfg_stack = list_create();
@@ -836,12 +1279,6 @@ static void save_value(char *key, void *value, int size)
 	check();
 }
 
-static void save_value_no_dup(char *key, void *value, int size)
-{
-	bin_config_add_no_dup(ckp, cfg_top()->elem, key, value, size);
-	check();
-}
-
 #define DEF_LOAD_TYPE(type) \
 static type##_t load_##type(char *key) \
 { \
@@ -21,8 +21,12 @@
 #define ARCH_X86_EMU_CHECKPOINT_H
 
 /* Architectural state checkpoints */
+extern int x86_checkpoint_compress;
+extern int x86_checkpoint_warm_state;
+
 void x86_checkpoint_load(char *path);
 void x86_checkpoint_save(char *path);
+void x86_checkpoint_done(void);
 
 #endif
 
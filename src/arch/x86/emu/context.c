@@ -47,6 +47,7 @@
 #include "loader.h"
 #include "regs.h"
 #include "signal.h"
+#include "simpoint.h"
 #include "syscall.h"
 
 //Hugo
@@ -360,6 +361,10 @@ void x86_ctx_execute(struct x86_ctx_t *ctx)
 	/* Execute instruction */
 	x86_isa_execute_inst(ctx);
 
+	/* Basic block vectors */
+	if (x86_simpoint_bbv_prefix[0] && !spec_mode)
+		x86_simpoint_bbv_inst(ctx);
+
 	/* Statistics */
 	arch_x86->inst_count++;
 	ctx->inst_count++;
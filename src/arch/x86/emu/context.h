@@ -116,6 +116,10 @@ struct x86_ctx_t
 	int str_op_dir;  /* Direction: 1 = forward, -1 = backward */
 	int str_op_count;  /* Number of iterations in string operation */
 
+	/* Basic block being profiled for SimPoint */
+	unsigned int bbv_block_eip;  /* Address of first instruction */
+	int bbv_block_size;  /* Instructions executed so far */
+
 
 
 	/*
@@ -36,12 +36,14 @@
 #include <mem-system/mem-system.h>
 #include <mem-system/memory.h>
 
+#include "checkpoint.h"
 #include "context.h"
 #include "emu.h"
 #include "file-desc.h"
 #include "isa.h"
 #include "regs.h"
 #include "signal.h"
+#include "simpoint.h"
 #include "syscall.h"
 
 
@@ -92,6 +94,7 @@ void x86_emu_init(void)
 	/* Initialize */
 	x86_sys_init();
 	x86_isa_init();
+	x86_simpoint_init();
 
 	/* Initialize */
 	x86_emu->current_pid = 100;  /* Initial assigned pid */
@@ -140,6 +143,8 @@ void x86_emu_done(void)
 	free(x86_emu);
 
 	/* End */
+	x86_checkpoint_done();
+	x86_simpoint_done();
 	x86_isa_done();
 	x86_sys_done();
 }
@@ -765,6 +770,10 @@ int x86_emu_run(void)
 			esim_finish = esim_finish_x86_min_inst_per_ctx;
 	}
 
+	/* Save checkpoints at simulation points */
+	if (x86_simpoint_checkpoint_prefix[0])
+		x86_simpoint_checkpoint();
+
 	/* Stop if any previous reason met */
 	if (esim_finish)
 		return TRUE;
@@ -0,0 +1,689 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arch/common/arch.h>
+#include <arch/x86/timing/cpu.h>
+#include <lib/esim/esim.h>
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/debug.h>
+#include <lib/util/file.h>
+#include <lib/util/misc.h>
+#include <lib/util/string.h>
+
+#include "checkpoint.h"
+#include "context.h"
+#include "regs.h"
+#include "simpoint.h"
+
+
+/* Dimensions of the random projection applied to BBVs before clustering,
+ * and number of k-means runs with different initial centers for each k. */
+#define X86_SIMPOINT_DIMS  15
+#define X86_SIMPOINT_SEEDS  5
+#define X86_SIMPOINT_ITER_MAX  100
+
+/* A clustering with fewer clusters is chosen if its BIC score is within
+ * this fraction of the best score, as done by the SimPoint tools. */
+#define X86_SIMPOINT_BIC_THRESHOLD  0.9
+
+
+char *x86_simpoint_bbv_prefix = "";
+char *x86_simpoint_checkpoint_prefix = "";
+long long x86_simpoint_interval = 10000000;
+int x86_simpoint_max_k = 10;
+
+
+struct x86_simpoint_block_t
+{
+	unsigned int eip;  /* First instruction, 0 for empty entry */
+	int id;  /* Identifier in BBVs, starting at 1 */
+};
+
+struct x86_simpoint_point_t
+{
+	long long interval;
+	int cluster;
+};
+
+struct x86_simpoint_t
+{
+	/* Hash table of basic blocks, indexed by address */
+	struct x86_simpoint_block_t *blocks;
+	int blocks_size;
+	int blocks_count;
+
+	/* Instructions executed in current interval, indexed by block
+	 * identifier, and identifiers of blocks executed in it. */
+	long long *counts;
+	int counts_size;
+	int *touched;
+	int touched_size;
+	int touched_count;
+
+	/* Current interval */
+	long long inst_count;
+	FILE *bb_file;
+
+	/* Projected BBV and instruction count of every finished interval */
+	double *vectors;
+	long long *vector_inst;
+	int vectors_size;
+	int vectors_count;
+
+	/* Checkpoints to save, sorted by interval */
+	struct x86_simpoint_point_t *points;
+	int points_count;
+	int points_next;
+};
+
+static struct x86_simpoint_t *x86_simpoint;
+
+
+
+
+/*
+ * Private Functions
+ */
+
+/* Deterministic pseudo-random numbers, so that two profiling runs of the
+ * same program choose the same simulation points. */
+static unsigned int x86_simpoint_hash(unsigned int x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
+
+
+/* Entry of the random projection matrix for block 'id' and dimension 'dim',
+ * uniform in [-1, 1]. */
+static double x86_simpoint_projection(int id, int dim)
+{
+	unsigned int x;
+
+	x = x86_simpoint_hash(id * X86_SIMPOINT_DIMS + dim + 1);
+	return (double) x / 0x7fffffffU - 1.0;
+}
+
+
+/* Hash table entry for address 'eip', either holding it or empty */
+static struct x86_simpoint_block_t *x86_simpoint_block_find(unsigned int eip)
+{
+	int i;
+
+	i = x86_simpoint_hash(eip) & (x86_simpoint->blocks_size - 1);
+	while (x86_simpoint->blocks[i].eip && x86_simpoint->blocks[i].eip != eip)
+		i = (i + 1) & (x86_simpoint->blocks_size - 1);
+	return &x86_simpoint->blocks[i];
+}
+
+
+/* Return the identifier of the block starting at 'eip', allocating one for
+ * new blocks. */
+static int x86_simpoint_block_id(unsigned int eip)
+{
+	struct x86_simpoint_block_t *block;
+	struct x86_simpoint_block_t *old_blocks;
+
+	int old_size;
+	int i;
+
+	/* Existing block */
+	block = x86_simpoint_block_find(eip);
+	if (block->eip)
+		return block->id;
+
+	/* Grow table when half full */
+	if ((x86_simpoint->blocks_count + 1) * 2 > x86_simpoint->blocks_size)
+	{
+		old_blocks = x86_simpoint->blocks;
+		old_size = x86_simpoint->blocks_size;
+		x86_simpoint->blocks_size *= 2;
+		x86_simpoint->blocks = xcalloc(x86_simpoint->blocks_size,
+			sizeof(struct x86_simpoint_block_t));
+		for (i = 0; i < old_size; i++)
+			if (old_blocks[i].eip)
+				*x86_simpoint_block_find(old_blocks[i].eip) = old_blocks[i];
+		free(old_blocks);
+		block = x86_simpoint_block_find(eip);
+	}
+
+	/* Grow interval counters */
+	if (x86_simpoint->blocks_count + 1 >= x86_simpoint->counts_size)
+	{
+		x86_simpoint->counts = xrealloc(x86_simpoint->counts,
+			x86_simpoint->counts_size * 2 * sizeof(long long));
+		memset(&x86_simpoint->counts[x86_simpoint->counts_size], 0,
+			x86_simpoint->counts_size * sizeof(long long));
+		x86_simpoint->counts_size *= 2;
+	}
+
+	/* New block */
+	block->eip = eip;
+	block->id = ++x86_simpoint->blocks_count;
+	return block->id;
+}
+
+
+static void x86_simpoint_block_add(unsigned int eip, int size)
+{
+	int id;
+
+	/* First time in interval */
+	id = x86_simpoint_block_id(eip);
+	if (!x86_simpoint->counts[id])
+	{
+		if (x86_simpoint->touched_count == x86_simpoint->touched_size)
+		{
+			x86_simpoint->touched_size = MAX(1024, x86_simpoint->touched_size * 2);
+			x86_simpoint->touched = xrealloc(x86_simpoint->touched,
+				x86_simpoint->touched_size * sizeof(int));
+		}
+		x86_simpoint->touched[x86_simpoint->touched_count++] = id;
+	}
+	x86_simpoint->counts[id] += size;
+}
+
+
+/* Dump the BBV of the current interval and store its projection */
+static void x86_simpoint_interval_end(void)
+{
+	double *vector;
+	long long total;
+
+	int dim;
+	int id;
+	int i;
+
+	/* Room for a new vector */
+	if (x86_simpoint->vectors_count == x86_simpoint->vectors_size)
+	{
+		x86_simpoint->vectors_size = MAX(256, x86_simpoint->vectors_size * 2);
+		x86_simpoint->vectors = xrealloc(x86_simpoint->vectors,
+			x86_simpoint->vectors_size * X86_SIMPOINT_DIMS * sizeof(double));
+		x86_simpoint->vector_inst = xrealloc(x86_simpoint->vector_inst,
+			x86_simpoint->vectors_size * sizeof(long long));
+	}
+	vector = &x86_simpoint->vectors[x86_simpoint->vectors_count * X86_SIMPOINT_DIMS];
+	x86_simpoint->vector_inst[x86_simpoint->vectors_count] = x86_simpoint->inst_count;
+	x86_simpoint->vectors_count++;
+
+	/* Dump BBV */
+	total = 0;
+	fprintf(x86_simpoint->bb_file, "T");
+	for (i = 0; i < x86_simpoint->touched_count; i++)
+	{
+		id = x86_simpoint->touched[i];
+		fprintf(x86_simpoint->bb_file, ":%d:%lld ", id, x86_simpoint->counts[id]);
+		total += x86_simpoint->counts[id];
+	}
+	fprintf(x86_simpoint->bb_file, "\n");
+
+	/* Project normalized BBV */
+	memset(vector, 0, X86_SIMPOINT_DIMS * sizeof(double));
+	for (i = 0; i < x86_simpoint->touched_count; i++)
+	{
+		id = x86_simpoint->touched[i];
+		for (dim = 0; dim < X86_SIMPOINT_DIMS; dim++)
+			vector[dim] += (double) x86_simpoint->counts[id] / total *
+				x86_simpoint_projection(id, dim);
+		x86_simpoint->counts[id] = 0;
+	}
+
+	/* Next interval */
+	x86_simpoint->touched_count = 0;
+	x86_simpoint->inst_count = 0;
+}
+
+
+static double x86_simpoint_dist(double *a, double *b)
+{
+	double dist;
+	int dim;
+
+	dist = 0.0;
+	for (dim = 0; dim < X86_SIMPOINT_DIMS; dim++)
+		dist += (a[dim] - b[dim]) * (a[dim] - b[dim]);
+	return dist;
+}
+
+
+/* Run k-means once, with initial centers chosen furthest-first from
+ * interval 'first'. Return the distortion. */
+static double x86_simpoint_kmeans_run(int k, int first, int *assign, double *centers)
+{
+	double *vectors = x86_simpoint->vectors;
+	double *min_dist;
+	double distortion;
+	double dist;
+
+	int count = x86_simpoint->vectors_count;
+	int *cluster_size;
+	int changed;
+	int iter;
+	int best;
+	int i;
+	int j;
+	int dim;
+
+	min_dist = xcalloc(count, sizeof(double));
+	cluster_size = xcalloc(k, sizeof(int));
+
+	/* Initial centers */
+	memcpy(centers, &vectors[first * X86_SIMPOINT_DIMS], X86_SIMPOINT_DIMS * sizeof(double));
+	for (i = 0; i < count; i++)
+		min_dist[i] = x86_simpoint_dist(&vectors[i * X86_SIMPOINT_DIMS], centers);
+	for (j = 1; j < k; j++)
+	{
+		best = 0;
+		for (i = 1; i < count; i++)
+			if (min_dist[i] > min_dist[best])
+				best = i;
+		memcpy(&centers[j * X86_SIMPOINT_DIMS], &vectors[best * X86_SIMPOINT_DIMS],
+			X86_SIMPOINT_DIMS * sizeof(double));
+		for (i = 0; i < count; i++)
+			min_dist[i] = MIN(min_dist[i], x86_simpoint_dist(&vectors[i * X86_SIMPOINT_DIMS],
+				&centers[j * X86_SIMPOINT_DIMS]));
+	}
+
+	/* Iterate */
+	for (i = 0; i < count; i++)
+		assign[i] = -1;
+	distortion = 0.0;
+	for (iter = 0; iter < X86_SIMPOINT_ITER_MAX; iter++)
+	{
+		/* Assign intervals to closest center */
+		changed = 0;
+		distortion = 0.0;
+		for (i = 0; i < count; i++)
+		{
+			best = 0;
+			min_dist[i] = x86_simpoint_dist(&vectors[i * X86_SIMPOINT_DIMS], centers);
+			for (j = 1; j < k; j++)
+			{
+				dist = x86_simpoint_dist(&vectors[i * X86_SIMPOINT_DIMS],
+					&centers[j * X86_SIMPOINT_DIMS]);
+				if (dist < min_dist[i])
+				{
+					min_dist[i] = dist;
+					best = j;
+				}
+			}
+			changed |= assign[i] != best;
+			assign[i] = best;
+			distortion += min_dist[i];
+		}
+		if (!changed)
+			break;
+
+		/* Move centers. Empty clusters keep their old center. */
+		memset(cluster_size, 0, k * sizeof(int));
+		for (i = 0; i < count; i++)
+			cluster_size[assign[i]]++;
+		for (j = 0; j < k; j++)
+			if (cluster_size[j])
+				memset(&centers[j * X86_SIMPOINT_DIMS], 0, X86_SIMPOINT_DIMS * sizeof(double));
+		for (i = 0; i < count; i++)
+			for (dim = 0; dim < X86_SIMPOINT_DIMS; dim++)
+				centers[assign[i] * X86_SIMPOINT_DIMS + dim] +=
+					vectors[i * X86_SIMPOINT_DIMS + dim] / cluster_size[assign[i]];
+	}
+
+	free(min_dist);
+	free(cluster_size);
+	return distortion;
+}
+
+
+/* Best of several k-means runs. Return the distortion. */
+static double x86_simpoint_kmeans(int k, int *assign, double *centers)
+{
+	double distortion;
+	double best_distortion;
+	double *run_centers;
+
+	int count = x86_simpoint->vectors_count;
+	int *run_assign;
+	int seed;
+
+	run_assign = xcalloc(count, sizeof(int));
+	run_centers = xcalloc(k * X86_SIMPOINT_DIMS, sizeof(double));
+	best_distortion = DBL_MAX;
+	for (seed = 0; seed < X86_SIMPOINT_SEEDS; seed++)
+	{
+		distortion = x86_simpoint_kmeans_run(k,
+			x86_simpoint_hash(k * X86_SIMPOINT_SEEDS + seed) % count,
+			run_assign, run_centers);
+		if (distortion < best_distortion)
+		{
+			best_distortion = distortion;
+			memcpy(assign, run_assign, count * sizeof(int));
+			memcpy(centers, run_centers, k * X86_SIMPOINT_DIMS * sizeof(double));
+		}
+	}
+	free(run_assign);
+	free(run_centers);
+	return best_distortion;
+}
+
+
+/* Bayesian Information Criterion of a clustering, assuming spherical
+ * Gaussian clusters with a common variance (Pelleg and Moore, X-means). */
+static double x86_simpoint_bic(int k, int *assign, double distortion)
+{
+	double variance;
+	double likelihood;
+	double params;
+
+	int count = x86_simpoint->vectors_count;
+	int *cluster_size;
+	int i;
+
+	cluster_size = xcalloc(k, sizeof(int));
+	for (i = 0; i < count; i++)
+		cluster_size[assign[i]]++;
+
+	variance = count > k ? distortion / (count - k) : 0.0;
+	variance = MAX(variance, 1e-12);
+	likelihood = -count * log(count) - count / 2.0 * log(2.0 * M_PI)
+		- count * X86_SIMPOINT_DIMS / 2.0 * log(variance) - (count - k) / 2.0;
+	for (i = 0; i < k; i++)
+		if (cluster_size[i])
+			likelihood += cluster_size[i] * log(cluster_size[i]);
+	params = k - 1 + X86_SIMPOINT_DIMS * k + 1;
+
+	free(cluster_size);
+	return likelihood - params / 2.0 * log(count);
+}
+
+
+/* Cluster the BBVs and write simulation points and weights */
+static void x86_simpoint_cluster(void)
+{
+	char file_name[MAX_PATH_SIZE];
+
+	FILE *simpoints_file;
+	FILE *weights_file;
+
+	double *centers;
+	double *bic;
+	double *min_dist;
+	double bic_min;
+	double bic_max;
+	double dist;
+
+	long long *cluster_inst;
+	long long total_inst;
+
+	int count = x86_simpoint->vectors_count;
+	int *assign;
+	int *rep;
+	int max_k;
+	int k;
+	int i;
+
+	/* BIC score for each number of clusters */
+	max_k = MIN(x86_simpoint_max_k, count);
+	assign = xcalloc(count, sizeof(int));
+	centers = xcalloc(max_k * X86_SIMPOINT_DIMS, sizeof(double));
+	bic = xcalloc(max_k + 1, sizeof(double));
+	bic_min = DBL_MAX;
+	bic_max = -DBL_MAX;
+	for (k = 1; k <= max_k; k++)
+	{
+		dist = x86_simpoint_kmeans(k, assign, centers);
+		bic[k] = x86_simpoint_bic(k, assign, dist);
+		bic_min = MIN(bic_min, bic[k]);
+		bic_max = MAX(bic_max, bic[k]);
+	}
+
+	/* Smallest k with a good enough score */
+	for (k = 1; k < max_k; k++)
+		if (bic[k] >= bic_min + X86_SIMPOINT_BIC_THRESHOLD * (bic_max - bic_min))
+			break;
+	x86_simpoint_kmeans(k, assign, centers);
+
+	/* Representative interval of each cluster is the closest to its center */
+	rep = xcalloc(k, sizeof(int));
+	min_dist = xcalloc(k, sizeof(double));
+	cluster_inst = xcalloc(k, sizeof(long long));
+	total_inst = 0;
+	for (i = 0; i < k; i++)
+	{
+		rep[i] = -1;
+		min_dist[i] = DBL_MAX;
+	}
+	for (i = 0; i < count; i++)
+	{
+		dist = x86_simpoint_dist(&x86_simpoint->vectors[i * X86_SIMPOINT_DIMS],
+			&centers[assign[i] * X86_SIMPOINT_DIMS]);
+		if (dist < min_dist[assign[i]])
+		{
+			min_dist[assign[i]] = dist;
+			rep[assign[i]] = i;
+		}
+		cluster_inst[assign[i]] += x86_simpoint->vector_inst[i];
+		total_inst += x86_simpoint->vector_inst[i];
+	}
+
+	/* Simulation points */
+	snprintf(file_name, sizeof file_name, "%s.simpoints", x86_simpoint_bbv_prefix);
+	simpoints_file = file_open_for_write(file_name);
+	if (!simpoints_file)
+		fatal("%s: cannot open file for simulation points", file_name);
+	snprintf(file_name, sizeof file_name, "%s.weights", x86_simpoint_bbv_prefix);
+	weights_file = file_open_for_write(file_name);
+	if (!weights_file)
+		fatal("%s: cannot open file for simulation point weights", file_name);
+	for (i = 0; i < k; i++)
+	{
+		if (rep[i] < 0)
+			continue;
+		fprintf(simpoints_file, "%d %d\n", rep[i], i);
+		fprintf(weights_file, "%.6f %d\n", (double) cluster_inst[i] / total_inst, i);
+	}
+	file_close(simpoints_file);
+	file_close(weights_file);
+
+	/* Free */
+	free(assign);
+	free(centers);
+	free(bic);
+	free(rep);
+	free(min_dist);
+	free(cluster_inst);
+}
+
+
+static int x86_simpoint_point_compare(const void *ptr1, const void *ptr2)
+{
+	const struct x86_simpoint_point_t *point1 = ptr1;
+	const struct x86_simpoint_point_t *point2 = ptr2;
+
+	if (point1->interval != point2->interval)
+		return point1->interval < point2->interval ? -1 : 1;
+	return point1->cluster - point2->cluster;
+}
+
+
+/* Read simulation points produced by a profiling run */
+static void x86_simpoint_read_points(void)
+{
+	char file_name[MAX_PATH_SIZE];
+
+	struct x86_simpoint_point_t point;
+	FILE *f;
+
+	int size;
+
+	snprintf(file_name, sizeof file_name, "%s.simpoints", x86_simpoint_checkpoint_prefix);
+	f = file_open_for_read(file_name);
+	if (!f)
+		fatal("%s: cannot read simulation points", file_name);
+
+	size = 0;
+	while (fscanf(f, "%lld %d", &point.interval, &point.cluster) == 2)
+	{
+		if (point.interval < 0 || point.cluster < 0)
+			fatal("%s: invalid simulation point", file_name);
+		if (x86_simpoint->points_count == size)
+		{
+			size = MAX(16, size * 2);
+			x86_simpoint->points = xrealloc(x86_simpoint->points,
+				size * sizeof(struct x86_simpoint_point_t));
+		}
+		x86_simpoint->points[x86_simpoint->points_count++] = point;
+	}
+	if (!feof(f))
+		fatal("%s: invalid format for simulation points", file_name);
+	file_close(f);
+
+	if (!x86_simpoint->points_count)
+		fatal("%s: no simulation points", file_name);
+	qsort(x86_simpoint->points, x86_simpoint->points_count,
+		sizeof(struct x86_simpoint_point_t), x86_simpoint_point_compare);
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
+void x86_simpoint_init(void)
+{
+	char file_name[MAX_PATH_SIZE];
+
+	if (!x86_simpoint_bbv_prefix[0] && !x86_simpoint_checkpoint_prefix[0])
+		return;
+	if (x86_simpoint_interval <= 0)
+		fatal("invalid SimPoint interval size");
+	if (x86_simpoint_max_k <= 0)
+		fatal("invalid maximum number of SimPoint clusters");
+
+	/* Create */
+	x86_simpoint = xcalloc(1, sizeof(struct x86_simpoint_t));
+
+	/* Profiling */
+	if (x86_simpoint_bbv_prefix[0])
+	{
+		snprintf(file_name, sizeof file_name, "%s.bb", x86_simpoint_bbv_prefix);
+		x86_simpoint->bb_file = file_open_for_write(file_name);
+		if (!x86_simpoint->bb_file)
+			fatal("%s: cannot open file for basic block vectors", file_name);
+		x86_simpoint->blocks_size = 1024;
+		x86_simpoint->blocks = xcalloc(x86_simpoint->blocks_size,
+			sizeof(struct x86_simpoint_block_t));
+		x86_simpoint->counts_size = 1024;
+		x86_simpoint->counts = xcalloc(x86_simpoint->counts_size, sizeof(long long));
+	}
+
+	/* Checkpoints are taken between instructions, which only happens in
+	 * functional simulation. */
+	if (x86_simpoint_checkpoint_prefix[0])
+	{
+		if (arch_x86->sim_kind != arch_sim_kind_functional)
+			fatal("SimPoint checkpoints can only be created in x86 functional simulation");
+		x86_simpoint_read_points();
+	}
+}
+
+
+void x86_simpoint_done(void)
+{
+	if (!x86_simpoint)
+		return;
+
+	/* Last interval counts only if it is not too short */
+	if (x86_simpoint->bb_file)
+	{
+		if (x86_simpoint->inst_count * 2 >= x86_simpoint_interval ||
+				(x86_simpoint->inst_count && !x86_simpoint->vectors_count))
+			x86_simpoint_interval_end();
+		file_close(x86_simpoint->bb_file);
+		if (x86_simpoint->vectors_count)
+			x86_simpoint_cluster();
+		else
+			warning("no basic block vectors collected, no simulation points created");
+	}
+
+	/* Free */
+	free(x86_simpoint->blocks);
+	free(x86_simpoint->counts);
+	free(x86_simpoint->touched);
+	free(x86_simpoint->vectors);
+	free(x86_simpoint->vector_inst);
+	free(x86_simpoint->points);
+	free(x86_simpoint);
+	x86_simpoint = NULL;
+}
+
+
+/* Account for a non-speculative instruction just executed by 'ctx'. A basic
+ * block ends at any instruction not followed by the next one in memory. */
+void x86_simpoint_bbv_inst(struct x86_ctx_t *ctx)
+{
+	if (!ctx->bbv_block_size)
+		ctx->bbv_block_eip = ctx->curr_eip;
+	ctx->bbv_block_size++;
+	if (ctx->regs->eip != ctx->curr_eip + ctx->inst.size)
+	{
+		x86_simpoint_block_add(ctx->bbv_block_eip, ctx->bbv_block_size);
+		ctx->bbv_block_size = 0;
+	}
+
+	/* End of interval */
+	x86_simpoint->inst_count++;
+	if (x86_simpoint->inst_count == x86_simpoint_interval)
+		x86_simpoint_interval_end();
+}
+
+
+/* Save the checkpoints for simulation points starting at the current
+ * instruction, and stop after the last one. */
+void x86_simpoint_checkpoint(void)
+{
+	char file_name[MAX_PATH_SIZE];
+
+	struct x86_simpoint_point_t *point;
+	long long start;
+
+	while (x86_simpoint->points_next < x86_simpoint->points_count)
+	{
+		point = &x86_simpoint->points[x86_simpoint->points_next];
+		start = MAX(0, point->interval * x86_simpoint_interval - x86_cpu_warm_up_count);
+		if (arch_x86->inst_count < start)
+			return;
+
+		snprintf(file_name, sizeof file_name, "%s.%d.ckp",
+			x86_simpoint_checkpoint_prefix, point->cluster);
+		x86_checkpoint_save(file_name);
+		x86_simpoint->points_next++;
+	}
+	esim_finish = esim_finish_x86_simpoints;
+}
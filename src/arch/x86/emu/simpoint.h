@@ -0,0 +1,54 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ARCH_X86_EMU_SIMPOINT_H
+#define ARCH_X86_EMU_SIMPOINT_H
+
+
+/*
+ * SimPoint sampled simulation.
+ *
+ * Profiling run ('x86_simpoint_bbv_prefix' set): the non-speculative
+ * instruction stream is split in intervals of 'x86_simpoint_interval'
+ * instructions, and a basic block vector (BBV) is dumped for each interval
+ * in '<prefix>.bb', in the format used by the SimPoint tools. At the end of
+ * the run, the BBVs are clustered with k-means, and one simulation point per
+ * cluster is written in '<prefix>.simpoints' and '<prefix>.weights'.
+ *
+ * Checkpoint run ('x86_simpoint_checkpoint_prefix' set): functional
+ * simulation reads '<prefix>.simpoints' and saves a checkpoint in
+ * '<prefix>.<cluster>.ckp' at the beginning of each simulation point, or
+ * 'x86_cpu_warm_up_count' instructions before it.
+ */
+
+struct x86_ctx_t;
+
+extern char *x86_simpoint_bbv_prefix;
+extern char *x86_simpoint_checkpoint_prefix;
+extern long long x86_simpoint_interval;
+extern int x86_simpoint_max_k;
+
+void x86_simpoint_init(void);
+void x86_simpoint_done(void);
+
+void x86_simpoint_bbv_inst(struct x86_ctx_t *ctx);
+void x86_simpoint_checkpoint(void);
+
+
+#endif
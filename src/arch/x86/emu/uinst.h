@@ -282,6 +282,12 @@ struct x86_uinst_t
 
 	/* Cycles lost due interthread interference in dram modules */
 	long long dram_interthread_penalty_cycles;
+
+	/* Same as above, not cleared when accounted for in dispatch stalls */
+	long long dram_interthread_cycles;
+
+	/* Deepest level of the memory hierarchy reached by this access */
+	int mem_level;
 };
 
 
@@ -18,14 +18,19 @@
  */
 
 #include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <lib/mhandle/mhandle.h>
+#include <lib/util/bin-config.h>
 #include <lib/util/debug.h>
 #include <lib/util/misc.h>
 #include <lib/util/string.h>
 
 #include "bpred.h"
 #include "cpu.h"
+#include "trace-cache.h"
 #include "uop.h"
 
 
@@ -36,10 +41,69 @@ struct btb_entry_t
 {
 	unsigned int source;  /* eip */
 	unsigned int target;  /* neip */
+	int uncond;  /* Unconditional branch */
 	int counter;  /* LRU counter */
 };
 
 
+/* Global history of conditional branches for the TAGE-SC-L and perceptron
+ * predictors. The outcomes are stored in a circular buffer, the most recent
+ * at position 'ptr'. Predictors use long histories folded into the width of
+ * their table indexes and tags, updated incrementally as new outcomes are
+ * inserted. */
+#define X86_BPRED_HIST_BUFFER_SIZE  2048
+#define X86_BPRED_HIST_MAX  1000
+#define X86_BPRED_FOLDS_MAX  (X86_BPRED_TABLES_MAX * 3)
+
+struct x86_bpred_fold_t
+{
+	unsigned int value;
+	int length;  /* Number of outcomes folded */
+	int width;  /* Bits of 'value' */
+};
+
+struct x86_bpred_hist_t
+{
+	int ptr;
+	unsigned int path;  /* One bit of the address of the last 16 branches */
+	unsigned long long recent;  /* Last 64 outcomes */
+	struct x86_bpred_fold_t fold[X86_BPRED_FOLDS_MAX];
+};
+
+
+/* TAGE tagged table entry */
+struct x86_bpred_tage_entry_t
+{
+	signed char ctr;  /* 3-bit signed counter, taken if >= 0 */
+	unsigned char u;  /* 2-bit useful counter */
+	unsigned short tag;
+};
+
+/* Loop predictor entry */
+struct x86_bpred_loop_t
+{
+	unsigned short tag;
+	unsigned short past_iter;  /* Iterations in the last execution of the loop */
+	unsigned short current_iter;  /* Iterations in the current execution */
+	unsigned char conf;  /* Number of times 'past_iter' was repeated */
+	unsigned char age;
+	unsigned char dir;  /* Direction in the loop body */
+};
+
+#define X86_BPRED_TAGE_CTR_MAX  3
+#define X86_BPRED_TAGE_CTR_MIN  -4
+#define X86_BPRED_TAGE_U_MAX  3
+#define X86_BPRED_TAGE_U_RESET  (1 << 18)  /* Branches between useful counter aging */
+#define X86_BPRED_SC_WEIGHT_MAX  31
+#define X86_BPRED_SC_WEIGHT_MIN  -32
+#define X86_BPRED_LOOP_ASSOC  4
+#define X86_BPRED_LOOP_ITER_MAX  0x3fff
+#define X86_BPRED_LOOP_CONF_MAX  3
+#define X86_BPRED_LOOP_AGE_MAX  31
+#define X86_BPRED_PERCEPTRON_WEIGHT_MAX  127
+#define X86_BPRED_PERCEPTRON_WEIGHT_MIN  -128
+
+
 /* Branch Predictor Structure */
 struct x86_bpred_t
 {
@@ -68,13 +132,41 @@ struct x86_bpred_t
 	 *   2,3 - Use two-level adaptive predictor */
 	char *choice;
 
+	/* Global history for TAGE-SC-L and perceptron */
+	char *hist_bits;
+	struct x86_bpred_hist_t hist;
+	int fold_count;
+
+	/* TAGE - base bimodal table of 2-bit counters, and tagged tables indexed
+	 * with increasing history lengths. */
+	char *tage_base;
+	struct x86_bpred_tage_entry_t *tage_table[X86_BPRED_TABLES_MAX];
+	int tage_use_alt;  /* Use alternate prediction on newly allocated entries */
+	int tage_tick;  /* Updates since last aging of useful counters */
+	unsigned int tage_seed;  /* Pseudo-random allocation */
+
+	/* Statistical corrector */
+	signed char *sc_table[X86_BPRED_SC_TABLES];
+	int sc_threshold;
+	int sc_threshold_ctr;
+
+	/* Loop predictor */
+	struct x86_bpred_loop_t *loop;
+	int loop_use;  /* Confidence in the loop predictor when it disagrees */
+
+	/* Hashed perceptron */
+	signed char *perceptron_table[X86_BPRED_TABLES_MAX];
+	int perceptron_theta;
+	int perceptron_theta_ctr;
+
 	/* Stats */
 	long long accesses;
 	long long hits;
 };
 
 
-char *x86_bpred_kind_map[] = { "Perfect", "Taken", "NotTaken", "Bimodal", "TwoLevel", "Combined" };
+char *x86_bpred_kind_map[] = { "Perfect", "Taken", "NotTaken", "Bimodal", "TwoLevel",
+	"Combined", "TAGE", "Perceptron" };
 enum x86_bpred_kind_t x86_bpred_kind;
 int x86_bpred_btb_sets;  /* Number of BTB sets */
 int x86_bpred_btb_assoc;  /* Number of BTB ways */
@@ -87,6 +179,548 @@ int x86_bpred_twolevel_l2size;  /* Two-level adaptive predictor: level-2 size */
 int x86_bpred_twolevel_hist_size;  /* Two-level adaptive predictor: level-2 history size */
 static int x86_bpred_twolevel_l2height;
 
+int x86_bpred_tage_tables;  /* Number of tagged tables */
+int x86_bpred_tage_table_size;  /* Entries per tagged table */
+int x86_bpred_tage_base_size;  /* Entries of the base bimodal table */
+int x86_bpred_tage_tag_bits;  /* Tag width */
+int x86_bpred_tage_min_hist;  /* History length of the first tagged table */
+int x86_bpred_tage_max_hist;  /* History length of the last tagged table */
+int x86_bpred_sc_size;  /* Entries per statistical corrector table, 0 = none */
+int x86_bpred_loop_size;  /* Entries of the loop predictor, 0 = none */
+static int x86_bpred_tage_hist_len[X86_BPRED_TABLES_MAX];
+
+int x86_bpred_perceptron_tables;  /* Number of weight tables */
+int x86_bpred_perceptron_size;  /* Weights per table */
+int x86_bpred_perceptron_hist_size;  /* History length of the last table */
+static int x86_bpred_perceptron_hist_len[X86_BPRED_TABLES_MAX];
+
+/* History lengths of the statistical corrector tables */
+static int x86_bpred_sc_hist_len[X86_BPRED_SC_TABLES] = { 0, 4, 8, 12 };
+
+
+
+
+/*
+ * Private functions
+ */
+
+static unsigned int x86_bpred_hash(unsigned int a, unsigned int b)
+{
+	a ^= b * 0x9e3779b1;
+	a ^= a >> 15;
+	a *= 0x85ebca6b;
+	a ^= a >> 13;
+	return a;
+}
+
+
+static void x86_bpred_fold_init(struct x86_bpred_fold_t *fold, int length, int width)
+{
+	assert(length < X86_BPRED_HIST_BUFFER_SIZE - 32);
+	assert(width > 0 && width < 32);
+	fold->value = 0;
+	fold->length = length;
+	fold->width = width;
+}
+
+
+/* Insert the outcome of a conditional branch in a global history. Argument
+ * 'hist' can be a copy of the predictor's history, used to predict several
+ * branches ahead. Its outcomes are written in free positions of the buffer. */
+static void x86_bpred_hist_push(struct x86_bpred_t *bpred, struct x86_bpred_hist_t *hist,
+	unsigned int eip, int taken)
+{
+	struct x86_bpred_fold_t *fold;
+	char *bits = bpred->hist_bits;
+	int i;
+
+	hist->ptr = (hist->ptr - 1) & (X86_BPRED_HIST_BUFFER_SIZE - 1);
+	bits[hist->ptr] = taken;
+	hist->recent = (hist->recent << 1) | taken;
+	hist->path = ((hist->path << 1) | ((eip ^ (eip >> 2) ^ (eip >> 4)) & 1)) & 0xffff;
+
+	for (i = 0; i < bpred->fold_count; i++)
+	{
+		fold = &hist->fold[i];
+		fold->value = (fold->value << 1) | taken;
+		fold->value ^= bits[(hist->ptr + fold->length) & (X86_BPRED_HIST_BUFFER_SIZE - 1)]
+			<< (fold->length % fold->width);
+		fold->value ^= fold->value >> fold->width;
+		fold->value &= (1 << fold->width) - 1;
+	}
+}
+
+
+/* Lengths in geometric progression from 'min' to 'max' */
+static void x86_bpred_geometric(int *len, int count, int min, int max)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		len[i] = count == 1 ? min : (int) (min * pow((double) max / min,
+			(double) i / (count - 1)) + 0.5);
+}
+
+
+static int x86_bpred_tage_index(struct x86_bpred_t *bpred, struct x86_bpred_hist_t *hist,
+	unsigned int eip, int table)
+{
+	int log_size = log_base2(x86_bpred_tage_table_size);
+	unsigned int path;
+	unsigned int index;
+
+	path = hist->path & ((1 << MIN(x86_bpred_tage_hist_len[table], 16)) - 1);
+	index = eip ^ (eip >> log_size) ^ hist->fold[table * 3].value ^
+		path ^ (path >> (log_size - table % log_size));
+	return index & (x86_bpred_tage_table_size - 1);
+}
+
+
+static int x86_bpred_tage_tag(struct x86_bpred_t *bpred, struct x86_bpred_hist_t *hist,
+	unsigned int eip, int table)
+{
+	unsigned int tag;
+
+	tag = eip ^ hist->fold[table * 3 + 1].value ^ (hist->fold[table * 3 + 2].value << 1);
+	return tag & ((1 << x86_bpred_tage_tag_bits) - 1);
+}
+
+
+/* Loop predictor way holding branch 'eip', or NULL */
+static struct x86_bpred_loop_t *x86_bpred_loop_find(struct x86_bpred_t *bpred,
+	unsigned int eip, struct x86_bpred_loop_t **set_ptr, unsigned short *tag_ptr)
+{
+	struct x86_bpred_loop_t *set;
+	int num_sets;
+	int way;
+
+	num_sets = x86_bpred_loop_size / X86_BPRED_LOOP_ASSOC;
+	set = &bpred->loop[((eip ^ (eip >> 4)) & (num_sets - 1)) * X86_BPRED_LOOP_ASSOC];
+	*set_ptr = set;
+	*tag_ptr = (eip >> log_base2(num_sets)) & 0x3ff;
+	for (way = 0; way < X86_BPRED_LOOP_ASSOC; way++)
+		if (set[way].conf || set[way].past_iter || set[way].current_iter || set[way].age)
+			if (set[way].tag == *tag_ptr)
+				return &set[way];
+	return NULL;
+}
+
+
+/* Direction of a branch predicted by the loop predictor. Return -1 if the
+ * loop predictor is not confident about it. */
+static int x86_bpred_loop_predict(struct x86_bpred_t *bpred, unsigned int eip)
+{
+	struct x86_bpred_loop_t *set;
+	struct x86_bpred_loop_t *entry;
+	unsigned short tag;
+
+	if (!x86_bpred_loop_size)
+		return -1;
+	entry = x86_bpred_loop_find(bpred, eip, &set, &tag);
+	if (!entry || entry->conf < X86_BPRED_LOOP_CONF_MAX)
+		return -1;
+	return entry->current_iter == entry->past_iter ? !entry->dir : entry->dir;
+}
+
+
+/* Train the loop predictor with the outcome of a branch in the correct path.
+ * Iteration counts must follow the fetched branches, so this is done at fetch
+ * for branches that are not in speculative mode, since they are all going to
+ * commit. Argument 'pred' is the prediction of the rest of the predictor. */
+static void x86_bpred_loop_update(struct x86_bpred_t *bpred, unsigned int eip,
+	int loop_pred, int pred, int taken)
+{
+	struct x86_bpred_loop_t *set;
+	struct x86_bpred_loop_t *entry;
+	unsigned short tag;
+	int way;
+
+	if (!x86_bpred_loop_size)
+		return;
+
+	/* Use loop predictor when it disagrees with TAGE */
+	if (loop_pred >= 0 && loop_pred != pred)
+		bpred->loop_use = loop_pred == taken ? MIN(bpred->loop_use + 1, 63) :
+			MAX(bpred->loop_use - 1, -64);
+
+	/* Allocate on misprediction */
+	entry = x86_bpred_loop_find(bpred, eip, &set, &tag);
+	if (!entry)
+	{
+		if ((loop_pred >= 0 ? loop_pred : pred) == taken)
+			return;
+		for (way = 0; way < X86_BPRED_LOOP_ASSOC; way++)
+		{
+			if (set[way].age)
+				continue;
+			entry = &set[way];
+			entry->tag = tag;
+			entry->past_iter = 0;
+			entry->current_iter = 0;
+			entry->conf = 0;
+			entry->age = X86_BPRED_LOOP_AGE_MAX;
+			entry->dir = !taken;
+			return;
+		}
+		for (way = 0; way < X86_BPRED_LOOP_ASSOC; way++)
+			set[way].age--;
+		return;
+	}
+
+	/* Wrong prediction of a confident entry, free it */
+	if (loop_pred >= 0 && loop_pred != taken)
+	{
+		memset(entry, 0, sizeof(struct x86_bpred_loop_t));
+		return;
+	}
+	if (loop_pred >= 0 && pred != taken)
+		entry->age = MIN(entry->age + 1, X86_BPRED_LOOP_AGE_MAX);
+
+	/* Loop body */
+	if (taken == entry->dir)
+	{
+		entry->current_iter++;
+		if (entry->current_iter > X86_BPRED_LOOP_ITER_MAX)
+			memset(entry, 0, sizeof(struct x86_bpred_loop_t));
+		return;
+	}
+
+	/* Loop exit */
+	if (entry->current_iter == entry->past_iter)
+	{
+		entry->conf = MIN(entry->conf + 1, X86_BPRED_LOOP_CONF_MAX);
+	}
+	else
+	{
+		entry->past_iter = entry->current_iter;
+		entry->conf = 0;
+	}
+	entry->current_iter = 0;
+}
+
+
+/* Predict the direction of a conditional branch with TAGE-SC-L, using the
+ * global history in 'hist'. The state needed to train the predictor is
+ * recorded in 'info'. */
+static int x86_bpred_tage_predict(struct x86_bpred_t *bpred, struct x86_bpred_hist_t *hist,
+	unsigned int eip, struct x86_bpred_info_t *info)
+{
+	struct x86_bpred_tage_entry_t *entry;
+
+	int log_size;
+	int table;
+	int ctr;
+	int pred;
+	int i;
+
+	/* Base predictor */
+	info->base_index = eip & (x86_bpred_tage_base_size - 1);
+	info->provider = -1;
+	info->alt = -1;
+	info->provider_pred = bpred->tage_base[info->base_index] > 1;
+	info->alt_pred = info->provider_pred;
+	ctr = 2 * bpred->tage_base[info->base_index] - 3;
+
+	/* Longest and second longest matching tables */
+	for (table = 0; table < x86_bpred_tage_tables; table++)
+	{
+		info->index[table] = x86_bpred_tage_index(bpred, hist, eip, table);
+		info->tag[table] = x86_bpred_tage_tag(bpred, hist, eip, table);
+	}
+	for (table = x86_bpred_tage_tables - 1; table >= 0; table--)
+	{
+		entry = &bpred->tage_table[table][info->index[table]];
+		if (entry->tag != info->tag[table])
+			continue;
+		if (info->provider < 0)
+		{
+			info->provider = table;
+			info->provider_pred = entry->ctr >= 0;
+			ctr = 2 * entry->ctr + 1;
+		}
+		else
+		{
+			info->alt = table;
+			info->alt_pred = entry->ctr >= 0;
+			break;
+		}
+	}
+
+	/* Newly allocated entries are weak, and the alternate prediction is
+	 * often better for them. */
+	info->tage_pred = info->provider_pred;
+	if (info->provider >= 0 && (ctr == 1 || ctr == -1) && bpred->tage_use_alt >= 0)
+		info->tage_pred = info->alt_pred;
+	pred = info->tage_pred;
+
+	/* Statistical corrector. It reverts TAGE predictions in branches that are
+	 * statistically biased against them. The confidence of TAGE counts. */
+	info->sc_pred = pred;
+	if (x86_bpred_sc_size)
+	{
+		log_size = log_base2(x86_bpred_sc_size);
+		info->sc_sum = info->tage_pred ? 8 * abs(ctr) : -8 * abs(ctr);
+		for (i = 0; i < X86_BPRED_SC_TABLES; i++)
+		{
+			info->sc_index[i] = i ? x86_bpred_hash(eip, (hist->recent &
+				((1ULL << x86_bpred_sc_hist_len[i]) - 1)) + (i << 16)) :
+				(eip ^ (eip >> log_size)) << 1 | info->tage_pred;
+			info->sc_index[i] &= x86_bpred_sc_size - 1;
+			info->sc_sum += 2 * bpred->sc_table[i][info->sc_index[i]] + 1;
+		}
+		info->sc_pred = info->sc_sum >= 0;
+		if (abs(info->sc_sum) >= bpred->sc_threshold)
+			pred = info->sc_pred;
+	}
+
+	return pred;
+}
+
+
+static void x86_bpred_tage_update(struct x86_bpred_t *bpred, struct x86_uop_t *uop, int taken)
+{
+	struct x86_bpred_info_t *info = &uop->pred_info;
+	struct x86_bpred_tage_entry_t *entry;
+	struct x86_bpred_tage_entry_t *provider;
+	signed char *weight;
+
+	int table;
+	int weak;
+	int i;
+
+	/* Statistical corrector, trained when wrong or not confident */
+	if (x86_bpred_sc_size)
+	{
+		if (info->sc_pred != info->tage_pred && abs(info->sc_sum) >= bpred->sc_threshold)
+		{
+			bpred->sc_threshold_ctr += info->sc_pred == taken ? -1 : 1;
+			if (bpred->sc_threshold_ctr >= 32)
+			{
+				bpred->sc_threshold += 2;
+				bpred->sc_threshold_ctr = 0;
+			}
+			if (bpred->sc_threshold_ctr <= -32)
+			{
+				bpred->sc_threshold = MAX(bpred->sc_threshold - 2, 6);
+				bpred->sc_threshold_ctr = 0;
+			}
+		}
+		if (info->sc_pred != taken || abs(info->sc_sum) < bpred->sc_threshold)
+		{
+			for (i = 0; i < X86_BPRED_SC_TABLES; i++)
+			{
+				weight = &bpred->sc_table[i][info->sc_index[i]];
+				*weight = taken ? MIN(*weight + 1, X86_BPRED_SC_WEIGHT_MAX) :
+					MAX(*weight - 1, X86_BPRED_SC_WEIGHT_MIN);
+			}
+		}
+	}
+
+	/* Provider entry, if it was not replaced since the prediction */
+	provider = NULL;
+	if (info->provider >= 0)
+	{
+		provider = &bpred->tage_table[info->provider][info->index[info->provider]];
+		if (provider->tag != info->tag[info->provider])
+			provider = NULL;
+	}
+
+	/* Choice between provider and alternate for weak entries */
+	weak = provider && (provider->ctr == 0 || provider->ctr == -1);
+	if (weak && info->provider_pred != info->alt_pred)
+		bpred->tage_use_alt = info->alt_pred == taken ?
+			MIN(bpred->tage_use_alt + 1, 7) : MAX(bpred->tage_use_alt - 1, -8);
+
+	/* Allocate an entry in a table with longer history on misprediction */
+	if (info->tage_pred != taken && info->provider < x86_bpred_tage_tables - 1)
+	{
+		bpred->tage_seed = bpred->tage_seed * 1103515245 + 12345;
+		table = info->provider + 1 + ((bpred->tage_seed >> 16) & 1);
+		table = MIN(table, x86_bpred_tage_tables - 1);
+		for (; table < x86_bpred_tage_tables; table++)
+		{
+			entry = &bpred->tage_table[table][info->index[table]];
+			if (entry->u)
+				continue;
+			entry->tag = info->tag[table];
+			entry->ctr = taken ? 0 : -1;
+			break;
+		}
+		if (table == x86_bpred_tage_tables)
+		{
+			for (table = info->provider + 1; table < x86_bpred_tage_tables; table++)
+			{
+				entry = &bpred->tage_table[table][info->index[table]];
+				if (entry->u)
+					entry->u--;
+			}
+		}
+	}
+
+	/* Update provider counter, or base predictor. New entries with no
+	 * usefulness yet also train the alternate prediction. */
+	if (provider)
+	{
+		provider->ctr = taken ? MIN(provider->ctr + 1, X86_BPRED_TAGE_CTR_MAX) :
+			MAX(provider->ctr - 1, X86_BPRED_TAGE_CTR_MIN);
+		if (info->provider_pred != info->alt_pred)
+			provider->u = info->provider_pred == taken ?
+				MIN(provider->u + 1, X86_BPRED_TAGE_U_MAX) : MAX(provider->u - 1, 0);
+	}
+	if (!provider || (!provider->u && info->alt < 0))
+	{
+		i = bpred->tage_base[info->base_index];
+		bpred->tage_base[info->base_index] = taken ? MIN(i + 1, 3) : MAX(i - 1, 0);
+	}
+	else if (!provider->u)
+	{
+		entry = &bpred->tage_table[info->alt][info->index[info->alt]];
+		if (entry->tag == info->tag[info->alt])
+			entry->ctr = taken ? MIN(entry->ctr + 1, X86_BPRED_TAGE_CTR_MAX) :
+				MAX(entry->ctr - 1, X86_BPRED_TAGE_CTR_MIN);
+	}
+
+	/* Age useful counters periodically */
+	if (++bpred->tage_tick >= X86_BPRED_TAGE_U_RESET)
+	{
+		bpred->tage_tick = 0;
+		for (table = 0; table < x86_bpred_tage_tables; table++)
+			for (i = 0; i < x86_bpred_tage_table_size; i++)
+				bpred->tage_table[table][i].u >>= 1;
+	}
+}
+
+
+/* Predict the direction of a conditional branch with a hashed perceptron. Each
+ * table is indexed with the branch address and a different length of the
+ * global history, and the prediction is the sign of the sum of the weights. */
+static int x86_bpred_perceptron_predict(struct x86_bpred_t *bpred, struct x86_bpred_hist_t *hist,
+	unsigned int eip, struct x86_bpred_info_t *info)
+{
+	int table;
+
+	info->sum = 0;
+	for (table = 0; table < x86_bpred_perceptron_tables; table++)
+	{
+		info->index[table] = x86_bpred_hash(eip, table ?
+			hist->fold[table - 1].value + (table << 20) : 0);
+		info->index[table] &= x86_bpred_perceptron_size - 1;
+		info->sum += bpred->perceptron_table[table][info->index[table]];
+	}
+	return info->sum >= 0;
+}
+
+
+static void x86_bpred_perceptron_update(struct x86_bpred_t *bpred, struct x86_uop_t *uop, int taken)
+{
+	struct x86_bpred_info_t *info = &uop->pred_info;
+	signed char *weight;
+	int table;
+
+	/* Adapt training threshold, keeping updates due to a low output about as
+	 * frequent as mispredictions. */
+	if ((info->sum >= 0) != taken)
+	{
+		if (++bpred->perceptron_theta_ctr >= 32)
+		{
+			bpred->perceptron_theta++;
+			bpred->perceptron_theta_ctr = 0;
+		}
+	}
+	else if (abs(info->sum) <= bpred->perceptron_theta)
+	{
+		if (--bpred->perceptron_theta_ctr <= -32)
+		{
+			bpred->perceptron_theta = MAX(bpred->perceptron_theta - 1, 1);
+			bpred->perceptron_theta_ctr = 0;
+		}
+	}
+	else
+	{
+		return;
+	}
+
+	/* Train */
+	for (table = 0; table < x86_bpred_perceptron_tables; table++)
+	{
+		weight = &bpred->perceptron_table[table][info->index[table]];
+		*weight = taken ? MIN(*weight + 1, X86_BPRED_PERCEPTRON_WEIGHT_MAX) :
+			MAX(*weight - 1, X86_BPRED_PERCEPTRON_WEIGHT_MIN);
+	}
+}
+
+
+/* Direction prediction of the TAGE-SC-L and perceptron predictors. In
+ * TAGE-SC-L, a confident loop predictor overrides the TAGE and statistical
+ * corrector prediction. */
+static int x86_bpred_predict(struct x86_bpred_t *bpred, struct x86_bpred_hist_t *hist,
+	unsigned int eip, struct x86_bpred_info_t *info)
+{
+	int pred;
+
+	if (x86_bpred_kind == x86_bpred_kind_perceptron)
+		return x86_bpred_perceptron_predict(bpred, hist, eip, info);
+
+	pred = info->tage_sc_pred = x86_bpred_tage_predict(bpred, hist, eip, info);
+	info->loop_pred = x86_bpred_loop_predict(bpred, eip);
+	if (info->loop_pred >= 0 && bpred->loop_use >= 0)
+		pred = info->loop_pred;
+	return pred;
+}
+
+
+/* BTB entry for address 'eip', or NULL */
+static struct btb_entry_t *x86_bpred_btb_find(struct x86_bpred_t *bpred, unsigned int eip)
+{
+	struct btb_entry_t *entry;
+	int set;
+	int way;
+
+	set = eip & (x86_bpred_btb_sets - 1);
+	for (way = 0; way < x86_bpred_btb_assoc; way++)
+	{
+		entry = BTB_ENTRY(set, way);
+		if (entry->source == eip)
+			return entry;
+	}
+	return NULL;
+}
+
+
+/* Multiple prediction for TAGE-SC-L and perceptron. The branches following
+ * the primary one are found in the BTB along the predicted path, and are
+ * predicted with a copy of the global history extended with the previous
+ * predictions. Unconditional branches are predicted taken. */
+static int x86_bpred_lookup_multiple_path(struct x86_bpred_t *bpred, unsigned int eip,
+	unsigned int bsize, int count)
+{
+	struct x86_bpred_info_t info;
+	struct x86_bpred_hist_t hist;
+	struct btb_entry_t *entry;
+
+	int pred;
+	int taken;
+	int i;
+
+	hist = bpred->hist;
+	pred = 0;
+	for (i = 0; i < count && eip; i++)
+	{
+		entry = x86_bpred_btb_find(bpred, eip);
+		if (!entry)
+			break;
+		taken = entry->uncond;
+		if (!taken)
+		{
+			taken = x86_bpred_predict(bpred, &hist, eip, &info);
+			x86_bpred_hist_push(bpred, &hist, eip, taken);
+		}
+		pred |= taken << i;
+		eip = x86_bpred_btb_next_branch(bpred, taken ? entry->target : eip + 1, bsize);
+	}
+	return pred;
+}
+
 
 
 
@@ -121,7 +755,50 @@ void x86_bpred_init()
 		fatal("two-level predictor sizes must be power of 2");
 	if (x86_bpred_twolevel_l2size & (x86_bpred_twolevel_l2size - 1))
 		fatal("two-level predictor sizes must be power of 2");
-	
+
+	/* TAGE-SC-L parameters */
+	if (x86_bpred_kind == x86_bpred_kind_tage)
+	{
+		if (x86_bpred_tage_tables < 1 || x86_bpred_tage_tables > X86_BPRED_TABLES_MAX)
+			fatal("number of TAGE tables must be >=1 and <=%d", X86_BPRED_TABLES_MAX);
+		if (x86_bpred_tage_table_size < 2 || (x86_bpred_tage_table_size & (x86_bpred_tage_table_size - 1)))
+			fatal("number of entries in TAGE tables must be a power of 2");
+		if (x86_bpred_tage_base_size < 1 || (x86_bpred_tage_base_size & (x86_bpred_tage_base_size - 1)))
+			fatal("number of entries in TAGE base predictor must be a power of 2");
+		if (x86_bpred_tage_tag_bits < 4 || x86_bpred_tage_tag_bits > 16)
+			fatal("TAGE tag size must be >=4 and <=16");
+		if (x86_bpred_tage_min_hist < 1 || x86_bpred_tage_max_hist > X86_BPRED_HIST_MAX ||
+				x86_bpred_tage_min_hist > x86_bpred_tage_max_hist)
+			fatal("TAGE history lengths must be >=1 and <=%d", X86_BPRED_HIST_MAX);
+		if (x86_bpred_sc_size && (x86_bpred_sc_size < 2 || (x86_bpred_sc_size & (x86_bpred_sc_size - 1))))
+			fatal("number of entries in statistical corrector must be 0 or a power of 2");
+		if (x86_bpred_loop_size && (x86_bpred_loop_size < X86_BPRED_LOOP_ASSOC ||
+				(x86_bpred_loop_size & (x86_bpred_loop_size - 1))))
+			fatal("number of entries in loop predictor must be 0 or a power of 2 >=%d",
+				X86_BPRED_LOOP_ASSOC);
+		x86_bpred_geometric(x86_bpred_tage_hist_len, x86_bpred_tage_tables,
+			x86_bpred_tage_min_hist, x86_bpred_tage_max_hist);
+	}
+
+	/* Perceptron parameters. Table 0 has no history. */
+	if (x86_bpred_kind == x86_bpred_kind_perceptron)
+	{
+		if (x86_bpred_perceptron_tables < 1 || x86_bpred_perceptron_tables > X86_BPRED_TABLES_MAX)
+			fatal("number of perceptron tables must be >=1 and <=%d", X86_BPRED_TABLES_MAX);
+		if (x86_bpred_perceptron_size < 2 || (x86_bpred_perceptron_size & (x86_bpred_perceptron_size - 1)))
+			fatal("number of perceptron weights per table must be a power of 2");
+		if (x86_bpred_perceptron_hist_size < 2 || x86_bpred_perceptron_hist_size > X86_BPRED_HIST_MAX)
+			fatal("perceptron history size must be >=2 and <=%d", X86_BPRED_HIST_MAX);
+		x86_bpred_geometric(x86_bpred_perceptron_hist_len + 1, x86_bpred_perceptron_tables - 1,
+			2, x86_bpred_perceptron_hist_size);
+	}
+
+	/* Multiple branch prediction for the trace cache */
+	if (x86_trace_cache_present && x86_bpred_kind != x86_bpred_kind_twolevel &&
+			x86_bpred_kind != x86_bpred_kind_tage &&
+			x86_bpred_kind != x86_bpred_kind_perceptron)
+		fatal("trace cache requires a TwoLevel, TAGE, or Perceptron branch predictor");
+
 	/* Initialization */
 	X86_CORE_FOR_EACH X86_THREAD_FOR_EACH
 	{
@@ -141,6 +818,61 @@ void x86_bpred_done()
 }
 
 
+/* Storage of the direction predictor of each hardware thread in bits, not
+ * including the BTB and RAS. */
+long long x86_bpred_storage_bits(void)
+{
+	long long bits = 0;
+
+	switch (x86_bpred_kind)
+	{
+
+	case x86_bpred_kind_bimod:
+		bits = 2LL * x86_bpred_bimod_size;
+		break;
+
+	case x86_bpred_kind_twolevel:
+		bits = (long long) x86_bpred_twolevel_l1size * x86_bpred_twolevel_hist_size +
+			2LL * x86_bpred_twolevel_l2size * x86_bpred_twolevel_l2height;
+		break;
+
+	case x86_bpred_kind_comb:
+		bits = 2LL * x86_bpred_bimod_size + 2LL * x86_bpred_choice_size +
+			(long long) x86_bpred_twolevel_l1size * x86_bpred_twolevel_hist_size +
+			2LL * x86_bpred_twolevel_l2size * x86_bpred_twolevel_l2height;
+		break;
+
+	case x86_bpred_kind_tage:
+
+		/* Base and tagged tables (counter, useful, tag), use-alternate
+		 * counter, global and path history */
+		bits = 2LL * x86_bpred_tage_base_size + (long long) x86_bpred_tage_tables *
+			x86_bpred_tage_table_size * (3 + 2 + x86_bpred_tage_tag_bits) +
+			4 + x86_bpred_tage_max_hist + 16;
+
+		/* Statistical corrector weights and threshold */
+		if (x86_bpred_sc_size)
+			bits += 6LL * X86_BPRED_SC_TABLES * x86_bpred_sc_size + 12;
+
+		/* Loop entries (tag, iterations, confidence, age, direction) and
+		 * use counter */
+		if (x86_bpred_loop_size)
+			bits += (10 + 14 + 14 + 2 + 5 + 1) * (long long) x86_bpred_loop_size + 7;
+		break;
+
+	case x86_bpred_kind_perceptron:
+		bits = 8LL * x86_bpred_perceptron_tables * x86_bpred_perceptron_size +
+			x86_bpred_perceptron_hist_size;
+		break;
+
+	default:
+		break;
+	}
+
+	return bits;
+}
+
+
 struct x86_bpred_t *x86_bpred_create(char *name)
 {
 	struct x86_bpred_t *bpred;
@@ -178,6 +910,50 @@ struct x86_bpred_t *x86_bpred_create(char *name)
 			bpred->choice[i] = 2;
 	}
 
+	/* Global history */
+	if (x86_bpred_kind == x86_bpred_kind_tage || x86_bpred_kind == x86_bpred_kind_perceptron)
+		bpred->hist_bits = xcalloc(X86_BPRED_HIST_BUFFER_SIZE, sizeof(char));
+
+	/* TAGE-SC-L. Each tagged table uses three folded histories for its index
+	 * and tag. */
+	if (x86_bpred_kind == x86_bpred_kind_tage)
+	{
+		bpred->tage_base = xcalloc(x86_bpred_tage_base_size, sizeof(char));
+		for (i = 0; i < x86_bpred_tage_base_size; i++)
+			bpred->tage_base[i] = 2;
+		for (i = 0; i < x86_bpred_tage_tables; i++)
+		{
+			bpred->tage_table[i] = xcalloc(x86_bpred_tage_table_size,
+				sizeof(struct x86_bpred_tage_entry_t));
+			x86_bpred_fold_init(&bpred->hist.fold[i * 3], x86_bpred_tage_hist_len[i],
+				log_base2(x86_bpred_tage_table_size));
+			x86_bpred_fold_init(&bpred->hist.fold[i * 3 + 1], x86_bpred_tage_hist_len[i],
+				x86_bpred_tage_tag_bits);
+			x86_bpred_fold_init(&bpred->hist.fold[i * 3 + 2], x86_bpred_tage_hist_len[i],
+				x86_bpred_tage_tag_bits - 1);
+		}
+		bpred->fold_count = x86_bpred_tage_tables * 3;
+		bpred->tage_seed = 1;
+		for (i = 0; x86_bpred_sc_size && i < X86_BPRED_SC_TABLES; i++)
+			bpred->sc_table[i] = xcalloc(x86_bpred_sc_size, sizeof(signed char));
+		bpred->sc_threshold = 35;
+		if (x86_bpred_loop_size)
+			bpred->loop = xcalloc(x86_bpred_loop_size, sizeof(struct x86_bpred_loop_t));
+		bpred->loop_use = -1;
+	}
+
+	/* Perceptron */
+	if (x86_bpred_kind == x86_bpred_kind_perceptron)
+	{
+		for (i = 0; i < x86_bpred_perceptron_tables; i++)
+			bpred->perceptron_table[i] = xcalloc(x86_bpred_perceptron_size, sizeof(signed char));
+		for (i = 1; i < x86_bpred_perceptron_tables; i++)
+			x86_bpred_fold_init(&bpred->hist.fold[i - 1], x86_bpred_perceptron_hist_len[i],
+				log_base2(x86_bpred_perceptron_size));
+		bpred->fold_count = x86_bpred_perceptron_tables - 1;
+		bpred->perceptron_theta = 2.14 * x86_bpred_perceptron_tables + 20.58;
+	}
+
 	/* Allocate BTB and assign LRU counters */
 	bpred->btb = xcalloc(x86_bpred_btb_sets * x86_bpred_btb_assoc, sizeof(struct btb_entry_t));
 	for (i = 0; i < x86_bpred_btb_sets; i++)
@@ -191,6 +967,8 @@ struct x86_bpred_t *x86_bpred_create(char *name)
 
 void x86_bpred_free(struct x86_bpred_t *bpred)
 {
+	int i;
+
 	/* Bimodal table */
 	if (x86_bpred_kind == x86_bpred_kind_bimod || x86_bpred_kind == x86_bpred_kind_comb)
 		free(bpred->bimod);
@@ -204,6 +982,18 @@ void x86_bpred_free(struct x86_bpred_t *bpred)
 	/* Choice table */
 	if (x86_bpred_kind == x86_bpred_kind_comb)
 		free(bpred->choice);
+
+	/* TAGE-SC-L and perceptron tables */
+	for (i = 0; i < X86_BPRED_TABLES_MAX; i++)
+	{
+		free(bpred->tage_table[i]);
+		free(bpred->perceptron_table[i]);
+	}
+	for (i = 0; i < X86_BPRED_SC_TABLES; i++)
+		free(bpred->sc_table[i]);
+	free(bpred->tage_base);
+	free(bpred->loop);
+	free(bpred->hist_bits);
 	
 	/* Free */
 	free(bpred->name);
@@ -216,6 +1006,8 @@ void x86_bpred_free(struct x86_bpred_t *bpred)
 /* Return prediction for an address (0=not taken, 1=taken) */
 int x86_bpred_lookup(struct x86_bpred_t *bpred, struct x86_uop_t *uop)
 {
+	int taken;
+
 	/* If branch predictor is accessed, a BTB hit must have occurred before, which
 	 * provides information about the branch, i.e., target address and whether it
 	 * is a call, ret, jump, or conditional branch. Thus, branches other than
@@ -274,22 +1066,47 @@ int x86_bpred_lookup(struct x86_bpred_t *bpred, struct x86_uop_t *uop)
 		uop->pred = uop->choice_pred ? uop->twolevel_pred : uop->bimod_pred;
 	}
 
+	/* TAGE-SC-L and perceptron. The global history is updated right away
+	 * with the outcome of branches in the correct path, which is known at
+	 * fetch. This is equivalent to a speculative history repaired on every
+	 * misprediction. Wrong-path branches are left out of it. */
+	if (x86_bpred_kind == x86_bpred_kind_tage || x86_bpred_kind == x86_bpred_kind_perceptron)
+	{
+		uop->pred = x86_bpred_predict(bpred, &bpred->hist, uop->eip, &uop->pred_info);
+		uop->pred_info.valid = 1;
+		if (!uop->specmode)
+		{
+			taken = uop->neip != uop->eip + uop->mop_size;
+			if (x86_bpred_kind == x86_bpred_kind_tage)
+				x86_bpred_loop_update(bpred, uop->eip, uop->pred_info.loop_pred,
+					uop->pred_info.tage_sc_pred, taken);
+			x86_bpred_hist_push(bpred, &bpred->hist, uop->eip, taken);
+		}
+	}
+
 	/* Return prediction */
 	assert(!uop->pred || uop->pred == 1);
 	return uop->pred;
 }
 
 
-/* Return multiple predictions for an address. This can only be done for two-level
- * adaptive predictors, since they use global history. The prediction of the
- * primary branch is stored in the least significant bit (bit 0), whereas the prediction
- * of the last branch is stored in bit 'count-1'. */
-int x86_bpred_lookup_multiple(struct x86_bpred_t *bpred, unsigned int eip, int count)
+/* Return multiple predictions for an address. This can only be done for
+ * predictors using global history: two-level adaptive, TAGE-SC-L, and perceptron.
+ * The prediction of the primary branch is stored in the least significant bit
+ * (bit 0), whereas the prediction of the last branch is stored in bit 'count-1'.
+ * Argument 'bsize' is the size of the fetch block where following branches are
+ * looked up in the BTB. */
+int x86_bpred_lookup_multiple(struct x86_bpred_t *bpred, unsigned int eip,
+	unsigned int bsize, int count)
 {
 	int i, pred, temp_pred;
 	unsigned int bht_index, pht_col;
 	unsigned int bhr;  /* branch history register = pht_row */
 
+	/* TAGE-SC-L and perceptron */
+	if (x86_bpred_kind == x86_bpred_kind_tage || x86_bpred_kind == x86_bpred_kind_perceptron)
+		return x86_bpred_lookup_multiple_path(bpred, eip, bsize, count);
+
 	/* First make a regular prediction. This updates the necessary fields in the
 	 * uop for a later call to x86_bpred_update, and makes the first prediction
 	 * considering known characteristics of the primary branch. */
@@ -336,6 +1153,12 @@ void x86_bpred_update(struct x86_bpred_t *bpred, struct x86_uop_t *uop)
 		return;
 	if (uop->flags & X86_UINST_UNCOND)
 		return;
+
+	/* TAGE-SC-L and perceptron, only trained for branches looked up at fetch */
+	if (x86_bpred_kind == x86_bpred_kind_tage && uop->pred_info.valid)
+		x86_bpred_tage_update(bpred, uop, taken);
+	if (x86_bpred_kind == x86_bpred_kind_perceptron && uop->pred_info.valid)
+		x86_bpred_perceptron_update(bpred, uop, taken);
 	
 	/* Bimodal predictor was used */
 	if (x86_bpred_kind == x86_bpred_kind_bimod || 
@@ -454,6 +1277,7 @@ void x86_bpred_btb_update(struct x86_bpred_t *bpred, struct x86_uop_t *uop)
 				entry->counter = x86_bpred_btb_assoc - 1;
 				entry->source = uop->eip;
 				entry->target = uop->neip;
+				entry->uncond = !!(uop->flags & X86_UINST_UNCOND);
 			}
 		}
 	}
@@ -469,6 +1293,7 @@ void x86_bpred_btb_update(struct x86_bpred_t *bpred, struct x86_uop_t *uop)
 		}
 		found->counter = x86_bpred_btb_assoc - 1;
 		found->target = uop->neip;
+		found->uncond = !!(uop->flags & X86_UINST_UNCOND);
 	}
 }
 
@@ -499,3 +1324,178 @@ unsigned int x86_bpred_btb_next_branch(struct x86_bpred_t *bpred, unsigned int e
 	return 0;
 }
 
+
+
+/* Look up and train the predictor and the BTB with a non-speculative branch,
+ * as fetch and commit would, without counting it in the statistics. Used for
+ * functional warming. */
+void x86_bpred_warm(struct x86_bpred_t *bpred, struct x86_uop_t *uop)
+{
+	long long accesses = bpred->accesses;
+	long long hits = bpred->hits;
+
+	unsigned int target;
+
+	target = x86_bpred_btb_lookup(bpred, uop);
+	uop->pred_neip = target && x86_bpred_lookup(bpred, uop) ?
+		target : uop->eip + uop->mop_size;
+	x86_bpred_update(bpred, uop);
+	x86_bpred_btb_update(bpred, uop);
+
+	bpred->accesses = accesses;
+	bpred->hits = hits;
+}
+
+
+/* Tables and registers saved in warm-state checkpoints */
+#define X86_BPRED_STATE_MAX  (X86_BPRED_TABLES_MAX * 2 + X86_BPRED_SC_TABLES + 16)
+
+struct x86_bpred_state_t
+{
+	char name[32];
+	void *data;
+	int size;
+};
+
+static int x86_bpred_state_add(struct x86_bpred_state_t *state, int count,
+	void *data, int size, char *fmt, int index)
+{
+	assert(count < X86_BPRED_STATE_MAX);
+	snprintf(state[count].name, sizeof state[count].name, fmt, index);
+	state[count].data = data;
+	state[count].size = size;
+	return count + 1;
+}
+
+/* List the structures of 'bpred' that exist for the current predictor
+ * kind. Return the number of elements in 'state'. */
+static int x86_bpred_state_list(struct x86_bpred_t *bpred, struct x86_bpred_state_t *state)
+{
+	int count = 0;
+	int i;
+
+	count = x86_bpred_state_add(state, count, bpred->ras,
+		x86_bpred_ras_size * sizeof(unsigned int), "ras", 0);
+	count = x86_bpred_state_add(state, count, &bpred->ras_index,
+		sizeof bpred->ras_index, "ras_index", 0);
+	count = x86_bpred_state_add(state, count, bpred->btb, x86_bpred_btb_sets *
+		x86_bpred_btb_assoc * sizeof(struct btb_entry_t), "btb", 0);
+	if (bpred->bimod)
+		count = x86_bpred_state_add(state, count, bpred->bimod,
+			x86_bpred_bimod_size, "bimod", 0);
+	if (bpred->twolevel_bht)
+	{
+		count = x86_bpred_state_add(state, count, bpred->twolevel_bht,
+			x86_bpred_twolevel_l1size * sizeof(unsigned int), "twolevel_bht", 0);
+		count = x86_bpred_state_add(state, count, bpred->twolevel_pht,
+			x86_bpred_twolevel_l2size * x86_bpred_twolevel_l2height, "twolevel_pht", 0);
+	}
+	if (bpred->choice)
+		count = x86_bpred_state_add(state, count, bpred->choice,
+			x86_bpred_choice_size, "choice", 0);
+
+	/* Global history */
+	if (bpred->hist_bits)
+	{
+		count = x86_bpred_state_add(state, count, bpred->hist_bits,
+			X86_BPRED_HIST_BUFFER_SIZE, "hist_bits", 0);
+		count = x86_bpred_state_add(state, count, &bpred->hist,
+			sizeof bpred->hist, "hist", 0);
+	}
+
+	/* TAGE-SC-L */
+	if (bpred->tage_base)
+	{
+		count = x86_bpred_state_add(state, count, bpred->tage_base,
+			x86_bpred_tage_base_size, "tage_base", 0);
+		for (i = 0; i < x86_bpred_tage_tables; i++)
+			count = x86_bpred_state_add(state, count, bpred->tage_table[i],
+				x86_bpred_tage_table_size * sizeof(struct x86_bpred_tage_entry_t),
+				"tage_table.%d", i);
+		count = x86_bpred_state_add(state, count, &bpred->tage_use_alt,
+			sizeof bpred->tage_use_alt, "tage_use_alt", 0);
+		count = x86_bpred_state_add(state, count, &bpred->tage_tick,
+			sizeof bpred->tage_tick, "tage_tick", 0);
+		count = x86_bpred_state_add(state, count, &bpred->tage_seed,
+			sizeof bpred->tage_seed, "tage_seed", 0);
+		for (i = 0; bpred->sc_table[0] && i < X86_BPRED_SC_TABLES; i++)
+			count = x86_bpred_state_add(state, count, bpred->sc_table[i],
+				x86_bpred_sc_size, "sc_table.%d", i);
+		count = x86_bpred_state_add(state, count, &bpred->sc_threshold,
+			sizeof bpred->sc_threshold, "sc_threshold", 0);
+		count = x86_bpred_state_add(state, count, &bpred->sc_threshold_ctr,
+			sizeof bpred->sc_threshold_ctr, "sc_threshold_ctr", 0);
+		if (bpred->loop)
+			count = x86_bpred_state_add(state, count, bpred->loop,
+				x86_bpred_loop_size * sizeof(struct x86_bpred_loop_t), "loop", 0);
+		count = x86_bpred_state_add(state, count, &bpred->loop_use,
+			sizeof bpred->loop_use, "loop_use", 0);
+	}
+
+	/* Perceptron */
+	if (bpred->perceptron_table[0])
+	{
+		for (i = 0; i < x86_bpred_perceptron_tables; i++)
+			count = x86_bpred_state_add(state, count, bpred->perceptron_table[i],
+				x86_bpred_perceptron_size, "perceptron_table.%d", i);
+		count = x86_bpred_state_add(state, count, &bpred->perceptron_theta,
+			sizeof bpred->perceptron_theta, "perceptron_theta", 0);
+		count = x86_bpred_state_add(state, count, &bpred->perceptron_theta_ctr,
+			sizeof bpred->perceptron_theta_ctr, "perceptron_theta_ctr", 0);
+	}
+
+	return count;
+}
+
+
+/* Save the tables, BTB, RAS and global history of the predictor as children
+ * of 'parent_elem'. Statistics are not saved. */
+void x86_bpred_save_state(struct x86_bpred_t *bpred, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem)
+{
+	struct x86_bpred_state_t state[X86_BPRED_STATE_MAX];
+
+	int count;
+	int i;
+
+	bin_config_add(bin_config, parent_elem, "kind", &x86_bpred_kind, sizeof x86_bpred_kind);
+	count = x86_bpred_state_list(bpred, state);
+	for (i = 0; i < count; i++)
+		bin_config_add(bin_config, parent_elem, state[i].name, state[i].data, state[i].size);
+}
+
+
+/* Restore the state saved with 'x86_bpred_save_state'. Return 0 and leave the
+ * predictor unchanged if it was saved for a different kind or size. */
+int x86_bpred_load_state(struct x86_bpred_t *bpred, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem)
+{
+	struct x86_bpred_state_t state[X86_BPRED_STATE_MAX];
+	enum x86_bpred_kind_t kind;
+
+	void *data;
+	int size;
+	int count;
+	int i;
+
+	/* Check kind and sizes before changing anything */
+	if (!bin_config_get_copy(bin_config, parent_elem, "kind", &kind, sizeof kind) ||
+			kind != x86_bpred_kind)
+		return 0;
+	count = x86_bpred_state_list(bpred, state);
+	for (i = 0; i < count; i++)
+	{
+		if (!bin_config_get(bin_config, parent_elem, state[i].name, &data, &size) ||
+				size != state[i].size)
+			return 0;
+		if (state[i].data == &bpred->ras_index &&
+				!IN_RANGE(* (int *) data, 0, x86_bpred_ras_size - 1))
+			return 0;
+	}
+
+	/* Restore */
+	for (i = 0; i < count; i++)
+		bin_config_get_copy(bin_config, parent_elem, state[i].name,
+			state[i].data, state[i].size);
+	return 1;
+}
@@ -22,9 +22,51 @@
 
 
 /* Forward types */
+struct bin_config_t;
+struct bin_config_elem_t;
 struct x86_uop_t;
 
 
+/* Maximum number of tables in the TAGE and perceptron predictors */
+#define X86_BPRED_TABLES_MAX  16
+
+/* Tables of the statistical corrector. Table 0 is indexed by the branch
+ * address and the TAGE prediction, the rest by the address and the outcome
+ * of the last 4, 8, and 12 branches. */
+#define X86_BPRED_SC_TABLES  4
+
+/* State of the TAGE-SC-L and perceptron predictors for one branch, recorded
+ * at lookup time and used to train the predictor at commit. */
+struct x86_bpred_info_t
+{
+	int valid;  /* Predictor accessed at fetch */
+
+	/* Entry and tag accessed in each TAGE or perceptron table */
+	int index[X86_BPRED_TABLES_MAX];
+	int tag[X86_BPRED_TABLES_MAX];
+
+	/* TAGE */
+	int base_index;
+	int provider;  /* Longest matching table, or -1 for base predictor */
+	int alt;  /* Next matching table, or -1 for base predictor */
+	int provider_pred;
+	int alt_pred;
+	int tage_pred;
+
+	/* Statistical corrector */
+	int sc_index[X86_BPRED_SC_TABLES];
+	int sc_sum;
+	int sc_pred;
+	int tage_sc_pred;  /* Prediction of TAGE and statistical corrector */
+
+	/* Loop predictor, -1 if not confident */
+	int loop_pred;
+
+	/* Perceptron output */
+	int sum;
+};
+
+
 extern char *x86_bpred_kind_map[];
 extern enum x86_bpred_kind_t
 {
@@ -33,7 +75,9 @@ extern enum x86_bpred_kind_t
 	x86_bpred_kind_nottaken,
 	x86_bpred_kind_bimod,
 	x86_bpred_kind_twolevel,
-	x86_bpred_kind_comb
+	x86_bpred_kind_comb,
+	x86_bpred_kind_tage,
+	x86_bpred_kind_perceptron
 } x86_bpred_kind;
 
 extern int x86_bpred_btb_sets;
@@ -46,20 +90,43 @@ extern int x86_bpred_twolevel_l1size;
 extern int x86_bpred_twolevel_l2size;
 extern int x86_bpred_twolevel_hist_size;
 
+extern int x86_bpred_tage_tables;
+extern int x86_bpred_tage_table_size;
+extern int x86_bpred_tage_base_size;
+extern int x86_bpred_tage_tag_bits;
+extern int x86_bpred_tage_min_hist;
+extern int x86_bpred_tage_max_hist;
+extern int x86_bpred_sc_size;
+extern int x86_bpred_loop_size;
+
+extern int x86_bpred_perceptron_tables;
+extern int x86_bpred_perceptron_size;
+extern int x86_bpred_perceptron_hist_size;
+
 
 void x86_bpred_init(void);
 void x86_bpred_done(void);
 
+long long x86_bpred_storage_bits(void);
+
 struct x86_bpred_t *x86_bpred_create(char *name);
 void x86_bpred_free(struct x86_bpred_t *bpred);
 int x86_bpred_lookup(struct x86_bpred_t *bpred, struct x86_uop_t *uop);
-int x86_bpred_lookup_multiple(struct x86_bpred_t *bpred, unsigned int eip, int count);
+int x86_bpred_lookup_multiple(struct x86_bpred_t *bpred, unsigned int eip,
+	unsigned int bsize, int count);
 void x86_bpred_update(struct x86_bpred_t *bpred, struct x86_uop_t *uop);
 
 unsigned int x86_bpred_btb_lookup(struct x86_bpred_t *bpred, struct x86_uop_t *uop);
 void x86_bpred_btb_update(struct x86_bpred_t *bpred, struct x86_uop_t *uop);
 unsigned int x86_bpred_btb_next_branch(struct x86_bpred_t *bpred, unsigned int eip, unsigned int bsize);
 
+void x86_bpred_warm(struct x86_bpred_t *bpred, struct x86_uop_t *uop);
+
+void x86_bpred_save_state(struct x86_bpred_t *bpred, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem);
+int x86_bpred_load_state(struct x86_bpred_t *bpred, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem);
+
 
 #endif
 
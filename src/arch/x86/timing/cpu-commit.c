@@ -27,6 +27,7 @@
 #include <lib/esim/trace.h>
 #include <lib/util/debug.h>
 #include <lib/util/linked-list.h>
+#include <lib/util/misc.h>
 #include <mem-system/cache.h>
 #include <mem-system/mem-system.h>
 #include <mem-system/module.h>
@@ -39,6 +40,9 @@
 #include "rob.h"
 #include "trace-cache.h"
 
+/* Cycles without committing before the simulation is considered stalled */
+#define X86_CPU_COMMIT_STALL_CYCLES  1000000
+
 static char *err_x86_cpu_commit_stall =
 	"\tThe CPU commit stage has not received any instruction for 1M\n"
 	"\tcycles. Most likely, this means that a deadlock condition\n"
@@ -55,7 +59,7 @@ static int x86_cpu_can_commit_thread(int core, int thread)
 	 * going wrong if more than 1M cycles go by without committing an inst. */
 	if (!ctx || !x86_ctx_get_state(ctx, x86_ctx_running))
 		X86_THREAD.last_commit_cycle = arch_x86->cycle;
-	if (arch_x86->cycle - X86_THREAD.last_commit_cycle > 1000000)
+	if (arch_x86->cycle - X86_THREAD.last_commit_cycle > X86_CPU_COMMIT_STALL_CYCLES)
 	{
 		warning("core-thread %d-%d: simulation ended due to commit stall.\n%s",
 			core, thread, err_x86_cpu_commit_stall);
@@ -81,8 +85,138 @@ static int x86_cpu_can_commit_thread(int core, int thread)
 		return uop->ready;
 	}
 
-	/* Instructions other than stores must be completed. */
-	return uop->completed;
+	/* Instructions other than stores must be completed. Loads that
+	 * violated a memory dependence are replayed first. */
+	return uop->completed && !uop->mem_dep_violation;
+}
+
+
+/* Return the CPI stack component to which commit slots not used by a thread
+ * are attributed, based on the state of the uop at the head of its ROB. */
+static enum x86_cpi_t x86_cpu_commit_stall(int core, int thread)
+{
+	struct x86_ctx_t *ctx = X86_THREAD.ctx;
+	struct x86_uop_t *uop;
+
+	int level;
+
+	/* Empty ROB */
+	if (!X86_THREAD.rob_count)
+	{
+		if (!ctx || !x86_ctx_get_state(ctx, x86_ctx_running))
+			return x86_cpi_idle;
+		if (X86_THREAD.cpi_recover)
+			return x86_cpi_bpred;
+		if (mod_in_flight_access(X86_THREAD.inst_mod, X86_THREAD.fetch_access,
+				X86_THREAD.fetch_address))
+			return x86_cpi_icache;
+		return x86_cpi_frontend;
+	}
+
+	/* The head of a shared ROB is from another thread */
+	if (!x86_rob_can_dequeue(core, thread))
+		return x86_cpi_interthread;
+
+	/* Head ready to commit, commit slots used by other threads */
+	uop = x86_rob_head(core, thread);
+	if (uop->uinst->opcode == x86_uinst_store ? uop->ready :
+			uop->completed && !uop->mem_dep_violation)
+		return x86_cpu_num_threads > 1 ? x86_cpi_interthread : x86_cpi_core;
+
+	/* Memory access in flight */
+	if ((uop->flags & X86_UINST_MEM) && uop->issued && !uop->completed)
+	{
+		level = uop->uinst->mem_level;
+		if (uop->uinst->interthread_miss)
+			return x86_cpi_interthread;
+		if (level >= max_mod_level)
+			return x86_cpi_dram;
+		if (level > 1 && level == max_mod_level - 1)
+			return x86_cpi_llc;
+		if (level > 1)
+			return x86_cpi_l2;
+		return x86_cpi_l1d;
+	}
+
+	/* Head waiting for its operands or for execution. Account for the
+	 * structure that prevents younger uops from entering the pipeline. */
+	switch (X86_THREAD.last_dispatch_stall)
+	{
+	case x86_dispatch_stall_rob:
+	case x86_dispatch_stall_rob_mem:
+		return x86_cpi_rob;
+	case x86_dispatch_stall_rob_smt:
+		return x86_cpi_interthread;
+	case x86_dispatch_stall_iq:
+		return x86_cpi_iq;
+	case x86_dispatch_stall_lq:
+	case x86_dispatch_stall_sq:
+	case x86_dispatch_stall_pq:
+		return x86_cpi_lsq;
+	default:
+		return x86_cpi_core;
+	}
+}
+
+
+/* Account for the commit slots of 'cycles' cycles of a thread in its CPI
+ * stack. Slots are used by the uops committed since the last call. */
+static void x86_cpu_commit_account(int core, int thread, long long cycles)
+{
+	struct x86_uop_t *uop;
+	enum x86_cpi_t cpi;
+
+	long long used;
+	long long slots;
+
+	/* Used slots */
+	used = X86_THREAD.num_committed_uinst - X86_THREAD.cpi_committed_uinst;
+	X86_THREAD.cpi_committed_uinst = X86_THREAD.num_committed_uinst;
+	X86_THREAD.cpi_stack[x86_cpi_base] += used;
+
+	/* Lost slots */
+	slots = x86_cpu_commit_width * cycles - used;
+	if (slots <= 0)
+		return;
+	cpi = x86_cpu_commit_stall(core, thread);
+	X86_THREAD.cpi_stack[cpi] += slots;
+	if (cpi == x86_cpi_dram)
+	{
+		uop = x86_rob_head(core, thread);
+		uop->cpi_dram_slots += slots;
+	}
+}
+
+
+/* Move 'slots' commit slots of a thread from main memory to interthread
+ * interference in its CPI stack. */
+static void x86_cpu_commit_interthread(int core, int thread, long long slots)
+{
+	X86_THREAD.cpi_stack[x86_cpi_dram] -= slots;
+	X86_THREAD.cpi_stack[x86_cpi_interthread] += slots;
+}
+
+
+/* Replay the load at the head of the ROB if it read stale data before an
+ * older store to an overlapping address. Instructions are emulated at fetch,
+ * so younger uops in the correct path cannot be fetched again. The violation
+ * is modeled by squashing the wrong path, stalling fetch for the recovery
+ * penalty, and issuing the load again before it can commit. The wrong path
+ * of a mispredicted branch in flight is squashed as well, so the branch does
+ * not recover again. */
+static void x86_cpu_commit_replay(int core, int thread)
+{
+	struct x86_uop_t *uop;
+
+	if (!x86_rob_can_dequeue(core, thread))
+		return;
+	uop = x86_rob_head(core, thread);
+	if (!uop->mem_dep_violation || !uop->completed)
+		return;
+
+	x86_cpu_recover(core, thread);
+	X86_THREAD.replay_recover_id = X86_CORE.uop_id_counter;
+	x86_lsq_replay(uop);
 }
 
 
@@ -105,7 +239,8 @@ static void x86_cpu_commit_thread(int core, int thread, int quant)
 
 		/* Mispredicted branch */
 		if (x86_cpu_recover_kind == x86_cpu_recover_kind_commit &&
-			(uop->flags & X86_UINST_CTRL) && uop->neip != uop->pred_neip)
+			(uop->flags & X86_UINST_CTRL) && uop->neip != uop->pred_neip &&
+			uop->id_in_core >= X86_THREAD.replay_recover_id)
 			recover = 1;
 
 		/* Free physical registers */
@@ -167,6 +302,16 @@ static void x86_cpu_commit_thread(int core, int thread, int quant)
 		if (uop->in_aq)
 			x86_aq_remove(uop);
 
+		/* Memory dependences */
+		if (uop->flags & X86_UINST_MEM)
+			x86_lsq_commit(uop);
+
+		/* Slots lost in main memory due to interference from other
+		 * threads are known once the access completes. */
+		if (uop->cpi_dram_slots)
+			x86_cpu_commit_interthread(core, thread, MIN(uop->cpi_dram_slots,
+				uop->uinst->dram_interthread_cycles * x86_cpu_commit_width));
+
 		/* Retire instruction */
 		x86_rob_remove_head(core, thread);
 		X86_CORE.rob_reads++;
@@ -179,6 +324,7 @@ static void x86_cpu_commit_thread(int core, int thread, int quant)
 		{
 			x86_cpu_recover(core, thread);
 			x86_fu_release(core);
+			X86_THREAD.cpi_recover = 1;
 		}
 	}
 
@@ -194,6 +340,11 @@ static void x86_cpu_commit_core(int core)
 	int pass;
 	int quant;
 	int new;
+	int thread;
+
+	/* Loads with memory order violations */
+	X86_THREAD_FOR_EACH
+		x86_cpu_commit_replay(core, thread);
 
 	/* Commit stage for core */
 	switch (x86_cpu_commit_kind)
@@ -229,6 +380,10 @@ static void x86_cpu_commit_core(int core)
 		break;
 
 	}
+
+	/* CPI stacks */
+	X86_THREAD_FOR_EACH
+		x86_cpu_commit_account(core, thread, 1);
 }
 
 
@@ -240,3 +395,50 @@ void x86_cpu_commit()
 	X86_CORE_FOR_EACH
 		x86_cpu_commit_core(core);
 }
+
+
+/* Return TRUE if no thread of 'core' can commit in the next cycle until other
+ * stages make progress. The cycle when the commit stall check would fire is
+ * recorded in 'wake_ptr'. */
+int x86_cpu_commit_idle(int core, long long *wake_ptr)
+{
+	struct x86_ctx_t *ctx;
+	struct x86_uop_t *uop;
+
+	int thread;
+
+	X86_THREAD_FOR_EACH
+	{
+		/* Contexts being evicted leave when the pipeline drains */
+		ctx = X86_THREAD.ctx;
+		if (ctx && ctx->evict_signal)
+			return 0;
+		if (ctx && x86_ctx_get_state(ctx, x86_ctx_running))
+			*wake_ptr = MIN(*wake_ptr, X86_THREAD.last_commit_cycle +
+				X86_CPU_COMMIT_STALL_CYCLES + 1);
+
+		/* Same conditions as 'x86_cpu_can_commit_thread' */
+		if (!x86_rob_can_dequeue(core, thread))
+			continue;
+		uop = x86_rob_head(core, thread);
+		if (uop->uinst->opcode == x86_uinst_store)
+		{
+			if (uop->ready || x86_reg_file_ready(uop))
+				return 0;
+		}
+		else if (uop->completed)
+			return 0;
+	}
+	return 1;
+}
+
+
+/* Account for the commit slots of 'cycles' idle cycles skipped in 'core', as
+ * if 'x86_cpu_commit_core' had run in each of them. */
+void x86_cpu_commit_skip(int core, long long cycles)
+{
+	int thread;
+
+	X86_THREAD_FOR_EACH
+		x86_cpu_commit_account(core, thread, cycles);
+}
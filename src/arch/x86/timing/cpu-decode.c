@@ -100,4 +100,24 @@ void x86_cpu_decode()
 	x86_cpu->stage = "decode";
 	X86_CORE_FOR_EACH
 		x86_cpu_decode_core(core);
-}
\ No newline at end of file
+}
+
+
+/* Return TRUE if no thread of 'core' can decode in the next cycle. Instruction
+ * cache accesses in flight finish with an event. */
+int x86_cpu_decode_idle(int core)
+{
+	struct x86_uop_t *uop;
+	int thread;
+
+	X86_THREAD_FOR_EACH
+	{
+		uop = list_get(X86_THREAD.fetch_queue, 0);
+		if (!uop || list_count(X86_THREAD.uop_queue) >= x86_uop_queue_size)
+			continue;
+		if (uop->trace_cache || !mod_in_flight_access(X86_THREAD.inst_mod,
+				uop->fetch_access, uop->fetch_address))
+			return 0;
+	}
+	return 1;
+}
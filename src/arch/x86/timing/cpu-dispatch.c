@@ -87,62 +87,71 @@ static enum x86_dispatch_stall_t x86_cpu_can_dispatch_thread(int core, int threa
 }
 
 
+/* Account for 'cycles' cycles in which 'slots' dispatch slots per cycle are
+ * lost for reason 'stall' in a thread. */
+static void x86_cpu_dispatch_stall(int core, int thread,
+	enum x86_dispatch_stall_t stall, int slots, long long cycles)
+{
+	struct x86_uop_t *head = NULL;
+
+	X86_THREAD.last_dispatch_stall = stall;
+	X86_CORE.dispatch_stall[stall] += slots * cycles;
+	X86_THREAD.dispatch_stall[stall] += slots * cycles;
+	if (X86_THREAD.ctx)
+		X86_THREAD.ctx->dispatch_stall[stall] += slots * cycles;
+
+	/* Account for stalls caused by memory uops */
+	switch (stall)
+	{
+		case x86_dispatch_stall_rob_mem:
+			head = x86_rob_head(core, thread);
+			break;
+		case x86_dispatch_stall_lq:
+		case x86_dispatch_stall_sq:
+			linked_list_head(X86_THREAD.aq);
+			head = linked_list_get(X86_THREAD.aq);
+			break;
+		default:
+			break;
+	}
+	if (!head)
+		return;
+	assert(head->flags & X86_UINST_MEM);
+
+	/* This miss is due an eviction in a shared cache caused by another thread */
+	if (head->uinst->interthread_miss)
+	{
+		X86_THREAD.interthread_penalty_cycles += cycles;
+		X86_CORE.interthread_penalty_cycles += cycles;
+		if (X86_THREAD.ctx)
+			X86_THREAD.ctx->interthread_cache_penalty_cycles += cycles;
+	}
+
+	/* Intrathread miss, account for DRAM interthread interference */
+	else
+	{
+		X86_THREAD.interthread_penalty_cycles += head->uinst->dram_interthread_penalty_cycles;
+		X86_CORE.interthread_penalty_cycles += head->uinst->dram_interthread_penalty_cycles;
+		if (X86_THREAD.ctx)
+			X86_THREAD.ctx->interthread_dram_penalty_cycles += head->uinst->dram_interthread_penalty_cycles;
+		head->uinst->dram_interthread_penalty_cycles = 0; /* Only count one time */
+	}
+}
+
+
 static int x86_cpu_dispatch_thread(int core, int thread, int quant)
 {
 	struct x86_uop_t *uop;
 	enum x86_dispatch_stall_t stall;
 
+	X86_THREAD.last_dispatch_stall = x86_dispatch_stall_used;
 	while (quant)
 	{
 		/* Check if we can decode */
 		stall = x86_cpu_can_dispatch_thread(core, thread);
 		if (stall != x86_dispatch_stall_used)
 		{
-			struct x86_uop_t *head = NULL;
-
-			X86_CORE.dispatch_stall[stall] += quant;
-			X86_THREAD.dispatch_stall[stall] += quant;
-			if (X86_THREAD.ctx)
-				X86_THREAD.ctx->dispatch_stall[stall] += quant;
-
-			/* Account for stalls caused by memory uops */
-			switch (stall)
-			{
-				case x86_dispatch_stall_rob_mem:
-					head = x86_rob_head(core, thread);
-					break;
-				case x86_dispatch_stall_lq:
-				case x86_dispatch_stall_sq:
-					linked_list_head(X86_THREAD.aq);
-					head = linked_list_get(X86_THREAD.aq);
-					break;
-				default:
-					break;
-			}
-			if (head)
-			{
-				assert(head->flags & X86_UINST_MEM);
-
-				/* This miss is due an eviction in a shared cache caused by another thread */
-				if (head->uinst->interthread_miss)
-				{
-					X86_THREAD.interthread_penalty_cycles += 1;
-					X86_CORE.interthread_penalty_cycles += 1;
-					if (X86_THREAD.ctx)
-						X86_THREAD.ctx->interthread_cache_penalty_cycles += 1;
-				}
-
-				/* Intrathread miss, account for DRAM interthread interference */
-				else
-				{
-					X86_THREAD.interthread_penalty_cycles += head->uinst->dram_interthread_penalty_cycles;
-					X86_CORE.interthread_penalty_cycles += head->uinst->dram_interthread_penalty_cycles;
-					if (X86_THREAD.ctx)
-						X86_THREAD.ctx->interthread_dram_penalty_cycles += head->uinst->dram_interthread_penalty_cycles;
-					head->uinst->dram_interthread_penalty_cycles = 0; /* Only count one time */
-				}
-			}
-
+			x86_cpu_dispatch_stall(core, thread, stall, quant, 1);
 			break;
 		}
 
@@ -158,6 +167,7 @@ static int x86_cpu_dispatch_thread(int core, int thread, int quant)
 		x86_rob_enqueue(uop);
 		X86_CORE.rob_writes++;
 		X86_THREAD.rob_writes++;
+		X86_THREAD.cpi_recover = 0;
 
 		/* Non memory instruction into IQ */
 		if (!(uop->flags & X86_UINST_MEM))
@@ -233,3 +243,33 @@ void x86_cpu_dispatch()
 	X86_CORE_FOR_EACH
 		x86_cpu_dispatch_core(core);
 }
+
+
+/* Return TRUE if no thread of 'core' can dispatch in the next cycle */
+int x86_cpu_dispatch_idle(int core)
+{
+	int thread;
+
+	X86_THREAD_FOR_EACH
+		if (x86_cpu_can_dispatch_thread(core, thread) == x86_dispatch_stall_used)
+			return 0;
+	return 1;
+}
+
+
+/* Account for the dispatch stalls of 'cycles' idle cycles skipped in 'core',
+ * as if 'x86_cpu_dispatch_core' had run in each of them. Only valid with one
+ * thread per core. */
+void x86_cpu_dispatch_skip(int core, long long cycles)
+{
+	enum x86_dispatch_stall_t stall;
+	int thread = 0;
+	int slots;
+
+	assert(x86_cpu_num_threads == 1);
+	stall = x86_cpu_can_dispatch_thread(core, thread);
+	assert(stall != x86_dispatch_stall_used);
+	slots = x86_cpu_dispatch_kind == x86_cpu_dispatch_kind_shared ?
+		1 : x86_cpu_dispatch_width;
+	x86_cpu_dispatch_stall(core, thread, stall, slots, cycles);
+}
@@ -26,6 +26,7 @@
 #include <lib/esim/trace.h>
 #include <lib/util/debug.h>
 #include <lib/util/list.h>
+#include <lib/util/misc.h>
 #include <lib/util/string.h>
 #include <mem-system/mmu.h>
 #include <mem-system/module.h>
@@ -35,6 +36,7 @@
 #include "event-queue.h"
 #include "fetch-queue.h"
 #include "reg-file.h"
+#include "sampling.h"
 #include "trace-cache.h"
 
 
@@ -53,6 +55,10 @@ static int x86_cpu_can_fetch(int core, int thread)
 	if (X86_THREAD.fetch_stall_until >= arch_x86->cycle || ctx->evict_signal)
 		return 0;
 
+	/* Pipeline draining before functional simulation */
+	if (x86_sampling_fetch_stopped())
+		return 0;
+
 	/* Fetch queue must have not exceeded the limit of stored bytes
 	 * to be able to store new macro-instructions. */
 	if (X86_THREAD.fetchq_occ >= x86_fetch_queue_size)
@@ -235,8 +241,8 @@ static int x86_cpu_fetch_thread_trace_cache(int core, int thread)
 	/* Access BTB, branch predictor, and trace cache */
 	eip_branch = x86_bpred_btb_next_branch(X86_THREAD.bpred,
 		X86_THREAD.fetch_neip, X86_THREAD.inst_mod->block_size);
-	mpred = eip_branch ? x86_bpred_lookup_multiple(X86_THREAD.bpred,
-		eip_branch, x86_trace_cache_branch_max) : 0;
+	mpred = eip_branch ? x86_bpred_lookup_multiple(X86_THREAD.bpred, eip_branch,
+		X86_THREAD.inst_mod->block_size, x86_trace_cache_branch_max) : 0;
 	hit = x86_trace_cache_lookup(X86_THREAD.trace_cache, X86_THREAD.fetch_neip, mpred,
 		&mop_count, &mop_array, &neip);
 	if (!hit)
@@ -459,3 +465,25 @@ void x86_cpu_fetch()
 	X86_CORE_FOR_EACH
 		x86_cpu_fetch_core(core);
 }
+
+
+/* Return TRUE if no thread of 'core' can fetch in the next cycle. The end of
+ * a fetch stall is recorded in 'wake_ptr'. Only valid with one thread per
+ * core, where all fetch policies behave the same. */
+int x86_cpu_fetch_idle(int core, long long *wake_ptr)
+{
+	int thread;
+
+	assert(x86_cpu_num_threads == 1);
+	X86_THREAD_FOR_EACH
+	{
+		if (X86_THREAD.fetch_stall_until > arch_x86->cycle)
+		{
+			*wake_ptr = MIN(*wake_ptr, X86_THREAD.fetch_stall_until + 1);
+			continue;
+		}
+		if (x86_cpu_can_fetch(core, thread))
+			return 0;
+	}
+	return 1;
+}
@@ -113,6 +113,7 @@ static int x86_cpu_issue_lq(int core, int thread, int quant)
 {
 	struct linked_list_t *lq = X86_THREAD.lq;
 	struct x86_uop_t *load;
+	struct x86_uop_t *store;
 	struct mod_client_info_t *client_info;
 
 	/* Process lq */
@@ -128,8 +129,16 @@ static int x86_cpu_issue_lq(int core, int thread, int quant)
 		}
 		load->ready = 1;
 
+		/* Check older stores. The load might need to wait for them, or
+		 * get its data forwarded from one of them. */
+		if (!x86_lsq_can_issue_load(load, &store))
+		{
+			linked_list_next(lq);
+			continue;
+		}
+
 		/* Check that memory system is accessible */
-		if (!mod_can_access(X86_THREAD.data_mod, load->phy_addr))
+		if (!store && !mod_can_access(X86_THREAD.data_mod, load->phy_addr))
 		{
 			linked_list_next(lq);
 			continue;
@@ -139,24 +148,38 @@ static int x86_cpu_issue_lq(int core, int thread, int quant)
 		assert(load->uinst->opcode == x86_uinst_load);
 		x86_lq_remove(core, thread);
 
-		/* Insert load in the accessing queue */
-		x86_aq_insert(load);
-
-		/* Create and fill the mod_client_info_t object */
-		client_info = mod_client_info_create(X86_THREAD.data_mod);
-		client_info->prefetcher_eip = load->eip;
-		client_info->core = core;
-		client_info->thread = thread;
-		client_info->ctx = load->ctx;
-
-		/* Access memory system */
-		mod_access(X86_THREAD.data_mod, mod_access_load,
-			load->phy_addr, NULL, X86_CORE.event_queue, load, client_info);
-
-		/* The cache system will place the load at the head of the
-		 * event queue when it is ready. For now, mark "in_event_queue" to
-		 * prevent the uop from being freed. */
-		load->in_event_queue = 1;
+		/* Store-to-load forwarding. The load completes in the next cycle
+		 * without accessing the memory system. */
+		if (store)
+		{
+			load->mem_dep_forward = store->id_in_core;
+			load->when = arch_x86->cycle + 1;
+			x86_event_queue_insert(X86_CORE.event_queue, load);
+			X86_THREAD.num_forwarded_loads++;
+			X86_CORE.num_forwarded_loads++;
+			x86_cpu->num_forwarded_loads++;
+		}
+		else
+		{
+			/* Insert load in the accessing queue */
+			x86_aq_insert(load);
+
+			/* Create and fill the mod_client_info_t object */
+			client_info = mod_client_info_create(X86_THREAD.data_mod);
+			client_info->prefetcher_eip = load->eip;
+			client_info->core = core;
+			client_info->thread = thread;
+			client_info->ctx = load->ctx;
+
+			/* Access memory system */
+			mod_access(X86_THREAD.data_mod, mod_access_load,
+				load->phy_addr, NULL, X86_CORE.event_queue, load, client_info);
+
+			/* The cache system will place the load at the head of the
+			 * event queue when it is ready. For now, mark "in_event_queue" to
+			 * prevent the uop from being freed. */
+			load->in_event_queue = 1;
+		}
 		load->issued = 1;
 		load->issue_when = arch_x86->cycle;
 
@@ -177,7 +200,7 @@ static int x86_cpu_issue_lq(int core, int thread, int quant)
 		quant--;
 
 		/* MMU statistics */
-		if (*mmu_report_file_name)
+		if (*mmu_report_file_name && !store)
 			mmu_access_page(load->phy_addr, mmu_access_read);
 
 		/* Trace */
@@ -368,6 +391,11 @@ static int x86_cpu_issue_thread_iq(int core, int thread, int quant)
 static void x86_cpu_issue_core(int core)
 {
 	int skip, quant;
+	int thread;
+
+	/* Resolve store addresses before loads are issued */
+	X86_THREAD_FOR_EACH
+		x86_lsq_resolve_stores(core, thread);
 
 	switch (x86_cpu_issue_kind)
 	{
@@ -440,3 +468,52 @@ void x86_cpu_issue()
 		x86_cpu_issue_core(core);
 
 }
+
+
+/* Return TRUE if no uop of 'core' can issue in the next cycle. Any uop with
+ * its input registers ready, or any committed store, counts as issuable,
+ * regardless of functional units or memory system availability. */
+int x86_cpu_issue_idle(int core)
+{
+	struct linked_list_t *list;
+	struct x86_uop_t *uop;
+	int thread;
+
+	X86_THREAD_FOR_EACH
+	{
+		/* Stores with an address to resolve */
+		if (!x86_lsq_resolve_idle(core, thread))
+			return 0;
+
+		/* Committed stores */
+		list = X86_THREAD.sq;
+		linked_list_head(list);
+		uop = linked_list_get(list);
+		if (uop && !uop->in_rob)
+			return 0;
+
+		/* Loads, prefetches, and other uops */
+		list = X86_THREAD.lq;
+		LINKED_LIST_FOR_EACH(list)
+		{
+			uop = linked_list_get(list);
+			if (uop->ready || x86_reg_file_ready(uop))
+				return 0;
+		}
+		list = X86_THREAD.preq;
+		LINKED_LIST_FOR_EACH(list)
+		{
+			uop = linked_list_get(list);
+			if (uop->ready || x86_reg_file_ready(uop))
+				return 0;
+		}
+		list = X86_THREAD.iq;
+		LINKED_LIST_FOR_EACH(list)
+		{
+			uop = linked_list_get(list);
+			if (uop->ready || x86_reg_file_ready(uop))
+				return 0;
+		}
+	}
+	return 1;
+}
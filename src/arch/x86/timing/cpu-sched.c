@@ -456,3 +456,14 @@ void x86_cpu_schedule(void)
 	 * when is the next time the scheduler should be invoked. */
 	x86_cpu_update_min_alloc_cycle();
 }
+
+
+/* Return TRUE if the scheduler has nothing to do until the next context
+ * quantum expires, recorded in 'wake_ptr'. */
+int x86_cpu_schedule_idle(long long *wake_ptr)
+{
+	if (x86_emu->schedule_signal)
+		return 0;
+	*wake_ptr = MIN(*wake_ptr, x86_cpu->min_alloc_cycle + x86_cpu_context_quantum);
+	return 1;
+}
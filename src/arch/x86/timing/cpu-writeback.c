@@ -23,6 +23,7 @@
 #include <arch/x86/emu/emu.h>
 #include <lib/esim/trace.h>
 #include <lib/util/linked-list.h>
+#include <lib/util/misc.h>
 
 #include "cpu.h"
 #include "load-store-queue.h"
@@ -67,7 +68,8 @@ static void x86_cpu_writeback_core(int core)
 		 * performed at writeback, schedule it for the end of the iteration. */
 		if (x86_cpu_recover_kind == x86_cpu_recover_kind_writeback &&
 			(uop->flags & X86_UINST_CTRL) && !uop->specmode &&
-			uop->neip != uop->pred_neip)
+			uop->neip != uop->pred_neip &&
+			uop->id_in_core >= X86_THREAD.replay_recover_id)
 			recover = 1;
 
 		/* Trace. Prevent instructions that are not in the ROB from tracing.
@@ -96,7 +98,10 @@ static void x86_cpu_writeback_core(int core)
 		/* Recovery. This must be performed at last, because lots of uops might be
 		 * freed, which interferes with the temporary extraction from the event_queue. */
 		if (recover)
+		{
 			x86_cpu_recover(core, thread);
+			X86_THREAD.cpi_recover = 1;
+		}
 	}
 }
 
@@ -110,3 +115,22 @@ void x86_cpu_writeback()
 		x86_cpu_writeback_core(core);
 }
 
+
+/* Return TRUE if no uop of 'core' completes in the next cycle. Uops other
+ * than memory ones complete at 'uop->when', and the earliest of those cycles
+ * is recorded in 'wake_ptr'. Memory uops are placed in the event queue by the
+ * memory system once complete. */
+int x86_cpu_writeback_idle(int core, long long *wake_ptr)
+{
+	struct linked_list_t *event_queue = X86_CORE.event_queue;
+	struct x86_uop_t *uop;
+
+	LINKED_LIST_FOR_EACH(event_queue)
+	{
+		uop = linked_list_get(event_queue);
+		if (uop->flags & X86_UINST_MEM)
+			return 0;
+		*wake_ptr = MIN(*wake_ptr, uop->when);
+	}
+	return 1;
+}
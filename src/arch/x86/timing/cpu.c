@@ -18,6 +18,7 @@
  */
 
 #include <assert.h>
+#include <limits.h>
 #include <math.h>
 
 #include <arch/common/arch.h>
@@ -27,6 +28,7 @@
 #include <lib/esim/esim.h>
 #include <lib/esim/trace.h>
 #include <lib/mhandle/mhandle.h>
+#include <lib/util/bin-config.h>
 #include <lib/util/config.h>
 #include <lib/util/debug.h>
 #include <lib/util/file.h>
@@ -36,6 +38,7 @@
 #include <lib/util/stats.h>
 #include <lib/util/string.h>
 #include <lib/util/timer.h>
+#include <mem-system/mem-system.h>
 #include <mem-system/memory.h>
 #include <mem-system/module.h>
 #include <mem-system/prefetch-history.h>
@@ -50,6 +53,7 @@
 #include "mem-config.h"
 #include "reg-file.h"
 #include "rob.h"
+#include "sampling.h"
 #include "trace-cache.h"
 #include "uop-queue.h"
 
@@ -110,6 +114,11 @@ char *x86_config_help =
 	"      Set these options to true to simulate a perfect data/instruction caches,\n"
 	"      respectively, where every access results in a hit. If set to false, the\n"
 	"      parameters of the caches are given in the memory configuration file\n"
+	"  SkipIdleCycles = {t|f} (Default = True)\n"
+	"      When no pipeline stage can make progress until a memory access completes\n"
+	"      or a functional unit finishes, jump directly to the cycle of that event\n"
+	"      instead of simulating each idle cycle. Results are not affected. Only\n"
+	"      applies to single-threaded cores (Threads = 1) without pipeline tracing.\n"
 	"\n"
 	"Section '[ Pipeline ]':\n"
 	"\n"
@@ -161,6 +170,19 @@ char *x86_config_help =
 	"      Load-store queue sharing among threads.\n"
 	"  LsqSize = <num_uops> (Default = 20)\n"
 	"      Load-store queue size in number of uops (if private, per-thread LSQ size).\n"
+	"  MemDep = {None|Conservative|Blind|StoreSet} (Default = None)\n"
+	"      Memory dependence model for loads. With 'None', loads issue regardless of\n"
+	"      older stores. Otherwise, loads get their data forwarded from an older store\n"
+	"      covering them, and wait for partially overlapping stores to leave the store\n"
+	"      queue. Loads issued before an older store to an overlapping address are\n"
+	"      replayed when reaching the ROB head, with a pipeline recovery.\n"
+	"      'Conservative' waits for the addresses of all older stores, 'Blind' never\n"
+	"      waits, and 'StoreSet' waits for stores predicted by a store set predictor.\n"
+	"  StoreSet.SsitSize = <entries> (Default = 1024)\n"
+	"      Number of entries of the store set identifier table, indexed by\n"
+	"      instruction address (PC).\n"
+	"  StoreSet.LfstSize = <entries> (Default = 128)\n"
+	"      Number of store sets, tracked in the last fetched store table.\n"
 	"  RfKind = {Private|Shared} (Default = Private)\n"
 	"      Register file sharing among threads.\n"
 	"  RfIntSize = <entries> (Default = 80)\n"
@@ -187,6 +209,23 @@ char *x86_config_help =
 	"  QueueSize = <num_uops> (Default = 32)\n"
 	"      Size of the trace queue size in uops.\n"
 	"\n"
+	"Section '[ Sampling ]':\n"
+	"\n"
+	"  Period = <num_inst> (Default = 0)\n"
+	"      Periodic sampling: one sampling unit is measured every <num_inst>\n"
+	"      instructions, and the rest are emulated functionally. A value of 0\n"
+	"      disables sampling.\n"
+	"  FunctionalWarming = {t|f} (Default = True)\n"
+	"      Update caches, directories and branch predictors during functional\n"
+	"      emulation between sampling units, without timing.\n"
+	"  DetailedWarmUp = <num_inst> (Default = 2000)\n"
+	"      Instructions simulated in detail before each sampling unit, to fill\n"
+	"      the pipeline, and not measured.\n"
+	"  Measure = <num_inst> (Default = 1000)\n"
+	"      Instructions in each sampling unit. The summary reports the mean CPI\n"
+	"      of all units, with the relative half-width of its 95% confidence\n"
+	"      interval.\n"
+	"\n"
 	"Section '[ FunctionalUnits ]':\n"
 	"\n"
 	"  The possible variables in this section follow the format\n"
@@ -230,8 +269,11 @@ char *x86_config_help =
 	"\n"
 	"Section '[ BranchPredictor ]':\n"
 	"\n"
-	"  Kind = {Perfect|Taken|NotTaken|Bimodal|TwoLevel|Combined} (Default = TwoLevel)\n"
-	"      Branch predictor type.\n"
+	"  Kind = {Perfect|Taken|NotTaken|Bimodal|TwoLevel|Combined|TAGE|Perceptron}\n"
+	"      (Default = TwoLevel)\n"
+	"      Branch predictor type. TAGE is a TAGE-SC-L predictor: a TAGE predictor,\n"
+	"      followed by a statistical corrector and a loop predictor. Perceptron is\n"
+	"      a hashed perceptron predictor.\n"
 	"  BTB.Sets = <num_sets> (Default = 256)\n"
 	"      Number of sets in the BTB.\n"
 	"  BTB.Assoc = <num_ways) (Default = 4)\n"
@@ -248,6 +290,36 @@ char *x86_config_help =
 	"      For the two-level adaptive predictor, level 2 size.\n"
 	"  TwoLevel.HistorySize = <size> (Default = 8)\n"
 	"      For the two-level adaptive predictor, level 2 history size.\n"
+	"  TAGE.Tables = <num> (Default = 8)\n"
+	"      Number of tagged tables of the TAGE predictor, up to 16.\n"
+	"  TAGE.TableSize = <entries> (Default = 1024)\n"
+	"      Number of entries of each tagged table.\n"
+	"  TAGE.BaseSize = <entries> (Default = 4096)\n"
+	"      Number of entries of the bimodal base predictor of TAGE.\n"
+	"  TAGE.TagBits = <bits> (Default = 11)\n"
+	"      Tag size in the tagged tables, between 4 and 16.\n"
+	"  TAGE.MinHistory = <length> (Default = 4)\n"
+	"  TAGE.MaxHistory = <length> (Default = 300)\n"
+	"      Global history length of the first and last tagged tables. History\n"
+	"      lengths of the tables follow a geometric series. Maximum is 1000.\n"
+	"  SC.Size = <entries> (Default = 1024)\n"
+	"      Number of entries of each table in the statistical corrector of the\n"
+	"      TAGE predictor. Set to 0 to disable the statistical corrector.\n"
+	"  Loop.Size = <entries> (Default = 64)\n"
+	"      Number of entries of the 4-way loop predictor of the TAGE predictor.\n"
+	"      Set to 0 to disable the loop predictor.\n"
+	"  Perceptron.Tables = <num> (Default = 8)\n"
+	"      Number of weight tables of the perceptron predictor, up to 16. The\n"
+	"      first table is indexed by the branch address only, and the rest by the\n"
+	"      branch address and increasing global history lengths.\n"
+	"  Perceptron.Size = <entries> (Default = 1024)\n"
+	"      Number of 8-bit weights in each table.\n"
+	"  Perceptron.HistorySize = <length> (Default = 128)\n"
+	"      Global history length of the last table. Maximum is 1000.\n"
+	"\n"
+	"      The storage of the branch direction predictor is shown in the report as\n"
+	"      'StorageBits'. TwoLevel, TAGE, and Perceptron predictors support the\n"
+	"      multiple branch prediction used by the trace cache.\n"
 	"\n";
 
 
@@ -297,6 +369,8 @@ int x86_cpu_commit_width;
 
 int x86_cpu_occupancy_stats;
 
+int x86_cpu_skip_idle_cycles;
+
 struct str_map_t x86_dispatch_stall_map =
 {
 	x86_dispatch_stall_max, {
@@ -315,6 +389,26 @@ struct str_map_t x86_dispatch_stall_map =
 	}
 };
 
+struct str_map_t x86_cpi_map =
+{
+	x86_cpi_max, {
+		{ "cpi-base", x86_cpi_base },
+		{ "cpi-bpred", x86_cpi_bpred },
+		{ "cpi-icache", x86_cpi_icache },
+		{ "cpi-frontend", x86_cpi_frontend },
+		{ "cpi-core", x86_cpi_core },
+		{ "cpi-rob", x86_cpi_rob },
+		{ "cpi-iq", x86_cpi_iq },
+		{ "cpi-lsq", x86_cpi_lsq },
+		{ "cpi-l1d", x86_cpi_l1d },
+		{ "cpi-l2", x86_cpi_l2 },
+		{ "cpi-llc", x86_cpi_llc },
+		{ "cpi-dram", x86_cpi_dram },
+		{ "cpi-interthread", x86_cpi_interthread },
+		{ "cpi-idle", x86_cpi_idle }
+	}
+};
+
 
 /*
  * Private Functions
@@ -347,6 +441,7 @@ static void x86_cpu_config_dump(FILE *f)
 	fprintf(f, "RecoverPenalty = %d\n", x86_cpu_recover_penalty);
 	fprintf(f, "ProcessPrefetchHints = %d\n", x86_emu_process_prefetch_hints);
 	fprintf(f, "PrefetchHistorySize = %d\n", prefetch_history_size);
+	fprintf(f, "SkipIdleCycles = %s\n", x86_cpu_skip_idle_cycles ? "True" : "False");
 	fprintf(f, "\n");
 
 	/* Pipeline */
@@ -374,6 +469,12 @@ static void x86_cpu_config_dump(FILE *f)
 	fprintf(f, "LqSize = %d\n", x86_lq_size);
 	fprintf(f, "SqSize = %d\n", x86_sq_size);
 	fprintf(f, "PqSize = %d\n", x86_pq_size);
+	fprintf(f, "MemDep = %s\n", x86_lsq_mem_dep_kind_map[x86_lsq_mem_dep_kind]);
+	if (x86_lsq_mem_dep_kind == x86_lsq_mem_dep_kind_store_set)
+	{
+		fprintf(f, "StoreSet.SsitSize = %d\n", x86_lsq_ssit_size);
+		fprintf(f, "StoreSet.LfstSize = %d\n", x86_lsq_lfst_size);
+	}
 	fprintf(f, "RfKind = %s\n", x86_reg_file_kind_map[x86_reg_file_kind]);
 	fprintf(f, "RfIntSize = %d\n", x86_reg_file_int_size);
 	fprintf(f, "RfFpSize = %d\n", x86_reg_file_fp_size);
@@ -389,6 +490,14 @@ static void x86_cpu_config_dump(FILE *f)
 	fprintf(f, "QueueSize = %d\n", x86_trace_cache_queue_size);
 	fprintf(f, "\n");
 
+	/* Sampling */
+	fprintf(f, "[ Config.Sampling ]\n");
+	fprintf(f, "Period = %lld\n", x86_sampling_period);
+	fprintf(f, "FunctionalWarming = %s\n", x86_sampling_functional_warming ? "True" : "False");
+	fprintf(f, "DetailedWarmUp = %lld\n", x86_sampling_warm_up);
+	fprintf(f, "Measure = %lld\n", x86_sampling_measure);
+	fprintf(f, "\n");
+
 	/* Functional units */
 	x86_fu_config_dump(f);
 
@@ -403,6 +512,19 @@ static void x86_cpu_config_dump(FILE *f)
 	fprintf(f, "TwoLevel.L1Size = %d\n", x86_bpred_twolevel_l1size);
 	fprintf(f, "TwoLevel.L2Size = %d\n", x86_bpred_twolevel_l2size);
 	fprintf(f, "TwoLevel.HistorySize = %d\n", x86_bpred_twolevel_hist_size);
+	fprintf(f, "TAGE.Tables = %d\n", x86_bpred_tage_tables);
+	fprintf(f, "TAGE.TableSize = %d\n", x86_bpred_tage_table_size);
+	fprintf(f, "TAGE.BaseSize = %d\n", x86_bpred_tage_base_size);
+	fprintf(f, "TAGE.TagBits = %d\n", x86_bpred_tage_tag_bits);
+	fprintf(f, "TAGE.MinHistory = %d\n", x86_bpred_tage_min_hist);
+	fprintf(f, "TAGE.MaxHistory = %d\n", x86_bpred_tage_max_hist);
+	fprintf(f, "SC.Size = %d\n", x86_bpred_sc_size);
+	fprintf(f, "Loop.Size = %d\n", x86_bpred_loop_size);
+	fprintf(f, "Perceptron.Tables = %d\n", x86_bpred_perceptron_tables);
+	fprintf(f, "Perceptron.Size = %d\n", x86_bpred_perceptron_size);
+	fprintf(f, "Perceptron.HistorySize = %d\n", x86_bpred_perceptron_hist_size);
+	fprintf(f, "StorageBits = %lld\n", x86_bpred_storage_bits());
+	fprintf(f, "StorageKB = %.2f\n", x86_bpred_storage_bits() / 8192.0);
 	fprintf(f, "\n");
 
 	/* End of configuration */
@@ -534,6 +656,17 @@ static void x86_cpu_dump_report(void)
 		(double) (x86_cpu->num_branch_uinst - x86_cpu->num_mispred_branch_uinst) / x86_cpu->num_branch_uinst : 0.0);
 	fprintf(f, "\n");
 
+	/* Memory dependences */
+	if (x86_lsq_mem_dep_kind != x86_lsq_mem_dep_kind_none)
+	{
+		fprintf(f, "; Memory dependences\n");
+		fprintf(f, ";    ForwardedLoads - Loads getting their data from an older store\n");
+		fprintf(f, ";    Violations - Loads replayed after issuing before a conflicting store\n");
+		fprintf(f, "MemDep.ForwardedLoads = %lld\n", x86_cpu->num_forwarded_loads);
+		fprintf(f, "MemDep.Violations = %lld\n", x86_cpu->num_mem_dep_violations);
+		fprintf(f, "\n");
+	}
+
 	/* Report for each core */
 	X86_CORE_FOR_EACH
 	{
@@ -586,6 +719,15 @@ static void x86_cpu_dump_report(void)
 			(double) (X86_CORE.num_branch_uinst - X86_CORE.num_mispred_branch_uinst) / X86_CORE.num_branch_uinst : 0.0);
 		fprintf(f, "\n");
 
+		/* Memory dependences */
+		if (x86_lsq_mem_dep_kind != x86_lsq_mem_dep_kind_none)
+		{
+			fprintf(f, "; Memory dependences\n");
+			fprintf(f, "MemDep.ForwardedLoads = %lld\n", X86_CORE.num_forwarded_loads);
+			fprintf(f, "MemDep.Violations = %lld\n", X86_CORE.num_mem_dep_violations);
+			fprintf(f, "\n");
+		}
+
 		/* Occupancy stats */
 		fprintf(f, "; Structure statistics (reorder buffer, instruction queue,\n");
 		fprintf(f, "; load-store queue, and integer/floating-point register file)\n");
@@ -640,6 +782,15 @@ static void x86_cpu_dump_report(void)
 				(double) (X86_THREAD.num_branch_uinst - X86_THREAD.num_mispred_branch_uinst) / X86_THREAD.num_branch_uinst : 0.0);
 			fprintf(f, "\n");
 
+			/* Memory dependences */
+			if (x86_lsq_mem_dep_kind != x86_lsq_mem_dep_kind_none)
+			{
+				fprintf(f, "; Memory dependences\n");
+				fprintf(f, "MemDep.ForwardedLoads = %lld\n", X86_THREAD.num_forwarded_loads);
+				fprintf(f, "MemDep.Violations = %lld\n", X86_THREAD.num_mem_dep_violations);
+				fprintf(f, "\n");
+			}
+
 			/* Occupancy stats */
 			fprintf(f, "; Structure statistics (reorder buffer, instruction queue, load-store queue,\n");
 			fprintf(f, "; integer/floating-point register file, and renaming table)\n");
@@ -772,6 +923,7 @@ void x86_cpu_read_config(void)
 
 	x86_emu_process_prefetch_hints = config_read_bool(config, section, "ProcessPrefetchHints", 1);
 	prefetch_history_size = config_read_int(config, section, "PrefetchHistorySize", 10);
+	x86_cpu_skip_idle_cycles = config_read_bool(config, section, "SkipIdleCycles", 1);
 
 	/* Create cpu and cores for storing the configuration */
 	x86_cpu = xcalloc(1, sizeof(struct x86_cpu_t));
@@ -816,6 +968,14 @@ void x86_cpu_read_config(void)
 	x86_lq_size = config_read_int(config, section, "LqSize", 32);
 	x86_sq_size = config_read_int(config, section, "SqSize", 32);
 	x86_pq_size = config_read_int(config, section, "PqSize", 32);
+	x86_lsq_mem_dep_kind = config_read_enum(config, section, "MemDep",
+		x86_lsq_mem_dep_kind_none, x86_lsq_mem_dep_kind_map, 4);
+	x86_lsq_ssit_size = config_read_int(config, section, "StoreSet.SsitSize", 1024);
+	x86_lsq_lfst_size = config_read_int(config, section, "StoreSet.LfstSize", 128);
+	if (x86_lsq_ssit_size < 1)
+		fatal("%s: invalid value for 'StoreSet.SsitSize'.", x86_config_file_name);
+	if (x86_lsq_lfst_size < 1)
+		fatal("%s: invalid value for 'StoreSet.LfstSize'.", x86_config_file_name);
 
 	x86_reg_file_kind = config_read_enum(config, section, "RfKind", x86_reg_file_kind_private, x86_reg_file_kind_map, 2);
 	x86_reg_file_int_size = config_read_int(config, section, "RfIntSize", 80);
@@ -831,7 +991,7 @@ void x86_cpu_read_config(void)
 
 	section = "BranchPredictor";
 
-	x86_bpred_kind = config_read_enum(config, section, "Kind", x86_bpred_kind_twolevel, x86_bpred_kind_map, 6);
+	x86_bpred_kind = config_read_enum(config, section, "Kind", x86_bpred_kind_twolevel, x86_bpred_kind_map, 8);
 	x86_bpred_btb_sets = config_read_int(config, section, "BTB.Sets", 256);
 	x86_bpred_btb_assoc = config_read_int(config, section, "BTB.Assoc", 4);
 	x86_bpred_bimod_size = config_read_int(config, section, "Bimod.Size", 1024);
@@ -840,10 +1000,24 @@ void x86_cpu_read_config(void)
 	x86_bpred_twolevel_l1size = config_read_int(config, section, "TwoLevel.L1Size", 1);
 	x86_bpred_twolevel_l2size = config_read_int(config, section, "TwoLevel.L2Size", 1024);
 	x86_bpred_twolevel_hist_size = config_read_int(config, section, "TwoLevel.HistorySize", 8);
+	x86_bpred_tage_tables = config_read_int(config, section, "TAGE.Tables", 8);
+	x86_bpred_tage_table_size = config_read_int(config, section, "TAGE.TableSize", 1024);
+	x86_bpred_tage_base_size = config_read_int(config, section, "TAGE.BaseSize", 4096);
+	x86_bpred_tage_tag_bits = config_read_int(config, section, "TAGE.TagBits", 11);
+	x86_bpred_tage_min_hist = config_read_int(config, section, "TAGE.MinHistory", 4);
+	x86_bpred_tage_max_hist = config_read_int(config, section, "TAGE.MaxHistory", 300);
+	x86_bpred_sc_size = config_read_int(config, section, "SC.Size", 1024);
+	x86_bpred_loop_size = config_read_int(config, section, "Loop.Size", 64);
+	x86_bpred_perceptron_tables = config_read_int(config, section, "Perceptron.Tables", 8);
+	x86_bpred_perceptron_size = config_read_int(config, section, "Perceptron.Size", 1024);
+	x86_bpred_perceptron_hist_size = config_read_int(config, section, "Perceptron.HistorySize", 128);
 
 	/* Trace Cache */
 	x86_trace_cache_read_config(config);
 
+	/* Sampling */
+	x86_sampling_read_config(config);
+
 	/* Check parameters */
 	if (x86_cpu_num_cores < 1 && x86_cpu_num_cores > 128)
 		fatal("%s: Number of cores must be > 1 and <= 128.\n", __FUNCTION__);
@@ -875,6 +1049,7 @@ void x86_cpu_init(void)
 	x86_reg_file_init();
 	x86_bpred_init();
 	x86_trace_cache_init();
+	x86_sampling_init();
 	x86_fetch_queue_init();
 	x86_uop_queue_init();
 	x86_rob_init();
@@ -911,6 +1086,7 @@ void x86_cpu_done(void)
 	x86_event_queue_done();
 	x86_bpred_done();
 	x86_trace_cache_done();
+	x86_sampling_done();
 	x86_reg_file_done();
 	x86_fu_done();
 
@@ -1001,29 +1177,37 @@ void x86_cpu_dump_summary(FILE *f)
 
 	/* Print statistics */
 	fprintf(f, "FastForwardInstructions = %lld\n", x86_cpu->num_fast_forward_inst);
+	fprintf(f, "SkippedIdleCycles = %lld\n", x86_cpu->num_skipped_cycles);
 	fprintf(f, "CommittedInstructions = %lld\n", x86_cpu->num_committed_inst);
 	fprintf(f, "CommittedInstructionsPerCycle = %.4g\n", inst_per_cycle);
 	fprintf(f, "CommittedMicroInstructions = %lld\n", x86_cpu->num_committed_uinst);
 	fprintf(f, "CommittedMicroInstructionsPerCycle = %.4g\n", uinst_per_cycle);
 	fprintf(f, "BranchPredictionAccuracy = %.4g\n", branch_acc);
+	if (x86_lsq_mem_dep_kind != x86_lsq_mem_dep_kind_none)
+	{
+		fprintf(f, "ForwardedLoads = %lld\n", x86_cpu->num_forwarded_loads);
+		fprintf(f, "MemoryDependenceViolations = %lld\n", x86_cpu->num_mem_dep_violations);
+	}
+	x86_sampling_dump_summary(f);
 }
 
 
 #define UPDATE_THREAD_OCCUPANCY_STATS(ITEM) { \
-	X86_THREAD.ITEM##_occupancy += X86_THREAD.ITEM##_count; \
+	X86_THREAD.ITEM##_occupancy += X86_THREAD.ITEM##_count * cycles; \
 	if (X86_THREAD.ITEM##_count == x86_##ITEM##_size) \
-		X86_THREAD.ITEM##_full++; \
+		X86_THREAD.ITEM##_full += cycles; \
 }
 
 
 #define UPDATE_CORE_OCCUPANCY_STATS(ITEM) { \
-	X86_CORE.ITEM##_occupancy += X86_CORE.ITEM##_count; \
+	X86_CORE.ITEM##_occupancy += X86_CORE.ITEM##_count * cycles; \
 	if (X86_CORE.ITEM##_count == x86_##ITEM##_size * x86_cpu_num_threads) \
-		X86_CORE.ITEM##_full++; \
+		X86_CORE.ITEM##_full += cycles; \
 }
 
 
-void x86_cpu_update_occupancy_stats(void)
+/* Account for structure occupancy during 'cycles' cycles */
+static void x86_cpu_add_occupancy_stats(long long cycles)
 {
 	int core, thread;
 
@@ -1069,6 +1253,12 @@ void x86_cpu_update_occupancy_stats(void)
 }
 
 
+void x86_cpu_update_occupancy_stats(void)
+{
+	x86_cpu_add_occupancy_stats(1);
+}
+
+
 void x86_cpu_uop_trace_list_add(struct x86_uop_t *uop)
 {
 	assert(x86_tracing());
@@ -1123,6 +1313,65 @@ void x86_cpu_run_stages(void)
 }
 
 
+/* Skip the following cycles in which no pipeline stage can make progress.
+ * Cycles are skipped up to the earliest of the next functional unit
+ * completion, fetch stall expiration, context quantum expiration, or event in
+ * the event-driven simulation, such as the completion of a memory access.
+ * The stats accumulated in every cycle are updated for all skipped cycles. */
+static void x86_cpu_skip_idle(void)
+{
+	long long wake;
+	long long cycles;
+
+	int core;
+
+	/* Only exact with one thread per core, where round-robin policies have
+	 * no state, and when no cycle-by-cycle output is produced. */
+	if (x86_cpu_num_threads > 1 || x86_tracing() ||
+			arch_get_sim_kind_detailed_count() > 1)
+		return;
+
+	/* Pending activity outside of the pipeline */
+	if (x86_sampling_fetch_stopped() || x86_emu->suspended_list_count || x86_emu->schedule_signal ||
+			x86_emu->process_events_force)
+		return;
+
+	/* Check all stages */
+	wake = LLONG_MAX;
+	if (!x86_cpu_schedule_idle(&wake))
+		return;
+	X86_CORE_FOR_EACH
+	{
+		if (!x86_cpu_commit_idle(core, &wake) ||
+				!x86_cpu_writeback_idle(core, &wake) ||
+				!x86_cpu_issue_idle(core) ||
+				!x86_cpu_dispatch_idle(core) ||
+				!x86_cpu_decode_idle(core) ||
+				!x86_cpu_fetch_idle(core, &wake))
+			return;
+	}
+
+	/* Cycles to skip. Cycle 'wake' must run. */
+	cycles = wake - arch_x86->cycle - 1;
+	if (x86_emu_max_cycles)
+		cycles = MIN(cycles, x86_emu_max_cycles - arch_x86->cycle);
+	cycles = esim_domain_skip_cycles(arch_x86->domain_index, cycles);
+	if (!cycles)
+		return;
+
+	/* Skip */
+	arch_x86->cycle += cycles;
+	x86_cpu->num_skipped_cycles += cycles;
+	X86_CORE_FOR_EACH
+	{
+		x86_cpu_dispatch_skip(core, cycles);
+		x86_cpu_commit_skip(core, cycles);
+	}
+	if (x86_cpu_occupancy_stats)
+		x86_cpu_add_occupancy_stats(cycles);
+}
+
+
 /* Run fast-forward simulation */
 void x86_cpu_run_fast_forward(void)
 {
@@ -1167,6 +1416,10 @@ int x86_cpu_run(void)
 		x86_emu_min_inst_per_ctx -= x86_cpu_fast_forward_count;
 	}
 
+	/* Sampled simulation */
+	if (x86_sampling_period)
+		x86_sampling_run();
+
 	/* Stop if maximum number of CPU instructions exceeded */
 	if (x86_emu_max_inst && x86_cpu->num_committed_inst >= x86_emu_max_inst)
 		esim_finish = esim_finish_x86_max_inst;
@@ -1194,6 +1447,7 @@ int x86_cpu_run(void)
 		if(!ctx)
 		{
 			x86_cpu_reset_stats();
+			mem_system_net_warm_up(0);
 			if (x86_emu_min_inst_per_ctx)
 				x86_emu_min_inst_per_ctx -= x86_cpu_warm_up_count;
 			if (x86_save_checkpoint_after_warm_up_file_name)
@@ -1218,6 +1472,10 @@ int x86_cpu_run(void)
 	/* Process host threads generating events */
 	x86_emu_process_events();
 
+	/* Jump over idle cycles */
+	if (x86_cpu_skip_idle_cycles)
+		x86_cpu_skip_idle();
+
 	/* Still simulating */
 	return TRUE;
 }
@@ -1250,6 +1508,45 @@ void x86_core_reset_stats(int core)
 }
 
 
+/* Save the branch predictor of each hardware thread as children of
+ * 'parent_elem', for warm-state checkpoints. */
+void x86_cpu_save_state(struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem)
+{
+	char name[MAX_STRING_SIZE];
+
+	int core;
+	int thread;
+
+	X86_CORE_FOR_EACH X86_THREAD_FOR_EACH
+	{
+		snprintf(name, sizeof name, "c%dt%d", core, thread);
+		x86_bpred_save_state(X86_THREAD.bpred, bin_config,
+			bin_config_add(bin_config, parent_elem, name, NULL, 0));
+	}
+}
+
+
+void x86_cpu_load_state(struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem)
+{
+	struct bin_config_elem_t *elem;
+	char name[MAX_STRING_SIZE];
+
+	int core;
+	int thread;
+
+	X86_CORE_FOR_EACH X86_THREAD_FOR_EACH
+	{
+		snprintf(name, sizeof name, "c%dt%d", core, thread);
+		elem = bin_config_get(bin_config, parent_elem, name, NULL, NULL);
+		if (!elem || !x86_bpred_load_state(X86_THREAD.bpred, bin_config, elem))
+			warning("%s: branch predictor differs from checkpoint, starting cold",
+				name);
+	}
+}
+
+
 void x86_cpu_reset_stats(void)
 {
 	int i;
@@ -1280,6 +1577,9 @@ void x86_cpu_reset_stats(void)
 	x86_cpu->num_squashed_uinst = 0;
 	x86_cpu->num_branch_uinst = 0;
 	x86_cpu->num_mispred_branch_uinst = 0;
+	x86_cpu->num_forwarded_loads = 0;
+	x86_cpu->num_mem_dep_violations = 0;
+	x86_cpu->num_skipped_cycles = 0;
 
 	/* Reset x86 ctxs stats */
 	x86_ctx_all_reset_stats();
@@ -1327,6 +1627,8 @@ static void x86_cpu_thread_interval_report_init(int core, int thread)
 	for (int i = 0; i < x86_dispatch_stall_max; i++)                                       /* Where the dispatch slots are going */
 		fprintf(stack->report_file, ",c%dt%d-%s", core, thread, str_map_value(&x86_dispatch_stall_map, i));
 	fprintf(stack->report_file, ",c%dt%d-%s", core, thread, "interthread-penalty-int");    /* Number of cycles with the ROB stalled dua a interthread miss */
+	for (int i = 0; i < x86_cpi_max; i++)                                                  /* CPI stack, in cycles per uop of the interval */
+		fprintf(stack->report_file, ",c%dt%d-%s", core, thread, str_map_value(&x86_cpi_map, i));
 	for (int level = 1; level <= max_mod_level - 1; level++)
 	{
 		fprintf(stack->report_file, ",c%dt%d-l%d-%s", core, thread, level, "hits-int");
@@ -1352,6 +1654,7 @@ static void x86_cpu_thread_interval_report(int core, int thread)
 	double interthread_penalty_cycles_int;
 	double dispatch_total_slots = 0;
 	double dispatch_stall_int[x86_dispatch_stall_max];
+	double cpi_int[x86_cpi_max];
 
 	/* Ratio of usage and stall of dispatch slots */
 	for (int i = 0; i < x86_dispatch_stall_max; i++)
@@ -1369,6 +1672,16 @@ static void x86_cpu_thread_interval_report(int core, int thread)
 	interthread_penalty_cycles_int = X86_THREAD.interthread_penalty_cycles - stack->interthread_penalty_cycles;
 
 	num_committed_uinst_int = X86_THREAD.num_committed_uinst - stack->num_committed_uinst;
+
+	/* CPI stack. Commit slots of each component are converted into cycles
+	 * per committed uop, adding up to the inverse of 'ipc-int'. */
+	for (int i = 0; i < x86_cpi_max; i++)
+	{
+		cpi_int[i] = num_committed_uinst_int ?
+				(double) (X86_THREAD.cpi_stack[i] - stack->cpi_stack[i]) /
+				x86_cpu_commit_width / num_committed_uinst_int :
+				NAN;
+	}
 	ipc_glob = arch_x86->cycle - arch_x86->last_reset_cycle ?
 			(double) X86_THREAD.num_committed_uinst / (arch_x86->cycle - arch_x86->last_reset_cycle) : 0.0;
 	ipc_int = (double) num_committed_uinst_int / cycles_int;
@@ -1387,6 +1700,8 @@ static void x86_cpu_thread_interval_report(int core, int thread)
 	for (int i = 0; i < x86_dispatch_stall_max; i++)
 		fprintf(stack->report_file, ",%.3f", dispatch_stall_int[i]);
 	fprintf(stack->report_file, ",%.3f", interthread_penalty_cycles_int);
+	for (int i = 0; i < x86_cpi_max; i++)
+		fprintf(stack->report_file, ",%.3f", cpi_int[i]);
 	for (int level = 1; level <= max_mod_level - 1; level++)
 	{
 		fprintf(stack->report_file, ",%lld", stack->hits_per_level_int[level]);
@@ -1402,6 +1717,8 @@ static void x86_cpu_thread_interval_report(int core, int thread)
 	stack->last_cycle = arch_x86->cycle;
 	for (int i = 0; i < x86_dispatch_stall_max; i++)
 		stack->dispatch_stall[i] = X86_THREAD.dispatch_stall[i];
+	for (int i = 0; i < x86_cpi_max; i++)
+		stack->cpi_stack[i] = X86_THREAD.cpi_stack[i];
 	stack->num_committed_uinst = X86_THREAD.num_committed_uinst;
 	stack->interthread_penalty_cycles = X86_THREAD.interthread_penalty_cycles;
 	for (int level = 1; level <= max_mod_level - 1; level++) /* Deepest mod level is main memory, not cache */
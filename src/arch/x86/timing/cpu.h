@@ -24,6 +24,8 @@
 
 
 /* Forward types */
+struct bin_config_t;
+struct bin_config_elem_t;
 struct x86_uop_t;
 
 
@@ -50,6 +52,8 @@ extern int x86_cpu_num_threads;
 
 extern int x86_cpu_context_quantum;
 
+extern int x86_cpu_skip_idle_cycles;
+
 extern int x86_cpu_thread_quantum;
 extern int x86_cpu_thread_switch_penalty;
 
@@ -109,6 +113,7 @@ extern long long x86_cpu_warm_up_count;
 extern char *x86_save_checkpoint_after_warm_up_file_name;
 
 extern struct str_map_t x86_dispatch_stall_map;
+extern struct str_map_t x86_cpi_map;
 
 /* Trace */
 #define x86_tracing() trace_status(x86_trace_category)
@@ -146,6 +151,29 @@ enum x86_dispatch_stall_t
 };
 
 
+/* Components of the CPI stack. Each cycle, the commit slots of a thread not
+ * used to commit an uop are attributed to the reason why the uop at the head
+ * of its ROB could not commit. */
+enum x86_cpi_t
+{
+	x86_cpi_base = 0,      /* Slot used to commit an uop */
+	x86_cpi_bpred,         /* ROB empty after a branch misprediction recovery */
+	x86_cpi_icache,        /* ROB empty, instruction cache access in flight */
+	x86_cpi_frontend,      /* ROB empty for other front-end reasons */
+	x86_cpi_core,          /* Head waiting for execution or its input operands */
+	x86_cpi_rob,           /* Same, with dispatch stalled by a full ROB */
+	x86_cpi_iq,            /* Same, with dispatch stalled by a full IQ */
+	x86_cpi_lsq,           /* Same, with dispatch stalled by a full LSQ */
+	x86_cpi_l1d,           /* Head memory access served by the L1 */
+	x86_cpi_l2,            /* Head memory access served by an intermediate level */
+	x86_cpi_llc,           /* Head memory access served by the last level cache */
+	x86_cpi_dram,          /* Head memory access served by main memory */
+	x86_cpi_interthread,   /* Interference from other threads */
+	x86_cpi_idle,          /* No running ctx */
+	x86_cpi_max
+};
+
+
 struct x86_thread_report_stack_t
 {
 	int core;
@@ -154,6 +182,7 @@ struct x86_thread_report_stack_t
 	long long num_committed_uinst;
 	long long interthread_penalty_cycles;
 	long long dispatch_stall[x86_dispatch_stall_max];
+	long long cpi_stack[x86_cpi_max];
 	long long *hits_per_level_int;
 	long long *stream_hits_per_level_int;
 	long long *misses_per_level_int;
@@ -202,6 +231,7 @@ struct x86_thread_t
 	struct linked_list_t *sq;
 	struct linked_list_t *aq; /* Queue with the accessing loads and stores */
 	struct linked_list_t *preq;
+	struct linked_list_t *inflight_lq;  /* Loads not committed, in program order */
 	struct x86_bpred_t *bpred;  /* branch predictor */
 	struct x86_trace_cache_t *trace_cache;  /* trace cache */
 	struct x86_reg_file_t *reg_file;  /* physical register file */
@@ -214,6 +244,7 @@ struct x86_thread_t
 	unsigned int fetch_address;  /* Physical address of last instruction fetch */
 	long long fetch_access;  /* Module access ID of last instruction fetch */
 	long long fetch_stall_until;  /* Cycle until which fetching is stalled (inclussive) */
+	long long replay_recover_id;  /* Uops older than this had their wrong path squashed by a load replay */
 
 	/* Entries to the memory system */
 	struct mod_t *data_mod;  /* Entry for data */
@@ -222,8 +253,14 @@ struct x86_thread_t
 	/* Cycle in which last micro-instruction committed */
 	long long last_commit_cycle;
 
+	/* CPI stack */
+	enum x86_dispatch_stall_t last_dispatch_stall;  /* Reason of the last dispatch stall */
+	int cpi_recover;  /* ROB not refilled after a branch misprediction recovery */
+	long long cpi_committed_uinst;  /* Committed uops already accounted for */
+
 	/* Statistics */
 	long long dispatch_stall[x86_dispatch_stall_max];
+	long long cpi_stack[x86_cpi_max];  /* Commit slots per CPI stack component */
 	long long interthread_penalty_cycles; /* Cicles with the ROB stalled due to a memory instruction that has missed due to interthread pollution */
 
 	long long num_fetched_uinst;
@@ -235,6 +272,8 @@ struct x86_thread_t
 	long long num_squashed_uinst;
 	long long num_branch_uinst;
 	long long num_mispred_branch_uinst;
+	long long num_forwarded_loads;
+	long long num_mem_dep_violations;
 
 	/* Statistics for structures */
 	long long rob_occupancy;
@@ -318,6 +357,13 @@ struct x86_core_t
 	struct x86_fu_t *fu;
 	struct prefetch_history_t *prefetch_history;
 
+	/* Store set tables. The SSIT is indexed by the instruction address
+	 * (PC) of a load or store, and maps it to its store set, or -1. The
+	 * LFST keeps the 'id_in_core' of the last dispatched store of each
+	 * set, or -1. */
+	int *ssit;
+	long long *lfst;
+
 	/* Per core counters */
 	long long uop_id_counter;  /* Counter for uop ID assignment */
 	long long dispatch_seq;  /* Counter for uop ID assignment */
@@ -356,6 +402,8 @@ struct x86_core_t
 	long long num_squashed_uinst;
 	long long num_branch_uinst;
 	long long num_mispred_branch_uinst;
+	long long num_forwarded_loads;
+	long long num_mem_dep_violations;
 
 	/* Statistics for shared structures */
 	long long rob_occupancy;
@@ -433,6 +481,7 @@ struct x86_cpu_t
 
 	/* Statistics */
 	long long num_fast_forward_inst;  /* Fast-forwarded x86 instructions */
+	long long num_skipped_cycles;  /* Idle cycles not simulated one by one */
 	long long num_fetched_uinst;
 	long long num_dispatched_uinst_array[x86_uinst_opcode_count];
 	long long num_issued_uinst_array[x86_uinst_opcode_count];
@@ -442,6 +491,8 @@ struct x86_cpu_t
 	long long num_squashed_uinst;
 	long long num_branch_uinst;
 	long long num_mispred_branch_uinst;
+	long long num_forwarded_loads;
+	long long num_mem_dep_violations;
 	double time;
 
 	/* For dumping */
@@ -470,6 +521,11 @@ void x86_cpu_dump_summary(FILE *f);
 
 void x86_cpu_reset_stats(void);
 
+void x86_cpu_save_state(struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem);
+void x86_cpu_load_state(struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem);
+
 void x86_cpu_update_occupancy_stats(void);
 
 int x86_cpu_pipeline_empty(int core, int thread);
@@ -488,6 +544,16 @@ void x86_cpu_writeback(void);
 void x86_cpu_commit(void);
 void x86_cpu_recover(int core, int thread);
 
+int x86_cpu_schedule_idle(long long *wake_ptr);
+int x86_cpu_fetch_idle(int core, long long *wake_ptr);
+int x86_cpu_decode_idle(int core);
+int x86_cpu_dispatch_idle(int core);
+void x86_cpu_dispatch_skip(int core, long long cycles);
+int x86_cpu_issue_idle(int core);
+int x86_cpu_writeback_idle(int core, long long *wake_ptr);
+int x86_cpu_commit_idle(int core, long long *wake_ptr);
+void x86_cpu_commit_skip(int core, long long cycles);
+
 int x86_cpu_run(void);
 
 #endif
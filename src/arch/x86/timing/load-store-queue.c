@@ -19,11 +19,14 @@
 
 #include <assert.h>
 
+#include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
 #include <lib/util/linked-list.h>
+#include <lib/util/misc.h>
 
 #include "cpu.h"
 #include "load-store-queue.h"
+#include "reg-file.h"
 #include "uop.h"
 
 
@@ -33,11 +36,137 @@ int x86_lq_size;
 int x86_sq_size;
 int x86_pq_size;
 
+char *x86_lsq_mem_dep_kind_map[] = { "None", "Conservative", "Blind", "StoreSet" };
+enum x86_lsq_mem_dep_kind_t x86_lsq_mem_dep_kind;
+int x86_lsq_ssit_size;
+int x86_lsq_lfst_size;
+
+
+
+
+/*
+ * Private Functions
+ */
+
+static int x86_lsq_ssit_index(unsigned int eip)
+{
+	return (eip ^ (eip >> 12)) % x86_lsq_ssit_size;
+}
+
+
+/* Return TRUE if the memory accesses of two uops overlap */
+static int x86_lsq_overlap(struct x86_uop_t *uop1, struct x86_uop_t *uop2)
+{
+	unsigned int addr1 = uop1->uinst->address;
+	unsigned int addr2 = uop2->uinst->address;
+
+	return addr1 < addr2 + MAX(uop2->uinst->size, 1) &&
+		addr2 < addr1 + MAX(uop1->uinst->size, 1);
+}
+
+
+/* Return TRUE if the access of 'store' covers all bytes read by 'load' */
+static int x86_lsq_covers(struct x86_uop_t *store, struct x86_uop_t *load)
+{
+	unsigned int store_addr = store->uinst->address;
+	unsigned int load_addr = load->uinst->address;
+
+	return store_addr <= load_addr && load_addr + load->uinst->size <=
+		store_addr + store->uinst->size;
+}
+
+
+/* Put 'load' and 'store' in the same store set after a memory order
+ * violation. If both already belong to a set, the one with the lowest
+ * identifier is kept. */
+static void x86_lsq_store_set_train(struct x86_uop_t *store, struct x86_uop_t *load)
+{
+	int core = store->core;
+	int store_index;
+	int load_index;
+	int store_ssid;
+	int load_ssid;
+
+	store_index = x86_lsq_ssit_index(store->eip);
+	load_index = x86_lsq_ssit_index(load->eip);
+	store_ssid = X86_CORE.ssit[store_index];
+	load_ssid = X86_CORE.ssit[load_index];
+
+	if (store_ssid < 0 && load_ssid < 0)
+		store_ssid = load_ssid = store_index % x86_lsq_lfst_size;
+	else if (store_ssid < 0)
+		store_ssid = load_ssid;
+	else if (load_ssid < 0)
+		load_ssid = store_ssid;
+	else
+		store_ssid = load_ssid = MIN(store_ssid, load_ssid);
+
+	X86_CORE.ssit[store_index] = store_ssid;
+	X86_CORE.ssit[load_index] = load_ssid;
+}
+
+
+/* The address of 'store' is known. Release the loads of its store set
+ * waiting for it, and look for younger loads that already read stale data
+ * from an overlapping address. These loads are replayed when they reach the
+ * head of the ROB. */
+static void x86_lsq_resolve_store(struct x86_uop_t *store)
+{
+	struct linked_list_t *inflight_lq;
+	struct x86_uop_t *load;
+
+	int core = store->core;
+	int thread = store->thread;
+	int ssid;
+
+	assert(store->uinst->opcode == x86_uinst_store);
+	assert(!store->mem_dep_resolved);
+	store->mem_dep_resolved = 1;
+
+	/* Last fetched store of its store set */
+	if (x86_lsq_mem_dep_kind == x86_lsq_mem_dep_kind_store_set)
+	{
+		ssid = X86_CORE.ssit[x86_lsq_ssit_index(store->eip)];
+		if (ssid >= 0 && X86_CORE.lfst[ssid] == store->id_in_core)
+			X86_CORE.lfst[ssid] = -1;
+	}
+
+	/* Younger loads that did not get their data from this store or a
+	 * younger one. */
+	inflight_lq = X86_THREAD.inflight_lq;
+	LINKED_LIST_FOR_EACH(inflight_lq)
+	{
+		load = linked_list_get(inflight_lq);
+		if (load->id_in_core < store->id_in_core || !load->issued ||
+				load->mem_dep_violation ||
+				load->mem_dep_forward >= store->id_in_core ||
+				!x86_lsq_overlap(store, load))
+			continue;
+
+		/* Memory order violation */
+		load->mem_dep_violation = 1;
+		if (x86_lsq_mem_dep_kind == x86_lsq_mem_dep_kind_store_set)
+			x86_lsq_store_set_train(store, load);
+
+		/* Statistics */
+		X86_THREAD.num_mem_dep_violations++;
+		X86_CORE.num_mem_dep_violations++;
+		x86_cpu->num_mem_dep_violations++;
+	}
+}
+
+
+
+
+/*
+ * Public Functions
+ */
 
 void x86_lsq_init()
 {
 	int core;
 	int thread;
+	int i;
 
 	X86_CORE_FOR_EACH X86_THREAD_FOR_EACH
 	{
@@ -45,6 +174,20 @@ void x86_lsq_init()
 		X86_THREAD.sq = linked_list_create();
 		X86_THREAD.aq = linked_list_create(); /* Queue with commited stores */
 		X86_THREAD.preq = linked_list_create();
+		X86_THREAD.inflight_lq = linked_list_create();
+	}
+
+	/* Store set tables */
+	if (x86_lsq_mem_dep_kind != x86_lsq_mem_dep_kind_store_set)
+		return;
+	X86_CORE_FOR_EACH
+	{
+		X86_CORE.ssit = xcalloc(x86_lsq_ssit_size, sizeof(int));
+		X86_CORE.lfst = xcalloc(x86_lsq_lfst_size, sizeof(long long));
+		for (i = 0; i < x86_lsq_ssit_size; i++)
+			X86_CORE.ssit[i] = -1;
+		for (i = 0; i < x86_lsq_lfst_size; i++)
+			X86_CORE.lfst[i] = -1;
 	}
 }
 
@@ -116,6 +259,17 @@ void x86_lsq_done()
 		}
 		linked_list_free(preq);
 	}
+
+	/* Loads in flight. They are also in the ROB, which frees them. */
+	X86_CORE_FOR_EACH X86_THREAD_FOR_EACH
+		linked_list_free(X86_THREAD.inflight_lq);
+
+	/* Store set tables */
+	X86_CORE_FOR_EACH
+	{
+		free(X86_CORE.ssit);
+		free(X86_CORE.lfst);
+	}
 }
 
 
@@ -156,6 +310,9 @@ void x86_lsq_insert(struct x86_uop_t *uop)
 	struct linked_list_t *lq = X86_THREAD.lq;
 	struct linked_list_t *sq = X86_THREAD.sq;
 	struct linked_list_t *preq = X86_THREAD.preq;
+	struct linked_list_t *inflight_lq = X86_THREAD.inflight_lq;
+
+	int ssid;
 
 	assert(!uop->in_lq && !uop->in_sq);
 	assert(uop->uinst->opcode == x86_uinst_load || uop->uinst->opcode == x86_uinst_store ||
@@ -170,6 +327,21 @@ void x86_lsq_insert(struct x86_uop_t *uop)
 		X86_THREAD.lq_writes++;
 		X86_CORE.lq_count++;
 		X86_THREAD.lq_count++;
+
+		/* Memory dependences */
+		uop->mem_dep_store = -1;
+		uop->mem_dep_forward = -1;
+		if (x86_lsq_mem_dep_kind != x86_lsq_mem_dep_kind_none)
+		{
+			linked_list_out(inflight_lq);
+			linked_list_insert(inflight_lq, uop);
+		}
+		if (x86_lsq_mem_dep_kind == x86_lsq_mem_dep_kind_store_set)
+		{
+			ssid = X86_CORE.ssit[x86_lsq_ssit_index(uop->eip)];
+			if (ssid >= 0)
+				uop->mem_dep_store = X86_CORE.lfst[ssid];
+		}
 	}
 	else if (uop->uinst->opcode == x86_uinst_store)
 	{
@@ -180,6 +352,14 @@ void x86_lsq_insert(struct x86_uop_t *uop)
 		X86_THREAD.sq_writes++;
 		X86_CORE.sq_count++;
 		X86_THREAD.sq_count++;
+
+		/* Last fetched store of its store set */
+		if (x86_lsq_mem_dep_kind == x86_lsq_mem_dep_kind_store_set)
+		{
+			ssid = X86_CORE.ssit[x86_lsq_ssit_index(uop->eip)];
+			if (ssid >= 0)
+				X86_CORE.lfst[ssid] = uop->id_in_core;
+		}
 	}
 	else
 	{
@@ -201,6 +381,7 @@ void x86_lsq_recover(int core, int thread)
 	struct linked_list_t *lq = X86_THREAD.lq;
 	struct linked_list_t *sq = X86_THREAD.sq;
 	struct linked_list_t *aq = X86_THREAD.aq;
+	struct linked_list_t *inflight_lq = X86_THREAD.inflight_lq;
 	struct x86_uop_t *uop;
 
 	/* Recover load queue */
@@ -244,6 +425,159 @@ void x86_lsq_recover(int core, int thread)
 		}
 		linked_list_next(aq);
 	}
+
+	/* Recover loads in flight. They are freed when removed from the ROB. */
+	linked_list_head(inflight_lq);
+	while (!linked_list_is_end(inflight_lq))
+	{
+		uop = linked_list_get(inflight_lq);
+		if (uop->specmode)
+		{
+			linked_list_remove(inflight_lq);
+			continue;
+		}
+		linked_list_next(inflight_lq);
+	}
+}
+
+
+/* Check older stores of the same thread before issuing 'load'. Return FALSE
+ * if the load must wait, either for the address of a store, or for a store
+ * partially overlapping with it to leave the store queue. Otherwise, the store
+ * forwarding the data is returned in 'store_ptr', or NULL if the load must
+ * access the memory hierarchy. */
+int x86_lsq_can_issue_load(struct x86_uop_t *load, struct x86_uop_t **store_ptr)
+{
+	struct linked_list_t *sq;
+	struct x86_uop_t *store;
+	struct x86_uop_t *forward;
+
+	int core = load->core;
+	int thread = load->thread;
+
+	/* No memory dependence model */
+	*store_ptr = NULL;
+	if (x86_lsq_mem_dep_kind == x86_lsq_mem_dep_kind_none)
+		return 1;
+
+	/* Find youngest older store with a known, overlapping address */
+	forward = NULL;
+	sq = X86_THREAD.sq;
+	LINKED_LIST_FOR_EACH(sq)
+	{
+		store = linked_list_get(sq);
+		if (store->id_in_core > load->id_in_core)
+			break;
+
+		/* Unknown address. Wait or speculate. */
+		if (!store->mem_dep_resolved)
+		{
+			if (x86_lsq_mem_dep_kind == x86_lsq_mem_dep_kind_conservative ||
+					store->id_in_core == load->mem_dep_store)
+				return 0;
+			continue;
+		}
+
+		/* Known address */
+		if (x86_lsq_overlap(store, load))
+			forward = store;
+	}
+
+	/* Partial overlap */
+	if (forward && !x86_lsq_covers(forward, load))
+		return 0;
+
+	/* Issue */
+	*store_ptr = forward;
+	return 1;
+}
+
+
+/* Resolve the addresses of stores whose input registers are ready */
+void x86_lsq_resolve_stores(int core, int thread)
+{
+	struct linked_list_t *sq = X86_THREAD.sq;
+	struct x86_uop_t *store;
+
+	if (x86_lsq_mem_dep_kind == x86_lsq_mem_dep_kind_none)
+		return;
+
+	LINKED_LIST_FOR_EACH(sq)
+	{
+		store = linked_list_get(sq);
+		if (!store->mem_dep_resolved && (store->ready || x86_reg_file_ready(store)))
+			x86_lsq_resolve_store(store);
+	}
+}
+
+
+/* Return TRUE if no store address of the thread can be resolved */
+int x86_lsq_resolve_idle(int core, int thread)
+{
+	struct linked_list_t *sq = X86_THREAD.sq;
+	struct x86_uop_t *store;
+
+	if (x86_lsq_mem_dep_kind == x86_lsq_mem_dep_kind_none)
+		return 1;
+
+	LINKED_LIST_FOR_EACH(sq)
+	{
+		store = linked_list_get(sq);
+		if (!store->mem_dep_resolved && (store->ready || x86_reg_file_ready(store)))
+			return 0;
+	}
+	return 1;
+}
+
+
+/* Memory uop 'uop' is committed. Stores that committed in the same cycle as
+ * their input registers became ready have not been resolved yet. */
+void x86_lsq_commit(struct x86_uop_t *uop)
+{
+	int core = uop->core;
+	int thread = uop->thread;
+
+	struct linked_list_t *inflight_lq = X86_THREAD.inflight_lq;
+
+	if (x86_lsq_mem_dep_kind == x86_lsq_mem_dep_kind_none)
+		return;
+
+	if (uop->uinst->opcode == x86_uinst_store && !uop->mem_dep_resolved)
+		x86_lsq_resolve_store(uop);
+
+	if (uop->uinst->opcode == x86_uinst_load)
+	{
+		linked_list_head(inflight_lq);
+		assert(linked_list_get(inflight_lq) == uop);
+		linked_list_remove(inflight_lq);
+	}
+}
+
+
+/* Insert a load that caused a memory order violation back into the head of
+ * the load queue, to be issued again. */
+void x86_lsq_replay(struct x86_uop_t *load)
+{
+	int core = load->core;
+	int thread = load->thread;
+	struct linked_list_t *lq = X86_THREAD.lq;
+
+	assert(load->uinst->opcode == x86_uinst_load);
+	assert(load->mem_dep_violation && load->completed);
+	assert(!load->in_lq && !load->in_event_queue && !load->in_aq);
+
+	load->mem_dep_violation = 0;
+	load->mem_dep_forward = -1;
+	load->issued = 0;
+	load->completed = 0;
+
+	linked_list_head(lq);
+	linked_list_insert(lq, load);
+	load->in_lq = 1;
+	X86_CORE.lq_writes++;
+	X86_THREAD.lq_writes++;
+	X86_CORE.lq_count++;
+	X86_THREAD.lq_count++;
 }
 
 
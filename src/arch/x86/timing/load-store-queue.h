@@ -32,6 +32,23 @@ extern int x86_lq_size;
 extern int x86_sq_size;
 extern int x86_pq_size;
 
+/* Memory dependence prediction. With 'none', loads issue regardless of older
+ * stores. Otherwise, store-to-load forwarding is modeled and loads that issue
+ * before an older store to an overlapping address are replayed. 'conservative'
+ * waits for the address of all older stores, 'blind' never waits, and
+ * 'store_set' waits for stores predicted by the store set tables. */
+extern char *x86_lsq_mem_dep_kind_map[];
+extern enum x86_lsq_mem_dep_kind_t
+{
+	x86_lsq_mem_dep_kind_none = 0,
+	x86_lsq_mem_dep_kind_conservative,
+	x86_lsq_mem_dep_kind_blind,
+	x86_lsq_mem_dep_kind_store_set
+} x86_lsq_mem_dep_kind;
+
+extern int x86_lsq_ssit_size;
+extern int x86_lsq_lfst_size;
+
 void x86_lsq_init(void);
 void x86_lsq_done(void);
 
@@ -39,6 +56,12 @@ int x86_lsq_can_insert(struct x86_uop_t *uop);
 void x86_lsq_insert(struct x86_uop_t *uop);
 void x86_lsq_recover(int core, int thread);
 
+int x86_lsq_can_issue_load(struct x86_uop_t *load, struct x86_uop_t **store_ptr);
+void x86_lsq_resolve_stores(int core, int thread);
+int x86_lsq_resolve_idle(int core, int thread);
+void x86_lsq_commit(struct x86_uop_t *uop);
+void x86_lsq_replay(struct x86_uop_t *load);
+
 void x86_lq_remove(int core, int thread);
 void x86_sq_remove(int core, int thread);
 void x86_preq_remove(int core, int thread);
@@ -0,0 +1,364 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <arch/common/arch.h>
+#include <arch/x86/emu/context.h>
+#include <arch/x86/emu/emu.h>
+#include <arch/x86/emu/regs.h>
+#include <arch/x86/emu/uinst.h>
+#include <lib/esim/esim.h>
+#include <lib/util/config.h>
+#include <lib/util/debug.h>
+#include <lib/util/linked-list.h>
+#include <lib/util/list.h>
+#include <lib/util/misc.h>
+#include <mem-system/mem-system.h>
+#include <mem-system/mmu.h>
+#include <mem-system/module.h>
+
+#include "bpred.h"
+#include "cpu.h"
+#include "sampling.h"
+#include "uop.h"
+
+
+/* Parameters */
+long long x86_sampling_period;  /* Instructions between sampling units, 0 = off */
+long long x86_sampling_warm_up;  /* Detailed warm-up before each unit */
+long long x86_sampling_measure;  /* Instructions in each sampling unit */
+int x86_sampling_functional_warming;  /* Warm caches and predictors */
+
+
+enum x86_sampling_phase_t
+{
+	x86_sampling_phase_functional = 0,
+	x86_sampling_phase_warm_up,
+	x86_sampling_phase_measure,
+	x86_sampling_phase_drain
+};
+
+static struct
+{
+	enum x86_sampling_phase_t phase;
+
+	/* Committed instructions and cycle at the beginning of the phase */
+	long long phase_inst;
+	long long phase_cycle;
+
+	/* Sampling units */
+	long long num_units;
+	double cpi_acc;
+	double cpi_sq_acc;
+
+	/* Instructions run in functional phases */
+	long long functional_inst;
+} x86_sampling;
+
+
+/*
+ * Private Functions
+ */
+
+/* Warm the data and instruction caches and the branch predictor of the
+ * hardware thread running 'ctx' with the instruction just emulated at 'eip'. */
+static void x86_sampling_warm(struct x86_ctx_t *ctx, unsigned int eip)
+{
+	struct mod_client_info_t *client_info;
+	struct x86_uinst_t *uinst;
+	struct x86_uop_t uop;
+
+	unsigned int block;
+
+	int core = ctx->core;
+	int thread = ctx->thread;
+	int i;
+
+	/* Instruction cache */
+	block = eip & ~(X86_THREAD.inst_mod->block_size - 1);
+	if (block != X86_THREAD.fetch_block)
+	{
+		X86_THREAD.fetch_block = block;
+		client_info = mod_client_info_create(X86_THREAD.inst_mod);
+		client_info->prefetcher_eip = -1;
+		client_info->core = core;
+		client_info->thread = thread;
+		client_info->ctx = ctx;
+		client_info->instr_fetch = 1;
+		mod_warm_access(X86_THREAD.inst_mod, mmu_translate(ctx->address_space_index,
+			eip), 0, client_info);
+		mod_client_info_free(X86_THREAD.inst_mod, client_info);
+	}
+
+	/* Data cache and branch predictor */
+	LIST_FOR_EACH(x86_uinst_list, i)
+	{
+		uinst = list_get(x86_uinst_list, i);
+		if (x86_uinst_info[uinst->opcode].flags & X86_UINST_MEM)
+		{
+			client_info = mod_client_info_create(X86_THREAD.data_mod);
+			client_info->prefetcher_eip = eip;
+			client_info->core = core;
+			client_info->thread = thread;
+			client_info->ctx = ctx;
+			mod_warm_access(X86_THREAD.data_mod, mmu_translate(ctx->address_space_index,
+				uinst->address), uinst->opcode == x86_uinst_store, client_info);
+			mod_client_info_free(X86_THREAD.data_mod, client_info);
+		}
+		if (x86_uinst_info[uinst->opcode].flags & X86_UINST_CTRL)
+		{
+			memset(&uop, 0, sizeof uop);
+			uop.uinst = uinst;
+			uop.flags = x86_uinst_info[uinst->opcode].flags;
+			uop.ctx = ctx;
+			uop.core = core;
+			uop.thread = thread;
+			uop.eip = eip;
+			uop.neip = ctx->regs->eip;
+			uop.mop_size = ctx->inst.size;
+			x86_bpred_warm(X86_THREAD.bpred, &uop);
+		}
+	}
+}
+
+
+/* Emulate 'count' instructions on the running contexts, warming up the
+ * structures of the hardware threads they are allocated to. */
+static void x86_sampling_functional(long long count)
+{
+	struct x86_ctx_t *ctx;
+
+	unsigned int eip;
+
+	int core;
+	int thread;
+	int warm;
+
+	while (count > 0 && x86_emu->running_list_head && !esim_finish)
+	{
+		for (ctx = x86_emu->running_list_head; ctx; ctx = ctx->running_list_next)
+		{
+			eip = ctx->regs->eip;
+			x86_ctx_execute(ctx);
+			ctx->num_committed_inst++;
+			x86_sampling.functional_inst++;
+			count--;
+
+			warm = x86_sampling_functional_warming &&
+				x86_ctx_get_state(ctx, x86_ctx_alloc);
+			if (warm && ctx->inst.size)
+				x86_sampling_warm(ctx, eip);
+			x86_uinst_clear();
+		}
+		x86_emu_process_events();
+	}
+
+	/* Resume fetch where emulation stopped */
+	X86_CORE_FOR_EACH
+	{
+		X86_THREAD_FOR_EACH
+		{
+			ctx = X86_THREAD.ctx;
+			if (ctx)
+				X86_THREAD.fetch_neip = ctx->regs->eip;
+		}
+	}
+}
+
+
+/* Return TRUE if no instruction or memory access is in flight */
+static int x86_sampling_drained(void)
+{
+	struct x86_ctx_t *ctx;
+	struct mod_t *mod;
+
+	int core;
+	int thread;
+	int i;
+
+	X86_CORE_FOR_EACH
+	{
+		X86_THREAD_FOR_EACH
+		{
+			if (!x86_cpu_pipeline_empty(core, thread) ||
+					linked_list_count(X86_THREAD.sq) ||
+					linked_list_count(X86_THREAD.aq))
+				return 0;
+			ctx = X86_THREAD.ctx;
+			if (ctx && x86_ctx_get_state(ctx, x86_ctx_spec_mode))
+				return 0;
+		}
+	}
+	LIST_FOR_EACH(mem_system->mod_list, i)
+	{
+		mod = list_get(mem_system->mod_list, i);
+		if (mod->access_list_count)
+			return 0;
+	}
+	return 1;
+}
+
+
+static void x86_sampling_set_phase(enum x86_sampling_phase_t phase)
+{
+	x86_sampling.phase = phase;
+	x86_sampling.phase_inst = x86_cpu->num_committed_inst;
+	x86_sampling.phase_cycle = arch_x86->cycle;
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
+void x86_sampling_read_config(struct config_t *config)
+{
+	char *section;
+	char *file_name;
+
+	/* Section in configuration file */
+	section = "Sampling";
+	file_name = config_get_file_name(config);
+
+	/* Read variables */
+	x86_sampling_period = config_read_llint(config, section, "Period", 0);
+	x86_sampling_functional_warming = config_read_bool(config, section,
+		"FunctionalWarming", 1);
+	x86_sampling_warm_up = config_read_llint(config, section, "DetailedWarmUp", 2000);
+	x86_sampling_measure = config_read_llint(config, section, "Measure", 1000);
+
+	/* Integrity checks */
+	if (x86_sampling_period < 0)
+		fatal("%s: %s: invalid value for 'Period'", file_name, section);
+	if (x86_sampling_warm_up < 0)
+		fatal("%s: %s: invalid value for 'DetailedWarmUp'", file_name, section);
+	if (x86_sampling_measure < 1)
+		fatal("%s: %s: invalid value for 'Measure'", file_name, section);
+	if (x86_sampling_period && x86_sampling_period <=
+			x86_sampling_warm_up + x86_sampling_measure)
+		fatal("%s: %s: 'Period' must be greater than 'DetailedWarmUp' + 'Measure'",
+			file_name, section);
+}
+
+
+/* The first sampling unit starts at the beginning of the detailed
+ * simulation, after its warm-up. */
+void x86_sampling_init(void)
+{
+	memset(&x86_sampling, 0, sizeof x86_sampling);
+	x86_sampling.phase = x86_sampling_phase_warm_up;
+}
+
+
+void x86_sampling_done(void)
+{
+}
+
+
+/* Called once per cycle before running the pipeline stages */
+void x86_sampling_run(void)
+{
+	long long inst;
+	long long cycles;
+	double cpi;
+
+	/* Statistics were reset, restart phase */
+	if (x86_cpu->num_committed_inst < x86_sampling.phase_inst)
+		x86_sampling_set_phase(x86_sampling.phase);
+	inst = x86_cpu->num_committed_inst - x86_sampling.phase_inst;
+
+	switch (x86_sampling.phase)
+	{
+
+	case x86_sampling_phase_warm_up:
+
+		if (inst < x86_sampling_warm_up)
+			break;
+		x86_sampling_set_phase(x86_sampling_phase_measure);
+		break;
+
+	case x86_sampling_phase_measure:
+
+		if (inst < x86_sampling_measure)
+			break;
+
+		/* Record sampling unit */
+		cycles = arch_x86->cycle - x86_sampling.phase_cycle;
+		cpi = (double) cycles / inst;
+		x86_sampling.num_units++;
+		x86_sampling.cpi_acc += cpi;
+		x86_sampling.cpi_sq_acc += cpi * cpi;
+		x86_sampling_set_phase(x86_sampling_phase_drain);
+		break;
+
+	case x86_sampling_phase_drain:
+
+		if (!x86_sampling_drained())
+			break;
+		x86_sampling_set_phase(x86_sampling_phase_functional);
+
+		/* Fall through */
+
+	case x86_sampling_phase_functional:
+
+		x86_sampling_functional(x86_sampling_period - x86_sampling_warm_up -
+			x86_sampling_measure - inst);
+		x86_sampling_set_phase(x86_sampling_phase_warm_up);
+		break;
+	}
+}
+
+
+/* Fetch is stopped while draining the pipeline */
+int x86_sampling_fetch_stopped(void)
+{
+	return x86_sampling_period && x86_sampling.phase == x86_sampling_phase_drain;
+}
+
+
+/* Mean CPI of the sampling units, with the half-width of its 95% confidence
+ * interval and the coefficient of variation, relative to the mean. */
+void x86_sampling_dump_summary(FILE *f)
+{
+	double mean;
+	double var;
+	double cv;
+	double conf;
+	long long n;
+
+	n = x86_sampling.num_units;
+	if (!x86_sampling_period || !n)
+		return;
+
+	mean = x86_sampling.cpi_acc / n;
+	var = n > 1 ? (x86_sampling.cpi_sq_acc - n * mean * mean) / (n - 1) : 0.0;
+	cv = mean ? sqrt(MAX(var, 0.0)) / mean : 0.0;
+	conf = 1.96 * cv / sqrt(n);
+
+	fprintf(f, "SampledFunctionalInstructions = %lld\n", x86_sampling.functional_inst);
+	fprintf(f, "SampledUnits = %lld\n", n);
+	fprintf(f, "SampledCyclesPerInstruction = %.4g\n", mean);
+	fprintf(f, "SampledInstructionsPerCycle = %.4g\n", mean ? 1.0 / mean : 0.0);
+	fprintf(f, "SampledConfidence95 = %.4g\n", conf);
+	fprintf(f, "SampledCoefficientOfVariation = %.4g\n", cv);
+}
@@ -0,0 +1,57 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ARCH_X86_TIMING_SAMPLING_H
+#define ARCH_X86_TIMING_SAMPLING_H
+
+#include <stdio.h>
+
+
+/*
+ * Periodic sampling (SMARTS). Every 'x86_sampling_period' instructions, the
+ * simulation goes through the following phases:
+ *   - Functional simulation, optionally warming up caches and branch
+ *     predictors with the instruction and data streams.
+ *   - Detailed simulation of 'x86_sampling_warm_up' instructions, to fill
+ *     up the pipeline and in-flight structures.
+ *   - Detailed simulation of 'x86_sampling_measure' instructions, whose CPI
+ *     is recorded as one sampling unit.
+ *   - Pipeline drain, with fetch stopped, before switching back to functional
+ *     simulation.
+ */
+
+struct config_t;
+
+extern long long x86_sampling_period;
+extern long long x86_sampling_warm_up;
+extern long long x86_sampling_measure;
+extern int x86_sampling_functional_warming;
+
+void x86_sampling_read_config(struct config_t *config);
+
+void x86_sampling_init(void);
+void x86_sampling_done(void);
+
+void x86_sampling_run(void);
+int x86_sampling_fetch_stopped(void);
+
+void x86_sampling_dump_summary(FILE *f);
+
+
+#endif
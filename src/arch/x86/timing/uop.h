@@ -22,6 +22,8 @@
 
 #include <arch/x86/emu/uinst.h>
 
+#include "bpred.h"
+
 struct x86_uop_t
 {
 	/* Micro-instruction */
@@ -85,6 +87,13 @@ struct x86_uop_t
 
 	/* For memory uops */
 	unsigned int phy_addr;  /* ... corresponding to 'uop->uinst->address' */
+	long long cpi_dram_slots;  /* Commit slots lost waiting for main memory */
+
+	/* Memory dependences */
+	int mem_dep_resolved;  /* Store address checked against younger loads */
+	int mem_dep_violation;  /* Load issued before an older conflicting store */
+	long long mem_dep_store;  /* 'id_in_core' of store the load waits for, or -1 */
+	long long mem_dep_forward;  /* 'id_in_core' of store forwarding to the load, or -1 */
 
 	/* Cycles */
 	long long when;  /* cycle when ready */
@@ -96,6 +105,7 @@ struct x86_uop_t
 	int bimod_index, bimod_pred;
 	int twolevel_bht_index, twolevel_pht_row, twolevel_pht_col, twolevel_pred;
 	int choice_index, choice_pred;
+	struct x86_bpred_info_t pred_info;  /* TAGE-SC-L and perceptron */
 };
 
 struct x86_uop_t *x86_uop_create(void);
@@ -69,6 +69,13 @@ void dram_system_dram_tick(struct dram_system_handler_t *ds)
 }
 
 
+void dram_system_set_num_threads(struct dram_system_handler_t *ds, int num_threads)
+{
+	assert(num_threads > 0);
+	ds->setNumUpdateThreads((unsigned) num_threads);
+}
+
+
 void dram_system_set_epoch_length(struct dram_system_handler_t *ds, unsigned long long epoch_lenght)
 {
 	EPOCH_LENGTH = epoch_lenght;
@@ -93,6 +100,12 @@ bool dram_system_will_accept_trans(struct dram_system_handler_t *ds, unsigned lo
 }
 
 
+double dram_system_trans_queue_occupancy(struct dram_system_handler_t *ds, unsigned long long addr)
+{
+	return ds->getTransactionQueueOccupancy(addr);
+}
+
+
 void dram_system_register_callbacks(
 		struct dram_system_handler_t *ds,
 		void(*read_done)(unsigned int, uint64_t, uint64_t),
@@ -58,12 +58,19 @@ int dram_system_get_num_mcs(struct dram_system_handler_t *ds);
 void dram_system_cpu_tick(struct dram_system_handler_t *ds);
 void dram_system_dram_tick(struct dram_system_handler_t *ds);
 
+/* Number of host threads updating the channels of the dram system on each
+ * dram tick. Completion callbacks are still invoked from the calling thread. */
+void dram_system_set_num_threads(struct dram_system_handler_t *ds, int num_threads);
+
 void dram_system_set_epoch_length(struct dram_system_handler_t *ds, unsigned long long epoch_lenght);
 void dram_system_print_stats(struct dram_system_handler_t *ds);
 void dram_system_print_final_stats(struct dram_system_handler_t *ds);
 
 bool dram_system_will_accept_trans(struct dram_system_handler_t *ds, unsigned long long addr);
 
+/* Fraction (0..1) of the transaction queue in use in the channel of the address */
+double dram_system_trans_queue_occupancy(struct dram_system_handler_t *ds, unsigned long long addr);
+
 void dram_system_register_callbacks(
 		struct dram_system_handler_t *ds,
 		void (*read_done)(unsigned int, uint64_t, uint64_t),
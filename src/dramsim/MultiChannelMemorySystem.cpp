@@ -45,6 +45,10 @@
 
 using namespace DRAMSim;
 
+/* Iterations a thread busy-waits for the next step of a parallel channel
+ * update before giving up the host core. */
+#define DRAMSIM_WORKER_SPINS 4096
+
 
 MultiChannelMemorySystem::MultiChannelMemorySystem(
 		const string &deviceIniFilename_,
@@ -62,7 +66,16 @@ MultiChannelMemorySystem::MultiChannelMemorySystem(
 		pwd(pwd_),
 		visFilename(visFilename_),
 		clockDomainCrosser(Callback<MultiChannelMemorySystem, void>(this, &MultiChannelMemorySystem::actual_update)),
-		csvOut(new CSVWriter(visDataOut))
+		csvOut(new CSVWriter(visDataOut)),
+		readDone(NULL),
+		writeDone(NULL),
+		channelReadDoneCB(NULL),
+		channelWriteDoneCB(NULL),
+		numUpdateThreads(1),
+		deferCompletions(false),
+		updateGeneration(0),
+		pendingWorkers(0),
+		workersStopping(false)
 {
 	currentClockCycle=0;
 	if (visFilename != "")
@@ -113,6 +126,7 @@ MultiChannelMemorySystem::MultiChannelMemorySystem(
 		MemorySystem *channel = new MemorySystem(i, megsOfMemory/NUM_CHANS, (*csvOut), dramsim_log);
 		channels.push_back(channel);
 	}
+	deferredCompletions.resize(NUM_CHANS);
 }
 /* Initialize the ClockDomainCrosser to use the CPU speed
 	If cpuClkFreqHz == 0, then assume a 1:1 ratio (like for TraceBasedSim)
@@ -362,6 +376,8 @@ void MultiChannelMemorySystem::mkdirIfNotExist(string path)
 
 MultiChannelMemorySystem::~MultiChannelMemorySystem()
 {
+	stopWorkers();
+
 	for (size_t i=0; i<NUM_CHANS; i++)
 	{
 		delete channels[i];
@@ -381,6 +397,8 @@ MultiChannelMemorySystem::~MultiChannelMemorySystem()
 
 	delete readDone;
 	delete writeDone;
+	delete channelReadDoneCB;
+	delete channelWriteDoneCB;
 	delete csvOut;
 }
 
@@ -402,14 +420,188 @@ void MultiChannelMemorySystem::actual_update()
 	if (currentClockCycle % EPOCH_LENGTH == 0)
 		printStats(false);
 
-	for (size_t i=0; i<NUM_CHANS; i++)
+	if (workers.empty())
 	{
-		channels[i]->update();
+		for (size_t i=0; i<NUM_CHANS; i++)
+		{
+			channels[i]->update();
+		}
+	}
+	else
+	{
+		updateChannelsParallel();
 	}
 
 
 	currentClockCycle++;
 }
+
+
+/* Update the channels statically assigned to a worker. The main thread is
+ * worker 0 and takes part in the update as well. */
+void MultiChannelMemorySystem::updateChannels(unsigned workerId)
+{
+	for (size_t i=workerId; i<NUM_CHANS; i+=numUpdateThreads)
+	{
+		channels[i]->update();
+	}
+}
+
+
+void MultiChannelMemorySystem::updateChannelsParallel()
+{
+	deferCompletions = true;
+
+	/* Release the workers for one DRAM cycle */
+	pendingWorkers.store(workers.size(), std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(workersMutex);
+		updateGeneration.fetch_add(1, std::memory_order_release);
+	}
+	workersCond.notify_all();
+
+	updateChannels(0);
+
+	/* The update of a channel is short, so busy-wait for the rest */
+	unsigned spins = 0;
+	while (pendingWorkers.load(std::memory_order_acquire))
+	{
+		if (++spins > DRAMSIM_WORKER_SPINS)
+			std::this_thread::yield();
+	}
+
+	deferCompletions = false;
+	deliverDeferredCompletions();
+}
+
+
+void MultiChannelMemorySystem::deliverDeferredCompletions()
+{
+	for (size_t i=0; i<NUM_CHANS; i++)
+	{
+		vector<DeferredCompletion> &queue = deferredCompletions[i];
+		for (size_t j=0; j<queue.size(); j++)
+		{
+			TransactionCompleteCB *cb = queue[j].isWrite ? writeDone : readDone;
+			if (cb)
+				(*cb)(i, queue[j].address, queue[j].interthreadPenalty);
+		}
+		queue.clear();
+	}
+}
+
+
+void MultiChannelMemorySystem::workerLoop(unsigned workerId)
+{
+	uint64_t generation = 0;
+	unsigned spins;
+
+	for (;;)
+	{
+		/* Spin for a while before going to sleep, since most of the time
+		 * the next DRAM cycle comes right after. */
+		spins = 0;
+		while (updateGeneration.load(std::memory_order_acquire) == generation)
+		{
+			if (++spins < DRAMSIM_WORKER_SPINS)
+				continue;
+
+			std::unique_lock<std::mutex> lock(workersMutex);
+			workersCond.wait(lock, [this, generation] {
+				return updateGeneration.load(std::memory_order_acquire) != generation;
+			});
+		}
+		generation++;
+
+		if (workersStopping.load(std::memory_order_acquire))
+			return;
+
+		updateChannels(workerId);
+		pendingWorkers.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+
+void MultiChannelMemorySystem::stopWorkers()
+{
+	if (workers.empty())
+		return;
+
+	workersStopping.store(true, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(workersMutex);
+		updateGeneration.fetch_add(1, std::memory_order_release);
+	}
+	workersCond.notify_all();
+	for (size_t i=0; i<workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+	workersStopping.store(false, std::memory_order_relaxed);
+	updateGeneration.store(0, std::memory_order_relaxed);
+}
+
+
+void MultiChannelMemorySystem::setNumUpdateThreads(unsigned numThreads)
+{
+	stopWorkers();
+
+	if (numThreads == 0)
+		numThreads = 1;
+	if (numThreads > NUM_CHANS)
+		numThreads = NUM_CHANS;
+
+	/* Workers busy-wait, so oversubscribing the host is counterproductive */
+	unsigned hostThreads = std::thread::hardware_concurrency();
+	if (hostThreads && numThreads > hostThreads)
+	{
+		ERROR("Warning: only "<<hostThreads<<" host threads available, using "<<hostThreads<<" channel update threads");
+		numThreads = hostThreads;
+	}
+
+	/* The verification output is a single stream shared by all channels */
+	if (VERIFICATION_OUTPUT && numThreads > 1)
+	{
+		ERROR("Warning: verification output enabled, channels will be updated sequentially");
+		numThreads = 1;
+	}
+
+	numUpdateThreads = numThreads;
+	for (unsigned i=1; i<numUpdateThreads; i++)
+		workers.push_back(std::thread(&MultiChannelMemorySystem::workerLoop, this, i));
+}
+
+
+unsigned MultiChannelMemorySystem::getNumUpdateThreads()
+{
+	return numUpdateThreads;
+}
+
+
+void MultiChannelMemorySystem::channelReadDone(unsigned id, uint64_t address, uint64_t interthreadPenalty)
+{
+	if (!deferCompletions)
+	{
+		(*readDone)(id, address, interthreadPenalty);
+		return;
+	}
+
+	/* Each channel is updated by a single thread, so its queue needs no lock */
+	DeferredCompletion completion = { false, address, interthreadPenalty };
+	deferredCompletions[id].push_back(completion);
+}
+
+
+void MultiChannelMemorySystem::channelWriteDone(unsigned id, uint64_t address, uint64_t interthreadPenalty)
+{
+	if (!deferCompletions)
+	{
+		(*writeDone)(id, address, interthreadPenalty);
+		return;
+	}
+
+	DeferredCompletion completion = { true, address, interthreadPenalty };
+	deferredCompletions[id].push_back(completion);
+}
 unsigned MultiChannelMemorySystem::findChannelNumber(uint64_t addr)
 {
 	// Single channel case is a trivial shortcut case
@@ -477,6 +669,16 @@ bool MultiChannelMemorySystem::willAcceptTransaction(uint64_t addr)
 }
 
 
+/* Fraction of the transaction queue in use in the channel the address maps
+ * to. Used by clients to back off before the queue is actually full. */
+double MultiChannelMemorySystem::getTransactionQueueOccupancy(uint64_t addr)
+{
+	unsigned chan, rank,bank,row,col;
+	addressMapping(addr, chan, rank, bank, row, col);
+	return (double) channels[chan]->memoryController->transactionQueue.size() / TRANS_QUEUE_DEPTH;
+}
+
+
 bool MultiChannelMemorySystem::willAcceptTransaction()
 {
 	for (size_t c=0; c<NUM_CHANS; c++) {
@@ -504,11 +706,23 @@ void MultiChannelMemorySystem::RegisterCallbacks(
 		TransactionCompleteCB const &writeDone,
 		void (*reportPower)(double bgpower, double burstpower, double refreshpower, double actprepower))
 {
+	typedef Callback<MultiChannelMemorySystem, void, unsigned, uint64_t, uint64_t> ChannelCB;
+
+	delete this->readDone;
+	delete this->writeDone;
 	this->readDone = readDone.clone();
 	this->writeDone = writeDone.clone();
 
+	/* Channels report completions through this object, which forwards them
+	 * right away or defers them during a parallel update. */
+	if (!channelReadDoneCB)
+	{
+		channelReadDoneCB = new ChannelCB(this, &MultiChannelMemorySystem::channelReadDone);
+		channelWriteDoneCB = new ChannelCB(this, &MultiChannelMemorySystem::channelWriteDone);
+	}
+
 	for (size_t i=0; i<NUM_CHANS; i++)
-		channels[i]->RegisterCallbacks(this->readDone, this->writeDone, reportPower);
+		channels[i]->RegisterCallbacks(channelReadDoneCB, channelWriteDoneCB, reportPower);
 }
 
 
@@ -35,6 +35,11 @@
 #include "ClockDomain.h"
 #include "CSVWriter.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 
 namespace DRAMSim {
 
@@ -52,6 +57,7 @@ class MultiChannelMemorySystem : public SimulatorObject
 		bool addTransaction(bool isWrite, uint64_t addr, int core=-1, int thread=-1);
 		bool willAcceptTransaction();
 		bool willAcceptTransaction(uint64_t addr);
+		double getTransactionQueueOccupancy(uint64_t addr);
 		void update(); /* If CPU ticks used, called every CPU cycle */
 		void actual_update(); /* If DRAM ticks used, called every DRAM cycle */
 		void printStats(bool finalStats=false);
@@ -66,6 +72,11 @@ class MultiChannelMemorySystem : public SimulatorObject
 		MemoryController* getMemoryController(unsigned mc);
 		unsigned getNumMemoryControllers();
 
+		/* Number of host threads used to update the channels every DRAM
+		 * cycle. A value of 1 (default) keeps the sequential update. */
+		void setNumUpdateThreads(unsigned numThreads);
+		unsigned getNumUpdateThreads();
+
 		//output file
 		std::ofstream visDataOut;
 		ofstream dramsim_log;
@@ -85,6 +96,36 @@ class MultiChannelMemorySystem : public SimulatorObject
 		CSVWriter *csvOut;
 		TransactionCompleteCB *readDone;
 		TransactionCompleteCB *writeDone;
+
+		/* Parallel channel update. Channels only share state through the
+		 * completion callbacks, so while the workers are running those are
+		 * queued per channel and delivered afterwards by the main thread in
+		 * channel order, which is the order of the sequential update. */
+		struct DeferredCompletion
+		{
+			bool isWrite;
+			uint64_t address;
+			uint64_t interthreadPenalty;
+		};
+		void channelReadDone(unsigned id, uint64_t address, uint64_t interthreadPenalty);
+		void channelWriteDone(unsigned id, uint64_t address, uint64_t interthreadPenalty);
+		void updateChannels(unsigned workerId);
+		void updateChannelsParallel();
+		void deliverDeferredCompletions();
+		void workerLoop(unsigned workerId);
+		void stopWorkers();
+
+		TransactionCompleteCB *channelReadDoneCB;
+		TransactionCompleteCB *channelWriteDoneCB;
+		vector<vector<DeferredCompletion> > deferredCompletions;
+		vector<std::thread> workers;
+		unsigned numUpdateThreads;
+		bool deferCompletions;
+		std::atomic<uint64_t> updateGeneration;
+		std::atomic<unsigned> pendingWorkers;
+		std::atomic<bool> workersStopping;
+		std::mutex workersMutex;
+		std::condition_variable workersCond;
 	};
 }
 
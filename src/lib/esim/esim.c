@@ -65,13 +65,14 @@ volatile enum esim_finish_t esim_finish = esim_finish_none;
 
 struct str_map_t esim_finish_map =
 {
-	21, {
+	23, {
 		{ "ContextsFinished", esim_finish_ctx },
 
 		{ "x86LastInst", esim_finish_x86_last_inst },
 		{ "x86MaxInst", esim_finish_x86_max_inst },
 		{ "x86MinInstPerCtx", esim_finish_x86_min_inst_per_ctx },
 		{ "x86MaxCycles", esim_finish_x86_max_cycles },
+		{ "x86SimPoints", esim_finish_x86_simpoints },
 
 		{ "ArmMaxInst", esim_finish_arm_max_inst },
 		{ "ArmMaxCycles", esim_finish_arm_max_cycles },
@@ -249,6 +250,43 @@ long long esim_cycle(void)
 }
 
 
+long long esim_domain_skip_cycles(int domain_index, long long cycles)
+{
+	struct esim_domain_t *domain;
+	struct esim_event_t *event;
+
+	long long cycle;
+	long long when;
+	long long max_cycles;
+
+	/* Get domain */
+	domain = list_get(esim_domain_list, domain_index);
+	if (!domain)
+		panic("%s: invalid domain index (%d)",
+				__FUNCTION__, domain_index);
+
+	/* A domain cycle runs in the first iteration of the main loop at or after
+	 * its start, after the events of the previous iterations. Do not skip a
+	 * cycle that would see the next pending event. */
+	cycle = esim_time / domain->cycle_time + 1;
+	when = heap_peek(esim_event_heap, (void **) &event);
+	if (!heap_error(esim_event_heap))
+	{
+		max_cycles = (when + esim_cycle_time - 1) / esim_cycle_time *
+			esim_cycle_time / domain->cycle_time - cycle;
+		cycles = MIN(cycles, max_cycles);
+	}
+	if (cycles <= 0)
+		return 0;
+
+	/* Leave time at the iteration right before the one running the next
+	 * domain cycle. The caller's iteration ends by advancing to it. */
+	esim_time = ((cycle + cycles) * domain->cycle_time + esim_cycle_time - 1) /
+		esim_cycle_time * esim_cycle_time - esim_cycle_time;
+	return cycles;
+}
+
+
 
 
 /*
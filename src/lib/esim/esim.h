@@ -41,6 +41,7 @@ extern volatile enum esim_finish_t
 	esim_finish_x86_max_inst,  /* Maximum instruction count reached in x86 CPU */
 	esim_finish_x86_min_inst_per_ctx,  /* Minimum instruction count reached in each ctx */
 	esim_finish_x86_max_cycles,  /* Maximum cycle count reached in x86 CPU */
+	esim_finish_x86_simpoints,  /* All SimPoint checkpoints saved */
 
 	esim_finish_arm_max_inst,
 	esim_finish_arm_max_cycles,
@@ -125,6 +126,14 @@ int esim_domain_frequency(int domain_index);
 /* Return the current cycle of the fastest domain. */
 long long esim_cycle(void);
 
+/* Advance global time by up to 'cycles' cycles of a frequency domain, as long
+ * as no event is due in between. This lets an architecture that knows it will
+ * be idle until some event skip the intermediate iterations of the main loop.
+ * The function must be called from the timing simulation of the domain, and
+ * the next cycle it runs is the one after the skipped ones. It returns the
+ * number of domain cycles actually skipped. */
+long long esim_domain_skip_cycles(int domain_index, long long cycles);
+
 
 /* Register an event, optionally giving an event name. These functions take an
  * additional argument 'domain_index', specifying the frequency domain that the
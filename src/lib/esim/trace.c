@@ -18,16 +18,32 @@
  */
 
 #include <assert.h>
+#include <ctype.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 #include <zlib.h>
 
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
 #include <lib/util/list.h>
+#include <lib/util/misc.h>
+#include <lib/util/string.h>
 
 #include "esim.h"
+#include "trace.h"
 
 
+struct str_map_t trace_format_map =
+{
+	2, {
+		{ "text", trace_format_text },
+		{ "binary", trace_format_binary }
+	}
+};
+
+enum trace_format_t trace_format = trace_format_text;
+
 static gzFile trace_file;
 static struct list_t *trace_category_list;
 
@@ -44,6 +60,550 @@ struct trace_category_t
 };
 
 
+
+/*
+ * Binary Trace
+ */
+
+/* Uncompressed size after which a block is closed at the next cycle */
+#define TRACE_BIN_BLOCK_SIZE  (1 << 16)
+
+/* Strings longer than this are stored as literals in the records */
+#define TRACE_BIN_MAX_STRING_SIZE  64
+
+/* Maximum number of symbols in a line record */
+#define TRACE_BIN_MAX_SYMBOLS  64
+
+#define isidchar(c) (isalnum((c)) || (c) == '.' || (c) == '_' || (c) =='-')
+
+static struct
+{
+	FILE *f;
+	long long offset;
+
+	/* Uncompressed records of current block */
+	unsigned char *block;
+	int block_size;
+	int block_max_size;
+	unsigned char *zblock;
+	int zblock_max_size;
+
+	/* First and last cycle records of current block, -1 if none */
+	long long block_first_cycle;
+	long long block_last_cycle;
+
+	/* Block number, used to invalidate last values of symbols */
+	int block_num;
+
+	/* String table */
+	int *string_table;
+	int string_table_size;
+	struct list_t *string_list;
+
+	/* Last integer value of each symbol name in the block, indexed by string
+	 * identifier, valid if 'value_block[id]' is the current block. */
+	long long *value;
+	int *value_block;
+	int value_max_size;
+
+	/* Index */
+	long long *index;
+	int index_max_size;
+
+	long long last_cycle;
+} trace_bin;
+
+
+static void trace_bin_write(void *buf, int size)
+{
+	if (fwrite(buf, 1, size, trace_bin.f) != size)
+		fatal("%s: cannot write trace file", __FUNCTION__);
+	trace_bin.offset += size;
+}
+
+
+static void trace_bin_write_fixed(unsigned long long value, int size)
+{
+	unsigned char buf[8];
+	int i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = value >> (i * 8);
+	trace_bin_write(buf, size);
+}
+
+
+static void trace_bin_put(void *buf, int size)
+{
+	if (trace_bin.block_size + size > trace_bin.block_max_size)
+	{
+		trace_bin.block_max_size = MAX(trace_bin.block_max_size * 2,
+			trace_bin.block_size + size);
+		trace_bin.block = xrealloc(trace_bin.block, trace_bin.block_max_size);
+	}
+	memcpy(trace_bin.block + trace_bin.block_size, buf, size);
+	trace_bin.block_size += size;
+}
+
+
+/* Encode 'value' in 'buf' in groups of 7 bits, least significant first, with
+ * the most significant bit of each byte set if more bytes follow. Return the
+ * number of bytes used, at most 10. */
+static int trace_bin_encode_varint(unsigned char *buf, unsigned long long value)
+{
+	int size = 0;
+
+	while (value >= 0x80)
+	{
+		buf[size++] = value | 0x80;
+		value >>= 7;
+	}
+	buf[size++] = value;
+	return size;
+}
+
+
+static void trace_bin_put_varint(unsigned long long value)
+{
+	unsigned char buf[10];
+
+	trace_bin_put(buf, trace_bin_encode_varint(buf, value));
+}
+
+
+static void trace_bin_put_byte(unsigned char value)
+{
+	trace_bin_put(&value, 1);
+}
+
+
+/* Return the identifier of string 's' with length 'len', adding it to the
+ * string table if needed. The table is an open-addressing hash table of
+ * identifiers plus one, kept at most half full. */
+static int trace_bin_string(char *s, int len)
+{
+	unsigned int hash;
+	unsigned int index;
+	char *str;
+	int id;
+	int i;
+
+	/* FNV-1a hash */
+	hash = 2166136261u;
+	for (i = 0; i < len; i++)
+		hash = (hash ^ (unsigned char) s[i]) * 16777619u;
+
+	/* Look up */
+	for (index = hash & (trace_bin.string_table_size - 1);
+		(id = trace_bin.string_table[index]);
+		index = (index + 1) & (trace_bin.string_table_size - 1))
+	{
+		str = list_get(trace_bin.string_list, id - 1);
+		if (!strncmp(str, s, len) && !str[len])
+			return id - 1;
+	}
+
+	/* Add string */
+	id = list_count(trace_bin.string_list);
+	str = xmalloc(len + 1);
+	memcpy(str, s, len);
+	str[len] = '\0';
+	list_add(trace_bin.string_list, str);
+	trace_bin.string_table[index] = id + 1;
+
+	/* Grow table */
+	if (list_count(trace_bin.string_list) * 2 > trace_bin.string_table_size)
+	{
+		free(trace_bin.string_table);
+		trace_bin.string_table_size *= 2;
+		trace_bin.string_table = xcalloc(trace_bin.string_table_size, sizeof(int));
+		LIST_FOR_EACH(trace_bin.string_list, i)
+		{
+			str = list_get(trace_bin.string_list, i);
+			hash = 2166136261u;
+			for (len = 0; str[len]; len++)
+				hash = (hash ^ (unsigned char) str[len]) * 16777619u;
+			for (index = hash & (trace_bin.string_table_size - 1);
+				trace_bin.string_table[index];
+				index = (index + 1) & (trace_bin.string_table_size - 1));
+			trace_bin.string_table[index] = i + 1;
+		}
+	}
+	return id;
+}
+
+
+/* Record the difference between 'value' and the last value of symbol 'name' */
+static void trace_bin_put_value(int name, long long value)
+{
+	unsigned long long delta;
+	int size;
+
+	if (name >= trace_bin.value_max_size)
+	{
+		size = trace_bin.value_max_size;
+		trace_bin.value_max_size = MAX(size * 2, name + 1);
+		trace_bin.value = xrealloc(trace_bin.value,
+			trace_bin.value_max_size * sizeof(long long));
+		trace_bin.value_block = xrealloc(trace_bin.value_block,
+			trace_bin.value_max_size * sizeof(int));
+		memset(trace_bin.value_block + size, -1,
+			(trace_bin.value_max_size - size) * sizeof(int));
+	}
+	if (trace_bin.value_block[name] != trace_bin.block_num)
+	{
+		trace_bin.value_block[name] = trace_bin.block_num;
+		trace_bin.value[name] = 0;
+	}
+
+	delta = (unsigned long long) value - trace_bin.value[name];
+	trace_bin.value[name] = value;
+	trace_bin_put_varint((delta << 1) ^ -(delta >> 63));
+}
+
+
+/* Return TRUE if the 'len' characters in 's' are a decimal number as printed
+ * with '%lld', returning it in 'value'. */
+static int trace_bin_is_dec(char *s, int len, long long *value)
+{
+	int neg;
+	int i;
+
+	neg = len && *s == '-';
+	if (len - neg < 1 || len - neg > 18)
+		return 0;
+	if (s[neg] == '0' && (neg || len > 1))
+		return 0;
+	*value = 0;
+	for (i = neg; i < len; i++)
+	{
+		if (!isdigit(s[i]))
+			return 0;
+		*value = *value * 10 + s[i] - '0';
+	}
+	if (neg)
+		*value = -*value;
+	return 1;
+}
+
+
+/* Return TRUE if the 'len' characters in 's' are a hexadecimal number as
+ * printed with '0x%llx', returning it in 'value'. */
+static int trace_bin_is_hex(char *s, int len, long long *value)
+{
+	unsigned long long hex;
+	int i;
+
+	if (len < 3 || len > 18 || s[0] != '0' || s[1] != 'x')
+		return 0;
+	if (s[2] == '0' && len > 3)
+		return 0;
+	hex = 0;
+	for (i = 2; i < len; i++)
+	{
+		if (isdigit(s[i]))
+			hex = hex * 16 + s[i] - '0';
+		else if (s[i] >= 'a' && s[i] <= 'f')
+			hex = hex * 16 + s[i] - 'a' + 10;
+		else
+			return 0;
+	}
+	*value = hex;
+	return 1;
+}
+
+
+static void trace_bin_put_symbol(char *name, int name_len, char *value, int len)
+{
+	long long dec;
+	int name_id;
+	int prefix_len;
+
+	/* Integers */
+	name_id = trace_bin_string(name, name_len);
+	trace_bin_put_varint(name_id);
+	if (trace_bin_is_dec(value, len, &dec))
+	{
+		trace_bin_put_byte(trace_bin_value_dec);
+		trace_bin_put_value(name_id, dec);
+		return;
+	}
+	if (trace_bin_is_hex(value, len, &dec))
+	{
+		trace_bin_put_byte(trace_bin_value_hex);
+		trace_bin_put_value(name_id, dec);
+		return;
+	}
+
+	/* Prefix followed by decimal, such as memory access names */
+	prefix_len = len;
+	while (prefix_len && isdigit(value[prefix_len - 1]))
+		prefix_len--;
+	if (prefix_len && prefix_len < len && prefix_len <= TRACE_BIN_MAX_STRING_SIZE &&
+		trace_bin_is_dec(value + prefix_len, len - prefix_len, &dec))
+	{
+		trace_bin_put_byte(trace_bin_value_prefix_dec);
+		trace_bin_put_varint(trace_bin_string(value, prefix_len));
+		trace_bin_put_value(name_id, dec);
+		return;
+	}
+
+	/* Strings */
+	if (len > TRACE_BIN_MAX_STRING_SIZE)
+	{
+		trace_bin_put_byte(trace_bin_value_literal);
+		trace_bin_put_varint(len);
+		trace_bin_put(value, len);
+		return;
+	}
+	trace_bin_put_byte(trace_bin_value_string);
+	trace_bin_put_varint(trace_bin_string(value, len));
+}
+
+
+/* Encode a line of a text trace with length 'len'. The line is split with the
+ * same rules used by the visualization tool to read text traces. Lines with a
+ * different format are stored as text records. */
+static void trace_bin_put_line(char *line, int len)
+{
+	char *symbol_name[TRACE_BIN_MAX_SYMBOLS];
+	char *symbol_value[TRACE_BIN_MAX_SYMBOLS];
+	int symbol_name_len[TRACE_BIN_MAX_SYMBOLS];
+	int symbol_value_len[TRACE_BIN_MAX_SYMBOLS];
+
+	char *command;
+	char *end;
+	char *s;
+
+	int num_symbols;
+	int i;
+
+	/* Ignore empty lines */
+	end = line + len;
+	for (s = line; s < end && isspace(*s); s++);
+	if (s == end)
+		return;
+
+	/* Command */
+	command = s;
+	while (s < end && isidchar(*s))
+		s++;
+	if (s == command || (s < end && !isspace(*s)))
+		goto text;
+	i = s - command;
+
+	/* Symbols */
+	num_symbols = 0;
+	while (s < end && isspace(*s))
+		s++;
+	while (s < end)
+	{
+		if (num_symbols == TRACE_BIN_MAX_SYMBOLS)
+			goto text;
+
+		/* Name */
+		symbol_name[num_symbols] = s;
+		while (s < end && isidchar(*s))
+			s++;
+		if (s == end || *s != '=')
+			goto text;
+		symbol_name_len[num_symbols] = s - symbol_name[num_symbols];
+		s++;
+
+		/* Value */
+		if (s < end && *s == '"')
+		{
+			symbol_value[num_symbols] = ++s;
+			while (s < end && *s != '"')
+				s++;
+			if (s == end)
+				goto text;
+			symbol_value_len[num_symbols] = s - symbol_value[num_symbols];
+			s++;
+		}
+		else
+		{
+			symbol_value[num_symbols] = s;
+			while (s < end && isidchar(*s))
+				s++;
+			symbol_value_len[num_symbols] = s - symbol_value[num_symbols];
+		}
+		if (s < end && !isspace(*s))
+			goto text;
+		num_symbols++;
+
+		/* Trailing blanks */
+		while (s < end && isspace(*s))
+			s++;
+	}
+
+	/* Line record */
+	trace_bin_put_varint(trace_bin_record_line + trace_bin_string(command, i));
+	trace_bin_put_varint(num_symbols);
+	for (i = 0; i < num_symbols; i++)
+		trace_bin_put_symbol(symbol_name[i], symbol_name_len[i],
+			symbol_value[i], symbol_value_len[i]);
+	return;
+
+text:
+	/* Text record */
+	trace_bin_put_varint(trace_bin_record_text);
+	trace_bin_put_varint(len);
+	trace_bin_put(line, len);
+}
+
+
+/* Compress and write current block */
+static void trace_bin_flush(void)
+{
+	uLongf zsize;
+	int err;
+
+	/* Nothing to write */
+	if (!trace_bin.block_size)
+		return;
+
+	/* Compress */
+	zsize = compressBound(trace_bin.block_size);
+	if (zsize > trace_bin.zblock_max_size)
+	{
+		trace_bin.zblock_max_size = zsize;
+		trace_bin.zblock = xrealloc(trace_bin.zblock, zsize);
+	}
+	err = compress2(trace_bin.zblock, &zsize, trace_bin.block,
+		trace_bin.block_size, Z_BEST_SPEED);
+	if (err != Z_OK)
+		fatal("%s: cannot compress trace (zlib error %d)", __FUNCTION__, err);
+
+	/* Add index entry. The first block also contains the header, and is
+	 * used for any cycle before its first cycle record. */
+	if (trace_bin.block_num * 2 + 2 > trace_bin.index_max_size)
+	{
+		trace_bin.index_max_size = MAX(trace_bin.index_max_size * 2, 64);
+		trace_bin.index = xrealloc(trace_bin.index,
+			trace_bin.index_max_size * sizeof(long long));
+	}
+	trace_bin.index[trace_bin.block_num * 2] = trace_bin.block_num ?
+		trace_bin.block_first_cycle : 0;
+	trace_bin.index[trace_bin.block_num * 2 + 1] = trace_bin.offset;
+
+	/* Write block */
+	trace_bin_write_fixed(trace_bin.block_size, 4);
+	trace_bin_write_fixed(zsize, 4);
+	trace_bin_write(trace_bin.zblock, zsize);
+
+	/* Start new block */
+	trace_bin.block_size = 0;
+	trace_bin.block_num++;
+	trace_bin.block_first_cycle = -1;
+	trace_bin.block_last_cycle = -1;
+}
+
+
+static void trace_bin_cycle(long long cycle)
+{
+	/* Close block */
+	if (trace_bin.block_size >= TRACE_BIN_BLOCK_SIZE)
+		trace_bin_flush();
+
+	/* Cycle record */
+	trace_bin_put_varint(trace_bin_record_cycle);
+	trace_bin_put_varint(trace_bin.block_last_cycle < 0 ? cycle :
+		cycle - trace_bin.block_last_cycle);
+	if (trace_bin.block_first_cycle < 0)
+		trace_bin.block_first_cycle = cycle;
+	trace_bin.block_last_cycle = cycle;
+	trace_bin.last_cycle = cycle;
+}
+
+
+static void trace_bin_message(char *buf, int len)
+{
+	char *end;
+	char *eol;
+
+	for (end = buf + len; buf < end; buf = eol + 1)
+	{
+		eol = memchr(buf, '\n', end - buf);
+		if (!eol)
+			eol = end;
+		trace_bin_put_line(buf, eol - buf);
+	}
+}
+
+
+static void trace_bin_init(char *file_name)
+{
+	memset(&trace_bin, 0, sizeof trace_bin);
+	trace_bin.f = fopen(file_name, "wb");
+	if (!trace_bin.f)
+		fatal("%s: cannot open trace file", file_name);
+	trace_bin.block_first_cycle = -1;
+	trace_bin.block_last_cycle = -1;
+	trace_bin.string_table_size = 1024;
+	trace_bin.string_table = xcalloc(trace_bin.string_table_size, sizeof(int));
+	trace_bin.string_list = list_create();
+
+	/* Header */
+	trace_bin_write(TRACE_BIN_MAGIC, TRACE_BIN_MAGIC_SIZE);
+	trace_bin_write_fixed(TRACE_BIN_VERSION, 4);
+}
+
+
+static void trace_bin_done(void)
+{
+	long long string_table_offset;
+	long long index_offset;
+	unsigned char buf[10];
+	char *s;
+	int i;
+
+	/* Last block */
+	trace_bin_flush();
+
+	/* String table */
+	string_table_offset = trace_bin.offset;
+	LIST_FOR_EACH(trace_bin.string_list, i)
+	{
+		s = list_get(trace_bin.string_list, i);
+		trace_bin_write(buf, trace_bin_encode_varint(buf, strlen(s)));
+		trace_bin_write(s, strlen(s) + 1);
+	}
+
+	/* Index */
+	index_offset = trace_bin.offset;
+	for (i = 0; i < trace_bin.block_num * 2; i++)
+		trace_bin_write_fixed(trace_bin.index[i], 8);
+
+	/* Trailer */
+	trace_bin_write_fixed(string_table_offset, 8);
+	trace_bin_write_fixed(list_count(trace_bin.string_list), 8);
+	trace_bin_write_fixed(index_offset, 8);
+	trace_bin_write_fixed(trace_bin.block_num, 8);
+	trace_bin_write_fixed(trace_bin.last_cycle, 8);
+	trace_bin_write(TRACE_BIN_MAGIC, TRACE_BIN_MAGIC_SIZE);
+	fclose(trace_bin.f);
+
+	/* Free */
+	LIST_FOR_EACH(trace_bin.string_list, i)
+		free(list_get(trace_bin.string_list, i));
+	list_free(trace_bin.string_list);
+	free(trace_bin.string_table);
+	free(trace_bin.block);
+	free(trace_bin.zblock);
+	free(trace_bin.value);
+	free(trace_bin.value_block);
+	free(trace_bin.index);
+	memset(&trace_bin, 0, sizeof trace_bin);
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
 void trace_init(char *file_name)
 {
 	struct trace_category_t *c;
@@ -53,9 +613,16 @@ void trace_init(char *file_name)
 		return;
 
 	/* Open destination file */
-	trace_file = gzopen(file_name, "wt");
-	if (!trace_file)
-		fatal("%s: cannot open trace file", file_name);
+	if (trace_format == trace_format_binary)
+	{
+		trace_bin_init(file_name);
+	}
+	else
+	{
+		trace_file = gzopen(file_name, "wt");
+		if (!trace_file)
+			fatal("%s: cannot open trace file", file_name);
+	}
 
 	/* Initialize list of categories */
 	trace_category_list = list_create();
@@ -69,11 +636,14 @@ void trace_init(char *file_name)
 void trace_done(void)
 {
 	/* Nothing if trace is inactive */
-	if (!trace_file)
+	if (!trace_category_list)
 		return;
 
 	/* Close trace file */
-	gzclose(trace_file);
+	if (trace_bin.f)
+		trace_bin_done();
+	else
+		gzclose(trace_file);
 
 	/* Free categories */
 	while (trace_category_list->count)
@@ -88,7 +658,7 @@ int trace_new_category(void)
 	struct trace_category_t *c;
 
 	/* If trace system not initialized, return invalid cateogry */
-	if (!trace_file)
+	if (!trace_category_list)
 		return 0;
 
 	/* Initialize */
@@ -144,6 +714,18 @@ void __trace(int category, int print_cycle, char *fmt, ...)
 	if (len + 1 == sizeof buf)
 		fatal("%s: buffer too small", __FUNCTION__);
 
+	/* Binary trace */
+	if (trace_bin.f)
+	{
+		if (cycle > trace_last_cycle && print_cycle)
+		{
+			trace_bin_cycle(cycle);
+			trace_last_cycle = cycle;
+		}
+		trace_bin_message(buf, len);
+		return;
+	}
+
 	/* Dump current cycle */
 	if (cycle > trace_last_cycle && print_cycle)
 	{
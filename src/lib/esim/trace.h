@@ -20,6 +20,77 @@
 #ifndef LIB_ESIM_TRACE_H
 #define LIB_ESIM_TRACE_H
 
+
+/*
+ * Binary trace format, selected with 'trace_format = trace_format_binary'.
+ * Each text line produced by a call to 'trace' is encoded as a record in a
+ * sequence of zlib-compressed blocks. A block holds a range of whole cycles,
+ * starting at a cycle record, and can be decoded without any other block.
+ * All multi-byte fixed-size fields are little-endian.
+ *
+ * Size		Description
+ * -----------------------------------------------------
+ * 8		Magic string TRACE_BIN_MAGIC
+ * 4		Version TRACE_BIN_VERSION
+ * -------- repeat for every block ---------------------
+ * 4		Uncompressed size
+ * 4		Compressed size
+ * var		Compressed records
+ * -------- string table -------------------------------
+ * var		Varint length, characters, and null terminator
+ * -------- index, one entry per block -----------------
+ * 8		First cycle in block
+ * 8		Offset of block in file
+ * -------- trailer ------------------------------------
+ * 8		Offset of string table
+ * 8		Number of strings
+ * 8		Offset of index
+ * 8		Number of blocks
+ * 8		Last cycle
+ * 8		Magic string TRACE_BIN_MAGIC
+ * -----------------------------------------------------
+ *
+ * A record starts with a varint tag of type 'trace_bin_record_t', or the
+ * identifier of the command string plus 'trace_bin_record_line'. A cycle
+ * record is followed by the varint difference with the previous cycle in the
+ * block. A text record, used for lines that do not follow the format
+ * 'command name=value name="value" ...', contains a varint length and the
+ * characters of the line. A line record is followed by the varint number of
+ * symbols, and then the varint identifier of each symbol name, one byte of type
+ * 'trace_bin_value_t', and the value. Integer values are zigzag-encoded
+ * differences with the last integer value of a symbol with the same name in
+ * the block.
+ */
+
+#define TRACE_BIN_MAGIC  "m2strace"
+#define TRACE_BIN_MAGIC_SIZE  8
+#define TRACE_BIN_VERSION  1
+#define TRACE_BIN_TRAILER_SIZE  48
+#define TRACE_BIN_INDEX_ENTRY_SIZE  16
+
+enum trace_bin_record_t
+{
+	trace_bin_record_cycle = 0,
+	trace_bin_record_text,
+	trace_bin_record_line
+};
+
+enum trace_bin_value_t
+{
+	trace_bin_value_string = 0,  /* String identifier */
+	trace_bin_value_literal,  /* Varint length and characters */
+	trace_bin_value_dec,  /* Decimal integer, e.g. '-12' */
+	trace_bin_value_hex,  /* Hexadecimal integer, e.g. '0x1f' */
+	trace_bin_value_prefix_dec  /* Prefix string identifier and decimal, e.g. 'A-12' */
+};
+
+extern struct str_map_t trace_format_map;
+extern enum trace_format_t
+{
+	trace_format_text = 0,
+	trace_format_binary
+} trace_format;
+
 void trace_init(char *file_name);
 void trace_done(void);
 
@@ -21,6 +21,7 @@
 #include <stdint.h>
 #include <zlib.h>
 #include <assert.h>
+#include <unistd.h>
 
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/hash-table.h>
@@ -350,6 +351,28 @@ struct bin_config_elem_t *bin_config_get(struct bin_config_t *bin_config,
 }
 
 
+int bin_config_get_copy(struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem, char *var,
+	void *buf, int size)
+{
+	void *data;
+	int data_size;
+
+	/* Get element */
+	if (!bin_config_get(bin_config, parent_elem, var, &data, &data_size))
+		return 0;
+	if (data_size != size)
+	{
+		bin_config->error_code = BIN_CONFIG_ERR_DATA;
+		return 0;
+	}
+
+	/* Copy data */
+	memcpy(buf, data, size);
+	return 1;
+}
+
+
 static void bin_config_elem_list_save(struct hash_table_t *elem_list, gzFile f)
 {
 	struct bin_config_elem_t *elem;
@@ -392,12 +415,9 @@ static void bin_config_elem_list_save(struct hash_table_t *elem_list, gzFile f)
 }
 
 
-int bin_config_save(struct bin_config_t *bin_config)
+static int bin_config_save_gz(struct bin_config_t *bin_config, gzFile f)
 {
-	gzFile f;
-
-	/* Open file */
-	f = gzopen(bin_config->file_name, "wb");
+	/* Check file */
 	if (!f)
 	{
 		bin_config->error_code = BIN_CONFIG_ERR_IO;
@@ -408,12 +428,28 @@ int bin_config_save(struct bin_config_t *bin_config)
 	bin_config_elem_list_save(bin_config->elem_list, f);
 
 	/* Close */
-	gzclose(f);
+	if (gzclose(f) != Z_OK)
+	{
+		bin_config->error_code = BIN_CONFIG_ERR_IO;
+		return 0;
+	}
 	bin_config->error_code = BIN_CONFIG_ERR_OK;
 	return 1;
 }
 
 
+int bin_config_save(struct bin_config_t *bin_config)
+{
+	return bin_config_save_gz(bin_config, gzopen(bin_config->file_name, "wb"));
+}
+
+
+int bin_config_save_fd(struct bin_config_t *bin_config, int fd)
+{
+	return bin_config_save_gz(bin_config, gzdopen(dup(fd), "wb"));
+}
+
+
 static struct hash_table_t *bin_config_load_elem_list(struct bin_config_t *bin_config,
 	gzFile f)
 {
@@ -469,12 +505,9 @@ static struct hash_table_t *bin_config_load_elem_list(struct bin_config_t *bin_c
 }
 
 
-int bin_config_load(struct bin_config_t *bin_config)
+static int bin_config_load_gz(struct bin_config_t *bin_config, gzFile f)
 {
-	gzFile f;
-
-	/* Open file */
-	f = gzopen(bin_config->file_name, "rb");
+	/* Check file */
 	if (!f)
 	{
 		bin_config->error_code = BIN_CONFIG_ERR_IO;
@@ -499,6 +532,18 @@ int bin_config_load(struct bin_config_t *bin_config)
 }
 
 
+int bin_config_load(struct bin_config_t *bin_config)
+{
+	return bin_config_load_gz(bin_config, gzopen(bin_config->file_name, "rb"));
+}
+
+
+int bin_config_load_fd(struct bin_config_t *bin_config, int fd)
+{
+	return bin_config_load_gz(bin_config, gzdopen(dup(fd), "rb"));
+}
+
+
 void bin_config_dump(struct bin_config_t *bin_config, FILE *f)
 {
 	/* Dump list of elements */
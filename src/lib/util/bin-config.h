@@ -119,6 +119,14 @@ int bin_config_load(struct bin_config_t *bin_config);
 int bin_config_save(struct bin_config_t *bin_config);
 
 
+/* Same as 'bin_config_load' and 'bin_config_save', but reading or writing
+ * the compressed elements at the current position of file descriptor 'fd'
+ * instead of the associated file. The caller keeps 'fd' open. A configuration
+ * loaded this way must be the last contents of the file. */
+int bin_config_load_fd(struct bin_config_t *bin_config, int fd);
+int bin_config_save_fd(struct bin_config_t *bin_config, int fd);
+
+
 /** Dump configuration in a human-readable format.
  *
  * @param bin_config
@@ -279,6 +287,37 @@ struct bin_config_elem_t *bin_config_get(struct bin_config_t *bin_config,
 	void **data_ptr, int *size_ptr);
 
 
+/** Copy the data associated with a variable into a buffer.
+ *
+ * @param bin_config
+ *	Configuration file object.
+ * @param parent_elem
+ *	Element where to search for the variable. If NULL, the variable is
+ *	searched in the highest level of the hierarchy.
+ * @param var
+ *	Name of the variable.
+ * @param buf
+ *	Buffer where the data is copied.
+ * @param size
+ *	Size of the buffer. The data is only copied if its size is exactly
+ *	this value.
+ *
+ * @return
+ *	The function returns non-0 on success. Otherwise, it returns 0 and the
+ *	error code is set to one of the following values:
+ *
+ *	BIN_CONFIG_ERR_NOT_FOUND
+ *		Variable was not found.
+ *	BIN_CONFIG_ERR_PARENT
+ *		Element 'parent_elem' does not belong to 'bin_config'.
+ *	BIN_CONFIG_ERR_DATA
+ *		The size of the data is different than 'size'.
+ */
+int bin_config_get_copy(struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem, char *var,
+	void *buf, int size);
+
+
 /** Start an enumeration of variables.
  * This call should be followed by a sequence of 'bin_config_find_next'.
  *
@@ -27,6 +27,7 @@ char interval_reports_dir[MAX_PATH_SIZE];
 
 char mod_interval_reports_dir[MAX_PATH_SIZE];
 char dram_interval_reports_dir[MAX_PATH_SIZE];
+char net_interval_reports_dir[MAX_PATH_SIZE];
 char x86_ctx_interval_reports_dir[MAX_PATH_SIZE];
 char x86_thread_interval_reports_dir[MAX_PATH_SIZE];
 
@@ -83,6 +84,7 @@ void m2s_interval_report_schedule(void)
 		assert(reports_dir && reports_dir[0]);
 		assert(interval_reports_dir[0]);
 		assert(mod_interval_reports_dir[0]);
+		assert(net_interval_reports_dir[0]);
 		assert(x86_ctx_interval_reports_dir[0]);
 		assert(x86_thread_interval_reports_dir[0]);
 		assert(global_reports_dir[0]);
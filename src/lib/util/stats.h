@@ -19,6 +19,7 @@ extern char interval_reports_dir[MAX_PATH_SIZE];
 
 extern char mod_interval_reports_dir[MAX_PATH_SIZE];
 extern char dram_interval_reports_dir[MAX_PATH_SIZE];
+extern char net_interval_reports_dir[MAX_PATH_SIZE];
 extern char x86_ctx_interval_reports_dir[MAX_PATH_SIZE];
 extern char x86_thread_interval_reports_dir[MAX_PATH_SIZE];
 
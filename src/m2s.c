@@ -56,6 +56,7 @@
 #include <arch/x86/emu/emu.h>
 #include <arch/x86/emu/isa.h>
 #include <arch/x86/emu/loader.h>
+#include <arch/x86/emu/simpoint.h>
 #include <arch/x86/emu/syscall.h>
 #include <arch/x86/timing/cpu.h>
 #include <arch/x86/timing/mem-config.h>
@@ -79,6 +80,7 @@
 #include <mem-system/mem-system.h>
 #include <mem-system/mmu.h>
 #include <network/net-system.h>
+#include <network/traffic.h>
 #include <sys/time.h>
 #include <visual/common/visual.h>
 
@@ -201,7 +203,14 @@ static char *m2s_help =
 		"      should watch the size of the generated trace as simulation runs, since\n"
 		"      the trace file can quickly become extremely large.\n"
 		"\n"
-		"  --visual <file>.gz\n"
+		"  --trace-format {text|binary}\n"
+		"      Format of the trace generated with option '--trace'. A binary trace\n"
+		"      (default is text) stores each line in a compact delta-encoded form,\n"
+		"      compressed in blocks of cycles, with an index of the first cycle of each\n"
+		"      block. It is much smaller and faster to generate than the text trace,\n"
+		"      and it is read directly by the visualization tool with '--visual'.\n"
+		"\n"
+		"  --visual <file>\n"
 		"      Run the Multi2Sim Visualization Tool. This option consumes a file\n"
 		"      generated with the '--trace' option in a previous simulation. This option\n"
 		"      is only available on systems with support for GTK 3.0 or higher.\n"
@@ -211,6 +220,36 @@ static char *m2s_help =
 		"x86 CPU Options\n"
 		"================================================================================\n"
 		"\n"
+		"  --x86-bbv <prefix>\n"
+		"      Profile basic block vectors (BBV) for SimPoint sampled simulation. The\n"
+		"      BBV of every interval of '--x86-bbv-interval' non-speculative instructions\n"
+		"      is dumped in file '<prefix>.bb', in the format used by the SimPoint tools.\n"
+		"      At the end of simulation, BBVs are clustered with k-means, choosing the\n"
+		"      number of clusters with the Bayesian Information Criterion. One simulation\n"
+		"      point per cluster (interval closest to its center) is written in file\n"
+		"      '<prefix>.simpoints', and its weight in '<prefix>.weights'.\n"
+		"\n"
+		"  --x86-bbv-interval <num_inst>\n"
+		"      Number of x86 instructions in each SimPoint interval. The same value must\n"
+		"      be used for options '--x86-bbv' and '--x86-simpoint-checkpoints'. The\n"
+		"      default value is 10000000.\n"
+		"\n"
+		"  --x86-checkpoint-compress\n"
+		"      Compress the memory pages of checkpoints saved with options\n"
+		"      '--x86-save-checkpoint' and '--x86-simpoint-checkpoints', or when a signal\n"
+		"      is received. Zero pages and pages with identical contents are always\n"
+		"      stored only once. Checkpoints are loaded lazily in any case, reading each\n"
+		"      page on its first access.\n"
+		"\n"
+		"  --x86-checkpoint-warm-state\n"
+		"      In detailed simulation, also save the contents of caches, directories,\n"
+		"      prefetcher tables and branch predictors in checkpoints. When such a\n"
+		"      checkpoint is loaded for detailed simulation with the same memory\n"
+		"      hierarchy and predictors, these structures start warm. The memory\n"
+		"      hierarchy is restored only if all its modules match the checkpoint;\n"
+		"      otherwise it starts cold, with a warning. Branch predictors with a\n"
+		"      different configuration are skipped with a warning.\n"
+		"\n"
 		"  --x86-checkpoints-dir <directory>\n"
 		"      Set a specific directory where all the checkpoints created when a signal is\n"
 		"      received will be stored. By default they will be stored in '.'.\n"
@@ -284,7 +323,10 @@ static char *m2s_help =
 		"      Maximum number of x86 instructions. On x86 functional simulation, this\n"
 		"      limit is given in number of emulated instructions. On x86 detailed\n"
 		"      simulation, it is given as the number of committed (non-speculative)\n"
-		"      instructions. Use 0 (default) for unlimited.\n"
+		"      instructions. With periodic sampling (section [ Sampling ] of the x86\n"
+		"      configuration file), only instructions simulated in detail count, and\n"
+		"      not those emulated between sampling units. Use 0 (default) for\n"
+		"      unlimited.\n"
 		"\n"
 		"  --x86-min-inst-per-ctx <inst>\n"
 		"      Minimum number of x86 instructions that every ctx must execute in order\n"
@@ -304,6 +346,19 @@ static char *m2s_help =
 		"      Useful options to use together with this are '--x86-max-inst' and\n"
 		"      '--x86-last-inst' to force the simulation to stop and create a checkpoint.\n"
 		"\n"
+		"  --x86-simpoint-checkpoints <prefix>\n"
+		"      Read simulation points from file '<prefix>.simpoints', created with option\n"
+		"      '--x86-bbv', and save a checkpoint in file '<prefix>.<cluster>.ckp' at the\n"
+		"      beginning of each of them during functional simulation. If option\n"
+		"      '--x86-warm-up' is given, checkpoints are taken that many instructions\n"
+		"      earlier. Simulation stops after the last checkpoint. Each simulation point\n"
+		"      can then be run in detail with '--x86-load-checkpoint', and the results\n"
+		"      combined with 'tools/simpoint/simpoint.py'.\n"
+		"\n"
+		"  --x86-simpoint-max-k <num>\n"
+		"      Maximum number of clusters, and thus simulation points, chosen by option\n"
+		"      '--x86-bbv'. The default value is 10.\n"
+		"\n"
 		"  --x86-sim {functional|detailed}\n"
 		"      Choose a functional simulation (emulation) of an x86 program, versus\n"
 		"      a detailed (architectural) simulation. Simulation is functional by\n" 	"      default.\n"
@@ -545,11 +600,20 @@ static char *m2s_help =
 		"      Print help message describing the network configuration file, passed to\n"
 		"      the simulator with option '--net-config <file>'.\n"
 		"\n"
+		"  --net-injection <process>\n"
+		"      For network simulation, injection process of end nodes. With\n"
+		"      'exponential' (default), delays between packets follow an exponential\n"
+		"      distribution. With 'bernoulli', a node generates a packet in each cycle\n"
+		"      with a probability equal to the injection rate. With 'bursty', nodes\n"
+		"      alternate bursts of one packet per cycle (8 cycles on average) and\n"
+		"      idle periods, keeping the injection rate on average. This option must\n"
+		"      be used together with '--net-sim'.\n"
+		"\n"
 		"  --net-injection-rate <rate>\n"
 		"      For network simulation, packet injection rate for nodes (e.g. 0.01 means\n"
-		"      one packet every 100 cycles on average. Nodes will inject packets into\n"
-		"      the network using random delays with exponential distribution with lambda\n"
-		"      = <rate>. This option must be used together with '--net-sim'.\n"
+		"      one packet every 100 cycles on average). The distribution of delays\n"
+		"      between packets is given by '--net-injection'. With '--net-sweep', this\n"
+		"      is the rate step. This option must be used together with '--net-sim'.\n"
 		"\n"
 		"  --net-max-cycles <cycles>\n"
 		"      Maximum number of cycles for network simulation. This option must be used\n"
@@ -574,7 +638,26 @@ static char *m2s_help =
 		"  --net-sim <network>\n"
 		"      Runs a network simulation using synthetic traffic, where <network> is the\n"
 		"      name of a network specified in the network configuration file (option\n"
-		"      '--net-config').\n"
+		"      '--net-config'). Packets wait in a queue at their source node until the\n"
+		"      network accepts them, and latencies include this wait.\n"
+		"\n"
+		"  --net-sweep <file>\n"
+		"      For network simulation, run a load-latency sweep instead of a single\n"
+		"      injection rate. Rates grow in steps of '--net-injection-rate', each of\n"
+		"      them simulated for '--net-max-cycles' cycles (the first fifth for\n"
+		"      warm-up), until the network saturates. One line is dumped per rate in\n"
+		"      CSV format, with the offered and accepted traffic in packets per node\n"
+		"      and cycle, and the average latency. This option must be used together\n"
+		"      with '--net-sim'.\n"
+		"\n"
+		"  --net-traffic <pattern>\n"
+		"      For network simulation, traffic pattern. Possible values are 'uniform'\n"
+		"      (default, random destinations), 'transpose', 'bitcomp' (bit complement),\n"
+		"      'bitrev' (bit reverse), 'hotspot' (a quarter of the packets go to the\n"
+		"      first end node), 'tornado' and 'neighbor'. Transpose, tornado and\n"
+		"      neighbor place end nodes in the grid of a mesh, torus or ring\n"
+		"      topology, or in a square grid otherwise. This option must be used\n"
+		"      together with '--net-sim'.\n"
 		"\n";
 
 
@@ -655,6 +738,15 @@ static void m2s_read_command_line(int *argc_ptr, char **argv)
 			continue;
 		}
 
+		/* Simulation trace format */
+		if (!strcmp(argv[argi], "--trace-format"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			trace_format = str_map_string_err_msg(&trace_format_map,
+					argv[++argi], "invalid value for --trace-format.");
+			continue;
+		}
+
 		/* Visualization tool */
 		if (!strcmp(argv[argi], "--visual"))
 		{
@@ -699,6 +791,40 @@ static void m2s_read_command_line(int *argc_ptr, char **argv)
 		 * x86 CPU Options
 		 */
 
+		/* SimPoint basic block vectors */
+		if (!strcmp(argv[argi], "--x86-bbv"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			x86_simpoint_bbv_prefix = argv[++argi];
+			continue;
+		}
+
+		/* SimPoint interval size */
+		if (!strcmp(argv[argi], "--x86-bbv-interval"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			x86_simpoint_interval = str_to_llint(argv[argi + 1], &err);
+			if (err || x86_simpoint_interval <= 0)
+				fatal("option %s, value '%s': %s", argv[argi],
+						argv[argi + 1], err ? str_error(err) : "invalid value");
+			argi++;
+			continue;
+		}
+
+		/* Compressed checkpoints */
+		if (!strcmp(argv[argi], "--x86-checkpoint-compress"))
+		{
+			x86_checkpoint_compress = 1;
+			continue;
+		}
+
+		/* Microarchitectural state in checkpoints */
+		if (!strcmp(argv[argi], "--x86-checkpoint-warm-state"))
+		{
+			x86_checkpoint_warm_state = 1;
+			continue;
+		}
+
 		/* Directory for storing checkpoints created when a SIGUSR2 or SIGTERM signal is received */
 		if (!strcmp(argv[argi], "--x86-checkpoints-dir"))
 		{
@@ -896,6 +1022,26 @@ static void m2s_read_command_line(int *argc_ptr, char **argv)
 			continue;
 		}
 
+		/* SimPoint checkpoints */
+		if (!strcmp(argv[argi], "--x86-simpoint-checkpoints"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			x86_simpoint_checkpoint_prefix = argv[++argi];
+			continue;
+		}
+
+		/* Maximum number of SimPoint clusters */
+		if (!strcmp(argv[argi], "--x86-simpoint-max-k"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			x86_simpoint_max_k = str_to_int(argv[argi + 1], &err);
+			if (err || x86_simpoint_max_k <= 0)
+				fatal("option %s, value '%s': %s", argv[argi],
+						argv[argi + 1], err ? str_error(err) : "invalid value");
+			argi++;
+			continue;
+		}
+
 		/* x86 simulation accuracy */
 		if (!strcmp(argv[argi], "--x86-sim"))
 		{
@@ -1466,6 +1612,16 @@ static void m2s_read_command_line(int *argc_ptr, char **argv)
 			continue;
 		}
 
+		/* Injection process for network simulation */
+		if (!strcmp(argv[argi], "--net-injection"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			net_sim_last_option = argv[argi];
+			net_traffic_injection = str_map_string_case_err_msg(&net_traffic_injection_map,
+				argv[++argi], "invalid value for --net-injection.");
+			continue;
+		}
+
 		/* Injection rate for network simulation */
 		if (!strcmp(argv[argi], "--net-injection-rate"))
 		{
@@ -1522,6 +1678,25 @@ static void m2s_read_command_line(int *argc_ptr, char **argv)
 			continue;
 		}
 
+		/* Load-latency sweep for network simulation */
+		if (!strcmp(argv[argi], "--net-sweep"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			net_sim_last_option = argv[argi];
+			net_traffic_sweep_file_name = argv[++argi];
+			continue;
+		}
+
+		/* Traffic pattern for network simulation */
+		if (!strcmp(argv[argi], "--net-traffic"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			net_sim_last_option = argv[argi];
+			net_traffic_pattern = str_map_string_case_err_msg(&net_traffic_pattern_map,
+				argv[++argi], "invalid value for --net-traffic.");
+			continue;
+		}
+
 
 		/*
 		 * Rest
@@ -1986,6 +2161,9 @@ void m2s_create_report_dirs(void)
 	/* Int. rep. mod */
 	filesystem_dir_create_and_store(mod_interval_reports_dir, MAX_PATH_SIZE, interval_reports_dir, "mod");
 
+	/* Int. rep. net */
+	filesystem_dir_create_and_store(net_interval_reports_dir, MAX_PATH_SIZE, interval_reports_dir, "net");
+
 	/* Int. rep. dram */
 	filesystem_dir_create_and_store(dram_interval_reports_dir, MAX_PATH_SIZE, interval_reports_dir, "dram");
 
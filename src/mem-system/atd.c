@@ -211,15 +211,7 @@ int atd_find_block(struct atd_t *atd, unsigned int addr, int *set_ptr, int *way_
 	int set, tag, way;
 
 	tag = addr & ~cache->block_mask;
-	if (mod->range_kind == mod_range_interleaved)
-	{
-		unsigned int num_mods = mod->range.interleaved.mod;
-		set = ((tag >> cache->log_block_size) / num_mods) % cache->num_sets;
-	}
-	else if (mod->range_kind == mod_range_bounds)
-		set = (tag >> cache->log_block_size) % cache->num_sets;
-	else
-		panic("%s: invalid range kind (%d)", __FUNCTION__, mod->range_kind);
+	set = mod_get_set(mod, addr);
 
 	assert(set >= 0 && set < cache->num_sets);
 
@@ -21,6 +21,7 @@
 #include <arch/x86/timing/cpu.h>
 #include <lib/esim/trace.h>
 #include <lib/mhandle/mhandle.h>
+#include <lib/util/bin-config.h>
 #include <lib/util/debug.h>
 #include <lib/util/linked-list.h>
 #include <lib/util/misc.h>
@@ -288,6 +289,164 @@ void cache_free(struct cache_t *cache)
 }
 
 
+/* Block contents saved in warm-state checkpoints */
+struct cache_saved_block_t
+{
+	int tag;
+	int state;
+	int thread_id;
+};
+
+
+/* Save tags, states and replacement order of all blocks as children of
+ * 'parent_elem'. Ways are saved from MRU to LRU for each set. */
+void cache_save_state(struct cache_t *cache, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem)
+{
+	struct cache_saved_block_t *saved_blocks;
+	struct cache_block_t *block;
+	int geometry[3];
+	int *order;
+	int set;
+	int way;
+	int i;
+
+	saved_blocks = xcalloc(cache->num_sets * cache->assoc, sizeof(struct cache_saved_block_t));
+	order = xcalloc(cache->num_sets * cache->assoc, sizeof(int));
+	for (set = 0; set < cache->num_sets; set++)
+	{
+		for (way = 0; way < cache->assoc; way++)
+		{
+			block = &cache->sets[set].blocks[way];
+			i = set * cache->assoc + way;
+			saved_blocks[i].tag = block->tag;
+			saved_blocks[i].state = block->state;
+			saved_blocks[i].thread_id = block->thread_id;
+		}
+		i = set * cache->assoc;
+		for (block = cache->sets[set].way_head; block; block = block->way_next)
+			order[i++] = block->way;
+	}
+
+	geometry[0] = cache->num_sets;
+	geometry[1] = cache->assoc;
+	geometry[2] = cache->block_size;
+	bin_config_add(bin_config, parent_elem, "geometry", geometry, sizeof geometry);
+	bin_config_add(bin_config, parent_elem, "blocks", saved_blocks,
+		cache->num_sets * cache->assoc * sizeof(struct cache_saved_block_t));
+	bin_config_add(bin_config, parent_elem, "order", order,
+		cache->num_sets * cache->assoc * sizeof(int));
+	free(saved_blocks);
+	free(order);
+}
+
+
+/* Restore the blocks saved with 'cache_save_state'. Return 0 and leave the
+ * cache unchanged if they were saved for a different geometry. If 'check_only'
+ * is set, the saved blocks are only validated. */
+int cache_load_state(struct cache_t *cache, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem, int check_only)
+{
+	int total_num_threads = x86_cpu_num_cores * x86_cpu_num_threads;
+	struct cache_saved_block_t *saved_blocks;
+	struct cache_set_t *cache_set;
+	struct cache_block_t *block;
+	int geometry[3];
+	int *seen;
+	int *order;
+	int set;
+	int way;
+	int size;
+	int i;
+
+	/* Geometry */
+	if (!bin_config_get_copy(bin_config, parent_elem, "geometry", geometry, sizeof geometry) ||
+			geometry[0] != cache->num_sets || geometry[1] != cache->assoc ||
+			geometry[2] != cache->block_size)
+		return 0;
+
+	/* Read arrays */
+	size = cache->num_sets * cache->assoc;
+	saved_blocks = xcalloc(size, sizeof(struct cache_saved_block_t));
+	order = xcalloc(size, sizeof(int));
+	if (!bin_config_get_copy(bin_config, parent_elem, "blocks", saved_blocks,
+			size * sizeof(struct cache_saved_block_t)) ||
+		!bin_config_get_copy(bin_config, parent_elem, "order", order,
+			size * sizeof(int)))
+	{
+		free(saved_blocks);
+		free(order);
+		return 0;
+	}
+
+	/* Order of each set must be a permutation of its ways */
+	seen = xcalloc(cache->assoc, sizeof(int));
+	for (i = 0; i < size; i++)
+	{
+		set = i / cache->assoc;
+		if (order[i] < 0 || order[i] >= cache->assoc ||
+				seen[order[i]] == set + 1 ||
+				!IN_RANGE(saved_blocks[i].state, cache_block_invalid,
+					cache_block_shared) ||
+				saved_blocks[i].thread_id < -1 ||
+				saved_blocks[i].thread_id >= total_num_threads)
+		{
+			free(saved_blocks);
+			free(order);
+			free(seen);
+			return 0;
+		}
+		seen[order[i]] = set + 1;
+	}
+	free(seen);
+	if (check_only)
+	{
+		free(saved_blocks);
+		free(order);
+		return 1;
+	}
+
+	/* Blocks */
+	memset(cache->used_ways, 0, total_num_threads * sizeof(int));
+	for (set = 0; set < cache->num_sets; set++)
+	{
+		cache_set = &cache->sets[set];
+		for (way = 0; way < cache->assoc; way++)
+		{
+			block = &cache_set->blocks[way];
+			i = set * cache->assoc + way;
+			block->tag = saved_blocks[i].tag;
+			block->transient_tag = saved_blocks[i].tag;
+			block->state = saved_blocks[i].state;
+			block->thread_id = saved_blocks[i].thread_id;
+			block->prefetched = 0;
+			block->pref_origin = NULL;
+			if (block->thread_id >= 0)
+				cache->used_ways[block->thread_id]++;
+		}
+
+		/* Replacement order */
+		cache_set->way_head = NULL;
+		cache_set->way_tail = NULL;
+		for (i = set * cache->assoc; i < (set + 1) * cache->assoc; i++)
+		{
+			block = &cache_set->blocks[order[i]];
+			block->way_prev = cache_set->way_tail;
+			block->way_next = NULL;
+			if (cache_set->way_tail)
+				cache_set->way_tail->way_next = block;
+			else
+				cache_set->way_head = block;
+			cache_set->way_tail = block;
+		}
+	}
+
+	free(saved_blocks);
+	free(order);
+	return 1;
+}
+
+
 /* Return {set, tag, offset} for a given address */
 void cache_decode_address(struct cache_t *cache, unsigned int addr, int *set_ptr, int *tag_ptr,
 	unsigned int *offset_ptr)
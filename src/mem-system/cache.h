@@ -30,7 +30,10 @@ extern struct str_map_t cache_policy_map;
 extern struct str_map_t cache_block_state_map;
 
 
+struct bin_config_t;
+struct bin_config_elem_t;
 struct mod_client_info_t;
+struct prefetch_profiler_entry_t;
 
 
 enum cache_policy_t
@@ -75,6 +78,7 @@ struct cache_block_t
 	int way;
 	int prefetched;
 	int thread_id; /* Thread who has put the block */
+	struct prefetch_profiler_entry_t *pref_origin; /* Profiler entry of the prefetch that brought it */
 
 	enum cache_block_state_t state;
 };
@@ -93,6 +97,7 @@ struct stream_block_t
 	int tag;
 	int transient_tag;
 	enum cache_block_state_t state;
+	struct prefetch_profiler_entry_t *pref_origin; /* Profiler entry of the prefetch that brought it */
 };
 
 struct stride_detector_camp_t
@@ -173,6 +178,11 @@ struct cache_t
 struct cache_t *cache_create(char *name, unsigned int num_sets, unsigned int block_size, unsigned int assoc, enum cache_policy_t policy);
 void cache_free(struct cache_t *cache);
 
+void cache_save_state(struct cache_t *cache, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem);
+int cache_load_state(struct cache_t *cache, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem, int check_only);
+
 void cache_decode_address(struct cache_t *cache, unsigned int addr,
 	int *set_ptr, int *tag_ptr, unsigned int *offset_ptr);
 int cache_find_block(struct cache_t *cache, unsigned int addr, int *set_ptr, int *pway,
@@ -35,10 +35,13 @@
 #include <lib/util/misc.h>
 #include <lib/util/stats.h>
 #include <lib/util/string.h>
+#include <network/buffer.h>
+#include <network/link.h>
 #include <network/net-system.h>
 #include <network/network.h>
 #include <network/node.h>
 #include <network/routing-table.h>
+#include <network/topology.h>
 
 #include "atd.h"
 #include "cache.h"
@@ -49,6 +52,7 @@
 #include "mem-system.h"
 #include "mmu.h"
 #include "module.h"
+#include "prefetch-profiler.h"
 #include "prefetcher.h"
 #include "ucp.h"
 
@@ -149,7 +153,8 @@ char *mem_config_help =
 	"  DirectoryAssoc = <assoc>\n"
 	"      Directory associativity in number of ways. This variable is only\n"
 	"      allowed for a main memory module.\n"
-	"  AddressRange = { BOUNDS <low> <high> | ADDR DIV <div> MOD <mod> EQ <eq> }\n"
+	"  AddressRange = { BOUNDS <low> <high> | ADDR DIV <div> MOD <mod> EQ <eq> |\n"
+	"                   HASH {XOR|MUL} DIV <div> MOD <mod> EQ <eq> }\n"
 	"      Physical address range served by the module. If not specified, the\n"
 	"      entire address space is served by the module. There are two possible\n"
 	"      formats for the value of 'Range':\n"
@@ -161,6 +166,14 @@ char *mem_config_help =
 	"      different modules in an interleaved manner. If dividing an address\n"
 	"      by <div> and modulo <mod> makes it equal to <eq>, it is served by\n"
 	"      this module. The value of <div> must be a multiple of the block size.\n"
+	"      The third format is like the second, but the address divided by <div>\n"
+	"      is hashed before comparing it with <eq>. Function XOR folds it with\n"
+	"      exclusive-or operations, and requires <mod> to be a power of two.\n"
+	"      Function MUL rotates the modules of each group of <mod> consecutive\n"
+	"      chunks by a multiplicative hash of the group number. Hashing avoids\n"
+	"      that strided accesses concentrate on a few modules. Both functions\n"
+	"      map the chunks of a group to different modules, so that a module\n"
+	"      indexes its cache sets with the group number and uses all of them.\n"
 	"      When a module serves only a subset of the address space, the user must\n"
 	"      make sure that the rest of the modules at the same level serve the\n"
 	"      remaining address space.\n"
@@ -221,6 +234,71 @@ char *mem_config_help =
 	"      Size of output buffers for end nodes and switch. \n"
 	"  DefaultBandwidth = <bandwidth>\n"
 	"      Bandwidth for links and switch crossbar in number of bytes per cycle.\n"
+	"  WarmUpModel = {Detailed|Fast}  (Default = Detailed)\n"
+	"      Network model used during the x86 warm-up phase ('--x86-warm-up').\n"
+	"  Width = <num>\n"
+	"  Height = <num>  (Default = 1)\n"
+	"      If 'Width' is given, the network is a 2D mesh of Width * Height\n"
+	"      switches instead of a single switch, built as a 'Mesh' topology of\n"
+	"      the network configuration file (see '--help-net-config'). Each\n"
+	"      module attaches to the switch of a tile, given as a number between 0\n"
+	"      and Width * Height - 1 in its 'LowNetworkNode' or 'HighNetworkNode'\n"
+	"      variable. Modules in the same tile share its switch.\n"
+	"\n"
+	"Section [SliceGroup <name>] defines a shared cache split into slices,\n"
+	"spread over the tiles of an internal mesh network. It is expanded into a\n"
+	"section [Network <name>] and sections [Module <name>-<i>], one per slice.\n"
+	"Upper-level modules connect to the mesh with 'LowNetwork = <name>' and a\n"
+	"tile number as 'LowNetworkNode', and list the whole group with\n"
+	"'LowModules = <name>'.\n"
+	"\n"
+	"  Slices = <num>  (Required)\n"
+	"      Number of slices.\n"
+	"  Geometry = <geo>  (Required)\n"
+	"      Cache geometry of each slice.\n"
+	"  Width = <num>\n"
+	"  Height = <num>\n"
+	"      Mesh dimensions. By default, the mesh is as square as possible.\n"
+	"  DefaultBandwidth = <bandwidth>  (Default = 32)\n"
+	"  DefaultInputBufferSize = <size>\n"
+	"  DefaultOutputBufferSize = <size>\n"
+	"      Parameters of the mesh, as in a [Network <net>] section.\n"
+	"  SliceFunction = {Modulo|XOR|MUL}  (Default = XOR)\n"
+	"      Function mapping addresses to slices. 'Modulo' interleaves blocks\n"
+	"      across slices, while 'XOR' and 'MUL' hash the block number, as in\n"
+	"      the 'HASH' format of variable 'AddressRange'. 'XOR' requires a\n"
+	"      power-of-two number of slices, and the default is 'MUL' otherwise.\n"
+	"      With any function, the chunks held by a slice are spread evenly\n"
+	"      over all of its sets.\n"
+	"  Granularity = <size>  (Default = block size)\n"
+	"      Size of the address chunks mapped to one slice. Using the page size\n"
+	"      keeps the pages of a thread in a single slice.\n"
+	"  SliceTiles = <tile0> [<tile1> ...]\n"
+	"      Tile of each slice. By default, slice <i> is placed at tile <i>.\n"
+	"  LowNetwork = <net>  (Required)\n"
+	"  LowNetworkNode = <prefix>\n"
+	"      Lower network of the slices. If given, slice <i> is mapped to node\n"
+	"      <prefix><i> of an external network.\n"
+	"  LowModules = <mod1> [<mod2> ...]  (Required)\n"
+	"      Lower-level modules of the slices.\n"
+	"\n"
+	"Section [DRAMSystem <name>] defines a main memory system simulated with\n"
+	"DRAMSim. Main memory modules refer to it with variable 'DRAMSystem'.\n"
+	"\n"
+	"  DeviceDescription = <file>  (Default = ini/DDR2_micron_16M_8b_x8_sg3E.ini)\n"
+	"      DRAMSim INI file describing the DRAM device.\n"
+	"  SystemDescription = <file>  (Default = system.ini)\n"
+	"      DRAMSim INI file describing the memory system organization.\n"
+	"  MB = <size>  (Default = 4096)\n"
+	"      Total memory size in megabytes.\n"
+	"  ReportFile = <file>\n"
+	"      File where DRAMSim dumps its per-epoch statistics.\n"
+	"  ChannelThreads = <num>  (Default = 1)\n"
+	"      Number of host threads used to update the channels of the DRAM\n"
+	"      system on every DRAM cycle. Channels are independent, so they can\n"
+	"      be simulated concurrently. Results are identical to the sequential\n"
+	"      update, since completed transactions are notified in channel order.\n"
+	"      The value is capped to the number of channels.\n"
 	"\n"
 	"Section [Entry <name>] creates an entry into the memory system. An entry is\n"
 	"a connection between a CPU core/thread or a GPU compute unit with a module\n"
@@ -354,9 +432,253 @@ static void mem_config_read_general(struct config_t *config)
 }
 
 
+/* Expand every [SliceGroup <name>] section into a mesh network [Network <name>]
+ * and one cache module [Module <name>-<i>] per slice, with hashed address
+ * ranges. Sections are written after enumerating them, because writes alter
+ * the enumeration of sections. */
+static void mem_config_read_slice_groups(struct config_t *config)
+{
+	struct list_t *section_list;
+
+	char buf[MAX_STRING_SIZE];
+	char value[MAX_STRING_SIZE];
+
+	char *section;
+	char *group_name;
+	char *geometry;
+	char *function;
+	char *low_net_name;
+	char *low_net_node_name;
+	char *low_mod_names;
+	char *tiles;
+	char *token;
+
+	int slices;
+	int width;
+	int height;
+	int granularity;
+	int block_size;
+	int bandwidth;
+	int input_buffer_size;
+	int output_buffer_size;
+	int *tile_list;
+	int hash;
+	int err;
+	int i;
+	int j;
+
+	/* Find groups */
+	section_list = list_create();
+	for (section = config_section_first(config); section;
+		section = config_section_next(config))
+	{
+		if (!strncasecmp(section, "SliceGroup ", 11))
+			list_add(section_list, xstrdup(section));
+	}
+
+	/* Expand */
+	LIST_FOR_EACH(section_list, i)
+	{
+		section = list_get(section_list, i);
+		group_name = section + 11;
+
+		/* Slices */
+		slices = config_read_int(config, section, "Slices", 0);
+		if (slices < 1)
+			fatal("%s: %s: invalid or missing value for 'Slices'.\n%s",
+				mem_config_file_name, section, mem_err_config_note);
+		geometry = config_read_string(config, section, "Geometry", "");
+		snprintf(buf, sizeof buf, "CacheGeometry %s", geometry);
+		if (!config_section_exists(config, buf))
+			fatal("%s: %s: invalid or missing value for 'Geometry'.\n%s",
+				mem_config_file_name, section, mem_err_config_note);
+		block_size = config_read_int(config, buf, "BlockSize", 0);
+
+		/* Mesh, as square as possible */
+		for (width = 1; width * width < slices; width++);
+		width = config_read_int(config, section, "Width", width);
+		height = config_read_int(config, section, "Height", (slices - 1) / width + 1);
+		if (width < 1 || height < 1 || width * height < MAX(slices, 2))
+			fatal("%s: %s: invalid values for 'Width' and 'Height'.\n%s",
+				mem_config_file_name, section, mem_err_config_note);
+		bandwidth = config_read_int(config, section, "DefaultBandwidth", 32);
+		input_buffer_size = config_read_int(config, section,
+			"DefaultInputBufferSize", 4 * (block_size + 8));
+		output_buffer_size = config_read_int(config, section,
+			"DefaultOutputBufferSize", 4 * (block_size + 8));
+
+		/* Slice selection */
+		function = config_read_string(config, section, "SliceFunction",
+			slices & (slices - 1) ? "MUL" : "XOR");
+		granularity = config_read_int(config, section, "Granularity", block_size);
+		if (strcasecmp(function, "Modulo"))
+		{
+			hash = str_map_string_case_err(&mod_range_hash_map, function, &err);
+			if (err)
+				fatal("%s: %s: invalid value for 'SliceFunction'.\n%s",
+					mem_config_file_name, section, mem_err_config_note);
+			if (hash == mod_range_hash_xor && (slices & (slices - 1)))
+				fatal("%s: %s: 'SliceFunction = XOR' requires a power-of-two "
+					"number of slices.\n%s", mem_config_file_name,
+					section, mem_err_config_note);
+		}
+
+		/* Lower level */
+		low_net_name = config_read_string(config, section, "LowNetwork", "");
+		low_net_node_name = config_read_string(config, section, "LowNetworkNode", "");
+		low_mod_names = config_read_string(config, section, "LowModules", "");
+		if (!*low_net_name || !*low_mod_names)
+			fatal("%s: %s: missing value for 'LowNetwork' or 'LowModules'.\n%s",
+				mem_config_file_name, section, mem_err_config_note);
+
+		/* Tiles of slices, by default one slice per tile in order */
+		tile_list = xcalloc(slices, sizeof(int));
+		tiles = xstrdup(config_read_string(config, section, "SliceTiles", ""));
+		token = strtok(tiles, ", ");
+		for (j = 0; j < slices; j++)
+		{
+			tile_list[j] = j;
+			if (!*tiles)
+				continue;
+			tile_list[j] = token ? str_to_int(token, &err) : -1;
+			if (!token || err || tile_list[j] < 0 || tile_list[j] >= width * height)
+				fatal("%s: %s: invalid value for 'SliceTiles'.\n%s",
+					mem_config_file_name, section, mem_err_config_note);
+			token = strtok(NULL, ", ");
+		}
+		if (token)
+			fatal("%s: %s: too many tiles in 'SliceTiles'.\n%s",
+				mem_config_file_name, section, mem_err_config_note);
+		free(tiles);
+		config_section_check(config, section);
+
+		/* Network */
+		snprintf(buf, sizeof buf, "Network %s", group_name);
+		if (config_section_exists(config, buf))
+			fatal("%s: %s: section [ %s ] already exists.\n%s",
+				mem_config_file_name, section, buf, mem_err_config_note);
+		config_write_int(config, buf, "DefaultInputBufferSize", input_buffer_size);
+		config_write_int(config, buf, "DefaultOutputBufferSize", output_buffer_size);
+		config_write_int(config, buf, "DefaultBandwidth", bandwidth);
+		config_write_int(config, buf, "Width", width);
+		config_write_int(config, buf, "Height", height);
+
+		/* Slices */
+		for (j = 0; j < slices; j++)
+		{
+			snprintf(buf, sizeof buf, "Module %s-%d", group_name, j);
+			if (config_section_exists(config, buf))
+				fatal("%s: %s: section [ %s ] already exists.\n%s",
+					mem_config_file_name, section, buf, mem_err_config_note);
+			config_write_string(config, buf, "Type", "Cache");
+			config_write_string(config, buf, "Geometry", geometry);
+			config_write_string(config, buf, "HighNetwork", group_name);
+			config_write_int(config, buf, "HighNetworkNode", tile_list[j]);
+			config_write_string(config, buf, "LowNetwork", low_net_name);
+			if (*low_net_node_name)
+			{
+				snprintf(value, sizeof value, "%s%d", low_net_node_name, j);
+				config_write_string(config, buf, "LowNetworkNode", value);
+			}
+			config_write_string(config, buf, "LowModules", low_mod_names);
+			if (!strcasecmp(function, "Modulo"))
+				snprintf(value, sizeof value, "ADDR DIV %d MOD %d EQ %d",
+					granularity, slices, j);
+			else
+				snprintf(value, sizeof value, "HASH %s DIV %d MOD %d EQ %d",
+					function, granularity, slices, j);
+			config_write_string(config, buf, "AddressRange", value);
+		}
+		free(tile_list);
+	}
+
+	/* Free section names */
+	LIST_FOR_EACH(section_list, i)
+		free(list_get(section_list, i));
+	list_free(section_list);
+}
+
+
+/* Largest number of modules attached to a tile of internal mesh 'net_name',
+ * which is the number of end nodes of each switch. */
+static int mem_config_mesh_concentration(struct config_t *config,
+	char *net_name, int tiles)
+{
+	char *section;
+	char *node_name;
+
+	int *count;
+	int concentration;
+	int tile;
+	int err;
+	int i;
+
+	count = xcalloc(tiles, sizeof(int));
+	for (section = config_section_first(config); section;
+		section = config_section_next(config))
+	{
+		if (strncasecmp(section, "Module ", 7))
+			continue;
+
+		/* Invalid tiles are reported when the module is inserted */
+		for (i = 0; i < 2; i++)
+		{
+			if (strcasecmp(config_read_string(config, section,
+				i ? "HighNetwork" : "LowNetwork", ""), net_name))
+				continue;
+			node_name = config_read_string(config, section,
+				i ? "HighNetworkNode" : "LowNetworkNode", "");
+			tile = str_to_int(node_name, &err);
+			if (!err && tile >= 0 && tile < tiles)
+				count[tile]++;
+		}
+	}
+
+	concentration = 1;
+	for (tile = 0; tile < tiles; tile++)
+		concentration = MAX(concentration, count[tile]);
+	free(count);
+	return concentration;
+}
+
+
+/* Create an internal network with a mesh topology. The switch of tile 't' is
+ * switch 't' of the topology, and modules are assigned to its end nodes as
+ * they are inserted in the network. */
+static void mem_config_create_mesh(struct config_t *config, struct net_t *net,
+	char *section, int width, int height)
+{
+	struct config_t *topology_config;
+	char topology_section[MAX_STRING_SIZE];
+
+	net->def_bandwidth = config_read_int(config, section, "DefaultBandwidth", 0);
+	net->def_input_buffer_size = config_read_int(config, section, "DefaultInputBufferSize", 0);
+	net->def_output_buffer_size = config_read_int(config, section, "DefaultOutputBufferSize", 0);
+	if (net->def_bandwidth < 1)
+		fatal("%s: %s: invalid or missing value for 'DefaultBandwidth'.\n%s",
+			mem_config_file_name, net->name, mem_err_config_note);
+
+	/* Topology, as in a network configuration file */
+	snprintf(topology_section, sizeof topology_section, "Network.%s.Topology", net->name);
+	topology_config = config_create(mem_config_file_name);
+	config_write_string(topology_config, topology_section, "Type", "Mesh");
+	config_write_int(topology_config, topology_section, "Width", width);
+	config_write_int(topology_config, topology_section, "Height", height);
+	config_write_int(topology_config, topology_section, "Concentration",
+		mem_config_mesh_concentration(config, net->name, width * height));
+	config_write_string(topology_config, topology_section, "SwitchPrefix", "Switch");
+	net->routing_table->topology = net_topology_create_from_config(net,
+		topology_config, topology_section);
+	config_free(topology_config);
+	mem_debug("\t%s: %dx%d mesh\n", net->name, width, height);
+}
+
+
 static void mem_config_read_networks(struct config_t *config)
 {
 	struct net_t *net;
+	int width;
+	int height;
 	int i;
 
 	char buf[MAX_STRING_SIZE];
@@ -398,6 +720,17 @@ static void mem_config_read_networks(struct config_t *config)
 		config_var_enforce(config, buf, "DefaultInputBufferSize");
 		config_var_enforce(config, buf, "DefaultOutputBufferSize");
 		config_var_enforce(config, buf, "DefaultBandwidth");
+		net->warm_up_model = config_read_enum(config, buf, "WarmUpModel",
+			net_model_detailed, net_model_map, 2);
+
+		/* Mesh of switches */
+		width = config_read_int(config, buf, "Width", 0);
+		height = config_read_int(config, buf, "Height", 1);
+		if (width < 0 || height < 1 || (width && width * height < 2))
+			fatal("%s: %s: invalid values for 'Width' and 'Height'.\n%s",
+				mem_config_file_name, net->name, mem_err_config_note);
+		if (width)
+			mem_config_create_mesh(config, net, buf, width, height);
 		config_section_check(config, buf);
 	}
 }
@@ -409,10 +742,17 @@ static void mem_config_insert_module_in_network(struct config_t *config,
 {
 	struct net_t *net;
 	struct net_node_t *node;
+	struct net_topology_t *topology;
 
 	int def_input_buffer_size;
 	int def_output_buffer_size;
 
+	int width;
+	int height;
+	int tile;
+	int err;
+	int i;
+
 	char buf[MAX_STRING_SIZE];
 
 	/* No network specified */
@@ -427,8 +767,29 @@ static void mem_config_insert_module_in_network(struct config_t *config,
 	if (!net)
 		goto try_external_network;
 
-	/* For private networks, 'net_node_name' should be empty */
-	if (*net_node_name)
+	/* For private networks, 'net_node_name' should be empty, except for
+	 * meshes, where it is the tile the module is connected to. The module
+	 * takes a free end node of the switch of the tile. */
+	node = NULL;
+	width = config_read_int(config, buf, "Width", 0);
+	height = config_read_int(config, buf, "Height", 1);
+	if (width)
+	{
+		tile = str_to_int(net_node_name, &err);
+		if (!*net_node_name || err || tile < 0 || tile >= width * height)
+			fatal("%s: %s: network %s: invalid or missing tile in network node name.\n%s",
+				mem_config_file_name, mod->name, net->name,
+				mem_err_config_note);
+		topology = net->routing_table->topology;
+		for (i = 0; i < topology->concentration; i++)
+		{
+			node = list_get(net->node_list, tile * topology->concentration + i);
+			if (!node->user_data)
+				break;
+		}
+		assert(i < topology->concentration);
+	}
+	else if (*net_node_name)
 		fatal("%s: %s: network node name should be empty.\n%s",
 			mem_config_file_name, mod->name,
 			mem_err_config_note);
@@ -468,8 +829,11 @@ static void mem_config_insert_module_in_network(struct config_t *config,
 			mod->block_size + 8, mod->name, mem_err_config_note);
 
 	/* Insert module in network */
-	node = net_add_end_node(net, def_input_buffer_size,
-		def_output_buffer_size, mod->name, mod);
+	if (node)
+		node->user_data = mod;
+	else
+		node = net_add_end_node(net, def_input_buffer_size,
+			def_output_buffer_size, mod->name, mod);
 
 	/* Return */
 	*net_ptr = net;
@@ -563,6 +927,47 @@ static struct prefetcher_t* mem_config_read_prefetcher(struct config_t *config,
 	pref->stream_tag_mask = -1 << (sizeof(pref->stream_tag_mask) * 8 - pref->stream_tag_bits);
 	prefetcher_stream_buffers_create(pref, pref->max_num_streams, pref->max_num_slots);
 
+	/* Best-Offset prefetcher */
+	if (type == prefetcher_type_bop)
+	{
+		int max_offset = config_read_int(config, section, "BOP.MaxOffset", 64); /* Largest candidate offset in blocks */
+		int rr_size = config_read_int(config, section, "BOP.RRSize", 256); /* Entries of the recent requests table */
+		int score_max = config_read_int(config, section, "BOP.ScoreMax", 31); /* Score that ends a learning phase */
+		int round_max = config_read_int(config, section, "BOP.RoundMax", 100); /* Rounds that end a learning phase */
+		int bad_score = config_read_int(config, section, "BOP.BadScore", 1); /* Best score below which prefetching is turned off */
+
+		if (max_offset < 1 || rr_size < 1 || score_max < 1 || round_max < 1 || bad_score < 0)
+			fatal("%s: prefetcher %s: invalid Best-Offset configuration.\n%s",
+				mem_config_file_name, pref_name, mem_err_config_note);
+		prefetcher_bop_create(pref, max_offset, rr_size, score_max, round_max, bad_score);
+	}
+
+	/* Signature Path Prefetcher */
+	if (type == prefetcher_type_spp)
+	{
+		int st_size = config_read_int(config, section, "SPP.STSize", 256); /* Entries of the signature table */
+		int pt_size = config_read_int(config, section, "SPP.PTSize", 512); /* Entries of the pattern table */
+		double threshold = config_read_double(config, section, "SPP.Threshold", 0.25); /* Path confidence to stop the lookahead */
+
+		if (st_size < 1 || pt_size < 1 || threshold <= 0 || threshold > 1)
+			fatal("%s: prefetcher %s: invalid SPP configuration.\n%s",
+				mem_config_file_name, pref_name, mem_err_config_note);
+		prefetcher_spp_create(pref, st_size, pt_size, threshold);
+	}
+
+	/* Prefetch queue */
+	pref->queue_size = config_read_int(config, section, "QueueSize", 0); /* If 0, prefetches go directly to the cache */
+	pref->queue_dram_threshold = config_read_double(config, section, "QueueDRAMThreshold", 0.75); /* Drop prefetches when the DRAM transaction queue is this full */
+	if (pref->queue_size < 0 || pref->queue_dram_threshold <= 0 || pref->queue_dram_threshold > 1)
+		fatal("%s: prefetcher %s: invalid prefetch queue configuration.\n%s",
+			mem_config_file_name, pref_name, mem_err_config_note);
+
+	/* Per-PC profile */
+	pref->profile_top_n = config_read_int(config, section, "ProfileTopN", 0); /* Sources shown in the reports. If 0, prefetches are not profiled. */
+	if (pref->profile_top_n < 0)
+		fatal("%s: prefetcher %s: invalid ProfileTopN.\n%s",
+			mem_config_file_name, pref_name, mem_err_config_note);
+
 	/* Adaptive prefetchers */
 	pref->aggr_ini = config_read_int(config, section, "InitialAggressivity", aggr);
 	adapt_policy_str = config_read_string(config, section, "AdaptPolicy", "none");
@@ -872,6 +1277,10 @@ static struct mod_t *mem_config_read_cache(struct config_t *config,
 		snprintf(buf, sizeof buf, " Prefetcher %s ", prefetcher_str);
 		mod->cache->prefetcher = mem_config_read_prefetcher(config, buf);
 		mod->cache->prefetcher->parent_cache = mod->cache;
+		if (mod->cache->prefetcher->queue_size)
+			prefetcher_queue_create(mod->cache->prefetcher, mod);
+		if (mod->cache->prefetcher->profile_top_n)
+			mod->cache->prefetcher->profiler = prefetch_profiler_create(mod, mod->cache->prefetcher->profile_top_n);
 	}
 
 	/* Partitioning policy */
@@ -1037,10 +1446,22 @@ static void mem_config_read_module_address_range(struct config_t *config,
 		if ((token = strtok(NULL, delim)))
 			goto invalid_format;
 	}
-	else if (!strcasecmp(token, "ADDR"))
+	else if (!strcasecmp(token, "ADDR") || !strcasecmp(token, "HASH"))
 	{
-		/* Format is: ADDR DIV <div> MOD <mod> EQ <eq> */
+		/* Format is: ADDR DIV <div> MOD <mod> EQ <eq>
+		 * or: HASH <function> DIV <div> MOD <mod> EQ <eq> */
 		mod->range_kind = mod_range_interleaved;
+		if (!strcasecmp(token, "HASH"))
+		{
+			mod->range_kind = mod_range_hashed;
+			if (!(token = strtok(NULL, delim)))
+				goto invalid_format;
+			mod->range.interleaved.hash = str_map_string_case_err(
+				&mod_range_hash_map, token, &err);
+			if (err)
+				fatal("%s: %s: invalid hash function '%s' in 'AddressRange'",
+					mem_config_file_name, mod->name, token);
+		}
 
 		/* Token 'DIV' */
 		if (!(token = strtok(NULL, delim)) || strcasecmp(token, "DIV"))
@@ -1087,6 +1508,18 @@ static void mem_config_read_module_address_range(struct config_t *config,
 		if (mod->range.interleaved.eq >= mod->range.interleaved.mod)
 			goto invalid_format;
 
+		/* XOR hash folds as many bits as needed to tell modules apart. Cache
+		 * sets are indexed assuming that the hash is a permutation of the
+		 * low bits, which only holds for a power-of-two number of modules. */
+		mod->range.interleaved.hash_bits = 1;
+		while (1U << mod->range.interleaved.hash_bits < mod->range.interleaved.mod)
+			mod->range.interleaved.hash_bits++;
+		if (mod->range_kind == mod_range_hashed &&
+				mod->range.interleaved.hash == mod_range_hash_xor &&
+				1U << mod->range.interleaved.hash_bits != mod->range.interleaved.mod)
+			fatal("%s: %s: XOR hash in 'AddressRange' requires a power-of-two <mod>.\n%s",
+				mem_config_file_name, mod->name, mem_err_config_note);
+
 		/* No more tokens */
 		if ((token = strtok(NULL, delim)))
 			goto invalid_format;
@@ -1123,6 +1556,7 @@ static void mem_config_read_dram_systems(struct config_t *config)
 	double dram_system_freq;
 
 	int megabytes; /* Total size */
+	int num_threads;
 	int ret;
 
 	/* Create main memory systems */
@@ -1145,6 +1579,10 @@ static void mem_config_read_dram_systems(struct config_t *config)
 
 		report_file_str = config_read_string(config, section, "ReportFile", dram_system_intrep_file);
 		megabytes = config_read_int(config, section, "MB", 4096);
+		num_threads = config_read_int(config, section, "ChannelThreads", 1);
+		if (num_threads < 1)
+			fatal("%s: %s: invalid value for 'ChannelThreads'.\n%s",
+				mem_config_file_name, section, mem_err_config_note);
 			
 		/* Create a handler to the underlying dramsim c++ objects */
 		handler = dram_system_create(device_config_str, system_config_str, megabytes, report_file_str);
@@ -1162,6 +1600,7 @@ static void mem_config_read_dram_systems(struct config_t *config)
 
 		dram_system_set_epoch_length(handler, epoch_length * (dram_system_freq / esim_frequency)); /* Epoch length for dram in dram cycles */
 		dram_system_register_payloaded_callbacks(handler, dram_system, main_memory_read_callback, main_memory_write_callback, main_memory_power_callback);
+		dram_system_set_num_threads(handler, num_threads);
 
 		/* Add dram system to hash table */
 		hash_table_insert(mem_system->dram_systems, dram_system_name, dram_system);
@@ -1218,6 +1657,10 @@ static void mem_config_read_modules(struct config_t *config)
 				snprintf(buf, sizeof buf, " Prefetcher %s ", prefetcher_str);
 				mod->cache->prefetcher = mem_config_read_prefetcher(config, buf);
 				mod->cache->prefetcher->parent_cache = mod->cache;
+				if (mod->cache->prefetcher->queue_size)
+					prefetcher_queue_create(mod->cache->prefetcher, mod);
+				if (mod->cache->prefetcher->profile_top_n)
+					mod->cache->prefetcher->profiler = prefetch_profiler_create(mod, mod->cache->prefetcher->profile_top_n);
 			}
 		}
 		else if (!strcasecmp(mod_type, "MainMemory"))
@@ -1308,6 +1751,29 @@ static void mem_config_check_route_to_main_memory(struct mod_t *mod,
 }
 
 
+static void mem_config_add_slice_group(struct config_t *config,
+	struct mod_t *mod, char *group_name)
+{
+	struct mod_t *low_mod;
+
+	char buf[MAX_STRING_SIZE];
+
+	int slices;
+	int i;
+
+	snprintf(buf, sizeof buf, "SliceGroup %s", group_name);
+	slices = config_read_int(config, buf, "Slices", 0);
+	for (i = 0; i < slices; i++)
+	{
+		snprintf(buf, sizeof buf, "Module %s-%d", group_name, i);
+		low_mod = config_read_ptr(config, buf, "ptr", NULL);
+		assert(low_mod);
+		linked_list_add(mod->low_mod_list, low_mod);
+		linked_list_add(low_mod->high_mod_list, mod);
+	}
+}
+
+
 static void mem_config_read_low_modules(struct config_t *config)
 {
 	char buf[MAX_STRING_SIZE];
@@ -1345,6 +1811,14 @@ static void mem_config_read_low_modules(struct config_t *config)
 		for (low_mod_name = strtok(low_mod_name_list, delim);
 			low_mod_name; low_mod_name = strtok(NULL, delim))
 		{
+			/* A slice group stands for all its slices */
+			snprintf(buf, sizeof buf, "SliceGroup %s", low_mod_name);
+			if (config_section_exists(config, buf))
+			{
+				mem_config_add_slice_group(config, mod, low_mod_name);
+				continue;
+			}
+
 			/* Check valid module name */
 			snprintf(buf, sizeof buf, "Module %s", low_mod_name);
 			if (!config_section_exists(config, buf))
@@ -1477,9 +1951,13 @@ static void mem_config_create_switches(struct config_t *config)
 		/* Get network and lower level cache */
 		net = list_get(mem_system->net_list, i);
 
-		/* Get switch bandwidth */
+		/* Meshes have their own switches and routes */
 		snprintf(buf, sizeof buf, "Network %s", net->name);
 		assert(config_section_exists(config, buf));
+		if (net->routing_table->topology)
+			continue;
+
+		/* Get switch bandwidth */
 		def_bandwidth = config_read_int(config, buf, "DefaultBandwidth", 0);
 		if (def_bandwidth < 1)
 			fatal("%s: %s: invalid or missing value for 'DefaultBandwidth'.\n%s",
@@ -2052,6 +2530,9 @@ void mem_config_read(void)
 	/* Read general variables */
 	mem_config_read_general(config);
 
+	/* Expand slice groups into networks and modules */
+	mem_config_read_slice_groups(config);
+
 	/* Read networks */
 	mem_config_read_networks(config);
 
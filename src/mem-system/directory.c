@@ -18,10 +18,12 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
 #include <lib/esim/esim.h>
 #include <lib/esim/trace.h>
 #include <lib/mhandle/mhandle.h>
+#include <lib/util/bin-config.h>
 #include <lib/util/misc.h>
 #include <lib/util/debug.h>
 
@@ -99,6 +101,67 @@ void dir_free(struct dir_t *dir)
 }
 
 
+/* Save the geometry and all entries of the directory as children of
+ * 'parent_elem'. */
+void dir_save_state(struct dir_t *dir, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem)
+{
+	int geometry[4];
+
+	geometry[0] = dir->xsize;
+	geometry[1] = dir->ysize;
+	geometry[2] = dir->zsize;
+	geometry[3] = dir->num_nodes;
+	bin_config_add(bin_config, parent_elem, "geometry", geometry, sizeof geometry);
+	bin_config_add(bin_config, parent_elem, "entries", dir->data,
+		DIR_ENTRY_SIZE * dir->xsize * dir->ysize * dir->zsize);
+}
+
+
+/* Restore the entries saved with 'dir_save_state'. Return 0 and leave the
+ * directory unchanged if they were saved for a different geometry. If
+ * 'check_only' is set, the saved entries are only validated. */
+int dir_load_state(struct dir_t *dir, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem, int check_only)
+{
+	struct dir_entry_t *dir_entry;
+	unsigned char *entries;
+
+	int geometry[4];
+	int size;
+	int i;
+
+	/* Geometry */
+	if (!bin_config_get_copy(bin_config, parent_elem, "geometry", geometry, sizeof geometry) ||
+			geometry[0] != dir->xsize || geometry[1] != dir->ysize ||
+			geometry[2] != dir->zsize || geometry[3] != dir->num_nodes)
+		return 0;
+
+	/* Entries */
+	size = DIR_ENTRY_SIZE * dir->xsize * dir->ysize * dir->zsize;
+	entries = xmalloc(size);
+	if (!bin_config_get_copy(bin_config, parent_elem, "entries", entries, size))
+	{
+		free(entries);
+		return 0;
+	}
+	for (i = 0; i < dir->xsize * dir->ysize * dir->zsize; i++)
+	{
+		dir_entry = (struct dir_entry_t *) (entries + i * DIR_ENTRY_SIZE);
+		if (dir_entry->owner < DIR_ENTRY_OWNER_NONE || dir_entry->owner >= dir->num_nodes ||
+				dir_entry->num_sharers < 0 || dir_entry->num_sharers > dir->num_nodes)
+		{
+			free(entries);
+			return 0;
+		}
+	}
+	if (!check_only)
+		memcpy(dir->data, entries, size);
+	free(entries);
+	return 1;
+}
+
+
 struct dir_entry_t *dir_entry_get(struct dir_t *dir, int x, int y, int z)
 {
 	assert(IN_RANGE(x, 0, dir->xsize - 1));
@@ -20,6 +20,8 @@
 #ifndef MEM_SYSTEM_DIRECTORY_H
 #define MEM_SYSTEM_DIRECTORY_H
 
+struct bin_config_t;
+struct bin_config_elem_t;
 
 struct dir_lock_t
 {
@@ -72,6 +74,11 @@ struct dir_t
 struct dir_t *dir_create(char *name, int xsize, int ysize, int zsize, int num_nodes);
 void dir_free(struct dir_t *dir);
 
+void dir_save_state(struct dir_t *dir, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem);
+int dir_load_state(struct dir_t *dir, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem, int check_only);
+
 struct dir_entry_t *dir_entry_get(struct dir_t *dir, int x, int y, int z);
 
 void dir_entry_set_owner(struct dir_t *dir, int x, int y, int z, int node);
@@ -31,6 +31,8 @@
 #include <lib/util/list.h>
 #include <lib/util/linked-list.h>
 #include <lib/util/string.h>
+#include <network/msg-stats.h>
+#include <network/net-system.h>
 #include <network/network.h>
 
 #include "cache.h"
@@ -41,6 +43,7 @@
 #include "mod-stack.h"
 #include "module.h"
 #include "nmoesi-protocol.h"
+#include "prefetch-profiler.h"
 #include "prefetcher.h"
 
 
@@ -371,6 +374,9 @@ void mem_system_init(void)
 	/* Event for adaptative prefetch */
 	EV_MOD_ADAPT_PREF = esim_register_event_with_name(mod_adapt_pref_handler, mem_domain_index, "mod_adapt_pref");
 
+	/* Event for prefetch queues */
+	EV_PREFETCHER_QUEUE = esim_register_event_with_name(prefetcher_queue_handler, mem_domain_index, "prefetcher_queue");
+
 	LIST_FOR_EACH(mem_system->mod_list, i)
 	{
 		struct mod_t *mod = list_get(mem_system->mod_list, i);
@@ -410,6 +416,10 @@ void mem_system_init(void)
 			mem_domain_index, "mod_local_mem_find_and_lock_action");
 	EV_MOD_LOCAL_MEM_FIND_AND_LOCK_FINISH = esim_register_event_with_name(mod_handler_local_mem_find_and_lock,
 			mem_domain_index, "mod_local_mem_find_and_lock_finish");
+
+	/* Networks use their warm-up model until the x86 warm-up ends */
+	if (x86_cpu_warm_up_count)
+		mem_system_net_warm_up(1);
 }
 
 
@@ -543,12 +553,25 @@ void mem_system_dump_report(void)
 		fprintf(f, "CanceledPrefetchStreamHit = %lld\n", mod->canceled_prefetches_stream_hit);
 		fprintf(f, "CanceledPrefetchRetry = %lld\n", mod->canceled_prefetches_retry);
 		fprintf(f, "PrefetchRetries = %lld\n", mod->prefetch_retries);
+		if (cache && cache->prefetcher && cache->prefetcher->queue)
+		{
+			fprintf(f, "QueuedPrefetches = %lld\n", mod->queued_prefetches);
+			fprintf(f, "DroppedPrefetchQueueFull = %lld\n", mod->dropped_prefetches_queue_full);
+			fprintf(f, "DroppedPrefetchInFlight = %lld\n", mod->dropped_prefetches_in_flight);
+			fprintf(f, "DroppedPrefetchDRAM = %lld\n", mod->dropped_prefetches_dram);
+			fprintf(f, "PrefetchQueueAvgCycles = %.4g\n", mod->injected_prefetches ?
+				(double) mod->prefetch_queue_cycles / mod->injected_prefetches : 0.0);
+			fprintf(f, "PrefetchDemotions = %lld\n", mod->prefetch_demotions);
+		}
 		fprintf(f, "\n");
 
 		fprintf(f, "UsefulPrefetches = %lld\n", mod->useful_prefetches);
 		fprintf(f, "PrefetchAccuracy = %.4g\n", mod->completed_prefetches ? (double) mod->useful_prefetches / mod->completed_prefetches : 0.0);
 		fprintf(f, "\n");
 
+		if (cache && cache->prefetcher && cache->prefetcher->profiler)
+			prefetch_profiler_dump(cache->prefetcher->profiler, f);
+
 		fprintf(f, "SinglePrefetches = %lld\n", mod->single_prefetches);
 		fprintf(f, "GroupPrefetches = %lld\n", mod->group_prefetches);
 		fprintf(f, "CanceledPrefetchGroups = %lld\n", mod->canceled_prefetch_groups);
@@ -627,6 +650,78 @@ struct net_t *mem_system_get_net(char *net_name)
 }
 
 
+/* Save the warm state of all modules (cache blocks, directory entries and
+ * prefetcher tables) as children of 'parent_elem'. Accesses in flight are
+ * not saved, so the state is exact only if the memory system is idle. */
+void mem_system_save_state(struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem)
+{
+	struct mod_t *mod;
+
+	int mod_id;
+
+	LIST_FOR_EACH(mem_system->mod_list, mod_id)
+	{
+		mod = list_get(mem_system->mod_list, mod_id);
+		mod_save_state(mod, bin_config, parent_elem);
+	}
+}
+
+
+/* Restore the state saved with 'mem_system_save_state'. Cache blocks and
+ * directory entries of different levels refer to each other, so either all
+ * modules are restored or none. Return 0 and leave the memory system cold if
+ * any module is missing from the checkpoint or has a different geometry. */
+int mem_system_load_state(struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem)
+{
+	struct mod_t *mod;
+
+	int mod_id;
+
+	/* Check all modules */
+	LIST_FOR_EACH(mem_system->mod_list, mod_id)
+	{
+		mod = list_get(mem_system->mod_list, mod_id);
+		if (!mod_load_state(mod, bin_config, parent_elem, 1))
+		{
+			warning("%s: module missing from checkpoint or with a different "
+				"configuration, starting with a cold memory hierarchy",
+				mod->name);
+			return 0;
+		}
+	}
+
+	/* Restore them */
+	LIST_FOR_EACH(mem_system->mod_list, mod_id)
+	{
+		mod = list_get(mem_system->mod_list, mod_id);
+		if (!mod_load_state(mod, bin_config, parent_elem, 0))
+			panic("%s: %s: cannot restore checked state",
+				__FUNCTION__, mod->name);
+	}
+	return 1;
+}
+
+
+/* Switch internal and external networks between their warm-up model and the
+ * detailed model. */
+void mem_system_net_warm_up(int warm_up)
+{
+	struct net_t *net;
+
+	int net_id;
+
+	LIST_FOR_EACH(mem_system->net_list, net_id)
+	{
+		net = list_get(mem_system->net_list, net_id);
+		net_set_warm_up(net, warm_up);
+	}
+	for (net = net_find_first(); net; net = net_find_next())
+		net_set_warm_up(net, warm_up);
+}
+
+
 void main_memory_power_callback(double a, double b, double c, double d)
 {
 }
@@ -664,7 +759,10 @@ void main_memory_read_callback(void *payload, unsigned int id, uint64_t address,
 
 	uop = stack->event_queue_item;
 	if (uop)
+	{
 		uop->uinst->dram_interthread_penalty_cycles += interthread_penalty * cpu_freq / dram_freq;
+		uop->uinst->dram_interthread_cycles += interthread_penalty * cpu_freq / dram_freq;
+	}
 	assert(uop || stack->client_info->instr_fetch || stack->prefetch); /* If there isn't a uop, then it must be a instruction fetch access or a prefetch */
 }
 
@@ -707,20 +805,40 @@ void main_memory_tic_handler(int event, void *data)
 
 void mem_system_interval_report_init(void)
 {
+	struct net_t *net;
+
 	for (int i = 0; i < list_count(mem_system->mod_list); i++)
 	{
 		struct mod_t *mod = list_get(mem_system->mod_list, i);
 		mod_interval_report_init(mod);
+		if (mod->cache && mod->cache->prefetcher && mod->cache->prefetcher->profiler)
+			prefetch_profiler_interval_report_init(mod->cache->prefetcher->profiler);
 	}
+
+	/* Internal and external networks */
+	for (int i = 0; i < list_count(mem_system->net_list); i++)
+		net_interval_report_init(list_get(mem_system->net_list, i));
+	for (net = net_find_first(); net; net = net_find_next())
+		net_interval_report_init(net);
 }
 
 
 void mem_system_interval_report(void)
 {
+	struct net_t *net;
+
 	/* Report for each cache */
 	for (int i = 0; i < list_count(mem_system->mod_list); i++)
 	{
 		struct mod_t *mod = list_get(mem_system->mod_list, i);
 		mod_interval_report(mod);
+		if (mod->cache && mod->cache->prefetcher && mod->cache->prefetcher->profiler)
+			prefetch_profiler_interval_report(mod->cache->prefetcher->profiler);
 	}
+
+	/* Report for each network */
+	for (int i = 0; i < list_count(mem_system->net_list); i++)
+		net_interval_report(list_get(mem_system->net_list, i));
+	for (net = net_find_first(); net; net = net_find_next())
+		net_interval_report(net);
 }
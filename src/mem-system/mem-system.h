@@ -87,6 +87,8 @@ extern int EV_MAIN_MEMORY_TIC;
  * Public Functions
  */
 
+struct bin_config_t;
+struct bin_config_elem_t;
 
 void mem_system_init(void);
 void mem_system_done(void);
@@ -95,6 +97,12 @@ void mem_system_dump_report(void);
 
 struct mod_t *mem_system_get_mod(char *mod_name);
 struct net_t *mem_system_get_net(char *net_name);
+void mem_system_net_warm_up(int warm_up);
+
+void mem_system_save_state(struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem);
+int mem_system_load_state(struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem);
 
 void main_memory_power_callback(double a, double b, double c, double d);
 void main_memory_read_callback(void *payload, unsigned int id, uint64_t address, uint64_t interthread_penalty);
@@ -106,6 +106,20 @@ struct mem_page_t *mem_page_get_next(struct mem_t *mem, unsigned int addr)
 }
 
 
+/* Fill in the contents of a page restored lazily */
+void mem_page_load(struct mem_page_t *page)
+{
+	void (*load)(struct mem_page_t *page);
+
+	if (!page->load)
+		return;
+	load = page->load;
+	page->load = NULL;
+	load(page);
+	page->load_data = NULL;
+}
+
+
 /* Create new mem page */
 static struct mem_page_t *mem_page_create(struct mem_t *mem, unsigned int addr, int perm)
 {
@@ -183,6 +197,8 @@ void mem_copy(struct mem_t *mem, unsigned int dest, unsigned int src, int size)
 		page_dest = mem_page_get(mem, dest);
 		page_src = mem_page_get(mem, src);
 		assert(page_src && page_dest);
+		mem_page_load(page_src);
+		mem_page_load(page_dest);
 		
 		/* Different actions depending on whether source and
 		 * destination page data are allocated. */
@@ -230,6 +246,7 @@ void *mem_get_buffer(struct mem_t *mem, unsigned int addr, int size,
 		fatal("mem_get_buffer: permission denied at 0x%x", addr);
 	
 	/* Allocate and initialize page data if it does not exist yet. */
+	mem_page_load(page);
 	if (!page->data)
 		page->data = xcalloc(1, MEM_PAGE_SIZE);
 	
@@ -269,6 +286,7 @@ static void mem_access_page_boundary(struct mem_t *mem, unsigned int addr,
 		}
 	}
 	assert(page);
+	mem_page_load(page);
 
 	/* If it is a write access, set the 'modified' flag in the page
 	 * attributes (perm). This is not done for 'initialize' access. */
@@ -640,6 +658,7 @@ void mem_clone(struct mem_t *dst_mem, struct mem_t *src_mem)
 		for (page = src_mem->pages[i]; page; page = page->next)
 		{
 			mem_page_create(dst_mem, page->tag, page->perm);
+			mem_page_load(page);
 			if (page->data)
 				mem_access(dst_mem, page->tag, MEM_PAGE_SIZE,
 					page->data, mem_access_init);
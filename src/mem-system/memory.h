@@ -47,6 +47,11 @@ struct mem_page_t
 	enum mem_access_t perm;  /* Access permissions; combination of flags */
 	struct mem_page_t *next;
 	unsigned char *data;
+
+	/* Contents restored lazily, e.g., from a checkpoint. If 'load' is set,
+	 * it is called to fill in 'data' on the first access to the page. */
+	void (*load)(struct mem_page_t *page);
+	void *load_data;
 };
 
 struct mem_t
@@ -80,6 +85,7 @@ void mem_clear(struct mem_t *mem);
 
 struct mem_page_t *mem_page_get(struct mem_t *mem, unsigned int addr);
 struct mem_page_t *mem_page_get_next(struct mem_t *mem, unsigned int addr);
+void mem_page_load(struct mem_page_t *page);
 
 unsigned int mem_map_space(struct mem_t *mem, unsigned int addr, int size);
 unsigned int mem_map_space_down(struct mem_t *mem, unsigned int addr, int size);
@@ -128,6 +128,7 @@ struct mod_stack_t
 	int background : 1;
 	int wb_hit : 1;
 	int stream_retried : 1; /* Tells if this stack id has tried to lock a stream entry and has failed. */
+	int pref_hit : 1; /* Demand hit on a block brought by a prefetch */
 
 	/* Prefetch */
 	int prefetch;
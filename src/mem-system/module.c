@@ -27,6 +27,7 @@
 #include <dramsim/bindings-c.h>
 #include <lib/esim/esim.h>
 #include <lib/mhandle/mhandle.h>
+#include <lib/util/bin-config.h>
 #include <lib/util/bloom.h>
 #include <lib/util/debug.h>
 #include <lib/util/file.h>
@@ -38,6 +39,8 @@
 #include <lib/util/repos.h>
 #include <lib/util/stats.h>
 #include <lib/util/string.h>
+#include <network/network.h>
+#include <network/node.h>
 
 #include "atd.h"
 #include "directory.h"
@@ -59,6 +62,15 @@ struct str_map_t mod_access_kind_map =
 	}
 };
 
+/* String map for address range hash functions */
+struct str_map_t mod_range_hash_map =
+{
+	2, {
+		{ "XOR", mod_range_hash_xor },
+		{ "MUL", mod_range_hash_mul }
+	}
+};
+
 /* Event used for updating the state of adaptative prefetch policy */
 int EV_MOD_ADAPT_PREF;
 
@@ -357,10 +369,11 @@ int mod_find_block_in_stream(struct mod_t *mod, unsigned int addr, int stream)
 }
 
 
-/* Return {set, way, tag, state} for an address.
+/* Return {set, way, tag, state} for an address, counting hits on the MRU
+ * block of the set only if 'count_mru_hits' is set.
  * The function returns TRUE on hit, FALSE on miss. */
-int mod_find_block(struct mod_t *mod, unsigned int addr, int *set_ptr,
-	int *way_ptr, int *tag_ptr, int *state_ptr)
+static int mod_lookup_block(struct mod_t *mod, unsigned int addr, int *set_ptr,
+	int *way_ptr, int *tag_ptr, int *state_ptr, int count_mru_hits)
 {
 	struct cache_t *cache = mod->cache;
 	struct cache_block_t *blk,*mru_blk;
@@ -374,19 +387,7 @@ int mod_find_block(struct mod_t *mod, unsigned int addr, int *set_ptr,
 	/* A transient tag is considered a hit if the block is
 	 * locked in the corresponding directory. */
 	tag = addr & ~cache->block_mask;
-	if (mod->range_kind == mod_range_interleaved)
-	{
-		unsigned int num_mods = mod->range.interleaved.mod;
-		set = ((tag >> cache->log_block_size) / num_mods) % cache->num_sets;
-	}
-	else if (mod->range_kind == mod_range_bounds)
-	{
-		set = (tag >> cache->log_block_size) % cache->num_sets;
-	}
-	else
-	{
-		panic("%s: invalid range kind (%d)", __FUNCTION__, mod->range_kind);
-	}
+	set = mod_get_set(mod, addr);
 
 	for (way = 0; way < cache->assoc; way++)
 	{
@@ -395,7 +396,7 @@ int mod_find_block(struct mod_t *mod, unsigned int addr, int *set_ptr,
 		
 		if (blk->tag == tag && blk->state){
 			//Hugo
-			if(blk->tag == mru_blk->tag){
+			if(count_mru_hits && blk->tag == mru_blk->tag){
 				mod->mru_hits++;
 			}
 			//End of modification
@@ -424,6 +425,15 @@ int mod_find_block(struct mod_t *mod, unsigned int addr, int *set_ptr,
 }
 
 
+/* Return {set, way, tag, state} for an address.
+ * The function returns TRUE on hit, FALSE on miss. */
+int mod_find_block(struct mod_t *mod, unsigned int addr, int *set_ptr,
+	int *way_ptr, int *tag_ptr, int *state_ptr)
+{
+	return mod_lookup_block(mod, addr, set_ptr, way_ptr, tag_ptr, state_ptr, 1);
+}
+
+
 /* Look for a block in prefetch buffer.
  * The function returns 0 on miss, 1 if hit on head and 2 if hit in the middle of the stream. */
 int mod_find_pref_block(struct mod_t *mod, unsigned int addr, int *pref_stream_ptr, int *pref_slot_ptr)
@@ -601,8 +611,22 @@ void mod_unlock_port(struct mod_t *mod, struct mod_port_t *port,
 		return;
 
 
-	/* Wake up one access waiting for a free port */
+	/* Wake up one access waiting for a free port. If the module queues its
+	 * prefetches, demand accesses go first. */
 	stack = mod->port_waiting_list_head;
+	if (stack->prefetch && mod->kind == mod_kind_cache &&
+		mod->cache->prefetcher && mod->cache->prefetcher->queue)
+	{
+		struct mod_stack_t *demand = stack;
+
+		while (demand && demand->prefetch)
+			demand = demand->port_waiting_list_next;
+		if (demand)
+		{
+			stack = demand;
+			mod->prefetch_demotions++;
+		}
+	}
 	event = stack->port_waiting_list_event;
 	assert(DOUBLE_LINKED_LIST_MEMBER(mod, port_waiting, stack));
 	DOUBLE_LINKED_LIST_REMOVE(mod, port_waiting, stack);
@@ -731,6 +755,41 @@ struct mod_stack_t *mod_in_flight_write(struct mod_t *mod,
 }
 
 
+/* Index among 'range.interleaved.mod' modules of the module serving an
+ * address, for hashed ranges. The XOR hash folds the address in chunks of
+ * 'hash_bits' bits, so that strided accesses spread across modules. The
+ * multiplicative hash rotates the modules of each group of 'mod' consecutive
+ * chunks by a Fibonacci hash of the group number. Either way, the chunks of a
+ * group go to different modules, which 'mod_get_set' relies on. */
+unsigned int mod_range_hash(struct mod_t *mod, unsigned int addr)
+{
+	unsigned int value;
+	unsigned int hash;
+	unsigned int mask;
+
+	value = addr / mod->range.interleaved.div;
+	switch (mod->range.interleaved.hash)
+	{
+
+	case mod_range_hash_xor:
+
+		mask = (1U << mod->range.interleaved.hash_bits) - 1;
+		for (hash = 0; value; value >>= mod->range.interleaved.hash_bits)
+			hash ^= value & mask;
+		return hash % mod->range.interleaved.mod;
+
+	case mod_range_hash_mul:
+
+		hash = value / mod->range.interleaved.mod * 2654435761U;
+		hash = ((unsigned long long) hash * mod->range.interleaved.mod) >> 32;
+		return (value + hash) % mod->range.interleaved.mod;
+	}
+
+	panic("%s: invalid hash function", __FUNCTION__);
+	return 0;
+}
+
+
 int mod_serves_address(struct mod_t *mod, unsigned int addr)
 {
 	/* Address bounds */
@@ -744,12 +803,44 @@ int mod_serves_address(struct mod_t *mod, unsigned int addr)
 			mod->range.interleaved.mod ==
 			mod->range.interleaved.eq;
 
+	/* Hashed addresses */
+	if (mod->range_kind == mod_range_hashed)
+		return mod_range_hash(mod, addr) == mod->range.interleaved.eq;
+
 	/* Invalid */
 	panic("%s: invalid range kind", __FUNCTION__);
 	return 0;
 }
 
 
+/* Cache set of an address. For interleaved and hashed ranges, a module gets
+ * one chunk of 'range.interleaved.div' bytes out of each group of
+ * 'range.interleaved.mod' consecutive chunks (see 'mod_range_hash'), so sets
+ * are indexed with the group number, and blocks within a chunk use
+ * consecutive sets. Otherwise, some sets would be left unused. */
+int mod_get_set(struct mod_t *mod, unsigned int addr)
+{
+	struct cache_t *cache = mod->cache;
+	unsigned int div;
+	unsigned int index;
+
+	if (mod->range_kind == mod_range_bounds)
+		return (addr >> cache->log_block_size) % cache->num_sets;
+
+	if (mod->range_kind == mod_range_interleaved || mod->range_kind == mod_range_hashed)
+	{
+		div = mod->range.interleaved.div;
+		index = addr / div / mod->range.interleaved.mod *
+			(div >> cache->log_block_size) +
+			((addr % div) >> cache->log_block_size);
+		return index % cache->num_sets;
+	}
+
+	panic("%s: invalid range kind (%d)", __FUNCTION__, mod->range_kind);
+	return 0;
+}
+
+
 /* Return the low module serving a given address. */
 struct mod_t *mod_get_low_mod(struct mod_t *mod, unsigned int addr)
 {
@@ -979,6 +1070,311 @@ void mod_client_info_free(struct mod_t *mod, struct mod_client_info_t *client_in
 }
 
 
+/*
+ * Functional warming. Accesses done without timing, leaving block states and
+ * directory entries as a coherent access would. No events are scheduled, so
+ * they must only be used while no access is in flight.
+ */
+
+/* Module above 'mod' connected to node 'index' of its high network */
+static struct mod_t *mod_warm_sharer(struct mod_t *mod, int index)
+{
+	struct net_node_t *node;
+
+	node = list_get(mod->high_net->node_list, index);
+	return node->user_data;
+}
+
+
+/* Invalidate the block containing 'addr' in 'mod' and all its copies above.
+ * Return TRUE if any of the copies was dirty. */
+static int mod_warm_invalidate(struct mod_t *mod, unsigned int addr,
+	struct mod_client_info_t *client_info)
+{
+	struct dir_t *dir = mod->dir;
+
+	int dirty;
+	int set;
+	int way;
+	int tag;
+	int state;
+	int z;
+	int i;
+
+	if (!mod_lookup_block(mod, addr, &set, &way, &tag, &state, 0))
+		return 0;
+
+	dirty = state == cache_block_modified || state == cache_block_owned;
+	for (z = 0; z < dir->zsize; z++)
+	{
+		for (i = 0; i < dir->num_nodes; i++)
+			if (dir_entry_is_sharer(dir, set, way, z, i))
+				dirty |= mod_warm_invalidate(mod_warm_sharer(mod, i),
+					tag + z * mod->sub_block_size, client_info);
+		dir_entry_clear_all_sharers(dir, set, way, z);
+		dir_entry_set_owner(dir, set, way, z, DIR_ENTRY_OWNER_NONE);
+	}
+	cache_set_block(mod->cache, set, way, 0, cache_block_invalid, client_info);
+	return dirty;
+}
+
+
+/* Leave the block containing 'addr' in 'mod' and all its copies above in
+ * shared state. Return TRUE if any of the copies was dirty. */
+static int mod_warm_downgrade(struct mod_t *mod, unsigned int addr,
+	struct mod_client_info_t *client_info)
+{
+	struct dir_t *dir = mod->dir;
+	struct dir_entry_t *dir_entry;
+
+	int dirty;
+	int set;
+	int way;
+	int tag;
+	int state;
+	int z;
+
+	if (!mod_lookup_block(mod, addr, &set, &way, &tag, &state, 0))
+		return 0;
+
+	dirty = state == cache_block_modified || state == cache_block_owned;
+	for (z = 0; z < dir->zsize; z++)
+	{
+		dir_entry = dir_entry_get(dir, set, way, z);
+		if (!DIR_ENTRY_VALID_OWNER(dir_entry))
+			continue;
+		dirty |= mod_warm_downgrade(mod_warm_sharer(mod, dir_entry->owner),
+			tag + z * mod->sub_block_size, client_info);
+		dir_entry_set_owner(dir, set, way, z, DIR_ENTRY_OWNER_NONE);
+	}
+	if (state != cache_block_shared && state != cache_block_noncoherent)
+		cache_set_block(mod->cache, set, way, tag, cache_block_shared, client_info);
+	return dirty;
+}
+
+
+/* Remove 'mod' from the directory entries of the block at 'tag' in the lower
+ * module, after evicting it. */
+static void mod_warm_evict(struct mod_t *mod, int tag, int dirty,
+	struct mod_client_info_t *client_info)
+{
+	struct mod_t *low_mod;
+	struct dir_t *dir;
+	struct dir_entry_t *dir_entry;
+
+	int node = mod->low_net_node->index;
+	int set;
+	int way;
+	int low_tag;
+	int state;
+	int z;
+
+	low_mod = mod_get_low_mod(mod, tag);
+	if (!mod_lookup_block(low_mod, tag, &set, &way, &low_tag, &state, 0))
+		return;
+
+	dir = low_mod->dir;
+	for (z = 0; z < dir->zsize; z++)
+	{
+		if (low_tag + z * low_mod->sub_block_size < tag ||
+				low_tag + z * low_mod->sub_block_size >= tag + mod->block_size)
+			continue;
+		dir_entry = dir_entry_get(dir, set, way, z);
+		dir_entry_clear_sharer(dir, set, way, z, node);
+		if (dir_entry->owner == node)
+			dir_entry_set_owner(dir, set, way, z, DIR_ENTRY_OWNER_NONE);
+	}
+	if (dirty && low_mod->kind != mod_kind_main_memory)
+		cache_set_block(low_mod->cache, set, way, low_tag, cache_block_modified, client_info);
+}
+
+
+/* Bring the block containing 'addr' into 'mod', with write permission if
+ * 'write' is set, going down the hierarchy as needed. Statistics of the
+ * modules are not updated. */
+void mod_warm_access(struct mod_t *mod, unsigned int addr, int write,
+	struct mod_client_info_t *client_info)
+{
+	struct mod_t *low_mod;
+	struct dir_t *dir;
+	struct dir_entry_t *dir_entry;
+
+	int node;
+	int hit;
+	int set;
+	int way;
+	int tag;
+	int state;
+	int low_set;
+	int low_way;
+	int low_tag;
+	int low_state;
+	int victim_tag;
+	int victim_state;
+	int entry_tag;
+	int shared;
+	int dirty;
+	int z;
+	int i;
+
+	/* Hit with enough permissions */
+	hit = mod_lookup_block(mod, addr, &set, &way, &tag, &state, 0);
+	low_mod = mod->kind == mod_kind_main_memory ? NULL : mod_get_low_mod(mod, addr);
+	if (hit && (!write || !low_mod || state == cache_block_modified ||
+			state == cache_block_exclusive))
+	{
+		cache_access_block(mod->cache, set, way);
+		if (write && state == cache_block_exclusive)
+			cache_set_block(mod->cache, set, way, tag, cache_block_modified, client_info);
+		return;
+	}
+
+	/* Get block from lower module */
+	low_set = low_way = low_tag = low_state = 0;
+	if (low_mod)
+	{
+		mod_warm_access(low_mod, addr, write, client_info);
+		hit = mod_lookup_block(mod, addr, &set, &way, &tag, &state, 0);
+		if (!mod_lookup_block(low_mod, addr, &low_set, &low_way,
+				&low_tag, &low_state, 0))
+			panic("%s: block not found in %s", __FUNCTION__, low_mod->name);
+	}
+
+	/* Replace victim, with all its copies above */
+	dir = mod->dir;
+	if (!hit)
+	{
+		way = cache_replace_block(mod->cache, set, client_info);
+		cache_get_block(mod->cache, set, way, &victim_tag, &victim_state);
+		if (victim_state)
+		{
+			dirty = victim_state == cache_block_modified ||
+				victim_state == cache_block_owned;
+			for (z = 0; z < dir->zsize; z++)
+				for (i = 0; i < dir->num_nodes; i++)
+					if (dir_entry_is_sharer(dir, set, way, z, i))
+						dirty |= mod_warm_invalidate(mod_warm_sharer(mod, i),
+							victim_tag + z * mod->sub_block_size, client_info);
+			if (low_mod)
+				mod_warm_evict(mod, victim_tag, dirty, client_info);
+		}
+		for (z = 0; z < dir->zsize; z++)
+		{
+			dir_entry_clear_all_sharers(dir, set, way, z);
+			dir_entry_set_owner(dir, set, way, z, DIR_ENTRY_OWNER_NONE);
+		}
+	}
+
+	/* Main memory */
+	if (!low_mod)
+	{
+		cache_set_block(mod->cache, set, way, tag, cache_block_exclusive, client_info);
+		cache_access_block(mod->cache, set, way);
+		return;
+	}
+
+	/* Register in the directory of the lower module. A write invalidates all
+	 * other copies, a read leaves a previous owner in shared state. */
+	node = mod->low_net_node->index;
+	shared = low_state == cache_block_shared || low_state == cache_block_owned ||
+		low_state == cache_block_noncoherent;
+	dir = low_mod->dir;
+	for (z = 0; z < dir->zsize; z++)
+	{
+		entry_tag = low_tag + z * low_mod->sub_block_size;
+		if (entry_tag < tag || entry_tag >= tag + mod->block_size)
+			continue;
+		dir_entry = dir_entry_get(dir, low_set, low_way, z);
+		for (i = 0; i < dir->num_nodes; i++)
+		{
+			if (i == node || !dir_entry_is_sharer(dir, low_set, low_way, z, i))
+				continue;
+			if (write)
+			{
+				mod_warm_invalidate(mod_warm_sharer(low_mod, i), entry_tag, client_info);
+				dir_entry_clear_sharer(dir, low_set, low_way, z, i);
+				continue;
+			}
+			if (dir_entry->owner == i &&
+					mod_warm_downgrade(mod_warm_sharer(low_mod, i), entry_tag, client_info))
+				cache_set_block(low_mod->cache, low_set, low_way, low_tag,
+					cache_block_modified, client_info);
+			shared = 1;
+		}
+		dir_entry_set_owner(dir, low_set, low_way, z, DIR_ENTRY_OWNER_NONE);
+		dir_entry_set_sharer(dir, low_set, low_way, z, node);
+	}
+	if (write || !shared)
+	{
+		for (z = 0; z < dir->zsize; z++)
+		{
+			entry_tag = low_tag + z * low_mod->sub_block_size;
+			if (entry_tag >= tag && entry_tag < tag + mod->block_size)
+				dir_entry_set_owner(dir, low_set, low_way, z, node);
+		}
+	}
+
+	/* New state */
+	state = write ? cache_block_modified : shared ? cache_block_shared :
+		cache_block_exclusive;
+	cache_set_block(mod->cache, set, way, tag, state, client_info);
+	cache_access_block(mod->cache, set, way);
+}
+
+
+/* Save the cache, directory and prefetcher of the module in a child element
+ * of 'parent_elem' named after the module. */
+void mod_save_state(struct mod_t *mod, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem)
+{
+	struct bin_config_elem_t *mod_elem;
+
+	mod_elem = bin_config_add(bin_config, parent_elem, mod->name, NULL, 0);
+	cache_save_state(mod->cache, bin_config,
+		bin_config_add(bin_config, mod_elem, "cache", NULL, 0));
+	if (mod->dir)
+		dir_save_state(mod->dir, bin_config,
+			bin_config_add(bin_config, mod_elem, "dir", NULL, 0));
+	if (mod->cache->prefetcher)
+		prefetcher_save_state(mod->cache->prefetcher, bin_config,
+			bin_config_add(bin_config, mod_elem, "prefetcher", NULL, 0));
+}
+
+
+/* Restore the state saved with 'mod_save_state'. Return 0 if the cache,
+ * directory or prefetcher is missing from the checkpoint or was saved with a
+ * different geometry. If 'check_only' is set, nothing is restored. Since the
+ * cache and directory of a module must agree, a module is only restored after
+ * all its structures were checked with 'check_only'. */
+int mod_load_state(struct mod_t *mod, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem, int check_only)
+{
+	struct bin_config_elem_t *mod_elem;
+	struct bin_config_elem_t *cache_elem;
+	struct bin_config_elem_t *dir_elem;
+	struct bin_config_elem_t *pref_elem;
+
+	mod_elem = bin_config_get(bin_config, parent_elem, mod->name, NULL, NULL);
+	if (!mod_elem)
+		return 0;
+
+	/* Structures saved must match those of the module */
+	cache_elem = bin_config_get(bin_config, mod_elem, "cache", NULL, NULL);
+	dir_elem = bin_config_get(bin_config, mod_elem, "dir", NULL, NULL);
+	pref_elem = bin_config_get(bin_config, mod_elem, "prefetcher", NULL, NULL);
+	if (!cache_elem || !dir_elem != !mod->dir ||
+			!pref_elem != !mod->cache->prefetcher)
+		return 0;
+
+	/* Check or restore */
+	return cache_load_state(mod->cache, bin_config, cache_elem, check_only) &&
+		(!mod->dir || dir_load_state(mod->dir, bin_config,
+			dir_elem, check_only)) &&
+		(!mod->cache->prefetcher || prefetcher_load_state(
+			mod->cache->prefetcher, bin_config, pref_elem, check_only));
+}
+
+
 void mod_interval_report_init(struct mod_t *mod)
 {
 	struct mod_report_stack_t *stack;
@@ -136,6 +136,10 @@ struct mod_client_info_t
 	 * to the PC of the instruction accessing the module */
 	unsigned int prefetcher_eip;
 
+	/* Prefetch profiler entry of the prefetch, NULL if this is not a
+	 * prefetch or the module has no profiler */
+	struct prefetch_profiler_entry_t *pref_origin;
+
 	unsigned int late_prefetch : 1; /* Flag that marks this access as a late prefetch */
 	unsigned int instr_fetch : 1;   /* Flag, access requesting a block of intructions */
 };
@@ -145,7 +149,16 @@ enum mod_range_kind_t
 {
 	mod_range_invalid = 0,
 	mod_range_bounds,
-	mod_range_interleaved
+	mod_range_interleaved,
+	mod_range_hashed
+};
+
+/* Hash functions for address ranges of kind 'mod_range_hashed' */
+extern struct str_map_t mod_range_hash_map;
+enum mod_range_hash_t
+{
+	mod_range_hash_xor = 0,
+	mod_range_hash_mul
 };
 
 struct mod_adapt_pref_stack_t
@@ -219,12 +232,14 @@ struct mod_t
 			unsigned int high;
 		} bounds;
 
-		/* For range_kind = mod_range_interleaved */
+		/* For range_kind = mod_range_interleaved and mod_range_hashed */
 		struct
 		{
 			unsigned int mod;
 			unsigned int div;
 			unsigned int eq;
+			enum mod_range_hash_t hash;
+			int hash_bits;	/* Bits folded per step by XOR hash */
 		} interleaved;
 	} range;
 
@@ -382,6 +397,13 @@ struct mod_t
 	long long canceled_prefetches_cache_hit;
 	long long canceled_prefetches_stream_hit;
 	long long canceled_prefetches_retry;
+	long long queued_prefetches; /* Prefetches that went through the prefetch queue */
+	long long dropped_prefetches_queue_full;
+	long long dropped_prefetches_in_flight;
+	long long dropped_prefetches_dram;
+	long long injected_prefetches; /* Queued prefetches injected into the module */
+	long long prefetch_queue_cycles; /* Cycles spent in the queue by injected prefetches */
+	long long prefetch_demotions; /* Demand accesses given a port before a waiting prefetch */
 	long long effective_useful_prefetches; /* Useful prefetches with less delay hit cicles than 1/3 of the delay of accesing MM */
 	long long pollution;
 
@@ -452,9 +474,19 @@ struct mod_stack_t *mod_in_flight_address(struct mod_t *mod, unsigned int addr,
 struct mod_stack_t *mod_in_flight_write(struct mod_t *mod,
 	struct mod_stack_t *older_than_stack);
 
+unsigned int mod_range_hash(struct mod_t *mod, unsigned int addr);
 int mod_serves_address(struct mod_t *mod, unsigned int addr);
+int mod_get_set(struct mod_t *mod, unsigned int addr);
 struct mod_t *mod_get_low_mod(struct mod_t *mod, unsigned int addr);
 
+void mod_warm_access(struct mod_t *mod, unsigned int addr, int write,
+	struct mod_client_info_t *client_info);
+
+void mod_save_state(struct mod_t *mod, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem);
+int mod_load_state(struct mod_t *mod, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem, int check_only);
+
 int mod_get_retry_latency(struct mod_t *mod);
 
 struct mod_stack_t *mod_can_coalesce(struct mod_t *mod,
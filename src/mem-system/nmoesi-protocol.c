@@ -33,6 +33,7 @@
 #include <lib/util/list.h>
 #include <lib/util/misc.h>
 #include <lib/util/string.h>
+#include <network/message.h>
 #include <network/network.h>
 #include <network/node.h>
 
@@ -42,6 +43,7 @@
 #include "mem-system.h"
 #include "mmu.h"
 #include "mod-stack.h"
+#include "prefetch-profiler.h"
 #include "prefetcher.h"
 #include "stream-prefetcher.h"
 
@@ -385,6 +387,8 @@ void mod_handler_pref(int event, void *data)
 		if(!stack->hit && !stack->stream_hit)
 		{
 			mod->completed_prefetches++;
+			if (pref->profiler)
+				prefetch_profiler_complete(pref->profiler, stack);
 
 			if (stack->client_info->late_prefetch)
 			{
@@ -1786,7 +1790,10 @@ void mod_handler_nmoesi_prefetch(int event, void *data)
 		/* Statistics. They are collected here to avoid cancelled prefetches, that go directly to EV_MOD_NMOESI_PREFETCH_FINISH. */
 		if(!stack->hit && !stack->stream_hit)
 		{
+			prefetcher_cache_fill(stack, mod);
 			mod->completed_prefetches++;
+			if (mod->cache->prefetcher->profiler)
+				prefetch_profiler_complete(mod->cache->prefetcher->profiler, stack);
 
 			if (stack->client_info->late_prefetch)
 			{
@@ -1868,6 +1875,13 @@ void mod_handler_nmoesi_find_and_lock(int event, void *data)
 		/* Default return values */
 		ret->err = 0;
 
+		/* Deepest level reached by the access of an x86 uop */
+		if (stack->request_dir == mod_request_up_down && stack->event_queue_item)
+		{
+			struct x86_uop_t *uop = stack->event_queue_item;
+			uop->uinst->mem_level = MAX(uop->uinst->mem_level, mod->level);
+		}
+
 		/* If block is in write buffer and request dir is up down, retry. Else, wait. */
 		if (!stack->background &&!(mod->kind==mod_kind_main_memory && stack->request_dir == mod_request_up_down))
 		{
@@ -2477,6 +2491,11 @@ void mod_handler_nmoesi_find_and_lock(int event, void *data)
 			return;
 		}
 
+		/* Demand hit on a prefetched block. Checked before the statistics
+		 * below clear the prefetched bit. */
+		stack->pref_hit = mod->kind == mod_kind_cache && !stack->prefetch &&
+			(stack->stream_hit || (stack->hit && mod_get_prefetched_bit(mod, stack->tag)));
+
 		/* Statistics */
 		if (should_count_stats(stack))
 		{
@@ -2587,6 +2606,8 @@ void mod_handler_nmoesi_find_and_lock(int event, void *data)
 			{
 				mod->useful_prefetches++;
 				ctx->report_stack->useful_prefs_per_level_int[mod->level]++;
+				if (pref && pref->profiler)
+					prefetch_profiler_useful(pref->profiler, stack);
 				mod_set_prefetched_bit(mod, stack->addr, 0);
 			}
 
@@ -2601,6 +2622,8 @@ void mod_handler_nmoesi_find_and_lock(int event, void *data)
 				/* Prefetch - demand pollution */
 				if (hash_table_gen_get(mod->report_stack->pref_pollution_filter, (void*) &stack->tag, sizeof(stack->tag)))
 					mod->report_stack->pref_pollution_int++;
+				if (pref && pref->profiler)
+					prefetch_profiler_miss(pref->profiler, stack);
 
 				/* Thread - thread pollution */
 				X86_CORE_FOR_EACH X86_THREAD_FOR_EACH
@@ -2666,6 +2689,7 @@ out:;
 		ret->background = stack->background;
 		ret->wb_hit = stack->wb_hit;
 		ret->hit = stack->hit;
+		ret->pref_hit = stack->pref_hit;
 		ret->atd_hit = stack->atd_hit;
 		mod_stack_return(stack);
 		return;
@@ -2794,6 +2818,8 @@ void mod_handler_nmoesi_evict(int event, void *data)
 		/* Send message */
 		stack->msg = net_try_send_ev(mod->low_net, mod->low_net_node,
 			low_node, msg_size, EV_MOD_NMOESI_EVICT_RECEIVE, stack, event, stack);
+		if (stack->msg)
+			stack->msg->msg_class = net_msg_class_writeback;
 		return;
 	}
 
@@ -3027,6 +3053,8 @@ void mod_handler_nmoesi_evict(int event, void *data)
 		stack->msg = net_try_send_ev(target_mod->high_net, target_mod->high_net_node,
 			mod->low_net_node, 8, EV_MOD_NMOESI_EVICT_REPLY_RECEIVE, stack,
 			event, stack);
+		if (stack->msg)
+			stack->msg->msg_class = net_msg_class_response;
 		return;
 	}
 
@@ -3058,6 +3086,10 @@ void mod_handler_nmoesi_evict(int event, void *data)
 			{
 				assert(!prefetcher_uses_stream_buffers(mod->cache->prefetcher)); /* Prefetches to stream buffers cannot cause evictions */
 
+				/* Prefetch pollution per prefetcher source */
+				if (mod->cache->prefetcher->profiler)
+					prefetch_profiler_evict(mod->cache->prefetcher->profiler, stack);
+
 				/* Prefetch pollution for adaptive prefetch */
 				if (prefetcher_uses_pollution_filters(mod->cache->prefetcher))
 				{
@@ -3281,6 +3313,9 @@ void mod_handler_nmoesi_read_request(int event, void *data)
 		/* Send message */
 		stack->msg = net_try_send_ev(net, src_node, dst_node, 8,
 			EV_MOD_NMOESI_READ_REQUEST_RECEIVE, stack, event, stack);
+		if (stack->msg)
+			stack->msg->msg_class = stack->request_dir == mod_request_up_down ?
+				net_msg_class_request : net_msg_class_invalidation;
 		return;
 	}
 
@@ -4137,6 +4172,8 @@ void mod_handler_nmoesi_read_request(int event, void *data)
 		/* Send message */
 		stack->msg = net_try_send_ev(net, src_node, dst_node, stack->reply_size,
 			EV_MOD_NMOESI_READ_REQUEST_FINISH, stack, event, stack);
+		if (stack->msg)
+			stack->msg->msg_class = net_msg_class_response;
 
 		return;
 	}
@@ -4229,6 +4266,9 @@ void mod_handler_nmoesi_write_request(int event, void *data)
 		/* Send message */
 		stack->msg = net_try_send_ev(net, src_node, dst_node, 8,
 			EV_MOD_NMOESI_WRITE_REQUEST_RECEIVE, stack, event, stack);
+		if (stack->msg)
+			stack->msg->msg_class = stack->request_dir == mod_request_up_down ?
+				net_msg_class_request : net_msg_class_invalidation;
 		return;
 	}
 
@@ -4777,6 +4817,8 @@ void mod_handler_nmoesi_write_request(int event, void *data)
 
 		stack->msg = net_try_send_ev(net, src_node, dst_node, stack->reply_size,
 			EV_MOD_NMOESI_WRITE_REQUEST_FINISH, stack, event, stack);
+		if (stack->msg)
+			stack->msg->msg_class = net_msg_class_response;
 
 		return;
 	}
@@ -4819,6 +4861,8 @@ void mod_handler_nmoesi_peer(int event, void *data)
 		/* Send message from src to peer */
 		stack->msg = net_try_send_ev(src->low_net, src->low_net_node, peer->low_net_node,
 			src->block_size + 8, EV_MOD_NMOESI_PEER_RECEIVE, stack, event, stack);
+		if (stack->msg)
+			stack->msg->msg_class = net_msg_class_response;
 
 		return;
 	}
@@ -4848,6 +4892,8 @@ void mod_handler_nmoesi_peer(int event, void *data)
 		/* Send ack from peer to src */
 		stack->msg = net_try_send_ev(peer->low_net, peer->low_net_node, src->low_net_node,
 				8, EV_MOD_NMOESI_PEER_FINISH, stack, event, stack);
+		if (stack->msg)
+			stack->msg->msg_class = net_msg_class_response;
 
 		return;
 	}
@@ -5004,6 +5050,8 @@ void mod_handler_nmoesi_message(int event, void *data)
 		/* Send message */
 		stack->msg = net_try_send_ev(net, src_node, dst_node, 8,
 			EV_MOD_NMOESI_MESSAGE_RECEIVE, stack, event, stack);
+		if (stack->msg)
+			stack->msg->msg_class = net_msg_class_request;
 		return;
 	}
 
@@ -5092,6 +5140,8 @@ void mod_handler_nmoesi_message(int event, void *data)
 		/* Send message */
 		stack->msg = net_try_send_ev(net, src_node, dst_node, stack->reply_size,
 			EV_MOD_NMOESI_MESSAGE_FINISH, stack, event, stack);
+		if (stack->msg)
+			stack->msg->msg_class = net_msg_class_response;
 		return;
 	}
 
@@ -0,0 +1,299 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <lib/esim/esim.h>
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/debug.h>
+#include <lib/util/file.h>
+#include <lib/util/hash-table-gen.h>
+#include <lib/util/list.h>
+#include <lib/util/misc.h>
+#include <lib/util/stats.h>
+
+#include "cache.h"
+#include "mod-stack.h"
+#include "module.h"
+#include "prefetch-profiler.h"
+#include "prefetcher.h"
+
+
+struct prefetch_profiler_key_t
+{
+	unsigned int eip;
+	int source;
+};
+
+
+struct prefetch_profiler_t *prefetch_profiler_create(struct mod_t *mod, int top_n)
+{
+	struct prefetch_profiler_t *profiler;
+
+	assert(mod->kind == mod_kind_cache);
+	assert(top_n > 0);
+
+	profiler = xcalloc(1, sizeof(struct prefetch_profiler_t));
+	profiler->mod = mod;
+	profiler->top_n = top_n;
+	profiler->entry_table = hash_table_gen_create(256);
+	profiler->entry_list = list_create();
+	profiler->victim_table = hash_table_gen_create(256);
+
+	return profiler;
+}
+
+
+void prefetch_profiler_free(struct prefetch_profiler_t *profiler)
+{
+	if (!profiler)
+		return;
+
+	while (list_count(profiler->entry_list))
+		free(list_remove_at(profiler->entry_list, 0));
+	list_free(profiler->entry_list);
+	hash_table_gen_free(profiler->entry_table);
+	hash_table_gen_free(profiler->victim_table);
+	file_close(profiler->interval_file);
+	free(profiler);
+}
+
+
+/* Entry of a prefetcher source. It is created the first time the source
+ * generates a prefetch, and travels with the prefetch in its client info. */
+struct prefetch_profiler_entry_t *prefetch_profiler_issue(
+	struct prefetch_profiler_t *profiler, unsigned int eip, int source)
+{
+	struct prefetch_profiler_entry_t *entry;
+	struct prefetch_profiler_key_t key;
+
+	/* Initialize the whole key, padding included, since it is hashed */
+	memset(&key, 0, sizeof key);
+	key.eip = eip;
+	key.source = source;
+
+	entry = hash_table_gen_get(profiler->entry_table, (char *) &key, sizeof key);
+	if (!entry)
+	{
+		entry = xcalloc(1, sizeof(struct prefetch_profiler_entry_t));
+		entry->eip = eip;
+		entry->source = source;
+		hash_table_gen_insert(profiler->entry_table, (char *) &key, sizeof key, entry);
+		list_add(profiler->entry_list, entry);
+	}
+
+	entry->issued++;
+	return entry;
+}
+
+
+/* A prefetch brought a block. The block remembers the entry, so that a later
+ * demand hit on it can be credited. */
+void prefetch_profiler_complete(struct prefetch_profiler_t *profiler,
+	struct mod_stack_t *stack)
+{
+	struct prefetch_profiler_entry_t *entry;
+	struct cache_t *cache = profiler->mod->cache;
+
+	entry = stack->client_info->pref_origin;
+	if (!entry)
+		return;
+	entry->completed++;
+	if (stack->client_info->late_prefetch)
+		entry->late++;
+
+	if (prefetcher_uses_stream_buffers(cache->prefetcher))
+		cache_get_pref_block(cache, stack->pref_stream, stack->pref_slot)->pref_origin = entry;
+	else
+		cache->sets[stack->set].blocks[stack->way].pref_origin = entry;
+}
+
+
+void prefetch_profiler_useful(struct prefetch_profiler_t *profiler,
+	struct mod_stack_t *stack)
+{
+	struct prefetch_profiler_entry_t *entry;
+	struct cache_t *cache = profiler->mod->cache;
+	int set;
+	int way;
+
+	if (stack->stream_hit)
+		entry = cache_get_pref_block(cache, stack->pref_stream, stack->pref_slot)->pref_origin;
+	else if (mod_find_block(profiler->mod, stack->tag, &set, &way, NULL, NULL))
+		entry = cache->sets[set].blocks[way].pref_origin;
+	else
+		entry = NULL;
+
+	/* Blocks prefetched before the profiler saw the prefetch */
+	if (entry)
+		entry->useful++;
+}
+
+
+/* A prefetch evicted a block. Remember who did it, in case the block is
+ * missed later. */
+void prefetch_profiler_evict(struct prefetch_profiler_t *profiler,
+	struct mod_stack_t *stack)
+{
+	struct prefetch_profiler_entry_t *entry;
+	unsigned int tag = stack->src_tag;
+
+	entry = stack->client_info->pref_origin;
+	if (!entry)
+		return;
+	if (!hash_table_gen_insert(profiler->victim_table, (char *) &tag, sizeof tag, entry))
+		hash_table_gen_set(profiler->victim_table, (char *) &tag, sizeof tag, entry);
+}
+
+
+void prefetch_profiler_miss(struct prefetch_profiler_t *profiler,
+	struct mod_stack_t *stack)
+{
+	struct prefetch_profiler_entry_t *entry;
+	unsigned int tag = stack->tag;
+
+	entry = hash_table_gen_remove(profiler->victim_table, (char *) &tag, sizeof tag);
+	if (entry)
+		entry->pollution++;
+}
+
+
+/*
+ * Reports
+ */
+
+/* Entries are ranked by the prefetches they wasted: completed but not used */
+static int prefetch_profiler_compare(const void *ptr1, const void *ptr2)
+{
+	const struct prefetch_profiler_entry_t *entry1 = ptr1;
+	const struct prefetch_profiler_entry_t *entry2 = ptr2;
+	long long useless1 = entry1->completed - entry1->useful;
+	long long useless2 = entry2->completed - entry2->useful;
+
+	if (useless1 != useless2)
+		return useless1 < useless2 ? 1 : -1;
+	if (entry1->completed != entry2->completed)
+		return entry1->completed < entry2->completed ? 1 : -1;
+	return 0;
+}
+
+
+static int prefetch_profiler_compare_int(const void *ptr1, const void *ptr2)
+{
+	const struct prefetch_profiler_entry_t *entry1 = ptr1;
+	const struct prefetch_profiler_entry_t *entry2 = ptr2;
+	long long completed1 = entry1->completed - entry1->last_completed;
+	long long completed2 = entry2->completed - entry2->last_completed;
+	long long useless1 = completed1 - (entry1->useful - entry1->last_useful);
+	long long useless2 = completed2 - (entry2->useful - entry2->last_useful);
+
+	if (useless1 != useless2)
+		return useless1 < useless2 ? 1 : -1;
+	if (completed1 != completed2)
+		return completed1 < completed2 ? 1 : -1;
+	return 0;
+}
+
+
+void prefetch_profiler_interval_report_init(struct prefetch_profiler_t *profiler)
+{
+	char file_name[MAX_PATH_SIZE];
+	int ret;
+
+	ret = snprintf(file_name, MAX_PATH_SIZE, "%s/%s.prefprof.csv",
+		mod_interval_reports_dir, profiler->mod->name);
+	if (ret < 0 || ret >= MAX_PATH_SIZE)
+		fatal("%s: string too long %s", __FUNCTION__, file_name);
+
+	profiler->interval_file = file_open_for_write(file_name);
+	if (!profiler->interval_file)
+		fatal("%s: cannot open interval report file", file_name);
+
+	fprintf(profiler->interval_file, "esim-time,rank,eip,source,issued,completed,"
+		"useful,late,pollution,accuracy\n");
+	fflush(profiler->interval_file);
+}
+
+
+/* Dump the top entries of the interval, one row each */
+void prefetch_profiler_interval_report(struct prefetch_profiler_t *profiler)
+{
+	struct prefetch_profiler_entry_t *entry;
+	long long completed;
+	long long useful;
+	int rank;
+	int i;
+
+	if (!profiler->interval_file)
+		return;
+
+	list_sort(profiler->entry_list, prefetch_profiler_compare_int);
+	rank = 0;
+	LIST_FOR_EACH(profiler->entry_list, i)
+	{
+		entry = list_get(profiler->entry_list, i);
+		if (rank < profiler->top_n && entry->issued != entry->last_issued)
+		{
+			completed = entry->completed - entry->last_completed;
+			useful = entry->useful - entry->last_useful;
+			fprintf(profiler->interval_file, "%lld,%d,0x%x,%d,%lld,%lld,%lld,%lld,%lld,%.3f\n",
+				esim_time, rank, entry->eip, entry->source,
+				entry->issued - entry->last_issued, completed, useful,
+				entry->late - entry->last_late,
+				entry->pollution - entry->last_pollution,
+				completed ? (double) useful / completed : NAN);
+			rank++;
+		}
+
+		entry->last_issued = entry->issued;
+		entry->last_completed = entry->completed;
+		entry->last_useful = entry->useful;
+		entry->last_late = entry->late;
+		entry->last_pollution = entry->pollution;
+	}
+	fflush(profiler->interval_file);
+
+	/* Pollution is measured per interval, as the module report does */
+	hash_table_gen_clear(profiler->victim_table);
+}
+
+
+void prefetch_profiler_dump(struct prefetch_profiler_t *profiler, FILE *f)
+{
+	struct prefetch_profiler_entry_t *entry;
+	int i;
+
+	list_sort(profiler->entry_list, prefetch_profiler_compare);
+
+	fprintf(f, "; Prefetch profile, top %d of %d sources by completed and not used prefetches\n",
+		profiler->top_n, list_count(profiler->entry_list));
+	fprintf(f, "; %10s %7s %10s %10s %10s %10s %10s %8s\n", "EIP", "Source",
+		"Issued", "Completed", "Useful", "Late", "Pollution", "Accuracy");
+	for (i = 0; i < profiler->top_n && i < list_count(profiler->entry_list); i++)
+	{
+		entry = list_get(profiler->entry_list, i);
+		fprintf(f, "PrefProfile[%d] = 0x%08x %7d %10lld %10lld %10lld %10lld %10lld %8.4g\n",
+			i, entry->eip, entry->source, entry->issued, entry->completed,
+			entry->useful, entry->late, entry->pollution,
+			entry->completed ? (double) entry->useful / entry->completed : 0.0);
+	}
+	fprintf(f, "\n");
+}
@@ -0,0 +1,84 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MEM_SYSTEM_PREFETCH_PROFILER_H
+#define MEM_SYSTEM_PREFETCH_PROFILER_H
+
+#include <stdio.h>
+
+/*
+ * Prefetch profiler. Attributes the prefetches of a module to the PC of the
+ * access that triggered them and to the prefetcher entry that generated
+ * them (GHB index table entry, Best-Offset offset, IP-stride entry, SPP
+ * signature table entry or stream buffer), so that the sources of useless,
+ * late or polluting prefetches can be found without tracing.
+ */
+
+struct mod_t;
+struct mod_stack_t;
+
+struct prefetch_profiler_entry_t
+{
+	unsigned int eip;	/* PC of the triggering access, -1 if unknown */
+	int source;		/* Prefetcher entry or stream, -1 if none */
+
+	long long issued;
+	long long completed;
+	long long useful;
+	long long late;
+	long long pollution;	/* Demand misses on blocks evicted by its prefetches */
+
+	/* Values at the beginning of the interval */
+	long long last_issued;
+	long long last_completed;
+	long long last_useful;
+	long long last_late;
+	long long last_pollution;
+};
+
+struct prefetch_profiler_t
+{
+	struct mod_t *mod;
+	int top_n;		/* Entries shown in the reports */
+
+	struct hash_table_gen_t *entry_table;	/* Indexed by (eip, source) */
+	struct list_t *entry_list;
+
+	/* Blocks evicted by a prefetch, and the entry that issued it */
+	struct hash_table_gen_t *victim_table;
+
+	FILE *interval_file;
+};
+
+struct prefetch_profiler_t *prefetch_profiler_create(struct mod_t *mod, int top_n);
+void prefetch_profiler_free(struct prefetch_profiler_t *profiler);
+
+/* Events */
+struct prefetch_profiler_entry_t *prefetch_profiler_issue(struct prefetch_profiler_t *profiler, unsigned int eip, int source);
+void prefetch_profiler_complete(struct prefetch_profiler_t *profiler, struct mod_stack_t *stack);
+void prefetch_profiler_useful(struct prefetch_profiler_t *profiler, struct mod_stack_t *stack);
+void prefetch_profiler_evict(struct prefetch_profiler_t *profiler, struct mod_stack_t *stack);
+void prefetch_profiler_miss(struct prefetch_profiler_t *profiler, struct mod_stack_t *stack);
+
+/* Reports */
+void prefetch_profiler_interval_report_init(struct prefetch_profiler_t *profiler);
+void prefetch_profiler_interval_report(struct prefetch_profiler_t *profiler);
+void prefetch_profiler_dump(struct prefetch_profiler_t *profiler, FILE *f);
+
+#endif
@@ -18,9 +18,12 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
+#include <dramsim/bindings-c.h>
 #include <lib/esim/esim.h> /* esim_cycle() */
 #include <lib/mhandle/mhandle.h>
+#include <lib/util/bin-config.h>
 #include <lib/util/debug.h>
 #include <lib/util/bloom.h>
 #include <lib/util/misc.h>
@@ -29,28 +32,53 @@
 #include "directory.h"
 #include "mem-system.h"
 #include "mmu.h"
+#include "prefetch-profiler.h"
 #include "prefetcher.h"
 #include "cache.h"
 #include "mod-stack.h"
+#include "module.h"
+
+int EV_PREFETCHER_QUEUE;
+
+int prefetcher_uses_ghb(struct prefetcher_t *pref)
+{
+	if (!pref) return 0;
+	switch(pref->type)
+	{
+		case prefetcher_type_bop:
+		case prefetcher_type_spp:
+		case prefetcher_type_ip_stride:
+			return 0;
+		default:
+			return 1;
+	}
+}
+
 
 int valid_prefetch_addr(struct mod_t *mod, unsigned int pref_addr, int stride);
 int can_prefetch(struct mod_stack_t *stack);
 void prefetch_to_stream_buffer(struct mod_t *mod, struct mod_client_info_t *client_info, int stream, int num_prefetches);
+static void prefetcher_queue_insert(struct prefetcher_queue_t *queue, struct mod_client_info_t *client_info, unsigned int addr, unsigned int eip, int source);
+static void prefetcher_queue_free(struct prefetcher_queue_t *queue);
 void stream_buffer_allocate_stream(struct mod_t *mod, struct mod_client_info_t *client_info, unsigned int miss_addr, int stride);
 void stream_buffer_prefetch_in_stream(struct mod_t *mod, struct mod_client_info_t *client_info, int stream, int slot);
 int get_it_index_tag(struct prefetcher_t *pref, struct mod_stack_t *stack, int *it_index, unsigned *tag);
 int prefetcher_ghb_cs_find_stride(struct prefetcher_t *pref, int it_index);
+void prefetch_to_cache(struct mod_t *mod, struct mod_client_info_t *client_info, unsigned int pref_addr, int source);
 
 /* If a new type is added don't forget to update functions
  * prefetcher_uses_XXX */
 struct str_map_t prefetcher_type_map =
 {
-	5, {
+	8, {
 		{ "PC_CS", prefetcher_type_pc_cs },
 		{ "PC_DC", prefetcher_type_pc_dc },
 		{ "PC_CS_SB", prefetcher_type_pc_cs_sb }, /* PC indexed constant stride prefetched to stream buffers */
 		{ "CZ_CS_SB", prefetcher_type_cz_cs_sb }, /* CZONE indexed constant stride prefetched to stream buffers */
 		{ "CZ_CS", prefetcher_type_cz_cs }, /* CZONE indexed constant stride prefetched to cache */
+		{ "BOP", prefetcher_type_bop }, /* Best-Offset prefetcher */
+		{ "SPP", prefetcher_type_spp }, /* Signature Path Prefetcher */
+		{ "IP_STRIDE", prefetcher_type_ip_stride }, /* Instruction pointer indexed stride, trained by the core accesses */
 	}
 };
 
@@ -107,6 +135,27 @@ struct prefetcher_t *prefetcher_create(int prefetcher_ghb_size, int prefetcher_i
 		pref->ghb[i].addr = -1;
 		pref->ghb[i].next = -1;
 		pref->ghb[i].prev = -1;
+		pref->ghb[i].owner = -1;
+	}
+
+	/* Delta correlation table */
+	pref->dc_hash_pow = 1;
+	for (int i = 1; i < prefetcher_lookup_depth; i++)
+		pref->dc_hash_pow *= PREFETCHER_DC_HASH_MUL;
+	if (type == prefetcher_type_pc_dc)
+	{
+		pref->dc_table = xcalloc(prefetcher_it_size * PREFETCHER_DC_TABLE_SIZE,
+			sizeof(struct prefetcher_dc_entry_t));
+		for (int i = 0; i < prefetcher_it_size * PREFETCHER_DC_TABLE_SIZE; i++)
+			pref->dc_table[i].pos = -1;
+	}
+
+	/* IP-stride prefetchers use the index table size for their table */
+	if (type == prefetcher_type_ip_stride)
+	{
+		pref->ip_stride_table = xcalloc(prefetcher_it_size, sizeof(struct prefetcher_ip_stride_entry_t));
+		for (int i = 0; i < prefetcher_it_size; i++)
+			pref->ip_stride_table[i].eip = -1;
 	}
 
 	/* Return */
@@ -114,12 +163,232 @@ struct prefetcher_t *prefetcher_create(int prefetcher_ghb_size, int prefetcher_i
 }
 
 
+/* Save the global history buffer, index table, per-entry tables and the
+ * Best-Offset and SPP state as children of 'parent_elem'. */
+void prefetcher_save_state(struct prefetcher_t *pref, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem)
+{
+	int geometry[3];
+
+	geometry[0] = pref->type;
+	geometry[1] = pref->ghb_size;
+	geometry[2] = pref->it_size;
+	bin_config_add(bin_config, parent_elem, "geometry", geometry, sizeof geometry);
+	bin_config_add(bin_config, parent_elem, "ghb_head", &pref->ghb_head, sizeof pref->ghb_head);
+	bin_config_add(bin_config, parent_elem, "ghb", pref->ghb,
+		pref->ghb_size * sizeof(struct prefetcher_ghb_t));
+	bin_config_add(bin_config, parent_elem, "index_table", pref->index_table,
+		pref->it_size * sizeof(struct prefetcher_it_t));
+	if (pref->dc_table)
+		bin_config_add(bin_config, parent_elem, "dc_table", pref->dc_table,
+			pref->it_size * PREFETCHER_DC_TABLE_SIZE * sizeof(struct prefetcher_dc_entry_t));
+	if (pref->ip_stride_table)
+		bin_config_add(bin_config, parent_elem, "ip_stride_table", pref->ip_stride_table,
+			pref->it_size * sizeof(struct prefetcher_ip_stride_entry_t));
+
+	/* Best-Offset */
+	if (pref->bop)
+	{
+		struct prefetcher_bop_t *bop = pref->bop;
+		int bop_state[7];
+
+		bop_state[0] = bop->num_offsets;
+		bop_state[1] = bop->rr_size;
+		bop_state[2] = bop->test_index;
+		bop_state[3] = bop->round;
+		bop_state[4] = bop->best_offset;
+		bop_state[5] = bop->best_score;
+		bop_state[6] = bop->offset;
+		bin_config_add(bin_config, parent_elem, "bop", bop_state, sizeof bop_state);
+		bin_config_add(bin_config, parent_elem, "bop_scores", bop->scores,
+			bop->num_offsets * sizeof(int));
+		bin_config_add(bin_config, parent_elem, "bop_rr_table", bop->rr_table,
+			bop->rr_size * sizeof(unsigned int));
+	}
+
+	/* SPP */
+	if (pref->spp)
+	{
+		struct prefetcher_spp_t *spp = pref->spp;
+		int spp_geometry[2];
+
+		spp_geometry[0] = spp->st_size;
+		spp_geometry[1] = spp->pt_size;
+		bin_config_add(bin_config, parent_elem, "spp", spp_geometry, sizeof spp_geometry);
+		bin_config_add(bin_config, parent_elem, "spp_signature_table", spp->signature_table,
+			spp->st_size * sizeof(struct prefetcher_spp_st_entry_t));
+		bin_config_add(bin_config, parent_elem, "spp_pattern_table", spp->pattern_table,
+			spp->pt_size * sizeof(struct prefetcher_spp_pt_entry_t));
+	}
+}
+
+
+/* Restore the tables saved with 'prefetcher_save_state'. Return 0 and leave
+ * the prefetcher unchanged if they were saved for a different type or size.
+ * If 'check_only' is set, the saved tables are only validated. */
+int prefetcher_load_state(struct prefetcher_t *pref, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem, int check_only)
+{
+	struct prefetcher_ghb_t *ghb;
+	struct prefetcher_it_t *index_table;
+	struct prefetcher_dc_entry_t *dc_table = NULL;
+	struct prefetcher_ip_stride_entry_t *ip_stride_table = NULL;
+	struct prefetcher_spp_st_entry_t *spp_signature_table = NULL;
+	struct prefetcher_spp_pt_entry_t *spp_pattern_table = NULL;
+	unsigned int *bop_rr_table = NULL;
+	int *bop_scores = NULL;
+
+	int geometry[3];
+	int bop_state[7];
+	int spp_geometry[2];
+	int ghb_head;
+	int valid;
+	int i;
+
+	/* Geometry */
+	if (!bin_config_get_copy(bin_config, parent_elem, "geometry", geometry, sizeof geometry) ||
+			geometry[0] != pref->type || geometry[1] != pref->ghb_size ||
+			geometry[2] != pref->it_size)
+		return 0;
+
+	/* Tables */
+	ghb = xmalloc(pref->ghb_size * sizeof(struct prefetcher_ghb_t));
+	index_table = xmalloc(pref->it_size * sizeof(struct prefetcher_it_t));
+	if (pref->dc_table)
+		dc_table = xmalloc(pref->it_size * PREFETCHER_DC_TABLE_SIZE *
+			sizeof(struct prefetcher_dc_entry_t));
+	if (pref->ip_stride_table)
+		ip_stride_table = xmalloc(pref->it_size * sizeof(struct prefetcher_ip_stride_entry_t));
+	valid = bin_config_get_copy(bin_config, parent_elem, "ghb_head", &ghb_head, sizeof ghb_head) &&
+		bin_config_get_copy(bin_config, parent_elem, "ghb", ghb,
+			pref->ghb_size * sizeof(struct prefetcher_ghb_t)) &&
+		bin_config_get_copy(bin_config, parent_elem, "index_table", index_table,
+			pref->it_size * sizeof(struct prefetcher_it_t)) &&
+		(!dc_table || bin_config_get_copy(bin_config, parent_elem, "dc_table", dc_table,
+			pref->it_size * PREFETCHER_DC_TABLE_SIZE * sizeof(struct prefetcher_dc_entry_t))) &&
+		(!ip_stride_table || bin_config_get_copy(bin_config, parent_elem, "ip_stride_table",
+			ip_stride_table, pref->it_size * sizeof(struct prefetcher_ip_stride_entry_t)));
+
+	/* Links must point within the tables */
+	valid = valid && IN_RANGE(ghb_head, -1, pref->ghb_size - 1);
+	for (i = 0; valid && i < pref->ghb_size; i++)
+		valid = IN_RANGE(ghb[i].next, -1, pref->ghb_size - 1) &&
+			IN_RANGE(ghb[i].prev, -1, ghb[i].prev_it_ghb == prefetcher_ptr_it ?
+				pref->it_size - 1 : pref->ghb_size - 1) &&
+			IN_RANGE(ghb[i].owner, -1, pref->it_size - 1);
+	for (i = 0; valid && i < pref->it_size; i++)
+		valid = IN_RANGE(index_table[i].ptr, -1, pref->ghb_size - 1);
+
+	/* Best-Offset, with the same candidate offsets and table size */
+	if (valid && pref->bop)
+	{
+		bop_scores = xmalloc(pref->bop->num_offsets * sizeof(int));
+		bop_rr_table = xmalloc(pref->bop->rr_size * sizeof(unsigned int));
+		valid = bin_config_get_copy(bin_config, parent_elem, "bop", bop_state, sizeof bop_state) &&
+			bop_state[0] == pref->bop->num_offsets &&
+			bop_state[1] == pref->bop->rr_size &&
+			IN_RANGE(bop_state[2], 0, pref->bop->num_offsets - 1) &&
+			bin_config_get_copy(bin_config, parent_elem, "bop_scores", bop_scores,
+				pref->bop->num_offsets * sizeof(int)) &&
+			bin_config_get_copy(bin_config, parent_elem, "bop_rr_table", bop_rr_table,
+				pref->bop->rr_size * sizeof(unsigned int));
+	}
+
+	/* SPP, with the same table sizes */
+	if (valid && pref->spp)
+	{
+		spp_signature_table = xmalloc(pref->spp->st_size *
+			sizeof(struct prefetcher_spp_st_entry_t));
+		spp_pattern_table = xmalloc(pref->spp->pt_size *
+			sizeof(struct prefetcher_spp_pt_entry_t));
+		valid = bin_config_get_copy(bin_config, parent_elem, "spp", spp_geometry,
+				sizeof spp_geometry) &&
+			spp_geometry[0] == pref->spp->st_size &&
+			spp_geometry[1] == pref->spp->pt_size &&
+			bin_config_get_copy(bin_config, parent_elem, "spp_signature_table",
+				spp_signature_table, pref->spp->st_size *
+				sizeof(struct prefetcher_spp_st_entry_t)) &&
+			bin_config_get_copy(bin_config, parent_elem, "spp_pattern_table",
+				spp_pattern_table, pref->spp->pt_size *
+				sizeof(struct prefetcher_spp_pt_entry_t));
+	}
+
+	if (!valid || check_only)
+	{
+		free(ghb);
+		free(index_table);
+		free(dc_table);
+		free(ip_stride_table);
+		free(bop_scores);
+		free(bop_rr_table);
+		free(spp_signature_table);
+		free(spp_pattern_table);
+		return valid;
+	}
+
+	/* Replace tables */
+	free(pref->ghb);
+	free(pref->index_table);
+	pref->ghb = ghb;
+	pref->index_table = index_table;
+	pref->ghb_head = ghb_head;
+	if (dc_table)
+	{
+		free(pref->dc_table);
+		pref->dc_table = dc_table;
+	}
+	if (ip_stride_table)
+	{
+		free(pref->ip_stride_table);
+		pref->ip_stride_table = ip_stride_table;
+	}
+	if (pref->bop)
+	{
+		free(pref->bop->scores);
+		free(pref->bop->rr_table);
+		pref->bop->scores = bop_scores;
+		pref->bop->rr_table = bop_rr_table;
+		pref->bop->test_index = bop_state[2];
+		pref->bop->round = bop_state[3];
+		pref->bop->best_offset = bop_state[4];
+		pref->bop->best_score = bop_state[5];
+		pref->bop->offset = bop_state[6];
+	}
+	if (pref->spp)
+	{
+		free(pref->spp->signature_table);
+		free(pref->spp->pattern_table);
+		pref->spp->signature_table = spp_signature_table;
+		pref->spp->pattern_table = spp_pattern_table;
+	}
+	return 1;
+}
+
+
 void prefetcher_free(struct prefetcher_t *pref)
 {
 	if (pref)
 	{
 		free(pref->ghb);
 		free(pref->index_table);
+		free(pref->dc_table);
+		if (pref->queue)
+			prefetcher_queue_free(pref->queue);
+		prefetch_profiler_free(pref->profiler);
+		free(pref->ip_stride_table);
+		if (pref->bop)
+		{
+			free(pref->bop->offsets);
+			free(pref->bop->scores);
+			free(pref->bop->rr_table);
+			free(pref->bop);
+		}
+		if (pref->spp)
+		{
+			free(pref->spp->signature_table);
+			free(pref->spp->pattern_table);
+			free(pref->spp);
+		}
 		if(pref->streams)
 		{
 			for (int stream = 0; stream < pref->max_num_streams; stream++)
@@ -169,6 +438,82 @@ int get_it_index_tag(struct prefetcher_t *pref, struct mod_stack_t *stack,
 }
 
 
+/* Forget the delta history of an index table entry being (re)allocated. */
+static void prefetcher_it_history_reset(struct prefetcher_t *pref, int it_index)
+{
+	struct prefetcher_it_t *it = &pref->index_table[it_index];
+
+	it->epoch++;
+	it->hist_len = 0;
+	it->num_addr = 0;
+	it->stride_run = 0;
+	it->hash = 0;
+
+	if (pref->dc_table)
+	{
+		struct prefetcher_dc_entry_t *dc = &pref->dc_table[it_index * PREFETCHER_DC_TABLE_SIZE];
+		for (int i = 0; i < PREFETCHER_DC_TABLE_SIZE; i++)
+			dc[i].pos = -1;
+	}
+}
+
+
+static struct prefetcher_dc_entry_t *prefetcher_dc_entry(struct prefetcher_t *pref,
+	int it_index, unsigned int hash)
+{
+	hash ^= hash >> 16;
+	return &pref->dc_table[it_index * PREFETCHER_DC_TABLE_SIZE +
+		hash % PREFETCHER_DC_TABLE_SIZE];
+}
+
+
+/* Add a new address to the delta history of an index table entry. Delta 'k'
+ * is the difference between addresses 'k + 1' and 'k' of the entry. The cost
+ * is constant, it does not depend on the GHB size. */
+static void prefetcher_it_history_add(struct prefetcher_t *pref, int it_index,
+	unsigned int addr)
+{
+	struct prefetcher_it_t *it = &pref->index_table[it_index];
+	struct prefetcher_dc_entry_t *dc;
+	int depth = pref->lookup_depth;
+	long long n;
+	int delta;
+
+	it->hist_len++;
+	it->num_addr++;
+	if (it->num_addr == 1)
+	{
+		it->last_addr = addr;
+		return;
+	}
+
+	/* New delta */
+	n = it->num_addr - 2;
+	delta = addr - it->last_addr;
+	it->last_addr = addr;
+	if (n > 0 && delta == PREFETCHER_DELTA(it, n - 1))
+		it->stride_run++;
+	else
+		it->stride_run = 1;
+
+	/* The previous 'depth' deltas were followed by this one */
+	if (pref->dc_table && n >= depth)
+	{
+		dc = prefetcher_dc_entry(pref, it_index, it->hash);
+		for (int i = 0; i < depth; i++)
+			dc->delta[i] = PREFETCHER_DELTA(it, n - depth + i);
+		dc->next_delta = delta;
+		dc->pos = n;
+	}
+
+	/* Roll the hash: drop the oldest delta and append the new one */
+	if (n >= depth)
+		it->hash -= PREFETCHER_DELTA(it, n - depth) * pref->dc_hash_pow;
+	it->hash = it->hash * PREFETCHER_DC_HASH_MUL + delta;
+	PREFETCHER_DELTA(it, n) = delta;
+}
+
+
 /* Returns it_index >= 0 if any valid update is made, negative otherwise. */
 int prefetcher_update_tables(struct mod_stack_t *stack)
 {
@@ -182,6 +527,10 @@ int prefetcher_update_tables(struct mod_stack_t *stack)
 	if (!mod->cache->prefetcher)
 		return -1;
 
+	/* Only GHB based prefetchers keep these tables */
+	if (!prefetcher_uses_ghb(pref))
+		return -1;
+
 	/* Get the index table index and test if is valid */
 	if(!get_it_index_tag(pref, stack, &it_index, &it_tag))
 		return -1;
@@ -215,6 +564,14 @@ int prefetcher_update_tables(struct mod_stack_t *stack)
 				pref->index_table[prev].ptr = -1;
 			}
 		}
+
+		/* The oldest address of the owner's history goes away */
+		prev = pref->ghb[ghb_index].owner;
+		if (prev >= 0 && pref->index_table[prev].epoch == pref->ghb[ghb_index].owner_epoch)
+		{
+			assert(pref->index_table[prev].hist_len > 0);
+			pref->index_table[prev].hist_len--;
+		}
 	}
 	pref->ghb[ghb_index].addr = -1; /* Not necessary, it will be overwritten */
 	pref->ghb[ghb_index].next = -1; /* Same */
@@ -243,6 +600,7 @@ int prefetcher_update_tables(struct mod_stack_t *stack)
 
 			pref->index_table[it_index].tag = -1;
 			pref->index_table[it_index].ptr = -1;
+			prefetcher_it_history_reset(pref, it_index);
 		}
 	}
 
@@ -251,6 +609,7 @@ int prefetcher_update_tables(struct mod_stack_t *stack)
 	{
 		/* Just an initialization. Tag == -1 implies the entry has never been used. */
 		pref->index_table[it_index].ptr = -1;
+		prefetcher_it_history_reset(pref, it_index);
 	}
 
 	/* Add new element into ghb. */
@@ -266,6 +625,9 @@ int prefetcher_update_tables(struct mod_stack_t *stack)
 	}
 	pref->ghb[ghb_index].prev_it_ghb = prefetcher_ptr_it;
 	pref->ghb[ghb_index].prev = it_index;
+	pref->ghb[ghb_index].owner = it_index;
+	pref->ghb[ghb_index].owner_epoch = pref->index_table[it_index].epoch;
+	prefetcher_it_history_add(pref, it_index, stack->addr);
 
 	/* Make the index table entries point to current ghb_index. */
 	pref->index_table[it_index].tag = it_tag;
@@ -280,8 +642,9 @@ int prefetcher_update_tables(struct mod_stack_t *stack)
 
 void prefetch_to_cache(
 		struct mod_t *mod, struct mod_client_info_t *client_info,
-		unsigned int pref_addr)
+		unsigned int pref_addr, int source)
 {
+	struct prefetcher_t *pref = mod->cache->prefetcher;
 	struct mod_client_info_t *ci;
 
 	assert(pref_addr != -1);
@@ -291,10 +654,198 @@ void prefetch_to_cache(
 	ci->thread = client_info->thread;
 	ci->ctx = client_info->ctx;
 
+	/* Prefetch waits in the queue for a free port. It is reported to the
+	 * profiler when injected, since the queue may still drop it. */
+	if (pref->queue)
+	{
+		prefetcher_queue_insert(pref->queue, ci, pref_addr,
+			client_info->prefetcher_eip, source);
+		return;
+	}
+
+	if (pref->profiler)
+		ci->pref_origin = prefetch_profiler_issue(pref->profiler, client_info->prefetcher_eip, source);
 	mod_access(mod, mod_access_prefetch, pref_addr, NULL, NULL, NULL, ci);
 }
 
 
+/*
+ * Prefetch queue
+ */
+
+void prefetcher_queue_create(struct prefetcher_t *pref, struct mod_t *mod)
+{
+	struct prefetcher_queue_t *queue;
+
+	assert(pref->queue_size > 0 && !pref->queue);
+	queue = xcalloc(1, sizeof(struct prefetcher_queue_t));
+	queue->mod = mod;
+	queue->size = pref->queue_size;
+	queue->entries = xcalloc(queue->size, sizeof(struct prefetcher_queue_entry_t));
+	queue->dram_threshold = pref->queue_dram_threshold;
+	queue->inject_cycle = -1;
+	pref->queue = queue;
+}
+
+
+static void prefetcher_queue_free(struct prefetcher_queue_t *queue)
+{
+	for (int i = 0; i < queue->count; i++)
+		mod_client_info_free(queue->mod, queue->entries[(queue->head + i) % queue->size].client_info);
+	free(queue->entries);
+	free(queue);
+}
+
+
+/* Return true if the DRAM channel serving the address is close to not
+ * accepting more transactions. Demand misses would be delayed by a
+ * prefetch sent there. */
+static int prefetcher_queue_dram_busy(struct prefetcher_queue_t *queue, unsigned int addr)
+{
+	struct dram_system_handler_t *handler;
+	struct mod_t *mod = queue->mod;
+
+	while (mod->kind != mod_kind_main_memory)
+		mod = mod_get_low_mod(mod, addr);
+	if (!mod->dram_system)
+		return 0;
+
+	handler = mod->dram_system->handler;
+	return !dram_system_will_accept_trans(handler, addr) ||
+		dram_system_trans_queue_occupancy(handler, addr) >= queue->dram_threshold;
+}
+
+
+/* Send queued prefetches to the module while it has ports that are not
+ * locked or requested by demand accesses. */
+static void prefetcher_queue_inject(struct prefetcher_queue_t *queue)
+{
+	struct prefetcher_queue_entry_t *entry;
+	struct mod_t *mod = queue->mod;
+	struct prefetcher_t *pref = mod->cache->prefetcher;
+	long long cycle = esim_cycle();
+	int free_ports;
+
+	/* Ports are locked some events after the access starts, so discount
+	 * the prefetches already injected in this cycle. */
+	if (queue->inject_cycle != cycle)
+	{
+		queue->inject_cycle = cycle;
+		queue->injected = 0;
+	}
+	free_ports = mod->num_ports - mod->num_locked_ports - queue->injected;
+	if (mod->port_waiting_list_count)
+		free_ports = 0;
+
+	while (queue->count && free_ports > 0)
+	{
+		entry = &queue->entries[queue->head];
+		queue->head = (queue->head + 1) % queue->size;
+		queue->count--;
+
+		/* A demand access or another prefetch fetched the block, or
+		 * memory got busy while the prefetch was waiting. */
+		if (mod_in_flight_address(mod, entry->addr, NULL))
+		{
+			mod->dropped_prefetches_in_flight++;
+			mod_client_info_free(mod, entry->client_info);
+			continue;
+		}
+		if (prefetcher_queue_dram_busy(queue, entry->addr))
+		{
+			mod->dropped_prefetches_dram++;
+			mod_client_info_free(mod, entry->client_info);
+			continue;
+		}
+
+		mem_debug("  %lld 0x%x %s prefetch dequeued after %lld cycles\n",
+			esim_time, entry->addr, mod->name, cycle - entry->time);
+		mod->prefetch_queue_cycles += cycle - entry->time;
+		mod->injected_prefetches++;
+		queue->injected++;
+		free_ports--;
+		if (pref->profiler)
+			entry->client_info->pref_origin = prefetch_profiler_issue(pref->profiler,
+				entry->eip, entry->source);
+		mod_access(mod, mod_access_prefetch, entry->addr, NULL, NULL, NULL, entry->client_info);
+	}
+
+	/* Try again next cycle */
+	if (queue->count && !queue->scheduled)
+	{
+		queue->scheduled = 1;
+		esim_schedule_event(EV_PREFETCHER_QUEUE, queue, 1);
+	}
+}
+
+
+static void prefetcher_queue_insert(struct prefetcher_queue_t *queue,
+	struct mod_client_info_t *client_info, unsigned int addr,
+	unsigned int eip, int source)
+{
+	struct prefetcher_queue_entry_t *entry;
+	struct mod_t *mod = queue->mod;
+	int i;
+
+	addr &= ~mod->cache->block_mask;
+
+	/* Already queued or being fetched */
+	for (i = 0; i < queue->count; i++)
+		if (queue->entries[(queue->head + i) % queue->size].addr == addr)
+			break;
+	if (i < queue->count || mod_in_flight_address(mod, addr, NULL))
+	{
+		mod->dropped_prefetches_in_flight++;
+		mod_client_info_free(mod, client_info);
+		return;
+	}
+
+	/* Memory is busy */
+	if (prefetcher_queue_dram_busy(queue, addr))
+	{
+		mod->dropped_prefetches_dram++;
+		mod_client_info_free(mod, client_info);
+		return;
+	}
+
+	/* Queue full, the oldest prefetch is the least timely one */
+	if (queue->count == queue->size)
+	{
+		entry = &queue->entries[queue->head];
+		mod_client_info_free(mod, entry->client_info);
+		queue->head = (queue->head + 1) % queue->size;
+		queue->count--;
+		mod->dropped_prefetches_queue_full++;
+	}
+
+	/* Enqueue */
+	entry = &queue->entries[(queue->head + queue->count) % queue->size];
+	entry->addr = addr;
+	entry->client_info = client_info;
+	entry->eip = eip;
+	entry->source = source;
+	entry->time = esim_cycle();
+	queue->count++;
+	mod->queued_prefetches++;
+
+	prefetcher_queue_inject(queue);
+}
+
+
+void prefetcher_queue_handler(int event, void *data)
+{
+	struct prefetcher_queue_t *queue = data;
+
+	assert(event == EV_PREFETCHER_QUEUE);
+	queue->scheduled = 0;
+
+	if (esim_finish)
+		return;
+
+	prefetcher_queue_inject(queue);
+}
+
+
 /* This function implements the GHB based PC/CS prefetching as described in the
  * 2005 paper by Nesbit and Smith. The index table lookup is based on the PC
  * of the instruction causing the miss. The GHB entries are looked at for finding
@@ -324,7 +875,7 @@ static void prefetcher_ghb_cs(struct mod_t *mod, struct mod_stack_t *stack, int
 				unsigned int pref_addr = stack->addr + i * stride;
 				if (!valid_prefetch_addr(mod, pref_addr, stride))
 					return;
-				prefetch_to_cache(mod, stack->client_info, stack->addr + i * stride);
+				prefetch_to_cache(mod, stack->client_info, stack->addr + i * stride, it_index);
 			}
 			break;
 		}
@@ -350,12 +901,7 @@ static void prefetcher_ghb_cs(struct mod_t *mod, struct mod_stack_t *stack, int
 
 int prefetcher_ghb_cs_find_stride(struct prefetcher_t *pref, int it_index)
 {
-	int stride;
-	int chain;
-	unsigned int prev_addr;
-	unsigned int cur_addr;
-
-	chain = pref->index_table[it_index].ptr;
+	struct prefetcher_it_t *it = &pref->index_table[it_index];
 
 	/* The lookup depth must be at least 2 - which essentially means
 	 * two strides have been seen so far, prefetch for the next.
@@ -364,34 +910,12 @@ int prefetcher_ghb_cs_find_stride(struct prefetcher_t *pref, int it_index)
 	 * redundant prefetches. Hence keeping the minimum at 2. */
 	assert(pref->lookup_depth >= 2);
 
-	/* If there's only one element in this linked list, nothing to do. */
-	if (pref->ghb[chain].next == -1)
+	/* The last 'lookup_depth' strides must be equal, and the addresses
+	 * they come from still be in the GHB. */
+	if (it->hist_len <= pref->lookup_depth || it->stride_run < pref->lookup_depth)
 		return 0;
 
-	prev_addr = pref->ghb[chain].addr;
-	chain = pref->ghb[chain].next;
-	cur_addr = pref->ghb[chain].addr;
-	stride = prev_addr - cur_addr;
-
-	for (int i = 2; i <= pref->lookup_depth; i++)
-	{
-		prev_addr = cur_addr;
-		chain = pref->ghb[chain].next;
-
-		/* The linked list (history) is smaller than the lookup depth */
-		if (chain == -1)
-			goto no_stride;
-
-		cur_addr = pref->ghb[chain].addr;
-
-		/* The stride changed, can't prefetch */
-		if (stride != prev_addr - cur_addr)
-			goto no_stride;
-	}
-	return stride;
-
-no_stride:
-	return 0;
+	return PREFETCHER_DELTA(it, it->num_addr - 2);
 }
 
 
@@ -404,86 +928,426 @@ no_stride:
 static void prefetcher_ghb_dc(struct mod_t *mod, struct mod_stack_t *stack, int it_index)
 {
 	struct prefetcher_t *pref;
-	int chain, chain2, stride[PREFETCHER_LOOKUP_DEPTH_MAX], i, pref_stride;
-	unsigned int prev_addr, cur_addr, prefetch_addr = 0;
+	struct prefetcher_it_t *it;
+	struct prefetcher_dc_entry_t *dc;
+	long long n;
+	int depth;
+	int i;
 
 	assert(mod->kind == mod_kind_cache && mod->cache != NULL);
 	pref = mod->cache->prefetcher;
-
-	chain = pref->index_table[it_index].ptr;
+	it = &pref->index_table[it_index];
+	depth = pref->lookup_depth;
 
 	/* The lookup depth must be at least 2 - which essentially means
 	 * two strides have been seen so far, predict the next stride. */
-	assert(pref->lookup_depth >= 2 && pref->lookup_depth <= PREFETCHER_LOOKUP_DEPTH_MAX);
+	assert(depth >= 2 && depth <= PREFETCHER_LOOKUP_DEPTH_MAX);
 
 	/* The table should've been updated before calling this function. */
-	assert(pref->ghb[chain].addr == stack->addr);
+	assert(pref->ghb[it->ptr].addr == stack->addr);
+
+	/* Not enough history to have "lookup_depth" strides (deltas) */
+	if (it->hist_len <= depth)
+		return;
+
+	/* Instead of searching the history backwards for an earlier occurrence
+	 * of the last strides, look up the most recent one by their hash. The
+	 * match is only valid if the strides and the one that followed are
+	 * still in the GHB. */
+	n = it->num_addr - 2;
+	dc = prefetcher_dc_entry(pref, it_index, it->hash);
+	if (dc->pos < 0 || dc->pos - depth < it->num_addr - it->hist_len)
+		return;
+	for (i = 0; i < depth; i++)
+		if (dc->delta[i] != PREFETCHER_DELTA(it, n - depth + 1 + i))
+			return;
+
+	if (stack->addr + dc->next_delta > 0)
+		prefetch_to_cache(mod, stack->client_info, stack->addr + dc->next_delta, it_index);
+}
+
+
+/*
+ * Best-Offset prefetcher
+ */
+
+static int prefetcher_bop_rr_index(struct prefetcher_bop_t *bop, unsigned int block)
+{
+	return (block ^ (block >> 8)) % bop->rr_size;
+}
+
+
+static void prefetcher_bop_rr_insert(struct prefetcher_bop_t *bop, unsigned int block)
+{
+	bop->rr_table[prefetcher_bop_rr_index(bop, block)] = block;
+}
 
-	/* Collect "lookup_depth" number of strides (deltas).
-	 * This doesn't really make sense for a depth > 2, but
-	 * I'll just have the code here for generality. */
-	for (i = 0; i < pref->lookup_depth; i++)
+
+static int prefetcher_bop_rr_hit(struct prefetcher_bop_t *bop, unsigned int block)
+{
+	return bop->rr_table[prefetcher_bop_rr_index(bop, block)] == block;
+}
+
+
+/* Test the next candidate offset against the recent requests table. At the
+ * end of a learning phase, the best offset becomes the prefetch offset, or
+ * prefetching is turned off if no offset got a decent score. */
+static void prefetcher_bop_learn(struct prefetcher_bop_t *bop, unsigned int block)
+{
+	int index = bop->test_index;
+	int offset = bop->offsets[index];
+
+	if (block >= offset && prefetcher_bop_rr_hit(bop, block - offset))
 	{
-		prev_addr = pref->ghb[chain].addr;
-		chain = pref->ghb[chain].next;
+		bop->scores[index]++;
+		if (bop->scores[index] > bop->best_score)
+		{
+			bop->best_score = bop->scores[index];
+			bop->best_offset = offset;
+		}
+	}
 
-		/* The chain isn't long enough */
-		if (chain == -1)
+	/* Next offset, and next round once all have been tested */
+	bop->test_index++;
+	if (bop->test_index == bop->num_offsets)
+	{
+		bop->test_index = 0;
+		bop->round++;
+	}
+
+	/* End of learning phase */
+	if (bop->best_score < bop->score_max && bop->round < bop->round_max)
+		return;
+
+	bop->offset = bop->best_score > bop->bad_score ? bop->best_offset : 0;
+	mem_debug("    BOP: learning phase finished, offset=%d score=%d\n",
+		bop->best_offset, bop->best_score);
+
+	memset(bop->scores, 0, bop->num_offsets * sizeof(int));
+	bop->test_index = 0;
+	bop->round = 0;
+	bop->best_offset = 0;
+	bop->best_score = 0;
+}
+
+
+/* Called on demand misses and on demand hits to prefetched blocks */
+static void prefetcher_bop(struct mod_t *mod, struct mod_stack_t *stack)
+{
+	struct prefetcher_t *pref = mod->cache->prefetcher;
+	struct prefetcher_bop_t *bop = pref->bop;
+	unsigned int block = stack->addr >> mod->cache->log_block_size;
+
+	assert(bop);
+	prefetcher_bop_learn(bop, block);
+
+	/* With prefetching off, the recent requests table records demand
+	 * accesses instead of prefetch fills. */
+	if (!bop->offset)
+	{
+		prefetcher_bop_rr_insert(bop, block);
+		return;
+	}
+
+	/* The aggressiveness sets how many multiples of the offset are prefetched */
+	for (int i = 1; i <= pref->aggr; i++)
+	{
+		int stride = i * bop->offset * mod->cache->block_size;
+		unsigned int pref_addr = (block << mod->cache->log_block_size) + stride;
+		if (!valid_prefetch_addr(mod, pref_addr, stride))
 			return;
+		prefetch_to_cache(mod, stack->client_info, pref_addr, bop->offset);
+	}
+}
 
-		cur_addr = pref->ghb[chain].addr;
-		stride[i] = prev_addr - cur_addr;
+
+void prefetcher_bop_create(struct prefetcher_t *pref, int max_offset, int rr_size,
+	int score_max, int round_max, int bad_score)
+{
+	struct prefetcher_bop_t *bop;
+	int offset;
+	int n;
+
+	assert(max_offset >= 1 && rr_size >= 1);
+	bop = xcalloc(1, sizeof(struct prefetcher_bop_t));
+	bop->rr_size = rr_size;
+	bop->score_max = score_max;
+	bop->round_max = round_max;
+	bop->bad_score = bad_score;
+
+	/* Candidate offsets are those whose only prime factors are 2, 3 and 5 */
+	bop->offsets = xcalloc(max_offset, sizeof(int));
+	for (offset = 1; offset <= max_offset; offset++)
+	{
+		n = offset;
+		while (n % 2 == 0)
+			n /= 2;
+		while (n % 3 == 0)
+			n /= 3;
+		while (n % 5 == 0)
+			n /= 5;
+		if (n == 1)
+			bop->offsets[bop->num_offsets++] = offset;
 	}
+	bop->scores = xcalloc(bop->num_offsets, sizeof(int));
+
+	/* Recent requests table starts empty */
+	bop->rr_table = xcalloc(rr_size, sizeof(unsigned int));
+	for (int i = 0; i < rr_size; i++)
+		bop->rr_table[i] = -1;
+
+	/* Start as a next-line prefetcher until the first phase ends */
+	bop->offset = 1;
+
+	pref->bop = bop;
+}
 
-	chain = pref->index_table[it_index].ptr;
-	chain = pref->ghb[chain].next;
-	assert(chain != -1);
 
-	/* "chain" now points to the second element of the list.
-	 * Try to match the stride array starting from here. */
-	while (chain != -1)
+/*
+ * Signature Path Prefetcher
+ */
+
+/* Deltas are folded into signatures as 7-bit sign-magnitude values */
+static unsigned int prefetcher_spp_next_sig(unsigned int sig, int delta)
+{
+	unsigned int delta_bits = delta < 0 ? (((-delta) & 0x3f) | 0x40) : (delta & 0x3f);
+	return ((sig << 3) ^ delta_bits) & ((1 << PREFETCHER_SPP_SIG_BITS) - 1);
+}
+
+
+static void prefetcher_spp_pt_update(struct prefetcher_spp_t *spp, unsigned int sig, int delta)
+{
+	struct prefetcher_spp_pt_entry_t *entry = &spp->pattern_table[sig % spp->pt_size];
+	int victim = 0;
+	int i;
+
+	for (i = 0; i < PREFETCHER_SPP_DELTAS; i++)
 	{
-		/* This really doesn't look realistic to implement in
-		 * hardware. Too much time consuming I feel. */
-		chain2 = chain;
-		for (i = 0; i < pref->lookup_depth; i++)
-		{
-			prev_addr = pref->ghb[chain2].addr;
-			chain2 = pref->ghb[chain2].next;
+		if (entry->delta_count[i] && entry->delta[i] == delta)
+			break;
+		if (entry->delta_count[i] < entry->delta_count[victim])
+			victim = i;
+	}
+
+	/* Replace the least confident delta */
+	if (i == PREFETCHER_SPP_DELTAS)
+	{
+		i = victim;
+		entry->delta[i] = delta;
+		entry->delta_count[i] = 0;
+	}
+	entry->delta_count[i]++;
+	entry->sig_count++;
+
+	/* Keep the counters saturated without losing their ratios */
+	if (entry->sig_count > PREFETCHER_SPP_COUNTER_MAX || entry->delta_count[i] > PREFETCHER_SPP_COUNTER_MAX)
+	{
+		entry->sig_count /= 2;
+		for (i = 0; i < PREFETCHER_SPP_DELTAS; i++)
+			entry->delta_count[i] /= 2;
+	}
+}
+
+
+static void prefetcher_spp(struct mod_t *mod, struct mod_stack_t *stack)
+{
+	struct prefetcher_t *pref = mod->cache->prefetcher;
+	struct prefetcher_spp_t *spp = pref->spp;
+	struct prefetcher_spp_st_entry_t *st_entry;
+	struct prefetcher_spp_pt_entry_t *pt_entry;
+
+	unsigned int page = stack->addr >> mmu_log_page_size;
+	unsigned int page_base = page << mmu_log_page_size;
+	unsigned int sig;
 
-			/* The chain isn't long enough and we
-			 * haven't found a match till now. */
-			if (chain2 == -1)
-				return;
+	int blocks_per_page = mmu_page_size >> mod->cache->log_block_size;
+	int offset = (stack->addr & mmu_page_mask) >> mod->cache->log_block_size;
+	int delta;
+	int best;
 
-			cur_addr = pref->ghb[chain2].addr;
-			if (stride[i] != prev_addr - cur_addr)
-				break;
+	double confidence;
+
+	assert(spp);
+
+	/* First access to the page, nothing to learn from */
+	st_entry = &spp->signature_table[page % spp->st_size];
+	if (st_entry->page != page)
+	{
+		st_entry->page = page;
+		st_entry->last_offset = offset;
+		st_entry->sig = 0;
+		return;
+	}
+
+	/* Same block */
+	delta = offset - st_entry->last_offset;
+	if (!delta)
+		return;
+
+	/* Train the pattern table and move to the new signature */
+	prefetcher_spp_pt_update(spp, st_entry->sig, delta);
+	st_entry->sig = prefetcher_spp_next_sig(st_entry->sig, delta);
+	st_entry->last_offset = offset;
+
+	/* Walk the most confident path. The aggressiveness bounds its depth. */
+	sig = st_entry->sig;
+	confidence = 1.0;
+	for (int depth = 0; depth < pref->aggr; depth++)
+	{
+		pt_entry = &spp->pattern_table[sig % spp->pt_size];
+		if (!pt_entry->sig_count)
+			break;
+
+		best = 0;
+		for (int i = 1; i < PREFETCHER_SPP_DELTAS; i++)
+			if (pt_entry->delta_count[i] > pt_entry->delta_count[best])
+				best = i;
+
+		confidence *= (double) pt_entry->delta_count[best] / pt_entry->sig_count;
+		if (confidence < spp->threshold)
+			break;
+
+		/* Prefetches stay within the page */
+		offset += pt_entry->delta[best];
+		if (offset < 0 || offset >= blocks_per_page)
+			break;
+
+		unsigned int pref_addr = page_base + (offset << mod->cache->log_block_size);
+		if (mod_serves_address(mod, pref_addr))
+			prefetch_to_cache(mod, stack->client_info, pref_addr, st_entry - spp->signature_table);
+
+		sig = prefetcher_spp_next_sig(sig, pt_entry->delta[best]);
+	}
+}
+
+
+void prefetcher_spp_create(struct prefetcher_t *pref, int st_size, int pt_size, double threshold)
+{
+	struct prefetcher_spp_t *spp;
+
+	assert(st_size >= 1 && pt_size >= 1);
+	spp = xcalloc(1, sizeof(struct prefetcher_spp_t));
+	spp->st_size = st_size;
+	spp->pt_size = pt_size;
+	spp->threshold = threshold;
+	spp->signature_table = xcalloc(st_size, sizeof(struct prefetcher_spp_st_entry_t));
+	spp->pattern_table = xcalloc(pt_size, sizeof(struct prefetcher_spp_pt_entry_t));
+	for (int i = 0; i < st_size; i++)
+		spp->signature_table[i].page = -1;
+
+	pref->spp = spp;
+}
+
+
+/*
+ * IP-stride prefetcher
+ */
+
+static void prefetcher_ip_stride(struct mod_t *mod, struct mod_stack_t *stack)
+{
+	struct prefetcher_t *pref = mod->cache->prefetcher;
+	struct prefetcher_ip_stride_entry_t *entry;
+
+	unsigned int eip = stack->client_info->prefetcher_eip;
+	unsigned int addr = stack->addr & ~(mod->cache->block_size - 1);
+	int stride;
+
+	/* No PC information */
+	if (eip == -1)
+		return;
+
+	entry = &pref->ip_stride_table[eip % pref->it_size];
+	if (entry->eip != eip)
+	{
+		entry->eip = eip;
+		entry->last_addr = addr;
+		entry->stride = 0;
+		entry->confidence = 0;
+		return;
+	}
+
+	/* Same block as the last access of this instruction */
+	stride = addr - entry->last_addr;
+	if (!stride)
+		return;
+	entry->last_addr = addr;
+
+	if (stride == entry->stride)
+	{
+		if (entry->confidence < 3)
+			entry->confidence++;
+	}
+	else if (entry->confidence > 0)
+	{
+		entry->confidence--;
+	}
+	else
+	{
+		entry->stride = stride;
+	}
+
+	if (entry->confidence < 2)
+		return;
+
+	for (int i = 1; i <= pref->aggr; i++)
+	{
+		unsigned int pref_addr = addr + i * entry->stride;
+		if (!valid_prefetch_addr(mod, pref_addr, i * entry->stride))
+			return;
+		prefetch_to_cache(mod, stack->client_info, pref_addr, entry - pref->ip_stride_table);
+	}
+}
+
+
+/* Prefetchers that are not based on the global history buffer. Returns
+ * non-zero if the access was handled. */
+static int prefetcher_no_ghb_access(struct mod_stack_t *stack, struct mod_t *mod, int hit)
+{
+	switch (mod->cache->prefetcher->type)
+	{
+		case prefetcher_type_bop:
+		{
+			/* Best-Offset learns from misses and prefetched hits only */
+			if (!hit || stack->pref_hit)
+				prefetcher_bop(mod, stack);
+			return 1;
 		}
 
-		/* If we traversed the above loop full, we have a match. */
-		if (i == pref->lookup_depth)
+		case prefetcher_type_spp:
 		{
-		    cur_addr = pref->ghb[chain].addr;
-		    assert(pref->ghb[chain].prev != -1 &&
-			   pref->ghb[chain].prev_it_ghb == prefetcher_ptr_ghb);
-		    chain = pref->ghb[chain].prev;
-		    prev_addr = pref->ghb[chain].addr;
-		    pref_stride = prev_addr - cur_addr;
-		    prefetch_addr = stack->addr + pref_stride;
-		    break;
+			prefetcher_spp(mod, stack);
+			return 1;
 		}
 
-		chain = pref->ghb[chain].next;
-	}
+		case prefetcher_type_ip_stride:
+		{
+			prefetcher_ip_stride(mod, stack);
+			return 1;
+		}
 
-	if (prefetch_addr > 0)
-	{
-		prefetch_to_cache(mod, stack->client_info, prefetch_addr);
+		default:
+			return 0;
 	}
 }
 
 
+/* Called when a prefetch brings a block into the cache */
+void prefetcher_cache_fill(struct mod_stack_t *stack, struct mod_t *mod)
+{
+	struct prefetcher_t *pref = mod->cache->prefetcher;
+	unsigned int block;
+
+	if (!pref || pref->type != prefetcher_type_bop || !pref->bop->offset)
+		return;
+
+	/* The block that would have triggered this prefetch with the current
+	 * offset is recorded, so that only timely offsets score. */
+	block = stack->addr >> mod->cache->log_block_size;
+	if (block >= pref->bop->offset)
+		prefetcher_bop_rr_insert(pref->bop, block - pref->bop->offset);
+}
+
+
 void prefetcher_cache_miss(struct mod_stack_t *stack, struct mod_t *target_mod)
 {
 	int it_index;
@@ -493,6 +1357,9 @@ void prefetcher_cache_miss(struct mod_stack_t *stack, struct mod_t *target_mod)
 
 	assert(!stack->stream_hit);
 
+	if (prefetcher_no_ghb_access(stack, target_mod, 0))
+		return;
+
 	/* Get the index table index and test if is valid */
 	if(!get_it_index_tag(target_mod->cache->prefetcher, stack, &it_index, NULL))
 		return;
@@ -534,6 +1401,9 @@ void prefetcher_cache_hit(struct mod_stack_t *stack, struct mod_t *target_mod)
 	if (!can_prefetch(stack))
 		return;
 
+	if (prefetcher_no_ghb_access(stack, target_mod, 1))
+		return;
+
 	/* Get the index table index and test if is valid */
 	if(!get_it_index_tag(target_mod->cache->prefetcher, stack, &it_index, NULL))
 		return;
@@ -622,13 +1492,15 @@ int valid_prefetch_addr(struct mod_t *mod, unsigned int pref_addr, int stride)
 int can_prefetch(struct mod_stack_t *stack)
 {
 	struct mod_t *mod = stack->target_mod ? stack->target_mod : stack->mod;
+	int core_access = stack->access_kind == mod_access_load || stack->access_kind == mod_access_store;
 
 	return mod->cache->prefetcher && /* This module has a prefetcher */
 		mod->cache->prefetcher->enabled && /* Prefetch is enabled */
 		!stack->prefetch && /* A prefetch cannot trigger more prefetches */
 		!stack->background && /* Background stacks can't enqueue prefetches */
 		mod->kind == mod_kind_cache && /* Only enqueue prefetches in cache modules */
-		stack->request_dir == mod_request_up_down; /* Only a up-down request can trigger a prefetch */
+		(stack->request_dir == mod_request_up_down || /* Only a up-down request can trigger a prefetch... */
+		(core_access && mod->cache->prefetcher->type == prefetcher_type_ip_stride)); /* ...or a core access for IP-stride */
 }
 
 
@@ -673,6 +1545,8 @@ void prefetch_to_stream_buffer(
 		client_info = mod_client_info_clone(mod, client_info);
 		client_info->stream = stream;
 		client_info->slot = sb->tail;
+		if (pref->profiler)
+			client_info->pref_origin = prefetch_profiler_issue(pref->profiler, client_info->prefetcher_eip, stream);
 
 		mod_access(mod, mod_access_prefetch, sb->next_address, NULL, NULL, NULL, client_info);
 
@@ -32,6 +32,8 @@ extern struct str_map_t prefetcher_type_map;
 extern struct str_map_t adapt_pref_policy_map;
 extern struct str_map_t interval_kind_map;
 
+extern int EV_PREFETCHER_QUEUE;
+
 enum prefetcher_type_t
 {
 	prefetcher_type_invalid = 0,
@@ -40,6 +42,9 @@ enum prefetcher_type_t
 	prefetcher_type_pc_cs_sb,
 	prefetcher_type_cz_cs_sb,
 	prefetcher_type_cz_cs,
+	prefetcher_type_bop,
+	prefetcher_type_spp,
+	prefetcher_type_ip_stride,
 };
 
 /* Doesn't really make sense to have a big lookup depth */
@@ -61,6 +66,32 @@ struct prefetcher_ghb_t
 		prefetcher_ptr_ghb = 0,
 		prefetcher_ptr_it,
 	} prev_it_ghb;
+	/* Index table entry that inserted this element, and its epoch at
+	 * that time, so its history length can be updated on eviction. */
+	int owner;
+	int owner_epoch;
+};
+
+/* Each index table entry keeps the deltas between its last addresses in a
+ * small ring, so stride and delta correlation lookups don't need to walk
+ * the GHB linked list. It must hold more than PREFETCHER_LOOKUP_DEPTH_MAX
+ * deltas, and be a power of 2. */
+#define PREFETCHER_DELTA_RING_SIZE 8
+#define PREFETCHER_DELTA(it, k) ((it)->delta_ring[(k) & (PREFETCHER_DELTA_RING_SIZE - 1)])
+
+/* Delta correlation table entries per index table entry. They are indexed
+ * by a rolling hash of the last 'lookup_depth' deltas. */
+#define PREFETCHER_DC_TABLE_SIZE 64
+#define PREFETCHER_DC_HASH_MUL 0x9e3779b1u
+
+struct prefetcher_dc_entry_t
+{
+	/* Delta tuple, oldest first */
+	int delta[PREFETCHER_LOOKUP_DEPTH_MAX];
+	/* Delta that followed the tuple, and its position in the history.
+	 * -1 implies invalid entry. */
+	int next_delta;
+	long long pos;
 };
 
 /* Index table. */
@@ -70,6 +101,108 @@ struct prefetcher_it_t
 	unsigned int tag;
 	/* Pointer into the GHB. -1 implies no entry in GHB. */
    	int ptr;
+
+	/* Delta history */
+	int epoch;		/* Incremented when the entry is replaced */
+	int hist_len;		/* Addresses of this entry still in the GHB */
+	long long num_addr;	/* Addresses seen since the entry was allocated */
+	unsigned int last_addr;
+	int delta_ring[PREFETCHER_DELTA_RING_SIZE];
+	int stride_run;		/* Consecutive occurrences of the last delta */
+	unsigned int hash;	/* Rolling hash of the last 'lookup_depth' deltas */
+};
+
+/* Best-Offset prefetcher (Michaud, HPCA 2016). Offsets are tested in rounds
+ * against a table of recent requests, and the one with the best score is
+ * used as prefetch offset during the next learning phase. */
+struct prefetcher_bop_t
+{
+	int *offsets;		/* Candidate offsets in blocks */
+	int *scores;		/* Score of each candidate offset */
+	int num_offsets;
+	int test_index;		/* Next offset to test */
+	int round;		/* Rounds in the current learning phase */
+	int best_offset;	/* Offset with the best score so far */
+	int best_score;
+
+	int offset;		/* Prefetch offset in use, 0 if prefetch is off */
+
+	/* Recent requests table, direct mapped, holds block numbers */
+	unsigned int *rr_table;
+	int rr_size;
+
+	/* Parameters */
+	int score_max;
+	int round_max;
+	int bad_score;
+};
+
+/* Signature Path Prefetcher (Kim et al., MICRO 2016). Deltas within a page
+ * are compressed into a signature, and the pattern table predicts the next
+ * deltas of a signature with a confidence used to walk ahead. */
+#define PREFETCHER_SPP_DELTAS 4
+#define PREFETCHER_SPP_SIG_BITS 12
+#define PREFETCHER_SPP_COUNTER_MAX 15
+
+struct prefetcher_spp_st_entry_t
+{
+	unsigned int page;	/* Page number, -1 if invalid */
+	int last_offset;	/* Last block offset accessed in the page */
+	unsigned int sig;
+};
+
+struct prefetcher_spp_pt_entry_t
+{
+	int delta[PREFETCHER_SPP_DELTAS];
+	int delta_count[PREFETCHER_SPP_DELTAS];
+	int sig_count;
+};
+
+struct prefetcher_spp_t
+{
+	struct prefetcher_spp_st_entry_t *signature_table;
+	struct prefetcher_spp_pt_entry_t *pattern_table;
+	int st_size;
+	int pt_size;
+	double threshold;	/* Minimum path confidence to keep prefetching */
+};
+
+/* IP-stride prefetcher. Tracks the stride between consecutive accesses of
+ * each load/store instruction and prefetches ahead once it is stable. */
+struct prefetcher_ip_stride_entry_t
+{
+	unsigned int eip;	/* Tag, -1 if invalid */
+	unsigned int last_addr;
+	int stride;
+	int confidence;		/* Saturating counter, prefetch when >= 2 */
+};
+
+/* Prefetch queue. Prefetches to cache wait here until the module has a free
+ * port, instead of competing for ports with demand accesses. */
+struct prefetcher_queue_entry_t
+{
+	unsigned int addr;	/* Block address */
+	struct mod_client_info_t *client_info;
+	unsigned int eip;	/* Prefetch origin, for the profiler */
+	int source;
+	long long time;		/* Cycle the prefetch was enqueued */
+};
+
+struct prefetcher_queue_t
+{
+	struct mod_t *mod;
+	struct prefetcher_queue_entry_t *entries;	/* Circular buffer */
+	int size;
+	int head;
+	int count;
+
+	/* Prefetches are dropped when the transaction queue of the DRAM
+	 * channel they map to is at least this full */
+	double dram_threshold;
+
+	int scheduled;		/* Injection event pending */
+	long long inject_cycle;	/* Cycle of the last injection */
+	int injected;		/* Prefetches injected in that cycle */
 };
 
 /* Adaptive policy */
@@ -142,6 +275,11 @@ struct prefetcher_t
 	struct prefetcher_it_t *index_table;
 	int ghb_head;
 
+	/* Delta correlation, PREFETCHER_DC_TABLE_SIZE entries per index
+	 * table entry. Only allocated for PC_DC. */
+	struct prefetcher_dc_entry_t *dc_table;
+	unsigned int dc_hash_pow;	/* Hash weight of the oldest delta */
+
 	/* CZone prefetchers */
 	int czone_bits;					/* Size in bits of the czone */
 	unsigned int czone_mask; 		/* For obtaining czone */
@@ -156,6 +294,20 @@ struct prefetcher_t
 	struct stream_buffer_t *stream_head;
 	struct stream_buffer_t *stream_tail;
 
+	/* Prefetch queue, NULL if prefetches go directly to the module */
+	int queue_size;
+	double queue_dram_threshold;
+	struct prefetcher_queue_t *queue;
+
+	/* Per-PC prefetch profiler, NULL if disabled */
+	int profile_top_n;
+	struct prefetch_profiler_t *profiler;
+
+	/* Best-Offset, SPP and IP-stride prefetchers */
+	struct prefetcher_bop_t *bop;
+	struct prefetcher_spp_t *spp;
+	struct prefetcher_ip_stride_entry_t *ip_stride_table;
+
 	/* Adaptive prefetchers */
 	enum adapt_pref_policy_t adapt_policy;		/* Adaptative policy used */
 	unsigned int aggr_ini;						/* Initial aggressivity */
@@ -172,6 +324,8 @@ struct prefetcher_t
 };
 
 
+struct bin_config_t;
+struct bin_config_elem_t;
 struct mod_client_info_t;
 struct mod_stack_t;
 struct mod_t;
@@ -179,12 +333,22 @@ struct mod_t;
 
 struct prefetcher_t *prefetcher_create(int prefetcher_ghb_size, int prefetcher_it_size, int prefetcher_lookup_depth, enum prefetcher_type_t type, int aggr);
 void prefetcher_stream_buffers_create(struct prefetcher_t *pref, int max_num_streams, int max_num_slots);
+void prefetcher_bop_create(struct prefetcher_t *pref, int max_offset, int rr_size, int score_max, int round_max, int bad_score);
+void prefetcher_spp_create(struct prefetcher_t *pref, int st_size, int pt_size, double threshold);
+void prefetcher_queue_create(struct prefetcher_t *pref, struct mod_t *mod);
+void prefetcher_queue_handler(int event, void *data);
 void prefetcher_free(struct prefetcher_t *pref);
 
+void prefetcher_save_state(struct prefetcher_t *pref, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem);
+int prefetcher_load_state(struct prefetcher_t *pref, struct bin_config_t *bin_config,
+	struct bin_config_elem_t *parent_elem, int check_only);
+
 int prefetcher_update_tables(struct mod_stack_t *stack);
 
 void prefetcher_cache_miss(struct mod_stack_t *stack, struct mod_t *mod);
 void prefetcher_cache_hit(struct mod_stack_t *stack, struct mod_t *mod);
+void prefetcher_cache_fill(struct mod_stack_t *stack, struct mod_t *mod);
 
 void prefetcher_stream_buffer_hit(struct mod_stack_t *stack);
 void prefetcher_stream_buffer_miss(struct mod_stack_t *stack);
@@ -192,6 +356,7 @@ void prefetcher_stream_buffer_miss(struct mod_stack_t *stack);
 int prefetcher_uses_stream_buffers(struct prefetcher_t *pref);
 int prefetcher_uses_pc_indexed_ghb(struct prefetcher_t *pref);
 int prefetcher_uses_czone_indexed_ghb(struct prefetcher_t *pref);
+int prefetcher_uses_ghb(struct prefetcher_t *pref);
 int prefetcher_uses_pollution_filters(struct prefetcher_t *pref);
 
 void prefetcher_set_default_adaptive_thresholds(struct prefetcher_t *pref);
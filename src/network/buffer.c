@@ -192,8 +192,10 @@ void net_buffer_extract(struct net_buffer_t *buffer, struct net_msg_frag_t *frag
 		node->name,
 		buffer->name);
 
-	/* Schedule events waiting for space in buffer. */
-	net_buffer_wakeup(buffer);
+	/* Schedule events waiting for space in buffer. Routers stepped by
+	 * several threads leave it for the end of the cycle. */
+	if (!net->router_parallel)
+		net_buffer_wakeup(buffer);
 }
 
 
@@ -40,6 +40,14 @@ enum net_buffer_kind_t
 	net_buffer_bus
 };
 
+/* State of an input buffer used as a virtual channel in flit switching */
+enum net_buffer_vc_state_t
+{
+	net_buffer_vc_idle = 0,
+	net_buffer_vc_routed,	/* Route computed, output VC requested */
+	net_buffer_vc_active	/* Output VC allocated */
+};
+
 struct net_buffer_t
 {
 	struct net_t *net;	/* Network it belongs to */
@@ -70,6 +78,16 @@ struct net_buffer_t
 	long long sched_when;	/* Last cycle when scheduler was called */
 	struct net_buffer_t *sched_buffer;	/* Input buffer to fetch from */
 
+	/* Flit switching. Input buffers of switches are virtual channels,
+	 * while output buffers hold the credits of the input buffer they
+	 * feed downstream. */
+	enum net_buffer_vc_state_t vc_state;
+	long long vc_when;		/* Cycle of the last pipeline stage */
+	struct net_buffer_t *vc_output;	/* Output VC requested or held */
+	struct net_buffer_t *vc_owner;	/* Input VC holding this output VC */
+	int credits;			/* Free bytes in downstream buffer */
+	int credits_returned;		/* Credits visible next cycle */
+
 	/* List of events to schedule when new space becomes available in the
 	 * buffer. Elements are of type 'struct net_buffer_wakeup_t' */
 	struct linked_list_t *wakeup_list;
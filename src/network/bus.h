@@ -31,6 +31,7 @@ struct net_bus_t
 	int index;
 	int bandwidth;
 	long long busy;		/* Busy until this cycle inclusive */
+	long long fast_busy;	/* Reserved by the fast model until this cycle */
 
 	/* Stats */
 	long long busy_cycles;
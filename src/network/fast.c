@@ -0,0 +1,188 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <lib/esim/esim.h>
+#include <lib/util/debug.h>
+#include <lib/util/list.h>
+#include <lib/util/misc.h>
+
+#include "buffer.h"
+#include "bus.h"
+#include "fast.h"
+#include "link.h"
+#include "message.h"
+#include "msg-stats.h"
+#include "net-system.h"
+#include "network.h"
+#include "node.h"
+#include "routing-table.h"
+
+
+int EV_NET_FAST_RECEIVE;
+
+
+/* Compute the arrival cycle of a message and schedule its delivery. With
+ * store-and-forward switching, a message is serialized again on every hop.
+ * Otherwise its head moves on one cycle after entering a link, and only the
+ * last link adds the serialization latency. */
+void net_fast_send(struct net_t *net, struct net_msg_t *msg)
+{
+	struct net_routing_table_entry_t *entry;
+	struct net_msg_frag_t *frag;
+	struct net_buffer_t *buffer;
+	struct net_link_t *link;
+	struct net_bus_t *bus;
+	struct net_node_t *node;
+	struct net_node_t *next_node;
+	struct net_node_t *dst_node;
+
+	long long *busy;
+	long long cycle;
+	long long when;
+	long long start;
+	long long arrival;
+
+	int bandwidth;
+	int frags;
+	int hops;
+	int lat;
+
+	/* Get current cycle */
+	cycle = esim_domain_cycle(net_domain_index);
+
+	/* Walk the route */
+	frag = list_get(msg->fragments, 0);
+	frags = list_count(msg->fragments);
+	node = frag->src_node;
+	dst_node = frag->dst_node;
+	when = cycle;
+	arrival = cycle;
+	for (hops = 0; node != dst_node; hops++)
+	{
+		if (hops == net->node_count)
+			fatal("%s: routing loop from %s to %s.\n%s", net->name,
+				frag->src_node->name, dst_node->name, net_err_cycle);
+
+		entry = net_routing_table_lookup(net->routing_table, node, dst_node);
+		buffer = entry->output_buffer;
+		if (!buffer)
+			fatal("%s: no route from %s to %s.\n%s", net->name,
+				node->name, dst_node->name, net_err_no_route);
+
+		/* Link or bus. Its statistics count the whole message as it
+		 * crosses, as the detailed model does fragment by fragment. */
+		if (buffer->link)
+		{
+			link = buffer->link;
+			bandwidth = link->bandwidth;
+			lat = (msg->size - 1) / bandwidth + 1;
+			busy = &link->fast_busy;
+			link->busy_cycles += lat;
+			link->transferred_msgs++;
+			link->transferred_frags += frags;
+			link->transferred_bytes += msg->size;
+			next_node = link->dst_node;
+		}
+		else
+		{
+			bus = buffer->bus;
+			bandwidth = bus->bandwidth;
+			lat = (msg->size - 1) / bandwidth + 1;
+			busy = &bus->fast_busy;
+			bus->busy_cycles += lat;
+			bus->transferred_msgs++;
+			bus->transferred_frags += frags;
+			bus->transferred_bytes += msg->size;
+			next_node = entry->next_node;
+		}
+		node->msgs_sent++;
+		node->frags_sent += frags;
+		node->bytes_sent += msg->size;
+		next_node->msgs_received++;
+		next_node->frags_received += frags;
+		next_node->bytes_received += msg->size;
+		node = next_node;
+
+		/* Contention */
+		start = MAX(when, *busy + 1);
+		*busy = start + lat - 1;
+		arrival = start + lat;
+		when = net->switching == network_switching_saf ? arrival : start + 1;
+
+		/* Latency breakdown */
+		msg->hops++;
+		msg->hop_cycles++;
+		if (net->switching == network_switching_saf)
+			msg->serial_cycles += lat - 1;
+	}
+	if (hops && net->switching != network_switching_saf)
+		msg->serial_cycles += lat - 1;
+
+	/* Deliver */
+	msg->cycle_sent = cycle;
+	net_debug("%lld: MSG -> "
+			"a=\"fast\" "
+			"net=\"%s\" "
+			"msg=%lld "
+			"hops=%d "
+			"lat=%lld\n",
+			cycle,
+			net->name,
+			msg->id,
+			hops,
+			arrival - cycle);
+	esim_schedule_event(EV_NET_FAST_RECEIVE, msg, arrival - cycle);
+}
+
+
+void net_fast_receive_handler(int event, void *data)
+{
+	struct net_msg_t *msg = data;
+	struct net_msg_frag_t *frag;
+	struct net_node_t *node;
+	struct net_t *net;
+
+	long long cycle;
+	int i;
+
+	/* Get current cycle */
+	cycle = esim_domain_cycle(net_domain_index);
+
+	/* All fragments arrive at once, out of any buffer */
+	frag = list_get(msg->fragments, 0);
+	net = frag->net;
+	node = frag->dst_node;
+	LIST_FOR_EACH(msg->fragments, i)
+	{
+		frag = list_get(msg->fragments, i);
+		frag->node = node;
+		frag->arrived = true;
+	}
+	msg->arrived_frags_count = list_count(msg->fragments);
+	msg->cycle_head_arrived = cycle;
+
+	/* Stats */
+	net_msg_stats_record(net, msg, node);
+
+	/* Return */
+	if (msg->ret_event == ESIM_EV_NONE)
+		net_receive_msg(net, node, msg);
+	else
+		esim_schedule_event(msg->ret_event, msg->ret_stack, 0);
+}
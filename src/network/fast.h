@@ -0,0 +1,41 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NETWORK_FAST_H
+#define NETWORK_FAST_H
+
+
+/*
+ * Fast network model, used in warm-up phases. A message does not go through
+ * buffers. Its latency is computed when it is sent, walking its route once:
+ * every link adds its serialization latency, and links are reserved for
+ * that time, so that messages sharing a link queue behind each other. The
+ * message is delivered with a single event at the resulting cycle.
+ */
+
+extern int EV_NET_FAST_RECEIVE;
+
+struct net_t;
+struct net_msg_t;
+
+void net_fast_send(struct net_t *net, struct net_msg_t *msg);
+void net_fast_receive_handler(int event, void *data);
+
+
+#endif
@@ -50,6 +50,8 @@ struct net_link_t *net_link_create(struct net_t *net,
 	link->dst_node = dst_node;
 	link->bandwidth = bandwidth;
 	link->virtual_channel = virtual_channel;
+	link->src_buffers = xcalloc(virtual_channel, sizeof(struct net_buffer_t *));
+	link->dst_buffers = xcalloc(virtual_channel, sizeof(struct net_buffer_t *));
 
 
 	for (int i = 0; i < virtual_channel; i++)
@@ -58,6 +60,8 @@ struct net_link_t *net_link_create(struct net_t *net,
 		src_buffer->kind = net_buffer_link;
 		dst_buffer = net_node_add_input_buffer(dst_node, link_dst_bsize);
 		dst_buffer->kind = net_buffer_link;
+		link->src_buffers[i] = src_buffer;
+		link->dst_buffers[i] = dst_buffer;
 
 		if (i == 0)
 		{
@@ -87,6 +91,8 @@ struct net_link_t *net_link_create(struct net_t *net,
 
 void net_link_free(struct net_link_t *link)
 {
+	free(link->src_buffers);
+	free(link->dst_buffers);
 	free(link->name);
 	free(link);
 }
@@ -118,69 +124,30 @@ void net_link_dump_report(struct net_link_t *link, FILE *f)
 struct net_buffer_t *net_link_arbitrator_vc(struct net_link_t *link,
 	struct net_node_t *node)
 {
-	struct net_node_t *src_node = link->src_node;
-	struct net_node_t *dst_node = link->dst_node;
-	int output_buffer_count = list_count(src_node->output_buffer_list);
-	int input_buffer_count = list_count(dst_node->input_buffer_list);
-
 	struct net_buffer_t *output_buffer;
 	struct net_msg_frag_t *frag;
 
-	/* Keeping indexes of last chosen buffer */
-	int last_output_buffer_vc_index;
-	int output_buffer_vc_index;
+	/* Keeping index of last chosen virtual channel */
+	int last_vc;
+	int vc;
 	int i;
 
 	long long cycle;
 
 	/* performing the check */
-	assert(node == src_node);
+	assert(node == link->src_node);
 
 	/* Get current cycle */
 	cycle = esim_domain_cycle(net_domain_index);
 
-	/* Getting the indexes of first output buffer and input buffer that
-	 * are connected to a link with virtual channel capability */
-	int out_vc_count = 0;
-	int in_vc_count = 0;
-	int first_src_buffer_act_index = 0;
-	int first_dst_buffer_act_index = 0;
-
-
-	for (i = 0; i < output_buffer_count; i++)
-	{
-		struct net_buffer_t *temp_out_buffer;
-
-		temp_out_buffer = list_get(src_node->output_buffer_list, i);
-		if (temp_out_buffer->link == link)
-			out_vc_count++;
-		if (out_vc_count == 1)
-			first_src_buffer_act_index = temp_out_buffer->index;
-	}
-
-	for (int j = 0; j < input_buffer_count; j++)
-	{
-		struct net_buffer_t *temp_in_buffer;
-
-		temp_in_buffer = list_get(dst_node->input_buffer_list, j);
-		if (temp_in_buffer->link == link)
-			in_vc_count++;
-		if (in_vc_count == 1)
-			first_dst_buffer_act_index = temp_in_buffer->index;
-	}
-
-	/* Checks */
-	assert(in_vc_count == link->virtual_channel);
-	assert(out_vc_count == link->virtual_channel);
-
 	/* If last decision was within the same cycle, return the same value */
 	if (link->sched_when == cycle)
 		return link->sched_buffer;
 
 	/* make a new decision */
 	link->sched_when = cycle;
-	last_output_buffer_vc_index = link->sched_buffer ?
-		(link->sched_buffer->index - first_src_buffer_act_index) : 0;
+	last_vc = link->sched_buffer ?
+		link->sched_buffer->index - link->src_buffers[0]->index : 0;
 
 	/* link must be ready */
 	if (link->busy >= cycle)
@@ -192,13 +159,8 @@ struct net_buffer_t *net_link_arbitrator_vc(struct net_link_t *link,
 	/* find output buffer to fetch from */
 	for (i = 0; i < link->virtual_channel; i++)
 	{
-		output_buffer_vc_index =
-			(last_output_buffer_vc_index + i +
-			1) % link->virtual_channel;
-		output_buffer =
-			list_get(node->output_buffer_list,
-			(output_buffer_vc_index +
-				first_src_buffer_act_index));
+		vc = (last_vc + i + 1) % link->virtual_channel;
+		output_buffer = link->src_buffers[vc];
 		assert(output_buffer->link == link);
 
 		/* frag should be at head */
@@ -217,13 +179,8 @@ struct net_buffer_t *net_link_arbitrator_vc(struct net_link_t *link,
 		/* ALL conditions satisfied */
 		link->sched_buffer = output_buffer;
 		link->src_buffer = output_buffer;
-		struct net_buffer_t *input_buffer;
-
-		input_buffer = list_get(dst_node->input_buffer_list,
-			(output_buffer_vc_index +
-				first_dst_buffer_act_index));
-		assert(input_buffer->link == link);
-		link->dst_buffer = input_buffer;
+		link->dst_buffer = link->dst_buffers[vc];
+		assert(link->dst_buffer->link == link);
 		return output_buffer;
 	}
 	/* No output buffer ready */
@@ -38,8 +38,14 @@ struct net_link_t
 	struct net_buffer_t *dst_buffer;
 	struct net_buffer_t *src_buffer;
 
+	/* Buffers of each virtual channel, in the source and destination
+	 * nodes. Arrays of 'virtual_channel' elements. */
+	struct net_buffer_t **src_buffers;
+	struct net_buffer_t **dst_buffers;
+
 	int bandwidth;
 	long long busy;		/* Busy until this cycle inclusive */
+	long long fast_busy;	/* Reserved by the fast model until this cycle */
 
 	/* Scheduling for link */
 	int virtual_channel;	/* Number of Virtual Channels on a Link*/
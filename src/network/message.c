@@ -23,11 +23,13 @@
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
 #include <lib/util/list.h>
+#include <lib/util/string.h>
 
 #include "buffer.h"
 #include "bus.h"
 #include "link.h"
 #include "message.h"
+#include "msg-stats.h"
 #include "net-system.h"
 #include "network.h"
 #include "node.h"
@@ -35,6 +37,17 @@
 
 long long msg_id_counter;
 
+struct str_map_t net_msg_class_map =
+{
+	net_msg_class_count, {
+		{ "Other", net_msg_class_other },
+		{ "Request", net_msg_class_request },
+		{ "Response", net_msg_class_response },
+		{ "Invalidation", net_msg_class_invalidation },
+		{ "Writeback", net_msg_class_writeback }
+	}
+};
+
 /*
  * Message
  */
@@ -80,8 +93,10 @@ struct net_msg_t *net_msg_create(struct net_t *net, struct net_node_t *src_node,
 					msg->id);
 			break;
 
-		/* VCT - Virtual Cut-Through: one msg is composed of size/bandwidth fragments */
+		/* VCT - Virtual Cut-Through: one msg is composed of size/bandwidth fragments.
+		 * Flit switching uses the same fragments as flits. */
 		case network_switching_vct:
+		case network_switching_flit:
 		{
 			int id;
 			int num_fragments = (size - 1) / net->def_bandwidth + 1;
@@ -119,11 +134,12 @@ struct net_msg_t *net_msg_create(struct net_t *net, struct net_node_t *src_node,
 					"net=%s "
 					"msg=%lld "
 					"frags=%d "
-					"switching=VCT \n",
+					"switching=%s \n",
 					cycle,
 					net->name,
 					msg->id,
-					list_count(msg->fragments));
+					list_count(msg->fragments),
+					network_switching_map[net->switching]);
 			break;
 		}
     }
@@ -221,7 +237,7 @@ void net_event_handler(int event, void *data)
 				src_node->name, dst_node->name,
 				net_err_no_route);
 
-		if (output_buffer->write_busy >= cycle)
+		if (frag->id == 0 && output_buffer->write_busy >= cycle)
 			panic("%s: output buffer busy.\n%s", __FUNCTION__, net_err_can_send);
 
 		/* Full msg must fit in buffers in both SAF and VCT */
@@ -231,15 +247,18 @@ void net_event_handler(int event, void *data)
 		if (output_buffer->count + frag->size > output_buffer->size)
 			panic("%s: output buffer full.\n%s", __FUNCTION__, net_err_can_send);
 
-		/* Insert in output buffer (1 cycle latency) */
+		/* Insert in output buffer (1 cycle latency). The rest of the
+		 * fragments follow in the next cycles, so the buffer stays busy
+		 * for other messages until the last one is inserted. */
 		net_buffer_insert(output_buffer, frag);
-		output_buffer->write_busy = cycle;
+		output_buffer->write_busy = cycle + list_count(msg->fragments) - 1 - frag->id;
 		frag->node = src_node;
 		frag->buffer = output_buffer;
 		frag->busy = cycle;
 
 		if (frag->id == 0)
 			frag->parent->cycle_sent = cycle;
+		net_msg_stats_hop(frag, 1, 1, 0);
 
 		/* Schedule next event for this fragment */
 		esim_schedule_event(EV_NET_OUTPUT_BUFFER, stack, 1);
@@ -414,6 +433,7 @@ void net_event_handler(int event, void *data)
 			frag->busy = cycle + lat - 1;
 
 			/* Stats */
+			net_msg_stats_hop(frag, 1, lat, 1);
 			link->busy_cycles += lat;
 			link->transferred_bytes += frag->size;
 			link->transferred_frags++;
@@ -549,6 +569,7 @@ void net_event_handler(int event, void *data)
 			frag->busy = cycle + lat - 1;
 
 			/* Stats */
+			net_msg_stats_hop(frag, 1, lat, 1);
 			bus->busy_cycles += lat;
 			bus->transferred_bytes += frag->size;
 			bus->transferred_frags++;
@@ -715,6 +736,7 @@ void net_event_handler(int event, void *data)
 		net_buffer_insert(output_buffer, frag);
 		frag->buffer = output_buffer;
 		frag->busy = cycle + lat - 1;
+		net_msg_stats_hop(frag, 1, lat, 0);
 
 		/* Schedule next event */
 		esim_schedule_event(EV_NET_OUTPUT_BUFFER, stack, lat);
@@ -742,9 +764,7 @@ void net_event_handler(int event, void *data)
 		if (frag->parent->arrived_frags_count == list_count(frag->parent->fragments))
 		{
 			/* Stats */
-			net->transfers++;
-			net->msg_size_acc += frag->parent->size;
-			net->lat_acc += cycle - frag->parent->cycle_sent;
+			net_msg_stats_record(net, frag->parent, dst_node);
 
 			net_debug("%lld: MSG -> "
 					"a=\"finish\" "
@@ -22,6 +22,19 @@
 
 #include <stdbool.h>
 
+
+/* Message class, set by the sender for statistics */
+extern struct str_map_t net_msg_class_map;
+enum net_msg_class_t
+{
+	net_msg_class_other = 0,
+	net_msg_class_request,
+	net_msg_class_response,
+	net_msg_class_invalidation,
+	net_msg_class_writeback,
+	net_msg_class_count
+};
+
 struct net_msg_t
 {
 	long long id;
@@ -42,6 +55,13 @@ struct net_msg_t
 
 	/* Cycle in which this message has entered the network */
 	long long cycle_sent;
+
+	/* Statistics, see 'msg-stats.h' */
+	enum net_msg_class_t msg_class;
+	int hops;			/* Links and buses crossed */
+	long long hop_cycles;		/* Hop latency */
+	long long serial_cycles;	/* Serialization before arriving */
+	long long cycle_head_arrived;	/* First fragment at destination */
 };
 
 struct net_msg_frag_t
@@ -0,0 +1,297 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include <lib/esim/esim.h>
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/debug.h>
+#include <lib/util/file.h>
+#include <lib/util/list.h>
+#include <lib/util/misc.h>
+#include <lib/util/stats.h>
+#include <lib/util/string.h>
+
+#include "message.h"
+#include "msg-stats.h"
+#include "net-system.h"
+#include "network.h"
+#include "node.h"
+
+
+static char *net_msg_lat_name[net_msg_lat_count] =
+{
+	"lat", "queue", "serial", "hop"
+};
+
+
+/*
+ * Private Functions
+ */
+
+static int net_msg_stats_bucket(long long lat)
+{
+	int bucket;
+
+	for (bucket = 0; bucket < NET_MSG_STATS_HIST_SIZE - 1; bucket++)
+		if (lat < 2LL << bucket)
+			break;
+	return bucket;
+}
+
+
+static void net_msg_stats_add(struct net_msg_stats_t *stats,
+	struct net_msg_t *msg, long long *lat)
+{
+	int i;
+
+	stats->msgs++;
+	stats->bytes += msg->size;
+	stats->hops += msg->hops;
+	for (i = 0; i < net_msg_lat_count; i++)
+	{
+		stats->lat_acc[i] += lat[i];
+		stats->hist[i][net_msg_stats_bucket(lat[i])]++;
+	}
+}
+
+
+static void net_msg_stats_write_row(FILE *f, char *class_name,
+	char *src_name, char *dst_name, struct net_msg_stats_t *stats)
+{
+	int i;
+	int j;
+
+	fprintf(f, "%lld,%s,%s,%s,%lld,%lld,%.3f", esim_time, class_name,
+		src_name, dst_name, stats->msgs, stats->bytes,
+		(double) stats->hops / stats->msgs);
+	for (i = 0; i < net_msg_lat_count; i++)
+		fprintf(f, ",%.3f", (double) stats->lat_acc[i] / stats->msgs);
+	for (i = 0; i < net_msg_lat_count; i++)
+		for (j = 0; j < NET_MSG_STATS_HIST_SIZE; j++)
+			fprintf(f, ",%lld", stats->hist[i][j]);
+	fprintf(f, "\n");
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
+void net_msg_stats_init(struct net_t *net)
+{
+	net->class_stats = xcalloc(net_msg_class_count, sizeof(struct net_msg_stats_t));
+	net->class_stats_int = xcalloc(net_msg_class_count, sizeof(struct net_msg_stats_t));
+}
+
+
+void net_msg_stats_done(struct net_t *net)
+{
+	int i;
+
+	free(net->class_stats);
+	free(net->class_stats_int);
+
+	/* Interval reports */
+	if (net->pair_stats_int)
+	{
+		for (i = 0; i < net->pair_stats_size * net->pair_stats_size; i++)
+			free(net->pair_stats_int[i]);
+		free(net->pair_stats_int);
+	}
+	file_close(net->interval_file);
+}
+
+
+/* Account for a resource crossed by a fragment in 'lat' cycles, after
+ * 'stages' cycles of pipeline, the last of which overlaps with the first
+ * cycle of the transfer. Only the head of the message counts, the rest of
+ * the fragments follow it. Argument 'hop' is set for links and buses, and
+ * clear for switch crossbars and injection. */
+void net_msg_stats_hop(struct net_msg_frag_t *frag, int stages, int lat, int hop)
+{
+	struct net_msg_t *msg = frag->parent;
+
+	if (frag->id)
+		return;
+
+	msg->hops += hop;
+	msg->hop_cycles += stages;
+	msg->serial_cycles += lat - 1;
+}
+
+
+/* Record a message whose fragments all arrived at 'dst_node' */
+void net_msg_stats_record(struct net_t *net, struct net_msg_t *msg,
+	struct net_node_t *dst_node)
+{
+	struct net_msg_frag_t *frag;
+	struct net_msg_stats_t *stats;
+
+	long long lat[net_msg_lat_count];
+	long long cycle;
+
+	int index;
+
+	/* Get current cycle */
+	cycle = esim_domain_cycle(net_domain_index);
+
+	/* General stats */
+	net->transfers++;
+	net->msg_size_acc += msg->size;
+	net->lat_acc += cycle - msg->cycle_sent;
+
+	/* Latency breakdown */
+	lat[net_msg_lat_total] = cycle - msg->cycle_sent;
+	lat[net_msg_lat_hop] = msg->hop_cycles;
+	lat[net_msg_lat_serial] = msg->serial_cycles + cycle - msg->cycle_head_arrived;
+	lat[net_msg_lat_queue] = MAX(0, lat[net_msg_lat_total] -
+		lat[net_msg_lat_hop] - lat[net_msg_lat_serial]);
+
+	/* Per class */
+	assert(msg->msg_class >= 0 && msg->msg_class < net_msg_class_count);
+	net_msg_stats_add(&net->class_stats[msg->msg_class], msg, lat);
+	if (!net->interval_file)
+		return;
+	net_msg_stats_add(&net->class_stats_int[msg->msg_class], msg, lat);
+
+	/* Per source and destination */
+	frag = list_get(msg->fragments, 0);
+	assert(frag->src_node->index < net->pair_stats_size);
+	assert(dst_node->index < net->pair_stats_size);
+	index = frag->src_node->index * net->pair_stats_size + dst_node->index;
+	stats = net->pair_stats_int[index];
+	if (!stats)
+	{
+		stats = xcalloc(1, sizeof(struct net_msg_stats_t));
+		net->pair_stats_int[index] = stats;
+	}
+	net_msg_stats_add(stats, msg, lat);
+}
+
+
+void net_msg_stats_dump(struct net_t *net, FILE *f)
+{
+	struct net_msg_stats_t *stats;
+
+	int i;
+	int j;
+
+	for (i = 0; i < net_msg_class_count; i++)
+	{
+		stats = &net->class_stats[i];
+		if (!stats->msgs)
+			continue;
+
+		fprintf(f, "[ Network.%s.Class.%s ]\n", net->name,
+			str_map_value(&net_msg_class_map, i));
+		fprintf(f, "Transfers = %lld\n", stats->msgs);
+		fprintf(f, "AverageMessageSize = %.2f\n", (double) stats->bytes / stats->msgs);
+		fprintf(f, "AverageHops = %.4f\n", (double) stats->hops / stats->msgs);
+		fprintf(f, "AverageLatency = %.4f\n", (double)
+			stats->lat_acc[net_msg_lat_total] / stats->msgs);
+		fprintf(f, "AverageQueueing = %.4f\n", (double)
+			stats->lat_acc[net_msg_lat_queue] / stats->msgs);
+		fprintf(f, "AverageSerialization = %.4f\n", (double)
+			stats->lat_acc[net_msg_lat_serial] / stats->msgs);
+		fprintf(f, "AverageHopLatency = %.4f\n", (double)
+			stats->lat_acc[net_msg_lat_hop] / stats->msgs);
+		fprintf(f, "LatencyHistogram =");
+		for (j = 0; j < NET_MSG_STATS_HIST_SIZE; j++)
+			fprintf(f, " %lld", stats->hist[net_msg_lat_total][j]);
+		fprintf(f, "\n\n");
+	}
+}
+
+
+void net_interval_report_init(struct net_t *net)
+{
+	char file_name[MAX_PATH_SIZE];
+	int ret;
+	int i;
+	int j;
+
+	ret = snprintf(file_name, MAX_PATH_SIZE, "%s/%s.msgstats.csv",
+		net_interval_reports_dir, net->name);
+	if (ret < 0 || ret >= MAX_PATH_SIZE)
+		fatal("%s: string too long %s", __FUNCTION__, file_name);
+
+	net->interval_file = file_open_for_write(file_name);
+	if (!net->interval_file)
+		fatal("%s: cannot open interval report file", file_name);
+
+	/* Per source and destination stats, allocated as pairs show up */
+	net->pair_stats_size = list_count(net->node_list);
+	net->pair_stats_int = xcalloc(net->pair_stats_size * net->pair_stats_size,
+		sizeof(struct net_msg_stats_t *));
+
+	/* Header */
+	fprintf(net->interval_file, "esim-time,class,src,dst,msgs,bytes,hops");
+	for (i = 0; i < net_msg_lat_count; i++)
+		fprintf(net->interval_file, ",%s", net_msg_lat_name[i]);
+	for (i = 0; i < net_msg_lat_count; i++)
+	{
+		for (j = 0; j < NET_MSG_STATS_HIST_SIZE - 1; j++)
+			fprintf(net->interval_file, ",%s<%lld", net_msg_lat_name[i], 2LL << j);
+		fprintf(net->interval_file, ",%s>=%lld", net_msg_lat_name[i], 1LL << j);
+	}
+	fprintf(net->interval_file, "\n");
+	fflush(net->interval_file);
+}
+
+
+/* One row per message class, and one per source and destination pair, with
+ * the messages delivered in the interval */
+void net_interval_report(struct net_t *net)
+{
+	struct net_msg_stats_t *stats;
+	struct net_node_t *src_node;
+	struct net_node_t *dst_node;
+
+	int i;
+
+	if (!net->interval_file)
+		return;
+
+	for (i = 0; i < net_msg_class_count; i++)
+	{
+		stats = &net->class_stats_int[i];
+		if (stats->msgs)
+			net_msg_stats_write_row(net->interval_file,
+				str_map_value(&net_msg_class_map, i), "*", "*", stats);
+	}
+	memset(net->class_stats_int, 0, net_msg_class_count * sizeof(struct net_msg_stats_t));
+
+	for (i = 0; i < net->pair_stats_size * net->pair_stats_size; i++)
+	{
+		stats = net->pair_stats_int[i];
+		if (!stats || !stats->msgs)
+			continue;
+
+		src_node = list_get(net->node_list, i / net->pair_stats_size);
+		dst_node = list_get(net->node_list, i % net->pair_stats_size);
+		net_msg_stats_write_row(net->interval_file, "*", src_node->name,
+			dst_node->name, stats);
+		memset(stats, 0, sizeof(struct net_msg_stats_t));
+	}
+	fflush(net->interval_file);
+}
@@ -0,0 +1,75 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NETWORK_MSG_STATS_H
+#define NETWORK_MSG_STATS_H
+
+#include <stdio.h>
+
+
+/*
+ * Latency of delivered messages, per message class and per source and
+ * destination node. The latency of a message is split into:
+ *   - Hop latency: one cycle for every link, bus or crossbar crossed by the
+ *     head of the message.
+ *   - Serialization: extra cycles needed to push the head through each
+ *     resource, plus the cycles the tail arrives after the head.
+ *   - Queueing: the rest, that is, cycles spent waiting for resources.
+ * Histograms have power-of-two buckets: [0, 2), [2, 4), [4, 8) ...
+ */
+
+#define NET_MSG_STATS_HIST_SIZE  16
+
+enum net_msg_lat_t
+{
+	net_msg_lat_total = 0,
+	net_msg_lat_queue,
+	net_msg_lat_serial,
+	net_msg_lat_hop,
+	net_msg_lat_count
+};
+
+struct net_msg_stats_t
+{
+	long long msgs;
+	long long bytes;
+	long long hops;
+	long long lat_acc[net_msg_lat_count];
+	long long hist[net_msg_lat_count][NET_MSG_STATS_HIST_SIZE];
+};
+
+struct net_t;
+struct net_msg_t;
+struct net_msg_frag_t;
+struct net_node_t;
+
+void net_msg_stats_init(struct net_t *net);
+void net_msg_stats_done(struct net_t *net);
+
+void net_msg_stats_hop(struct net_msg_frag_t *frag, int stages, int lat, int hop);
+void net_msg_stats_record(struct net_t *net, struct net_msg_t *msg,
+	struct net_node_t *dst_node);
+
+void net_msg_stats_dump(struct net_t *net, FILE *f);
+
+void net_interval_report_init(struct net_t *net);
+void net_interval_report(struct net_t *net);
+
+
+#endif
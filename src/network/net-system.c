@@ -17,8 +17,6 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
-#include <math.h>
-
 #include <lib/esim/esim.h>
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
@@ -28,9 +26,12 @@
 #include <lib/util/misc.h>
 #include <lib/util/string.h>
 
+#include "fast.h"
 #include "net-system.h"
 #include "network.h"
 #include "node.h"
+#include "router.h"
+#include "traffic.h"
 #include "visual.h"
 
 
@@ -67,6 +68,25 @@ char *net_config_help =
 	"      Default bandwidth for links in the network, specified in number of\n"
 	"      bytes per cycle. If a link's bandwidth is not specified, this value\n"
 	"      will be used.\n"
+	"  Switching = {SAF|VCT|Flit} (Default = SAF)\n"
+	"      Switching technique. With store-and-forward (SAF), messages move\n"
+	"      as a whole between buffers. With virtual cut-through (VCT), they\n"
+	"      are split into fragments of 'DefaultBandwidth' bytes. 'Flit' splits\n"
+	"      messages the same way, and models switches as pipelined routers\n"
+	"      with route computation, virtual channel allocation, switch\n"
+	"      allocation and crossbar traversal stages, and credit-based flow\n"
+	"      control. Buses are not supported with flit switching.\n"
+	"  WarmUpModel = {Detailed|Fast} (Default = Detailed)\n"
+	"      Model used while caches warm up (option '--x86-warm-up'). With 'Fast',\n"
+	"      messages skip buffers and are delivered after the serialization latency\n"
+	"      of each link in their route, plus the time waiting for links used by\n"
+	"      other messages. The detailed model is used after warm-up.\n"
+	"  Threads = <num> (Default = 1)\n"
+	"      Host threads used to simulate the routers with flit switching. Switches\n"
+	"      are split into this many regions of consecutive switches, and end nodes\n"
+	"      join the region of their switch. Flits crossing links between regions\n"
+	"      are exchanged at the end of every cycle, so results do not depend on\n"
+	"      the number of threads.\n"
 	"\n"
 	"Sections '[ Network.<network>.Node.<node> ]' are used to define nodes in\n"
 	"network '<network>'.\n"
@@ -110,7 +130,38 @@ char *net_config_help =
 	"  node_B. Immediate next node that each packet must go through to get \n"
 	"      from node_A to node_C\n"
 	"  Virtual Channel. Is an optional field to choose a virtual channel on \n"
-	"  the link between node_A and node_B. \n" "\n" "\n";
+	"  the link between node_A and node_B. \n"
+	"\n"
+	"Section '[ Network.<network>.Topology ]' can be used instead of node, link\n"
+	"and route sections to generate a network with a regular topology. Each\n"
+	"switch has 'Concentration' end nodes attached, except in fat trees, where\n"
+	"leaf switches have 'Radix' end nodes. Routes are computed when looked up,\n"
+	"with dimension-order routing for meshes, tori and rings, and up/down\n"
+	"routing for fat trees.\n"
+	"\n"
+	"  Type = {Mesh|Torus|Ring|FatTree|Crossbar} (Required)\n"
+	"      Topology. Tori and rings use two virtual channels per link to avoid\n"
+	"      deadlocks in the wrap-around links.\n"
+	"  Width = <switches> (Required for Mesh and Torus)\n"
+	"  Height = <switches> (Default = 1)\n"
+	"      Dimensions of the mesh or torus.\n"
+	"  Nodes = <nodes> (Required for Ring and Crossbar)\n"
+	"      Number of switches of the ring, or of end nodes of the crossbar.\n"
+	"  Concentration = <end nodes> (Default = 1)\n"
+	"      End nodes attached to each switch of a mesh, torus or ring.\n"
+	"  Radix = <ports> (Required for FatTree)\n"
+	"  Levels = <levels> (Required for FatTree)\n"
+	"      The fat tree is a k-ary n-tree with k = 'Radix' and n = 'Levels',\n"
+	"      having k^n end nodes and n * k^(n-1) switches.\n"
+	"  Bandwidth = <bandwidth> (Default = <network>.DefaultBandwidth)\n"
+	"      Bandwidth of the links in bytes per cycle.\n"
+	"  EndNodePrefix = <prefix> (Default = n)\n"
+	"  SwitchPrefix = <prefix> (Default = s)\n"
+	"      End nodes and switches are named with these prefixes followed by\n"
+	"      their number, starting at 0. In meshes and tori, switch 's' is at\n"
+	"      column s % Width and row s / Width, and end nodes\n"
+	"      s * Concentration to (s + 1) * Concentration - 1 hang from it.\n"
+	"\n" "\n";
 
 char *net_err_end_nodes =
 	"\tAn attempt has been made to send a message from/to an intermediate\n"
@@ -188,19 +239,6 @@ int net_frequency = 1000;
 int net_domain_index;
 
 
-/*
- * Private Functions
- */
-
-
-static double exp_random(double lambda)
-{
-	double x = (double) random() / RAND_MAX;
-
-	return log(1 - x) / -lambda;
-}
-
-
 /*
  * Public Functions
  */
@@ -315,6 +353,12 @@ void net_init(void)
 		net_domain_index, "net_input_buffer");
 	EV_NET_RECEIVE = esim_register_event_with_name(net_event_handler,
 		net_domain_index, "net_receive");
+	EV_NET_FAST_RECEIVE = esim_register_event_with_name(net_fast_receive_handler,
+		net_domain_index, "net_fast_receive");
+	EV_NET_ROUTER_TICK = esim_register_event_with_name(net_router_tick_handler,
+		net_domain_index, "net_router_tick");
+	EV_NET_TRAFFIC_RECEIVE = esim_register_event_with_name(net_traffic_receive_handler,
+		net_domain_index, "net_traffic_receive");
 
 	/* Report file */
 	if (*net_report_file_name)
@@ -416,7 +460,6 @@ struct net_t *net_find_next(void)
 void net_sim(char *debug_file_name)
 {
 	struct net_t *net;
-	double *inject_time;	/* Next injection time (one per node) */
 
 	/* Initialize */
 	debug_init();
@@ -431,64 +474,8 @@ void net_sim(char *debug_file_name)
 	if (!net)
 		fatal("%s: network does not exist", net_sim_network_name);
 
-	/* Initialize */
-	inject_time = xcalloc(net->node_count, sizeof(double));
-
-	/* FIXME: error for no dest node in network */
-
-	/* Simulation loop */
-	esim_process_events(TRUE);
-	while (1)
-	{
-		struct net_node_t *node;
-		struct net_node_t *dst_node;
-		long long cycle;
-		int i;
-
-		/* Get current cycle */
-		cycle = esim_domain_cycle(net_domain_index);
-		if (cycle >= net_max_cycles)
-			break;
-
-		/* Inject messages */
-		for (i = 0; i < net->node_count; i++)
-		{
-			/* Get end node */
-			node = list_get(net->node_list, i);
-			if (node->kind != net_node_end)
-				continue;
-
-			/* Turn for next injection? */
-			if (inject_time[i] > cycle)
-				continue;
-
-			/* Get a random destination node */
-			do
-			{
-				dst_node = list_get(net->node_list, random() %
-					list_count(net->node_list));
-			} while (dst_node->kind != net_node_end
-				|| dst_node == node);
-
-			/* Inject */
-			while (inject_time[i] < cycle)
-			{
-				inject_time[i] += exp_random(net_injection_rate);
-				if (net_can_send(net, node, dst_node, net_msg_size))
-					net_send(net, node, dst_node, net_msg_size);
-			}
-		}
-
-		/* Next cycle */
-		net_debug("___ cycle %lld ___\n", cycle);
-		esim_process_events(TRUE);
-	}
-
-	/* Drain events */
-	esim_process_all_events();
-
-	/* Free */
-	free(inject_time);
+	/* Synthetic traffic */
+	net_traffic_run(net);
 
 	/* Finalize */
 	net_done();
@@ -27,15 +27,21 @@
 
 #include "buffer.h"
 #include "bus.h"
+#include "fast.h"
 #include "link.h"
+#include "message.h"
+#include "msg-stats.h"
 #include "net-system.h"
 #include "network.h"
 #include "node.h"
+#include "router.h"
 #include "routing-table.h"
+#include "topology.h"
 #include "visual.h"
 
 
-char *network_switching_map[] = {"SAF", "VCT"};
+char *network_switching_map[] = {"SAF", "VCT", "Flit"};
+char *net_model_map[] = {"Detailed", "Fast"};
 enum network_switching_t network_switching;
 
 
@@ -188,6 +194,9 @@ struct net_t *net_create(char *name)
 	net->node_list = list_create();
 	net->link_list = list_create();
 	net->routing_table = net_routing_table_create(net);
+	net->router_arrival_list = list_create();
+	net->router_credit_list = list_create();
+	net_msg_stats_init(net);
 
 	/* Return */
 	return net;
@@ -220,7 +229,14 @@ struct net_t *net_create_from_config(struct config_t *config, char *name)
 				"DefaultOutputBufferSize", 0);
 		net->def_bandwidth = config_read_int(config, section,
 				"DefaultBandwidth", 0);
-		net->switching = config_read_enum(config, section, "Switching", network_switching_saf, network_switching_map, 2);
+		net->switching = config_read_enum(config, section, "Switching", network_switching_saf, network_switching_map, 3);
+		net->warm_up_model = config_read_enum(config, section, "WarmUpModel", net_model_detailed, net_model_map, 2);
+		net->router_threads = config_read_int(config, section, "Threads", 1);
+		if (net->router_threads < 1)
+			fatal("%s:%s: Threads: invalid value.\n%s",
+					net->name, section, net_err_config);
+		if (net->router_threads > 1 && net->switching != network_switching_flit)
+			warning("%s: 'Threads' only used with flit switching", net->name);
 		if (!net->def_input_buffer_size)
 			fatal("%s:%s: DefaultInputBufferSize: invalid/missing value.\n%s",
 					net->name, section, net_err_config);
@@ -234,6 +250,18 @@ struct net_t *net_create_from_config(struct config_t *config, char *name)
 		def_input_buffer_size = net->def_input_buffer_size;
 	}
 
+	/* Topology */
+	snprintf(section_str, sizeof section_str, "Network.%s.Topology", name);
+	for (section = config_section_first(config); section;
+			section = config_section_next(config))
+	{
+		if (strcasecmp(section, section_str))
+			continue;
+
+		net->routing_table->topology = net_topology_create_from_config(net,
+				config, section);
+	}
+
 	/* Nodes */
 	for (section = config_section_first(config); section;
 			section = config_section_next(config))
@@ -265,6 +293,11 @@ struct net_t *net_create_from_config(struct config_t *config, char *name)
 		if (!token || strcasecmp(token, "Node"))
 			continue;
 
+		/* Topologies generate their own nodes, links and routes */
+		if (net->routing_table->topology)
+			fatal("%s: %s: section not allowed in a network with a topology.\n%s",
+					net->name, section, net_err_config);
+
 		/* Get name */
 		node_name = strtok(NULL, delim);
 		token = strtok(NULL, delim);
@@ -350,6 +383,11 @@ struct net_t *net_create_from_config(struct config_t *config, char *name)
 		if (!token || strcasecmp(token, "Link"))
 			continue;
 
+		/* Topologies generate their own nodes, links and routes */
+		if (net->routing_table->topology)
+			fatal("%s: %s: section not allowed in a network with a topology.\n%s",
+					net->name, section, net_err_config);
+
 		/* Fourth token must name of the link */
 		link_name = strtok(NULL, delim);
 		token = strtok(NULL, delim);
@@ -453,8 +491,10 @@ struct net_t *net_create_from_config(struct config_t *config, char *name)
 		}
 	}
 
-	/* initializing the routing table */
-	net_routing_table_initiate(net->routing_table);
+	/* initializing the routing table. Routes of topologies are computed
+	 * on lookup. */
+	if (!net->routing_table->topology)
+		net_routing_table_initiate(net->routing_table);
 
 	/* Routes */
 	for (section = config_section_first(config); section;
@@ -481,6 +521,11 @@ struct net_t *net_create_from_config(struct config_t *config, char *name)
 		if (!token || strcasecmp(token, "Routes"))
 			continue;
 
+		/* Topologies generate their own nodes, links and routes */
+		if (net->routing_table->topology)
+			fatal("%s: %s: section not allowed in a network with a topology.\n%s",
+					net->name, section, net_err_config);
+
 		token_endl = strtok(NULL, delim);
 		if (token_endl)
 			fatal("%s: %s: bad format for route.\n%s",
@@ -493,7 +538,7 @@ struct net_t *net_create_from_config(struct config_t *config, char *name)
 
 	/* If there is no route section, Floyd-Warshall calculates the
 	 * shortest path for all the nodes in the network */
-	if (routing_type == 0)
+	if (routing_type == 0 && !net->routing_table->topology)
 		net_routing_table_floyd_warshall(net->routing_table);
 
 	/* Return */
@@ -531,6 +576,14 @@ void net_free(struct net_t *net)
 		}
 	}
 
+	/* Flit switching */
+	net_router_done(net);
+	list_free(net->router_arrival_list);
+	list_free(net->router_credit_list);
+
+	/* Message stats */
+	net_msg_stats_done(net);
+
 	/* Network */
 	free(net->name);
 	free(net);
@@ -569,6 +622,9 @@ void net_dump_report(struct net_t *net, FILE *f)
 			(double) net->lat_acc / net->transfers : 0.0);
 	fprintf(f, "\n");
 
+	/* Message classes */
+	net_msg_stats_dump(net, f);
+
 	/* Links */
 	for (i = 0; i < list_count(net->link_list); i++)
 	{
@@ -588,6 +644,23 @@ void net_dump_report(struct net_t *net, FILE *f)
 	}
 }
 
+
+/* Select the model used while caches warm up, or go back to the detailed
+ * model. Messages in flight finish with the model they were sent with: the
+ * fast model does not use buffers, and detailed messages keep their events. */
+void net_set_warm_up(struct net_t *net, int warm_up)
+{
+	net->model = warm_up ? net->warm_up_model : net_model_detailed;
+	net_debug("%lld: NET -> "
+			"a=\"model\" "
+			"net=\"%s\" "
+			"model=\"%s\"\n",
+			esim_domain_cycle(net_domain_index),
+			net->name,
+			net_model_map[net->model]);
+}
+
+
 void net_dump_visual(struct net_graph_t *graph, FILE *f)
 {
 	int i;
@@ -1062,14 +1135,27 @@ struct net_msg_t *net_send_ev(struct net_t *net, struct net_node_t *src_node,
 
 	/* Insert message into hash table of in-flight messages */
 	net_msg_table_insert(net, msg);
+	msg->ret_event = receive_event;
+	msg->ret_stack = receive_stack;
+
+	/* The fast model computes the latency once */
+	if (net->model == net_model_fast)
+	{
+		net_fast_send(net, msg);
+		return msg;
+	}
+
+	/* Flit switching steps all routers every cycle */
+	if (net->switching == network_switching_flit)
+	{
+		net_router_send(net, msg);
+		return msg;
+	}
 
 	/* Start event-driven simulation */
 	stack = net_stack_create(net, ESIM_EV_NONE, NULL);
 	stack->msg = msg;
 	stack->frag = list_get(msg->fragments, 0);
-
-	msg->ret_event = receive_event;
-	msg->ret_stack = receive_stack;
 	esim_execute_event(EV_NET_SEND, stack);
 
 	/* Return created message */
@@ -1128,6 +1214,8 @@ void net_receive_frag(struct net_t *net, struct net_node_t *node, struct net_msg
 
 	/* Mark this fragment as arrived */
 	frag->arrived = true;
+	if (!frag->parent->arrived_frags_count)
+		frag->parent->cycle_head_arrived = esim_domain_cycle(net_domain_index);
 	frag->parent->arrived_frags_count++;
 }
 
@@ -1142,7 +1230,14 @@ void net_receive_msg(struct net_t *net, struct net_node_t *node, struct net_msg_
 	{
 		frag = list_get(msg->fragments, i);
 		buffer = frag->buffer;
+
+		/* Messages sent with the fast model are in no buffer */
+		if (!buffer)
+			continue;
+
 		net_buffer_extract(buffer, frag);
+		if (net->switching == network_switching_flit)
+			net_router_return_credit(buffer, frag->size);
 	}
 
 	net_msg_table_extract(net, msg->id);
@@ -34,9 +34,18 @@ extern char *network_switching_map[];
 extern enum network_switching_t
 {
 	network_switching_saf = 0,
-	network_switching_vct
+	network_switching_vct,
+	network_switching_flit
 } network_switching;
 
+/* Network model. The fast model can be used while caches warm up. */
+extern char *net_model_map[];
+enum net_model_t
+{
+	net_model_detailed = 0,
+	net_model_fast
+};
+
 /* Stack */
 struct net_stack_t
 {
@@ -66,6 +75,8 @@ struct net_t
 	/* Properties */
 	char *name;
 	enum network_switching_t switching;
+	enum net_model_t model;		/* Model for new messages */
+	enum net_model_t warm_up_model;	/* Model during warm-up */
 	int def_output_buffer_size;
 	int def_input_buffer_size;
 	int def_bandwidth;
@@ -84,10 +95,29 @@ struct net_t
 	/* Hash table of in-flight messages. Each entry is a bucket list */
 	struct net_msg_t *msg_table[NET_MSG_TABLE_SIZE];
 
+	/* Flit switching */
+	int router_ready;		/* Credits initialized */
+	int router_tick_pending;	/* Tick event scheduled */
+	long long router_flits;		/* Flits not delivered yet */
+	struct list_t *router_arrival_list;	/* Flits on their last link */
+	struct list_t *router_credit_list;	/* Output buffers with returned credits */
+	int router_threads;		/* Host threads requested */
+	int router_parallel;		/* Regions being stepped concurrently */
+	int router_region_count;
+	struct net_router_region_t **router_regions;
+	struct net_router_pool_t *router_pool;	/* Worker threads */
+
 	/* Stats */
 	long long transfers;	/* Transfers */
 	long long lat_acc;	/* Accumulated latency */
 	long long msg_size_acc;	/* Accumulated message size */
+
+	/* Message stats, see 'msg-stats.h' */
+	struct net_msg_stats_t *class_stats;		/* Per message class */
+	struct net_msg_stats_t *class_stats_int;	/* Same, current interval */
+	struct net_msg_stats_t **pair_stats_int;	/* Per source/destination, current interval */
+	int pair_stats_size;				/* Nodes in 'pair_stats_int' */
+	FILE *interval_file;
 };
 
 
@@ -100,6 +130,8 @@ void net_dump(struct net_t *net, FILE *f);
 
 void net_dump_report(struct net_t *net, FILE *f);
 
+void net_set_warm_up(struct net_t *net, int warm_up);
+
 struct net_node_t *net_add_end_node(struct net_t *net,
 	int input_buffer_size, int output_buffer_size,
 	char *name, void *user_data);
@@ -145,7 +145,7 @@ void net_node_dump_report(struct net_node_t *node, FILE *f)
 		fprintf(f, "ReceiveRate = %.4f\n", cycle ?
 			(double) node->bytes_received / cycle : 0.0);
 
-		if (net->switching == network_switching_vct)
+		if (net->switching != network_switching_saf)
 		{
 			fprintf(f, "SentFragments = %lld\n", node->frags_sent);
 			fprintf(f, "ReceivedFragments = %lld\n", node->frags_received);
@@ -39,6 +39,7 @@ struct net_node_t
 	struct net_t *net;
 	enum net_node_kind_t kind;
 	int index;		/* Used to index routing table */
+	int region;		/* Router region, for flit switching */
 	char *name;
 	void *user_data;
 
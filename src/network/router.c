@@ -0,0 +1,859 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <lib/esim/esim.h>
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/debug.h>
+#include <lib/util/linked-list.h>
+#include <lib/util/list.h>
+#include <lib/util/misc.h>
+
+#include "buffer.h"
+#include "link.h"
+#include "message.h"
+#include "msg-stats.h"
+#include "net-system.h"
+#include "network.h"
+#include "node.h"
+#include "router.h"
+#include "routing-table.h"
+
+
+int EV_NET_ROUTER_TICK;
+
+
+/* Iterations a worker thread busy-waits for the next cycle before going to
+ * sleep. */
+#define NET_ROUTER_SPINS  4096
+
+
+/* Routers simulated by one host thread. Nodes of a region are stepped in
+ * increasing index order, like in a sequential simulation. Flits crossing a
+ * boundary link into another region are not inserted downstream until the
+ * end of the cycle, which is safe because a flit cannot be switched in the
+ * cycle it enters a buffer. */
+struct net_router_region_t
+{
+	struct net_t *net;
+	int index;
+	pthread_t thread;
+
+	struct list_t *node_list;	/* Nodes in the region */
+	struct list_t *transfer_list;	/* Flits on outgoing boundary links */
+	struct list_t *arrival_list;	/* Flits on their last link */
+	struct list_t *credit_list;	/* Output buffers with returned credits */
+	struct list_t *wakeup_list;	/* Output buffers to wake up */
+};
+
+
+/* Worker threads, one per region except the first one, which is simulated
+ * by the main thread. */
+struct net_router_pool_t
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+
+	long long generation;	/* Incremented to start a cycle */
+	long long cycle;	/* Cycle to simulate */
+	int pending;		/* Workers still in the cycle */
+	int stopping;		/* Workers must exit */
+};
+
+
+/*
+ * Private Functions
+ */
+
+/* Virtual channels of a link are consecutive buffers in the source and
+ * destination nodes, listed in 'link->src_buffers' and 'link->dst_buffers'. */
+
+static struct net_buffer_t *net_router_downstream(struct net_buffer_t *output_buffer)
+{
+	struct net_link_t *link = output_buffer->link;
+	int vc;
+
+	vc = output_buffer->index - link->src_buffers[0]->index;
+	assert(vc >= 0 && vc < link->virtual_channel);
+	return link->dst_buffers[vc];
+}
+
+
+static struct net_buffer_t *net_router_upstream(struct net_buffer_t *input_buffer)
+{
+	struct net_link_t *link = input_buffer->link;
+	int vc;
+
+	vc = input_buffer->index - link->dst_buffers[0]->index;
+	assert(vc >= 0 && vc < link->virtual_channel);
+	return link->src_buffers[vc];
+}
+
+
+/* Split the switches into 'Threads' regions of consecutive switches. With
+ * the usual row-major numbering of meshes and tori, regions are bands of
+ * rows. End nodes join the region of the switch they are attached to. */
+static void net_router_partition(struct net_t *net)
+{
+	struct net_router_region_t *region;
+	struct net_node_t *node;
+	struct net_buffer_t *buffer;
+
+	int switch_count;
+	int threads;
+	int cores;
+	int i;
+	int j;
+
+	/* Number of regions */
+	switch_count = 0;
+	LIST_FOR_EACH(net->node_list, i)
+	{
+		node = list_get(net->node_list, i);
+		switch_count += node->kind == net_node_switch;
+	}
+	threads = MAX(1, MIN(net->router_threads, switch_count));
+	cores = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads > 1 && cores > 0 && threads > cores)
+	{
+		warning("%s: only %d host cores available, using %d threads",
+			net->name, cores, cores);
+		threads = cores;
+	}
+	if (threads > 1 && debug_status(net_debug_category))
+	{
+		warning("%s: network debug enabled, routers will be simulated sequentially",
+			net->name);
+		threads = 1;
+	}
+#ifdef MHANDLE
+	if (threads > 1)
+	{
+		warning("%s: memory debugging is not thread-safe, routers will be "
+			"simulated sequentially", net->name);
+		threads = 1;
+	}
+#endif
+
+	/* Create regions */
+	net->router_region_count = threads;
+	net->router_regions = xcalloc(threads, sizeof(struct net_router_region_t *));
+	for (i = 0; i < threads; i++)
+	{
+		region = xcalloc(1, sizeof(struct net_router_region_t));
+		region->net = net;
+		region->index = i;
+		region->node_list = list_create();
+		region->transfer_list = list_create();
+		region->arrival_list = list_create();
+		region->credit_list = list_create();
+		region->wakeup_list = list_create();
+		net->router_regions[i] = region;
+	}
+
+	/* Assign switches */
+	j = 0;
+	LIST_FOR_EACH(net->node_list, i)
+	{
+		node = list_get(net->node_list, i);
+		if (node->kind != net_node_switch)
+			continue;
+		node->region = j * threads / switch_count;
+		j++;
+	}
+
+	/* Assign end nodes */
+	LIST_FOR_EACH(net->node_list, i)
+	{
+		node = list_get(net->node_list, i);
+		if (node->kind != net_node_end)
+			continue;
+		buffer = list_get(node->output_buffer_list, 0);
+		node->region = buffer && buffer->link->dst_node->kind == net_node_switch ?
+			buffer->link->dst_node->region : 0;
+	}
+
+	/* Node lists */
+	LIST_FOR_EACH(net->node_list, i)
+	{
+		node = list_get(net->node_list, i);
+		region = net->router_regions[node->region];
+		list_add(region->node_list, node);
+		net_debug("%s: node %s in region %d\n", net->name,
+			node->name, node->region);
+	}
+}
+
+
+static void net_router_region_free(struct net_router_region_t *region)
+{
+	list_free(region->node_list);
+	list_free(region->transfer_list);
+	list_free(region->arrival_list);
+	list_free(region->credit_list);
+	list_free(region->wakeup_list);
+	free(region);
+}
+
+
+/* Give every output buffer the credits of its downstream input buffer */
+static void net_router_init(struct net_t *net)
+{
+	struct net_node_t *node;
+	struct net_buffer_t *buffer;
+	struct net_buffer_t *input_buffer;
+
+	int i;
+	int j;
+
+	LIST_FOR_EACH(net->node_list, i)
+	{
+		node = list_get(net->node_list, i);
+		if (node->kind == net_node_bus)
+			fatal("%s: %s: buses are not supported with flit switching.\n%s",
+				net->name, node->name, net_err_config);
+
+		LIST_FOR_EACH(node->output_buffer_list, j)
+		{
+			buffer = list_get(node->output_buffer_list, j);
+			input_buffer = net_router_downstream(buffer);
+			if (input_buffer->size < net->def_bandwidth)
+				fatal("%s: %s: input buffer smaller than a flit.\n%s",
+					net->name, input_buffer->name, net_err_config);
+			buffer->credits = input_buffer->size;
+		}
+	}
+	net->router_ready = 1;
+}
+
+
+static void net_router_schedule(struct net_t *net)
+{
+	if (net->router_tick_pending)
+		return;
+	net->router_tick_pending = 1;
+	esim_schedule_event(EV_NET_ROUTER_TICK, net, 1);
+}
+
+
+static int net_router_is_tail(struct net_msg_frag_t *frag)
+{
+	return frag->id == list_count(frag->parent->fragments) - 1;
+}
+
+
+/* Add 'size' bytes to the credits given back by 'input_buffer' to its
+ * upstream output buffer, applied in the next cycle. */
+static void net_router_credit(struct list_t *credit_list,
+	struct net_buffer_t *input_buffer, int size)
+{
+	struct net_buffer_t *output_buffer;
+
+	output_buffer = net_router_upstream(input_buffer);
+	if (!output_buffer->credits_returned)
+		list_add(credit_list, output_buffer);
+	output_buffer->credits_returned += size;
+}
+
+
+static void net_router_apply_credits(struct list_t *credit_list)
+{
+	struct net_buffer_t *buffer;
+
+	while ((buffer = list_dequeue(credit_list)))
+	{
+		buffer->credits += buffer->credits_returned;
+		buffer->credits_returned = 0;
+	}
+}
+
+
+/* Flit 'frag' enters the input buffer it was sent to */
+static void net_router_receive(struct net_msg_frag_t *frag)
+{
+	struct net_buffer_t *input_buffer = frag->buffer;
+	struct net_node_t *node = input_buffer->node;
+
+	net_buffer_insert(input_buffer, frag);
+	node->bytes_received += frag->size;
+	node->frags_received++;
+	if (net_router_is_tail(frag))
+		node->msgs_received++;
+}
+
+
+/* Switch traversal and link traversal of flit 'frag', from 'buffer' to the
+ * input buffer fed by 'output_buffer'. For end nodes, both buffers are the
+ * same. */
+static void net_router_traverse(struct net_router_region_t *region,
+	struct net_buffer_t *buffer, struct net_buffer_t *output_buffer,
+	struct net_msg_frag_t *frag, long long cycle)
+{
+	struct net_t *net = buffer->net;
+	struct net_link_t *link = output_buffer->link;
+	struct net_node_t *node = buffer->node;
+	struct net_buffer_t *input_buffer;
+	int lat;
+
+	/* Leave current buffer. Events waiting for space in the output buffer
+	 * of an end node are woken up at the end of the cycle when regions run
+	 * concurrently. */
+	net_buffer_extract(buffer, frag);
+	if (buffer != output_buffer)
+		net_router_credit(region->credit_list, buffer, frag->size);
+	else if (net->router_parallel && linked_list_count(buffer->wakeup_list))
+		list_add(region->wakeup_list, buffer);
+
+	/* Messages wait whole in the input buffer of their destination until
+	 * received, so they must fit there */
+	input_buffer = net_router_downstream(output_buffer);
+	if (input_buffer->node == frag->dst_node && frag->parent->size > input_buffer->size)
+		fatal("%s: message does not fit in buffer.\n%s", net->name, net_err_large_message);
+
+	/* Occupy link and downstream credits */
+	lat = (frag->size - 1) / link->bandwidth + 1;
+	assert(output_buffer->credits >= frag->size);
+	output_buffer->credits -= frag->size;
+	link->busy = cycle + lat - 1;
+
+	/* Transfer flit, or leave it on the boundary link */
+	frag->node = input_buffer->node;
+	frag->buffer = input_buffer;
+	frag->busy = cycle + lat - 1;
+	if (input_buffer->node->region == node->region)
+		net_router_receive(frag);
+	else
+		list_add(region->transfer_list, frag);
+
+	/* Stats. The head flit spent the RC, VA and SA/ST stages in a switch,
+	 * or waited one cycle for injection in an end node. */
+	net_msg_stats_hop(frag, buffer == output_buffer ? 2 : 3, lat, 1);
+	link->busy_cycles += lat;
+	link->transferred_bytes += frag->size;
+	link->transferred_frags++;
+	node->bytes_sent += frag->size;
+	node->frags_sent++;
+	if (net_router_is_tail(frag))
+	{
+		link->transferred_msgs++;
+		node->msgs_sent++;
+	}
+
+	/* Debug */
+	net_debug("%lld: MSG -> "
+			"a=\"flit\" "
+			"net=\"%s\" "
+			"msg=%lld "
+			"frag=%lld "
+			"link=\"%s\" "
+			"buf=\"%s\"\n",
+			cycle,
+			net->name,
+			frag->parent->id,
+			frag->id,
+			link->name,
+			input_buffer->name);
+
+	/* Flits are delivered when they are off the last link */
+	if (frag->node == frag->dst_node)
+		list_add(region->arrival_list, frag);
+}
+
+
+/* End nodes inject the flits of their output buffers, one per link and
+ * cycle, alternating virtual channels. */
+static void net_router_inject(struct net_router_region_t *region,
+	struct net_node_t *node, long long cycle)
+{
+	struct net_buffer_t *buffer;
+	struct net_msg_frag_t *frag;
+
+	int count;
+	int i;
+
+	count = list_count(node->output_buffer_list);
+	for (i = 0; i < count; i++)
+	{
+		buffer = list_get(node->output_buffer_list, (cycle + i) % count);
+		frag = list_head(buffer->frag_list);
+		if (!frag || frag->busy >= cycle)
+			continue;
+		if (buffer->link->busy >= cycle || buffer->credits < frag->size)
+			continue;
+		net_router_traverse(region, buffer, buffer, frag, cycle);
+	}
+}
+
+
+/* One cycle of a switch. Stages are evaluated in pipeline order, and a
+ * virtual channel advances at most one stage per cycle. Input VCs are
+ * visited with a rotating priority, which makes both allocators round-robin. */
+static void net_router_switch(struct net_router_region_t *region,
+	struct net_node_t *node, long long cycle)
+{
+	struct net_t *net = node->net;
+	struct net_routing_table_entry_t *entry;
+	struct net_buffer_t *buffer;
+	struct net_buffer_t *output_buffer;
+	struct net_msg_frag_t *frag;
+
+	int count;
+	int i;
+
+	count = list_count(node->input_buffer_list);
+	for (i = 0; i < count; i++)
+	{
+		buffer = list_get(node->input_buffer_list, (cycle + i) % count);
+		frag = list_head(buffer->frag_list);
+		if (!frag || frag->busy >= cycle)
+			continue;
+
+		switch (buffer->vc_state)
+		{
+
+		case net_buffer_vc_idle:
+
+			/* RC */
+			assert(frag->id == 0);
+			entry = net_routing_table_lookup(net->routing_table,
+					node, frag->dst_node);
+			if (!entry->output_buffer)
+				fatal("%s: no route from %s to %s.\n%s", net->name,
+					node->name, frag->dst_node->name,
+					net_err_no_route);
+			buffer->vc_output = entry->output_buffer;
+			buffer->vc_state = net_buffer_vc_routed;
+			buffer->vc_when = cycle;
+			break;
+
+		case net_buffer_vc_routed:
+
+			/* VA */
+			output_buffer = buffer->vc_output;
+			if (output_buffer->vc_owner)
+				break;
+			output_buffer->vc_owner = buffer;
+			buffer->vc_state = net_buffer_vc_active;
+			buffer->vc_when = cycle;
+			break;
+
+		case net_buffer_vc_active:
+
+			/* SA. The 'sched_when' field of the input link marks its
+			 * crossbar input as used in this cycle. */
+			output_buffer = buffer->vc_output;
+			if (buffer->vc_when == cycle)
+				break;
+			if (buffer->link->sched_when == cycle)
+				break;
+			if (output_buffer->link->busy >= cycle)
+				break;
+			if (output_buffer->credits < frag->size)
+				break;
+			buffer->link->sched_when = cycle;
+
+			/* ST, releasing the output VC after the tail flit */
+			net_router_traverse(region, buffer, output_buffer, frag, cycle);
+			if (net_router_is_tail(frag))
+			{
+				output_buffer->vc_owner = NULL;
+				buffer->vc_state = net_buffer_vc_idle;
+				buffer->vc_output = NULL;
+			}
+			break;
+		}
+	}
+}
+
+
+/* One cycle of the routers of a region */
+static void net_router_region_step(struct net_router_region_t *region, long long cycle)
+{
+	struct net_node_t *node;
+	int i;
+
+	LIST_FOR_EACH(region->node_list, i)
+	{
+		node = list_get(region->node_list, i);
+		if (node->kind == net_node_end)
+			net_router_inject(region, node, cycle);
+		else if (node->kind == net_node_switch)
+			net_router_switch(region, node, cycle);
+	}
+}
+
+
+static void *net_router_worker(void *data)
+{
+	struct net_router_region_t *region = data;
+	struct net_router_pool_t *pool = region->net->router_pool;
+
+	long long generation = 0;
+	int spins;
+
+	for (;;)
+	{
+		/* Wait for next cycle, spinning for a while first, since cycles
+		 * with flits in flight usually come one after another. */
+		spins = 0;
+		while (__atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE) == generation)
+		{
+			if (++spins < NET_ROUTER_SPINS)
+				continue;
+
+			pthread_mutex_lock(&pool->mutex);
+			while (__atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE) == generation)
+				pthread_cond_wait(&pool->cond, &pool->mutex);
+			pthread_mutex_unlock(&pool->mutex);
+		}
+		generation++;
+
+		if (__atomic_load_n(&pool->stopping, __ATOMIC_ACQUIRE))
+			return NULL;
+
+		net_router_region_step(region, pool->cycle);
+		__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_RELEASE);
+	}
+}
+
+
+static void net_router_start_workers(struct net_t *net)
+{
+	struct net_router_pool_t *pool;
+	int i;
+
+	pool = xcalloc(1, sizeof(struct net_router_pool_t));
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+	net->router_pool = pool;
+
+	for (i = 1; i < net->router_region_count; i++)
+		if (pthread_create(&net->router_regions[i]->thread, NULL,
+				net_router_worker, net->router_regions[i]))
+			fatal("%s: cannot create router thread", net->name);
+}
+
+
+static void net_router_release_workers(struct net_t *net)
+{
+	struct net_router_pool_t *pool = net->router_pool;
+
+	pthread_mutex_lock(&pool->mutex);
+	__atomic_add_fetch(&pool->generation, 1, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+
+/* Simulate all regions concurrently. The main thread takes the first one. */
+static void net_router_step_parallel(struct net_t *net, long long cycle)
+{
+	struct net_router_pool_t *pool = net->router_pool;
+	int spins;
+
+	net->router_parallel = 1;
+	pool->cycle = cycle;
+	__atomic_store_n(&pool->pending, net->router_region_count - 1, __ATOMIC_RELAXED);
+	net_router_release_workers(net);
+
+	net_router_region_step(net->router_regions[0], cycle);
+
+	/* Regions are stepped in about the same time, so busy-wait */
+	spins = 0;
+	while (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE))
+		if (++spins > NET_ROUTER_SPINS)
+			sched_yield();
+	net->router_parallel = 0;
+}
+
+
+static int net_router_arrival_key(void *elem)
+{
+	struct net_msg_frag_t *frag = elem;
+	return frag->buffer->link->src_node->index;
+}
+
+
+static int net_router_wakeup_key(void *elem)
+{
+	struct net_buffer_t *buffer = elem;
+	return buffer->node->index;
+}
+
+
+/* Move the elements of the list given by 'get_list' for every region to the end of 'list',
+ * in the order a sequential simulation would have added them. Each region
+ * list is already sorted by the index of the node that added the element,
+ * given by 'key'. */
+static void net_router_merge(struct net_t *net, struct list_t *list,
+	struct list_t *(*get_list)(struct net_router_region_t *),
+	int (*key)(void *))
+{
+	struct list_t *region_list;
+	struct list_t *min_list;
+
+	int min_key;
+	int i;
+
+	for (;;)
+	{
+		min_list = NULL;
+		min_key = 0;
+		for (i = 0; i < net->router_region_count; i++)
+		{
+			region_list = get_list(net->router_regions[i]);
+			if (!list_count(region_list))
+				continue;
+			if (!min_list || key(list_head(region_list)) < min_key)
+			{
+				min_list = region_list;
+				min_key = key(list_head(region_list));
+			}
+		}
+		if (!min_list)
+			break;
+		list_add(list, list_dequeue(min_list));
+	}
+}
+
+
+static struct list_t *net_router_region_arrivals(struct net_router_region_t *region)
+{
+	return region->arrival_list;
+}
+
+
+static struct list_t *net_router_region_wakeups(struct net_router_region_t *region)
+{
+	return region->wakeup_list;
+}
+
+
+/* End of a cycle. Flits on boundary links enter their buffers, and the
+ * results of all regions are put together. */
+static void net_router_commit(struct net_t *net)
+{
+	struct net_router_region_t *region;
+	struct net_msg_frag_t *frag;
+	struct net_buffer_t *buffer;
+	struct list_t *wakeup_list;
+
+	int i;
+
+	/* Boundary links */
+	for (i = 0; i < net->router_region_count; i++)
+	{
+		region = net->router_regions[i];
+		while ((frag = list_dequeue(region->transfer_list)))
+			net_router_receive(frag);
+	}
+
+	/* Arrivals */
+	net_router_merge(net, net->router_arrival_list,
+		net_router_region_arrivals, net_router_arrival_key);
+
+	/* Deferred wakeups */
+	wakeup_list = list_create();
+	net_router_merge(net, wakeup_list, net_router_region_wakeups,
+		net_router_wakeup_key);
+	while ((buffer = list_dequeue(wakeup_list)))
+		net_buffer_wakeup(buffer);
+	list_free(wakeup_list);
+}
+
+
+/* Deliver flits that finished their last link. When the whole message is
+ * there, the receive event is scheduled. Messages sent without one are
+ * removed from the network. */
+static void net_router_deliver(struct net_t *net, long long cycle)
+{
+	struct net_msg_frag_t *frag;
+	struct net_msg_t *msg;
+	struct net_node_t *node;
+
+	int i;
+
+	i = 0;
+	while (i < list_count(net->router_arrival_list))
+	{
+		frag = list_get(net->router_arrival_list, i);
+		if (frag->busy >= cycle)
+		{
+			i++;
+			continue;
+		}
+		list_remove_at(net->router_arrival_list, i);
+		net->router_flits--;
+
+		/* Receive flit */
+		msg = frag->parent;
+		node = frag->node;
+		net_receive_frag(net, node, frag);
+		if (msg->arrived_frags_count < list_count(msg->fragments))
+			continue;
+
+		/* Stats */
+		net_msg_stats_record(net, msg, node);
+
+		net_debug("%lld: MSG -> "
+				"a=\"finish\" "
+				"net=\"%s\" "
+				"msg=%lld "
+				"lat=%lld "
+				"node=\"%s\"\n",
+				cycle,
+				net->name,
+				msg->id,
+				cycle - msg->cycle_sent,
+				node->name);
+
+		/* Return */
+		if (msg->ret_event == ESIM_EV_NONE)
+			net_receive_msg(net, node, msg);
+		else
+			esim_schedule_event(msg->ret_event, msg->ret_stack, 0);
+	}
+}
+
+
+/*
+ * Public Functions
+ */
+
+void net_router_tick_handler(int event, void *data)
+{
+	struct net_t *net = data;
+
+	long long cycle;
+	int i;
+
+	/* Get current cycle */
+	cycle = esim_domain_cycle(net_domain_index);
+	net->router_tick_pending = 0;
+
+	/* Credits returned in the previous cycle */
+	net_router_apply_credits(net->router_credit_list);
+	for (i = 0; i < net->router_region_count; i++)
+		net_router_apply_credits(net->router_regions[i]->credit_list);
+
+	/* Flits off their last link */
+	net_router_deliver(net, cycle);
+
+	/* Routers */
+	if (net->router_region_count > 1)
+		net_router_step_parallel(net, cycle);
+	else
+		net_router_region_step(net->router_regions[0], cycle);
+	net_router_commit(net);
+
+	/* Keep ticking while flits are in flight */
+	if (net->router_flits)
+		net_router_schedule(net);
+}
+
+
+/* Inject all flits of a message into the output buffer of its source node.
+ * The caller has checked 'net_can_send' before. */
+void net_router_send(struct net_t *net, struct net_msg_t *msg)
+{
+	struct net_routing_table_entry_t *entry;
+	struct net_buffer_t *output_buffer;
+	struct net_msg_frag_t *frag;
+	struct net_node_t *src_node;
+	struct net_node_t *dst_node;
+
+	long long cycle;
+	int i;
+
+	/* Get current cycle */
+	cycle = esim_domain_cycle(net_domain_index);
+
+	/* Credits and regions are set the first time, once all links exist */
+	if (!net->router_ready)
+	{
+		net_router_init(net);
+		net_router_partition(net);
+		if (net->router_region_count > 1)
+			net_router_start_workers(net);
+	}
+
+	/* Get output buffer */
+	frag = list_get(msg->fragments, 0);
+	src_node = frag->src_node;
+	dst_node = frag->dst_node;
+	entry = net_routing_table_lookup(net->routing_table, src_node, dst_node);
+	output_buffer = entry->output_buffer;
+	if (!output_buffer)
+		fatal("%s: no route from %s to %s.\n%s", net->name,
+			src_node->name, dst_node->name, net_err_no_route);
+	if (output_buffer->write_busy >= cycle)
+		panic("%s: output buffer busy.\n%s", __FUNCTION__, net_err_can_send);
+	if (output_buffer->count + msg->size > output_buffer->size)
+		panic("%s: output buffer full.\n%s", __FUNCTION__, net_err_can_send);
+
+	/* Insert flits */
+	LIST_FOR_EACH(msg->fragments, i)
+	{
+		frag = list_get(msg->fragments, i);
+		net_buffer_insert(output_buffer, frag);
+		frag->node = src_node;
+		frag->buffer = output_buffer;
+		frag->busy = cycle;
+	}
+	output_buffer->write_busy = cycle;
+	msg->cycle_sent = cycle;
+
+	/* Start ticking */
+	net->router_flits += list_count(msg->fragments);
+	net_router_schedule(net);
+}
+
+
+/* A flit left 'input_buffer'. Its space is given back to the upstream output
+ * buffer in the next cycle. */
+void net_router_return_credit(struct net_buffer_t *input_buffer, int size)
+{
+	net_router_credit(input_buffer->net->router_credit_list, input_buffer, size);
+}
+
+
+/* Stop worker threads and free regions */
+void net_router_done(struct net_t *net)
+{
+	struct net_router_pool_t *pool = net->router_pool;
+	int i;
+
+	if (pool)
+	{
+		__atomic_store_n(&pool->stopping, 1, __ATOMIC_RELEASE);
+		net_router_release_workers(net);
+		for (i = 1; i < net->router_region_count; i++)
+			pthread_join(net->router_regions[i]->thread, NULL);
+		pthread_mutex_destroy(&pool->mutex);
+		pthread_cond_destroy(&pool->cond);
+		free(pool);
+	}
+
+	for (i = 0; i < net->router_region_count; i++)
+		net_router_region_free(net->router_regions[i]);
+	free(net->router_regions);
+}
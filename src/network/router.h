@@ -0,0 +1,59 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NETWORK_ROUTER_H
+#define NETWORK_ROUTER_H
+
+
+/*
+ * Pipelined virtual-channel routers, used with flit switching. Messages are
+ * split into flits of 'DefaultBandwidth' bytes. Every input buffer of a
+ * switch is one virtual channel of an input port, and each output buffer
+ * keeps the credits of the input buffer it feeds downstream. All routers of
+ * a network are stepped by a single event per cycle while flits are in
+ * flight, with the stages:
+ *
+ *   RC - route computation for the head flit of a message.
+ *   VA - allocation of the output virtual channel given by the route. The
+ *        channel is held until the tail flit leaves.
+ *   SA - switch allocation, one flit per input and output port per cycle,
+ *        only if the output virtual channel has credits for it.
+ *   ST - crossbar and link traversal into the downstream input buffer.
+ *
+ * With 'Threads' greater than 1, switches are partitioned into regions,
+ * stepped concurrently by host threads. A flit never moves in the cycle it
+ * entered a buffer, so the links between regions give a lookahead of one
+ * cycle: flits crossing them are inserted downstream at the end of the
+ * cycle, and the outcome is the same as that of a sequential simulation.
+ */
+
+extern int EV_NET_ROUTER_TICK;
+
+struct net_t;
+struct net_msg_t;
+struct net_buffer_t;
+
+void net_router_tick_handler(int event, void *data);
+
+void net_router_send(struct net_t *net, struct net_msg_t *msg);
+void net_router_return_credit(struct net_buffer_t *input_buffer, int size);
+void net_router_done(struct net_t *net);
+
+
+#endif
@@ -30,6 +30,7 @@
 #include "network.h"
 #include "node.h"
 #include "routing-table.h"
+#include "topology.h"
 
 
 /* 
@@ -209,6 +210,8 @@ void net_routing_table_free(struct net_routing_table_t *routing_table)
 {
 	if (routing_table->entries)
 		free(routing_table->entries);
+	if (routing_table->topology)
+		net_topology_free(routing_table->topology);
 	free(routing_table);
 }
 
@@ -560,6 +563,9 @@ struct net_routing_table_entry_t *net_routing_table_lookup(struct
 {
 	struct net_routing_table_entry_t *entry;
 
+	if (routing_table->topology)
+		return net_topology_lookup(routing_table->topology, src_node, dst_node);
+
 	assert(src_node->index < routing_table->dim);
 	assert(dst_node->index < routing_table->dim);
 	assert(routing_table->dim > 0);
@@ -616,11 +622,7 @@ void net_routing_table_route_update(struct net_routing_table_t *routing_table,
 							routing_table->net->name, src_node->name,
 							dst_node->name, net_err_config);
 
-					struct net_buffer_t *vc_buffer;
-
-					vc_buffer = list_get(src_node->output_buffer_list, (buffer->index)+vc_num);
-					assert(vc_buffer->link == buffer->link);
-					entry->output_buffer = vc_buffer;
+					entry->output_buffer = link->src_buffers[vc_num];
 					route_check = 1;
 				}
 			}
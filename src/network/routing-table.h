@@ -40,6 +40,10 @@ struct net_routing_table_t
 
 	/* Flag set when a cycle was detected */
 	int has_cycle;
+
+	/* Parameterized topology. If set, routes are computed on lookup and
+	 * the 2D array is not allocated. */
+	struct net_topology_t *topology;
 };
 
 struct net_routing_table_t *net_routing_table_create(struct net_t *net);
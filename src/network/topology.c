@@ -0,0 +1,516 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <assert.h>
+
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/debug.h>
+#include <lib/util/list.h>
+#include <lib/util/string.h>
+
+#include "buffer.h"
+#include "link.h"
+#include "net-system.h"
+#include "network.h"
+#include "node.h"
+#include "topology.h"
+
+
+char *net_topology_kind_map[] = { "Invalid", "Mesh", "Torus", "Ring", "FatTree", "Crossbar" };
+
+
+/*
+ * Private Functions
+ */
+
+static struct net_routing_table_entry_t *net_topology_entry(struct net_topology_t
+	*topology, int switch_index, int port, int vc)
+{
+	assert(switch_index >= 0 && switch_index < topology->switch_count);
+	assert(port >= 0 && port < topology->port_count);
+	assert(vc >= 0 && vc < topology->vc_count);
+	return &topology->entries[topology->end_node_count +
+		(switch_index * topology->port_count + port) * topology->vc_count + vc];
+}
+
+
+/* Create a link from 'src_node' to 'dst_node' and set the routing entries of
+ * the source port to it. End nodes have a single port. */
+static void net_topology_connect(struct net_topology_t *topology,
+	struct net_node_t *src_node, int port, struct net_node_t *dst_node,
+	int bandwidth, int vc_count)
+{
+	struct net_t *net = topology->net;
+	struct net_routing_table_entry_t *entry;
+	struct net_link_t *link;
+	int vc;
+
+	link = net_add_link(net, src_node, dst_node, bandwidth,
+		src_node->output_buffer_size, dst_node->input_buffer_size,
+		vc_count);
+
+	for (vc = 0; vc < vc_count; vc++)
+	{
+		if (src_node->kind == net_node_end)
+			entry = &topology->entries[src_node->index];
+		else
+			entry = net_topology_entry(topology, src_node->index -
+				topology->end_node_count, port, vc);
+		assert(!entry->output_buffer);
+		entry->cost = 1;
+		entry->next_node = dst_node;
+		entry->output_buffer = link->src_buffers[vc];
+		assert(entry->output_buffer->link == link);
+	}
+}
+
+
+/* Meshes, tori and rings. Switch 's' is at (s % width, s / width), and end
+ * nodes [s * concentration, (s + 1) * concentration) hang from it. */
+static void net_topology_build_grid(struct net_topology_t *topology,
+	int bandwidth)
+{
+	struct net_t *net = topology->net;
+	struct net_node_t *node;
+	struct net_node_t *neighbor;
+
+	int wrap = topology->kind != net_topology_mesh;
+	int width = topology->width;
+	int height = topology->height;
+	int concentration = topology->concentration;
+	int x;
+	int y;
+	int s;
+	int e;
+
+	for (s = 0; s < topology->switch_count; s++)
+	{
+		node = list_get(net->node_list, topology->end_node_count + s);
+		x = s % width;
+		y = s / width;
+
+		/* End nodes */
+		for (e = s * concentration; e < (s + 1) * concentration; e++)
+		{
+			net_topology_connect(topology, list_get(net->node_list, e), 0,
+				node, bandwidth, 1);
+			net_topology_connect(topology, node, net_topology_port_local +
+				e % concentration, list_get(net->node_list, e), bandwidth, 1);
+		}
+
+		/* Link to +x neighbor and back */
+		if (width > 1 && (x + 1 < width || wrap))
+		{
+			neighbor = list_get(net->node_list, topology->end_node_count +
+				y * width + (x + 1) % width);
+			net_topology_connect(topology, node, net_topology_port_east,
+				neighbor, bandwidth, topology->vc_count);
+			net_topology_connect(topology, neighbor, net_topology_port_west,
+				node, bandwidth, topology->vc_count);
+		}
+
+		/* Link to +y neighbor and back */
+		if (height > 1 && (y + 1 < height || wrap))
+		{
+			neighbor = list_get(net->node_list, topology->end_node_count +
+				((y + 1) % height) * width + x);
+			net_topology_connect(topology, node, net_topology_port_north,
+				neighbor, bandwidth, topology->vc_count);
+			net_topology_connect(topology, neighbor, net_topology_port_south,
+				node, bandwidth, topology->vc_count);
+		}
+	}
+}
+
+
+/* Fat tree. Switch 's' is switch 'w' = s % switches_per_level of level
+ * s / switches_per_level, level 0 being the leaves. Up port 'u' of switch 'w'
+ * at level 'l' connects to the switch at level 'l + 1' whose base-'radix'
+ * digit 'l' is 'u', and whose other digits are those of 'w'. */
+static void net_topology_build_fat_tree(struct net_topology_t *topology,
+	int bandwidth)
+{
+	struct net_t *net = topology->net;
+	struct net_node_t *node;
+	struct net_node_t *upper_node;
+
+	int radix = topology->radix;
+	int spl = topology->switches_per_level;
+	int weight;
+	int digit;
+	int upper;
+	int e;
+	int l;
+	int w;
+	int u;
+
+	/* End nodes, 'radix' per leaf switch */
+	for (e = 0; e < topology->end_node_count; e++)
+	{
+		node = list_get(net->node_list, topology->end_node_count + e / radix);
+		net_topology_connect(topology, list_get(net->node_list, e), 0,
+			node, bandwidth, 1);
+		net_topology_connect(topology, node, e % radix,
+			list_get(net->node_list, e), bandwidth, 1);
+	}
+
+	/* Switches */
+	weight = 1;
+	for (l = 0; l < topology->levels - 1; l++)
+	{
+		for (w = 0; w < spl; w++)
+		{
+			node = list_get(net->node_list, topology->end_node_count + l * spl + w);
+			digit = (w / weight) % radix;
+			for (u = 0; u < radix; u++)
+			{
+				upper = w + (u - digit) * weight;
+				upper_node = list_get(net->node_list, topology->end_node_count +
+					(l + 1) * spl + upper);
+				net_topology_connect(topology, node, radix + u,
+					upper_node, bandwidth, 1);
+				net_topology_connect(topology, upper_node, digit,
+					node, bandwidth, 1);
+			}
+		}
+		weight *= radix;
+	}
+}
+
+
+static void net_topology_build_crossbar(struct net_topology_t *topology,
+	int bandwidth)
+{
+	struct net_t *net = topology->net;
+	struct net_node_t *node;
+	int e;
+
+	node = list_get(net->node_list, topology->end_node_count);
+	for (e = 0; e < topology->end_node_count; e++)
+	{
+		net_topology_connect(topology, list_get(net->node_list, e), 0,
+			node, bandwidth, 1);
+		net_topology_connect(topology, node, e,
+			list_get(net->node_list, e), bandwidth, 1);
+	}
+}
+
+
+/* Direction to take in a ring of 'size' switches to go from 'pos' to 'dst',
+ * along the shortest way. Ties go in the positive direction. Deadlocks are
+ * avoided with a dateline on the wrap-around links: a packet uses virtual
+ * channel 0 while it still has to cross the dateline, and virtual channel
+ * 1 once it has crossed it or if it does not need to. */
+static int net_topology_ring_direction(int pos, int dst, int size, int *vc)
+{
+	int delta;
+
+	if (pos == dst)
+		return 0;
+
+	delta = (dst - pos + size) % size;
+	if (delta <= size / 2)
+	{
+		*vc = dst < pos ? 0 : 1;
+		return 1;
+	}
+
+	*vc = dst > pos ? 0 : 1;
+	return -1;
+}
+
+
+/* Dimension-order routing, x first */
+static int net_topology_route_grid(struct net_topology_t *topology,
+	int s, int e, int *vc)
+{
+	int width = topology->width;
+	int tile = e / topology->concentration;
+	int x = s % width;
+	int y = s / width;
+	int dst_x = tile % width;
+	int dst_y = tile / width;
+	int dir;
+
+	*vc = 0;
+	if (topology->kind == net_topology_mesh)
+	{
+		if (dst_x != x)
+			return dst_x > x ? net_topology_port_east : net_topology_port_west;
+		if (dst_y != y)
+			return dst_y > y ? net_topology_port_north : net_topology_port_south;
+		return net_topology_port_local + e % topology->concentration;
+	}
+
+	dir = net_topology_ring_direction(x, dst_x, width, vc);
+	if (dir)
+		return dir > 0 ? net_topology_port_east : net_topology_port_west;
+	dir = net_topology_ring_direction(y, dst_y, topology->height, vc);
+	if (dir)
+		return dir > 0 ? net_topology_port_north : net_topology_port_south;
+
+	*vc = 0;
+	return net_topology_port_local + e % topology->concentration;
+}
+
+
+/* Up/down routing. Packets go up until they reach a common ancestor of the
+ * destination, choosing the up port by the destination digits so that
+ * traffic is spread among the upper switches, and then down. */
+static int net_topology_route_fat_tree(struct net_topology_t *topology,
+	int s, int e)
+{
+	int radix = topology->radix;
+	int level = s / topology->switches_per_level;
+	int w = s % topology->switches_per_level;
+	int weight = 1;
+	int i;
+
+	for (i = 0; i < level; i++)
+		weight *= radix;
+
+	/* Destination is below this switch */
+	if (e / (weight * radix) == w / weight)
+		return (e / weight) % radix;
+
+	assert(level < topology->levels - 1);
+	return radix + (e / (weight * radix)) % radix;
+}
+
+
+/*
+ * Public Functions
+ */
+
+struct net_topology_t *net_topology_create_from_config(struct net_t *net,
+	struct config_t *config, char *section)
+{
+	struct net_topology_t *topology;
+	char name[MAX_STRING_SIZE];
+	char *end_node_prefix;
+	char *switch_prefix;
+	int bandwidth;
+	int i;
+
+	/* Initialize */
+	topology = xcalloc(1, sizeof(struct net_topology_t));
+	topology->net = net;
+	topology->vc_count = 1;
+	topology->concentration = 1;
+
+	/* Nodes are created in order, so that their index locates them */
+	if (net->node_count)
+		fatal("%s: %s: nodes cannot be declared in a network with a topology.\n%s",
+			net->name, section, net_err_config);
+
+	/* Parameters */
+	topology->kind = config_read_enum(config, section, "Type",
+		net_topology_invalid, net_topology_kind_map, 6);
+	bandwidth = config_read_int(config, section, "Bandwidth", net->def_bandwidth);
+	end_node_prefix = config_read_string(config, section, "EndNodePrefix", "n");
+	switch_prefix = config_read_string(config, section, "SwitchPrefix", "s");
+	if (bandwidth < 1)
+		fatal("%s: %s: invalid value for 'Bandwidth'.\n%s",
+			net->name, section, net_err_config);
+
+	switch (topology->kind)
+	{
+
+	case net_topology_mesh:
+	case net_topology_torus:
+
+		topology->width = config_read_int(config, section, "Width", 0);
+		topology->height = config_read_int(config, section, "Height", 1);
+		topology->concentration = config_read_int(config, section, "Concentration", 1);
+		if (topology->width < 1 || topology->height < 1 ||
+				topology->width * topology->height < 2)
+			fatal("%s: %s: invalid values for 'Width' and 'Height'.\n%s",
+				net->name, section, net_err_config);
+		if (topology->concentration < 1)
+			fatal("%s: %s: invalid value for 'Concentration'.\n%s",
+				net->name, section, net_err_config);
+		break;
+
+	case net_topology_ring:
+
+		topology->width = config_read_int(config, section, "Nodes", 0);
+		topology->height = 1;
+		topology->concentration = config_read_int(config, section, "Concentration", 1);
+		if (topology->width < 2)
+			fatal("%s: %s: invalid value for 'Nodes'.\n%s",
+				net->name, section, net_err_config);
+		if (topology->concentration < 1)
+			fatal("%s: %s: invalid value for 'Concentration'.\n%s",
+				net->name, section, net_err_config);
+		break;
+
+	case net_topology_fat_tree:
+
+		topology->radix = config_read_int(config, section, "Radix", 0);
+		topology->levels = config_read_int(config, section, "Levels", 0);
+		if (topology->radix < 2 || topology->levels < 1)
+			fatal("%s: %s: invalid values for 'Radix' and 'Levels'.\n%s",
+				net->name, section, net_err_config);
+		break;
+
+	case net_topology_crossbar:
+
+		topology->width = config_read_int(config, section, "Nodes", 0);
+		if (topology->width < 2)
+			fatal("%s: %s: invalid value for 'Nodes'.\n%s",
+				net->name, section, net_err_config);
+		break;
+
+	default:
+		fatal("%s: %s: Type: invalid/missing value.\n%s",
+			net->name, section, net_err_config);
+	}
+
+	/* Geometry */
+	switch (topology->kind)
+	{
+
+	case net_topology_mesh:
+	case net_topology_torus:
+	case net_topology_ring:
+
+		topology->switch_count = topology->width * topology->height;
+		topology->end_node_count = topology->switch_count * topology->concentration;
+		topology->port_count = net_topology_port_local + topology->concentration;
+		if (topology->kind != net_topology_mesh)
+			topology->vc_count = 2;
+		break;
+
+	case net_topology_fat_tree:
+
+		topology->switches_per_level = 1;
+		for (i = 0; i < topology->levels - 1; i++)
+			topology->switches_per_level *= topology->radix;
+		topology->end_node_count = topology->switches_per_level * topology->radix;
+		topology->switch_count = topology->switches_per_level * topology->levels;
+		topology->port_count = 2 * topology->radix;
+		break;
+
+	case net_topology_crossbar:
+
+		topology->end_node_count = topology->width;
+		topology->switch_count = 1;
+		topology->port_count = topology->width;
+		break;
+
+	default:
+		panic("%s: invalid topology", __FUNCTION__);
+	}
+
+	/* Routing entries */
+	topology->entries = xcalloc(topology->end_node_count +
+		topology->switch_count * topology->port_count * topology->vc_count,
+		sizeof(struct net_routing_table_entry_t));
+	topology->no_route_entry.cost = net->node_count;
+
+	/* Nodes */
+	for (i = 0; i < topology->end_node_count; i++)
+	{
+		snprintf(name, sizeof name, "%s%d", end_node_prefix, i);
+		if (net_get_node_by_name(net, name))
+			fatal("%s: %s: %s: duplicate node name.\n%s",
+				net->name, section, name, net_err_node_name_duplicate);
+		net_add_end_node(net, net->def_input_buffer_size,
+			net->def_output_buffer_size, name, NULL);
+	}
+	for (i = 0; i < topology->switch_count; i++)
+	{
+		snprintf(name, sizeof name, "%s%d", switch_prefix, i);
+		if (net_get_node_by_name(net, name))
+			fatal("%s: %s: %s: duplicate node name.\n%s",
+				net->name, section, name, net_err_node_name_duplicate);
+		net_add_switch(net, net->def_input_buffer_size,
+			net->def_output_buffer_size, net->def_bandwidth, name);
+	}
+
+	/* Links */
+	if (topology->kind == net_topology_fat_tree)
+		net_topology_build_fat_tree(topology, bandwidth);
+	else if (topology->kind == net_topology_crossbar)
+		net_topology_build_crossbar(topology, bandwidth);
+	else
+		net_topology_build_grid(topology, bandwidth);
+
+	/* Debug */
+	net_debug("network %s: %s topology with %d end nodes and %d switches\n",
+		net->name, net_topology_kind_map[topology->kind],
+		topology->end_node_count, topology->switch_count);
+
+	/* Return */
+	return topology;
+}
+
+
+void net_topology_free(struct net_topology_t *topology)
+{
+	free(topology->entries);
+	free(topology);
+}
+
+
+struct net_routing_table_entry_t *net_topology_lookup(struct net_topology_t
+	*topology, struct net_node_t *src_node, struct net_node_t *dst_node)
+{
+	int s;
+	int e;
+	int port;
+	int vc;
+
+	assert(src_node->net == topology->net);
+	assert(dst_node->net == topology->net);
+
+	if (src_node == dst_node)
+		return &topology->self_entry;
+
+	/* Only end nodes are destinations */
+	e = dst_node->index;
+	if (e >= topology->end_node_count)
+		return &topology->no_route_entry;
+
+	/* End nodes inject to their switch */
+	if (src_node->index < topology->end_node_count)
+		return &topology->entries[src_node->index];
+
+	s = src_node->index - topology->end_node_count;
+	vc = 0;
+	switch (topology->kind)
+	{
+
+	case net_topology_fat_tree:
+
+		port = net_topology_route_fat_tree(topology, s, e);
+		break;
+
+	case net_topology_crossbar:
+
+		port = e;
+		break;
+
+	default:
+
+		port = net_topology_route_grid(topology, s, e, &vc);
+	}
+
+	return net_topology_entry(topology, s, port, vc);
+}
@@ -0,0 +1,104 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NETWORK_TOPOLOGY_H
+#define NETWORK_TOPOLOGY_H
+
+#include <stdio.h>
+
+#include <lib/util/config.h>
+
+#include "routing-table.h"
+
+
+/*
+ * Parameterized topologies. Nodes and links are generated from a
+ * '[ Network.<name>.Topology ]' section, and routes are computed
+ * arithmetically on each lookup instead of being stored in a table:
+ * dimension-order routing for meshes, tori and rings, and up/down routing
+ * for fat trees.
+ */
+
+extern char *net_topology_kind_map[];
+
+enum net_topology_kind_t
+{
+	net_topology_invalid = 0,
+	net_topology_mesh,
+	net_topology_torus,
+	net_topology_ring,
+	net_topology_fat_tree,
+	net_topology_crossbar
+};
+
+/* Switch ports in meshes, tori and rings. The end nodes of a switch are
+ * connected to ports 'net_topology_port_local' and following. */
+enum net_topology_port_t
+{
+	net_topology_port_east = 0,	/* +x */
+	net_topology_port_west,		/* -x */
+	net_topology_port_north,	/* +y */
+	net_topology_port_south,	/* -y */
+	net_topology_port_local
+};
+
+struct net_topology_t
+{
+	struct net_t *net;
+	enum net_topology_kind_t kind;
+
+	/* Meshes, tori and rings have a switch per tile of a 'width' x
+	 * 'height' grid, with 'concentration' end nodes attached to each.
+	 * Rings are 'width' x 1 tori. */
+	int width;
+	int height;
+	int concentration;
+
+	/* Fat trees are k-ary n-trees, with k = 'radix' and n = 'levels'.
+	 * There are 'radix' ^ 'levels' end nodes and 'switches_per_level'
+	 * = 'radix' ^ ('levels' - 1) switches at each level. Switch ports
+	 * [0, radix) go down and [radix, 2 * radix) go up. */
+	int radix;
+	int levels;
+	int switches_per_level;
+
+	/* End nodes have node indices [0, end_node_count), and switches
+	 * follow them. */
+	int end_node_count;
+	int switch_count;
+	int port_count;		/* Ports per switch */
+	int vc_count;		/* Virtual channels per switch link */
+
+	/* One entry per end node, followed by 'port_count' x 'vc_count'
+	 * entries per switch. Entries are only written while the topology
+	 * is built. */
+	struct net_routing_table_entry_t *entries;
+	struct net_routing_table_entry_t self_entry;
+	struct net_routing_table_entry_t no_route_entry;
+};
+
+struct net_topology_t *net_topology_create_from_config(struct net_t *net,
+	struct config_t *config, char *section);
+void net_topology_free(struct net_topology_t *topology);
+
+struct net_routing_table_entry_t *net_topology_lookup(struct net_topology_t
+	*topology, struct net_node_t *src_node, struct net_node_t *dst_node);
+
+
+#endif
@@ -0,0 +1,564 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <math.h>
+
+#include <lib/esim/esim.h>
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/debug.h>
+#include <lib/util/file.h>
+#include <lib/util/list.h>
+#include <lib/util/misc.h>
+#include <lib/util/string.h>
+
+#include "net-system.h"
+#include "network.h"
+#include "node.h"
+#include "routing-table.h"
+#include "topology.h"
+#include "traffic.h"
+
+
+/* Messages generated and not yet accepted by the network, per end node */
+#define NET_TRAFFIC_QUEUE_SIZE  1024
+
+/* Share of the messages sent to end node 0 with the hotspot pattern */
+#define NET_TRAFFIC_HOTSPOT_FRACTION  0.25
+
+/* Average length in cycles of a burst with bursty injection. A node injects
+ * a message every cycle of a burst. */
+#define NET_TRAFFIC_BURST_LENGTH  8
+
+/* Limit of points in a load-latency sweep */
+#define NET_TRAFFIC_SWEEP_POINTS  100
+
+
+struct str_map_t net_traffic_pattern_map =
+{
+	7, {
+		{ "uniform", net_traffic_uniform },
+		{ "transpose", net_traffic_transpose },
+		{ "bitcomp", net_traffic_bit_complement },
+		{ "bitrev", net_traffic_bit_reverse },
+		{ "hotspot", net_traffic_hotspot },
+		{ "tornado", net_traffic_tornado },
+		{ "neighbor", net_traffic_neighbor }
+	}
+};
+enum net_traffic_pattern_t net_traffic_pattern = net_traffic_uniform;
+
+struct str_map_t net_traffic_injection_map =
+{
+	3, {
+		{ "exponential", net_traffic_exponential },
+		{ "bernoulli", net_traffic_bernoulli },
+		{ "bursty", net_traffic_bursty }
+	}
+};
+enum net_traffic_injection_t net_traffic_injection = net_traffic_exponential;
+
+char *net_traffic_sweep_file_name = "";
+
+int EV_NET_TRAFFIC_RECEIVE;
+
+
+struct net_traffic_msg_t
+{
+	struct net_traffic_t *traffic;
+	struct net_node_t *dst_node;
+	struct net_msg_t *msg;
+	long long cycle;	/* Cycle when the message was generated */
+};
+
+struct net_traffic_node_t
+{
+	struct net_node_t *node;
+	int active;		/* Node sends messages */
+
+	/* Destination in permutation patterns */
+	struct net_node_t *dst_node;
+
+	/* Injection process */
+	double inject_time;
+	int burst;
+
+	/* Source queue, as a circular buffer */
+	struct net_traffic_msg_t *queue[NET_TRAFFIC_QUEUE_SIZE];
+	int queue_head;
+	int queue_count;
+};
+
+struct net_traffic_t
+{
+	struct net_t *net;
+	double rate;		/* Messages per end node per cycle */
+
+	struct net_traffic_node_t *nodes;
+	int node_count;
+	int active_node_count;	/* End nodes sending messages */
+
+	/* Grid where end nodes are placed for coordinate-based patterns */
+	int width;
+	int height;
+
+	/* Stats of the current measurement window */
+	long long generated;
+	long long dropped;
+	long long delivered;
+	long long lat_acc;
+};
+
+
+static double exp_random(double lambda)
+{
+	double x = (double) random() / RAND_MAX;
+
+	return log(1 - x) / -lambda;
+}
+
+
+static double net_traffic_random(void)
+{
+	return (double) random() / RAND_MAX;
+}
+
+
+static int net_traffic_log2(int value)
+{
+	int log;
+
+	for (log = 0; (1 << log) < value; log++);
+	if ((1 << log) != value)
+		return -1;
+	return log;
+}
+
+
+/* Fixed destination of end node 'index' in a permutation pattern */
+static int net_traffic_permutation(struct net_traffic_t *traffic, int index)
+{
+	int width = traffic->width;
+	int height = traffic->height;
+	int x = index % width;
+	int y = index / width;
+	int bits;
+	int dst;
+	int i;
+
+	switch (net_traffic_pattern)
+	{
+
+	case net_traffic_transpose:
+		return x * width + y;
+
+	case net_traffic_bit_complement:
+		return ~index & (traffic->node_count - 1);
+
+	case net_traffic_bit_reverse:
+		bits = net_traffic_log2(traffic->node_count);
+		dst = 0;
+		for (i = 0; i < bits; i++)
+			if (index & (1 << i))
+				dst |= 1 << (bits - i - 1);
+		return dst;
+
+	case net_traffic_tornado:
+		x = (x + (width + 1) / 2 - 1) % width;
+		y = (y + (height + 1) / 2 - 1) % height;
+		return y * width + x;
+
+	case net_traffic_neighbor:
+		return y * width + (x + 1) % width;
+
+	default:
+		panic("%s: not a permutation", __FUNCTION__);
+		return 0;
+	}
+}
+
+
+static struct net_traffic_t *net_traffic_create(struct net_t *net)
+{
+	struct net_routing_table_t *routing_table = net->routing_table;
+	struct net_traffic_node_t *traffic_node;
+	struct net_traffic_t *traffic;
+	struct net_node_t *node;
+
+	int count;
+	int dst;
+	int i;
+
+	/* Initialize */
+	traffic = xcalloc(1, sizeof(struct net_traffic_t));
+	traffic->net = net;
+	traffic->nodes = xcalloc(net->end_node_count, sizeof(struct net_traffic_node_t));
+	LIST_FOR_EACH(net->node_list, i)
+	{
+		node = list_get(net->node_list, i);
+		if (node->kind == net_node_end)
+			traffic->nodes[traffic->node_count++].node = node;
+	}
+	count = traffic->node_count;
+	if (count < 2)
+		fatal("%s: network simulation needs at least two end nodes", net->name);
+
+	/* Grids of meshes, tori and rings are those of the topology. Other
+	 * networks use a square grid if possible, and a row otherwise. */
+	if (routing_table->topology && routing_table->topology->width &&
+		routing_table->topology->concentration == 1)
+	{
+		traffic->width = routing_table->topology->width;
+		traffic->height = routing_table->topology->height;
+	}
+	else
+	{
+		traffic->width = sqrt(count);
+		while (count % traffic->width)
+			traffic->width--;
+		if (traffic->width * traffic->width != count)
+			traffic->width = count;
+		traffic->height = count / traffic->width;
+	}
+
+	/* Check pattern */
+	if (net_traffic_pattern == net_traffic_transpose && traffic->width != traffic->height)
+		fatal("%s: transpose traffic needs a square number of end nodes", net->name);
+	if ((net_traffic_pattern == net_traffic_bit_complement ||
+			net_traffic_pattern == net_traffic_bit_reverse) &&
+			net_traffic_log2(count) < 0)
+		fatal("%s: %s traffic needs a power of two of end nodes",
+			net->name, str_map_value(&net_traffic_pattern_map, net_traffic_pattern));
+
+	/* Destinations of permutation patterns. Nodes mapped to themselves
+	 * do not send messages. */
+	for (i = 0; i < count; i++)
+	{
+		traffic_node = &traffic->nodes[i];
+		if (net_traffic_pattern == net_traffic_uniform ||
+				net_traffic_pattern == net_traffic_hotspot)
+		{
+			traffic_node->active = 1;
+			traffic->active_node_count++;
+			continue;
+		}
+
+		dst = net_traffic_permutation(traffic, i);
+		if (dst == i)
+			continue;
+		traffic_node->active = 1;
+		traffic_node->dst_node = traffic->nodes[dst].node;
+		traffic->active_node_count++;
+	}
+
+	/* Return */
+	return traffic;
+}
+
+
+static void net_traffic_free(struct net_traffic_t *traffic)
+{
+	struct net_traffic_node_t *traffic_node;
+	int i;
+
+	/* Messages still in source queues */
+	for (i = 0; i < traffic->node_count; i++)
+	{
+		traffic_node = &traffic->nodes[i];
+		while (traffic_node->queue_count)
+		{
+			free(traffic_node->queue[traffic_node->queue_head]);
+			traffic_node->queue_head = (traffic_node->queue_head + 1) % NET_TRAFFIC_QUEUE_SIZE;
+			traffic_node->queue_count--;
+		}
+	}
+	free(traffic->nodes);
+	free(traffic);
+}
+
+
+/* Number of messages generated by a node in this cycle */
+static int net_traffic_inject_count(struct net_traffic_t *traffic,
+	struct net_traffic_node_t *traffic_node, long long cycle)
+{
+	double rate = traffic->rate;
+	double start;
+	int count;
+
+	switch (net_traffic_injection)
+	{
+
+	case net_traffic_exponential:
+
+		count = 0;
+		while (traffic_node->inject_time < cycle)
+		{
+			traffic_node->inject_time += exp_random(rate);
+			count++;
+		}
+		return count;
+
+	case net_traffic_bernoulli:
+
+		return net_traffic_random() < rate;
+
+	case net_traffic_bursty:
+
+		/* Bursts end with probability 1 / NET_TRAFFIC_BURST_LENGTH, and
+		 * start with the probability that keeps the average rate. */
+		if (traffic_node->burst)
+		{
+			if (net_traffic_random() < 1.0 / NET_TRAFFIC_BURST_LENGTH)
+				traffic_node->burst = 0;
+		}
+		else
+		{
+			start = rate >= 1.0 ? 1.0 : rate / (1.0 - rate) / NET_TRAFFIC_BURST_LENGTH;
+			if (net_traffic_random() < start)
+				traffic_node->burst = 1;
+		}
+		return traffic_node->burst;
+
+	default:
+		panic("%s: invalid injection process", __FUNCTION__);
+		return 0;
+	}
+}
+
+
+static struct net_node_t *net_traffic_destination(struct net_traffic_t *traffic,
+	struct net_traffic_node_t *traffic_node)
+{
+	struct net_node_t *dst_node;
+
+	/* Permutations */
+	if (net_traffic_pattern != net_traffic_uniform &&
+			net_traffic_pattern != net_traffic_hotspot)
+		return traffic_node->dst_node;
+
+	/* Hotspot */
+	if (net_traffic_pattern == net_traffic_hotspot &&
+			traffic_node != &traffic->nodes[0] &&
+			net_traffic_random() < NET_TRAFFIC_HOTSPOT_FRACTION)
+		return traffic->nodes[0].node;
+
+	/* Uniform */
+	do
+	{
+		dst_node = traffic->nodes[random() % traffic->node_count].node;
+	} while (dst_node == traffic_node->node);
+	return dst_node;
+}
+
+
+/* Generate messages for one cycle, and inject at most one message per end
+ * node from its source queue. */
+static void net_traffic_cycle(struct net_traffic_t *traffic, long long cycle)
+{
+	struct net_traffic_node_t *traffic_node;
+	struct net_traffic_msg_t *traffic_msg;
+	struct net_t *net = traffic->net;
+
+	int count;
+	int tail;
+	int i;
+
+	for (i = 0; i < traffic->node_count; i++)
+	{
+		/* Generate */
+		traffic_node = &traffic->nodes[i];
+		if (!traffic_node->active)
+			continue;
+		count = net_traffic_inject_count(traffic, traffic_node, cycle);
+		while (count--)
+		{
+			traffic_msg = xcalloc(1, sizeof(struct net_traffic_msg_t));
+			traffic_msg->traffic = traffic;
+			traffic_msg->dst_node = net_traffic_destination(traffic, traffic_node);
+			traffic_msg->cycle = cycle;
+			if (traffic_node->queue_count == NET_TRAFFIC_QUEUE_SIZE)
+			{
+				traffic->dropped++;
+				free(traffic_msg);
+				continue;
+			}
+			traffic->generated++;
+			tail = (traffic_node->queue_head + traffic_node->queue_count) % NET_TRAFFIC_QUEUE_SIZE;
+			traffic_node->queue[tail] = traffic_msg;
+			traffic_node->queue_count++;
+		}
+
+		/* Inject */
+		if (!traffic_node->queue_count)
+			continue;
+		traffic_msg = traffic_node->queue[traffic_node->queue_head];
+		if (!net_can_send(net, traffic_node->node, traffic_msg->dst_node, net_msg_size))
+			continue;
+		traffic_node->queue_head = (traffic_node->queue_head + 1) % NET_TRAFFIC_QUEUE_SIZE;
+		traffic_node->queue_count--;
+		traffic_msg->msg = net_send_ev(net, traffic_node->node, traffic_msg->dst_node,
+			net_msg_size, EV_NET_TRAFFIC_RECEIVE, traffic_msg);
+	}
+}
+
+
+/* Run the simulation until cycle 'until' */
+static void net_traffic_simulate(struct net_traffic_t *traffic, long long until)
+{
+	long long cycle;
+
+	while (1)
+	{
+		cycle = esim_domain_cycle(net_domain_index);
+		if (cycle >= until)
+			break;
+
+		net_traffic_cycle(traffic, cycle);
+
+		/* Next cycle */
+		net_debug("___ cycle %lld ___\n", cycle);
+		esim_process_events(TRUE);
+	}
+}
+
+
+static void net_traffic_reset_stats(struct net_traffic_t *traffic)
+{
+	traffic->generated = 0;
+	traffic->dropped = 0;
+	traffic->delivered = 0;
+	traffic->lat_acc = 0;
+}
+
+
+/* Increase the injection rate in steps of '--net-injection-rate', and dump
+ * one line per rate with offered and accepted traffic, in messages per
+ * active end node and cycle, and the average latency. Every point runs for
+ * '--net-max-cycles' cycles, the first fifth of them being warm-up. The sweep
+ * stops at the first saturated point: the latency is over 3 times that of
+ * the first point, the accepted traffic is under 90% of the offered, or
+ * source queues overflow. */
+static void net_traffic_sweep(struct net_traffic_t *traffic)
+{
+	FILE *f;
+
+	long long cycles;
+	long long warmup;
+	long long cycle;
+
+	double offered;
+	double accepted;
+	double latency;
+	double zero_load_latency = 0.0;
+
+	int saturated;
+	int point;
+
+	/* Open file */
+	f = file_open_for_write(net_traffic_sweep_file_name);
+	if (!f)
+		fatal("%s: cannot open network sweep file", net_traffic_sweep_file_name);
+	fprintf(f, "pattern,injection,rate,offered,accepted,latency,generated,delivered,dropped,saturated\n");
+
+	warmup = net_max_cycles / 5;
+	cycles = net_max_cycles - warmup;
+	if (cycles < 1)
+		fatal("%s: network sweep needs more cycles", traffic->net->name);
+
+	for (point = 1; point <= NET_TRAFFIC_SWEEP_POINTS; point++)
+	{
+		/* Rate. Other processes inject at most one message per cycle. */
+		traffic->rate = net_injection_rate * point;
+		if (net_traffic_injection != net_traffic_exponential && traffic->rate > 1.0)
+			break;
+
+		/* Warm-up and measurement */
+		cycle = esim_domain_cycle(net_domain_index);
+		net_traffic_simulate(traffic, cycle + warmup);
+		net_traffic_reset_stats(traffic);
+		net_traffic_simulate(traffic, cycle + warmup + cycles);
+
+		/* Results */
+		offered = (double) traffic->generated / traffic->active_node_count / cycles;
+		accepted = (double) traffic->delivered / traffic->active_node_count / cycles;
+		latency = traffic->delivered ? (double) traffic->lat_acc / traffic->delivered : 0.0;
+		if (point == 1)
+			zero_load_latency = latency;
+		saturated = traffic->dropped || accepted < offered * 0.9 ||
+			latency > zero_load_latency * 3.0;
+
+		fprintf(f, "%s,%s,%g,%.6f,%.6f,%.4f,%lld,%lld,%lld,%d\n",
+			str_map_value(&net_traffic_pattern_map, net_traffic_pattern),
+			str_map_value(&net_traffic_injection_map, net_traffic_injection),
+			traffic->rate, offered, accepted, latency, traffic->generated,
+			traffic->delivered, traffic->dropped, saturated);
+		fflush(f);
+
+		if (saturated)
+			break;
+	}
+
+	/* Close */
+	file_close(f);
+}
+
+
+/*
+ * Public Functions
+ */
+
+void net_traffic_receive_handler(int event, void *data)
+{
+	struct net_traffic_msg_t *traffic_msg = data;
+	struct net_traffic_t *traffic = traffic_msg->traffic;
+	long long cycle;
+
+	/* Get current cycle */
+	cycle = esim_domain_cycle(net_domain_index);
+
+	/* Stats */
+	traffic->delivered++;
+	traffic->lat_acc += cycle - traffic_msg->cycle;
+
+	/* Remove message */
+	net_receive_msg(traffic->net, traffic_msg->dst_node, traffic_msg->msg);
+	free(traffic_msg);
+}
+
+
+void net_traffic_run(struct net_t *net)
+{
+	struct net_traffic_t *traffic;
+
+	traffic = net_traffic_create(net);
+	esim_process_events(TRUE);
+
+	if (*net_traffic_sweep_file_name)
+	{
+		net_traffic_sweep(traffic);
+	}
+	else
+	{
+		traffic->rate = net_injection_rate;
+		net_traffic_simulate(traffic, net_max_cycles);
+	}
+
+	/* Drain messages in flight, which refer to 'traffic' */
+	esim_process_all_events();
+	net_traffic_free(traffic);
+}
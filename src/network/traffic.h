@@ -0,0 +1,62 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NETWORK_TRAFFIC_H
+#define NETWORK_TRAFFIC_H
+
+
+/*
+ * Synthetic traffic for standalone network simulation ('--net-sim'). End
+ * nodes generate messages following a traffic pattern and an injection
+ * process, and queue them at the source until the network accepts them.
+ * Latencies include the time spent in the source queue.
+ */
+
+extern struct str_map_t net_traffic_pattern_map;
+extern enum net_traffic_pattern_t
+{
+	net_traffic_uniform = 0,
+	net_traffic_transpose,
+	net_traffic_bit_complement,
+	net_traffic_bit_reverse,
+	net_traffic_hotspot,
+	net_traffic_tornado,
+	net_traffic_neighbor
+} net_traffic_pattern;
+
+extern struct str_map_t net_traffic_injection_map;
+extern enum net_traffic_injection_t
+{
+	net_traffic_exponential = 0,
+	net_traffic_bernoulli,
+	net_traffic_bursty
+} net_traffic_injection;
+
+extern char *net_traffic_sweep_file_name;
+
+extern int EV_NET_TRAFFIC_RECEIVE;
+
+struct net_t;
+
+void net_traffic_receive_handler(int event, void *data);
+
+void net_traffic_run(struct net_t *net);
+
+
+#endif
@@ -157,10 +157,16 @@ void vi_state_category_free(struct vi_state_category_t *category)
 
 struct vi_state_t
 {
-	/* Uncompressed trace file */
+	/* Uncompressed trace file, for text traces */
 	char *unzipped_trace_file_name;
 	FILE *unzipped_trace_file;
 
+	/* Binary traces are read directly from the trace file, with a separate
+	 * position for the state, header lines, and body lines. */
+	struct vi_trace_t *trace;
+	struct vi_trace_t *header_trace;
+	struct vi_trace_t *body_trace;
+
 	/* Checkpoint file */
 	char *checkpoint_file_name;
 	FILE *checkpoint_file;
@@ -192,6 +198,52 @@ struct vi_state_t
 static struct vi_state_t *vi_state;
 
 
+/* Read the trace line at the current position of 'trace' for binary traces,
+ * or of the uncompressed trace file for text traces. */
+static struct vi_trace_line_t *vi_state_read_trace_line(struct vi_trace_t *trace)
+{
+	if (trace)
+		return vi_trace_line_create_from_trace(trace);
+	return vi_trace_line_create_from_file(vi_state->unzipped_trace_file);
+}
+
+
+static long int vi_state_tell(struct vi_trace_t *trace)
+{
+	if (trace)
+		return vi_trace_tell(trace);
+	return ftell(vi_state->unzipped_trace_file);
+}
+
+
+static void vi_state_seek(struct vi_trace_t *trace, long int offset)
+{
+	if (trace)
+		vi_trace_seek(trace, offset);
+	else
+		fseek(vi_state->unzipped_trace_file, offset, SEEK_SET);
+}
+
+
+/* Read the trace line at position '*offset_ptr' and update it with the position
+ * of the next line. The uncompressed trace file of a text trace is shared, so
+ * its current position is restored. */
+static struct vi_trace_line_t *vi_state_read_trace_line_at(struct vi_trace_t *trace,
+	long int *offset_ptr)
+{
+	struct vi_trace_line_t *trace_line;
+	long int offset;
+
+	offset = vi_state_tell(trace);
+	vi_state_seek(trace, *offset_ptr);
+	trace_line = vi_state_read_trace_line(trace);
+	*offset_ptr = vi_state_tell(trace);
+	if (!trace)
+		vi_state_seek(trace, offset);
+	return trace_line;
+}
+
+
 static void vi_state_read_checkpoint(int index)
 {
 	struct vi_state_checkpoint_t *checkpoint;
@@ -205,7 +257,7 @@ static void vi_state_read_checkpoint(int index)
 
 	/* Set file positions */
 	fseek(vi_state->checkpoint_file, checkpoint->checkpoint_file_offset, SEEK_SET);
-	fseek(vi_state->unzipped_trace_file, checkpoint->unzipped_trace_file_offset, SEEK_SET);
+	vi_state_seek(vi_state->trace, checkpoint->unzipped_trace_file_offset);
 	vi_state->cycle = checkpoint->cycle;
 
 	/* Read checkpoint for every category */
@@ -244,10 +296,6 @@ void vi_state_init(char *trace_file_name)
 
 	/* Create */
 	vi_state = xcalloc(1, sizeof(struct vi_state_t));
-	
-	/* Create uncompressed trace file */
-	vi_state->unzipped_trace_file = file_create_temp(buf, sizeof buf);
-	vi_state->unzipped_trace_file_name = xstrdup(buf);
 
 	/* Create checkpoint file */
 	vi_state->checkpoint_file = file_create_temp(buf, sizeof buf);
@@ -258,9 +306,25 @@ void vi_state_init(char *trace_file_name)
 	vi_state->category_list = list_create();
 	vi_state->command_table = hash_table_create(0, FALSE);
 
+	/* Binary trace, read in place */
+	trace_file = vi_trace_create(trace_file_name);
+	if (vi_trace_is_binary(trace_file))
+	{
+		vi_state->trace = trace_file;
+		vi_state->header_trace = vi_trace_create(trace_file_name);
+		vi_state->body_trace = vi_trace_create(trace_file_name);
+		vi_state->num_cycles = vi_trace_get_num_cycles(trace_file);
+		printf("Loading binary trace (%lld cycles)\n", vi_state->num_cycles);
+		fflush(stdout);
+		return;
+	}
+
+	/* Create uncompressed trace file */
+	vi_state->unzipped_trace_file = file_create_temp(buf, sizeof buf);
+	vi_state->unzipped_trace_file_name = xstrdup(buf);
+
 	/* Unpack trace */
 	num_trace_lines = 0;
-	trace_file = vi_trace_create(trace_file_name);
 	while ((trace_line = vi_trace_line_create_from_trace(trace_file)))
 	{
 		/* Copy trace */
@@ -297,9 +361,18 @@ void vi_state_done(void)
 
 	int i;
 
-	/* Close and delete uncompressed trace file */
-	fclose(vi_state->unzipped_trace_file);
-	unlink(vi_state->unzipped_trace_file_name);
+	/* Close binary trace, or close and delete uncompressed trace file */
+	if (vi_state->trace)
+	{
+		vi_trace_free(vi_state->trace);
+		vi_trace_free(vi_state->header_trace);
+		vi_trace_free(vi_state->body_trace);
+	}
+	else
+	{
+		fclose(vi_state->unzipped_trace_file);
+		unlink(vi_state->unzipped_trace_file_name);
+	}
 
 	/* Close and detele checkpoint file */
 	fclose(vi_state->checkpoint_file);
@@ -363,17 +436,21 @@ void vi_state_create_checkpoints(void)
 	int num_trace_lines;
 
 	/* Get unzipped trace file size */
-	fseek(vi_state->unzipped_trace_file, 0, SEEK_END);
-	unzipped_trace_file_size = ftell(vi_state->unzipped_trace_file);
+	unzipped_trace_file_size = 0;
+	if (!vi_state->trace)
+	{
+		fseek(vi_state->unzipped_trace_file, 0, SEEK_END);
+		unzipped_trace_file_size = ftell(vi_state->unzipped_trace_file);
+	}
 
 	/* Initialize */
 	last_checkpoint_cycle = -VI_STATE_CHECKPOINT_INTERVAL;
-	fseek(vi_state->unzipped_trace_file, 0, SEEK_SET);
+	vi_state_seek(vi_state->trace, 0);
 
 	/* Parse uncompressed trace file */
 	num_trace_lines = 0;
 	vi_state->cycle = 0;
-	while ((trace_line = vi_trace_line_create_from_file(vi_state->unzipped_trace_file)))
+	while ((trace_line = vi_state_read_trace_line(vi_state->trace)))
 	{
 		struct vi_state_checkpoint_t *checkpoint;
 		struct vi_state_command_t *state_command;
@@ -413,6 +490,8 @@ void vi_state_create_checkpoints(void)
 		{
 			printf("Creating checkpoints (%.1fMB, %.1f%%)   \r",
 				ftell(vi_state->checkpoint_file) / 1.048e6,
+				vi_state->trace ?
+				vi_trace_get_progress(vi_state->trace) * 100.0 :
 				unzipped_trace_file_size ?
 				(double) ftell(vi_state->unzipped_trace_file) * 100.0 /
 				unzipped_trace_file_size : 0.0);
@@ -485,8 +564,8 @@ struct vi_trace_line_t *vi_state_header_next(void)
 		return NULL;
 
 	/* Read trace line */
-	fseek(vi_state->unzipped_trace_file, vi_state->header_trace_line_offset, SEEK_SET);
-	trace_line = vi_trace_line_create_from_file(vi_state->unzipped_trace_file);
+	trace_line = vi_state_read_trace_line_at(vi_state->header_trace,
+		&vi_state->header_trace_line_offset);
 	if (!trace_line)
 	{
 		vi_state->header_trace_line_offset = -1;
@@ -503,15 +582,12 @@ struct vi_trace_line_t *vi_state_header_next(void)
 
 	/* Save trace line and return */
 	vi_state->header_trace_line = trace_line;
-	vi_state->header_trace_line_offset = ftell(vi_state->unzipped_trace_file);
 	return trace_line;
 }
 
 
 struct vi_trace_line_t *vi_state_trace_line_first(long long cycle)
 {
-	long int trace_file_offset;
-
 	int checkpoint_index;
 
 	long long checkpoint_cycle;
@@ -529,9 +605,6 @@ struct vi_trace_line_t *vi_state_trace_line_first(long long cycle)
 	if (cycle > vi_state->num_cycles)
 		return NULL;
 
-	/* Store current position in trace file */
-	trace_file_offset = ftell(vi_state->unzipped_trace_file);
-
 	/* Get closest checkpoint */
 	checkpoint_index = cycle / VI_STATE_CHECKPOINT_INTERVAL;
 	checkpoint_cycle = (long long) checkpoint_index * VI_STATE_CHECKPOINT_INTERVAL;
@@ -539,14 +612,19 @@ struct vi_trace_line_t *vi_state_trace_line_first(long long cycle)
 	if (!checkpoint)
 		panic("%s: invalid checkpoint index", __FUNCTION__);
 
-	/* Set position in trace file */
-	fseek(vi_state->unzipped_trace_file, checkpoint->unzipped_trace_file_offset, SEEK_SET);
+	/* Set position in trace file. Binary traces start at the block containing
+	 * the cycle, found in the trace index. */
 	vi_state->body_trace_line_offset = checkpoint->unzipped_trace_file_offset;
+	if (vi_state->body_trace)
+	{
+		vi_state->body_trace_line_offset = vi_trace_find_cycle(vi_state->body_trace, cycle);
+		checkpoint_cycle = -1;
+	}
 	for (;;)
 	{
 		/* Read trace line */
-		vi_state->body_trace_line = vi_trace_line_create_from_file(vi_state->unzipped_trace_file);
-		vi_state->body_trace_line_offset = checkpoint->unzipped_trace_file_offset;
+		vi_state->body_trace_line = vi_state_read_trace_line_at(vi_state->body_trace,
+			&vi_state->body_trace_line_offset);
 		if (!vi_state->body_trace_line || checkpoint_cycle == cycle)
 			break;
 
@@ -560,19 +638,13 @@ struct vi_trace_line_t *vi_state_trace_line_first(long long cycle)
 		vi_state->body_trace_line = NULL;
 	}
 
-	/* Return to original position in trace file */
-	fseek(vi_state->unzipped_trace_file, trace_file_offset, SEEK_SET);
+	/* Return */
 	return vi_state->body_trace_line;
 }
 
 
 struct vi_trace_line_t *vi_state_trace_line_next(void)
 {
-	long long trace_file_offset;
-
-	/* Store current position in trace file */
-	trace_file_offset = ftell(vi_state->unzipped_trace_file);
-
 	/* Release previous body trace line if any */
 	if (vi_state->body_trace_line)
 	{
@@ -581,12 +653,8 @@ struct vi_trace_line_t *vi_state_trace_line_next(void)
 	}
 
 	/* Get next trace line */
-	fseek(vi_state->unzipped_trace_file, vi_state->body_trace_line_offset, SEEK_SET);
-	vi_state->body_trace_line = vi_trace_line_create_from_file(vi_state->unzipped_trace_file);
-	vi_state->body_trace_line_offset = ftell(vi_state->unzipped_trace_file);
-
-	/* Return to original position in trace file */
-	fseek(vi_state->unzipped_trace_file, trace_file_offset, SEEK_SET);
+	vi_state->body_trace_line = vi_state_read_trace_line_at(vi_state->body_trace,
+		&vi_state->body_trace_line_offset);
 	return vi_state->body_trace_line;
 }
 
@@ -615,8 +683,8 @@ void vi_state_go_to_cycle(long long cycle)
 		char *command;
 
 		/* Read a trace line */
-		unzipped_trace_file_pos = ftell(vi_state->unzipped_trace_file);
-		trace_line = vi_trace_line_create_from_file(vi_state->unzipped_trace_file);
+		unzipped_trace_file_pos = vi_state_tell(vi_state->trace);
+		trace_line = vi_state_read_trace_line(vi_state->trace);
 		if (!trace_line)
 			break;
 
@@ -632,7 +700,7 @@ void vi_state_go_to_cycle(long long cycle)
 			/* If we passed the target cycle, done */
 			if (new_cycle > cycle)
 			{
-				fseek(vi_state->unzipped_trace_file, unzipped_trace_file_pos, SEEK_SET);
+				vi_state_seek(vi_state->trace, unzipped_trace_file_pos);
 				vi_trace_line_free(trace_line);
 				break;
 			}
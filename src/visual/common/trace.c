@@ -18,14 +18,22 @@
  */
 
 #include <ctype.h>
+#include <fcntl.h>
 #include <gtk/gtk.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <zlib.h>
 
+#include <lib/esim/trace.h>
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
 #include <lib/util/hash-table.h>
+#include <lib/util/misc.h>
 #include <lib/util/string.h>
 
+#include "trace.h"
+
 
 
 
@@ -38,6 +46,32 @@ struct vi_trace_t
 	/* Last line number read from zip file with a call to
 	 * 'vi_trace_line_create_from_trace'. */
 	int line_num;
+
+	/* Binary trace mapped in memory (see 'lib/esim/trace.h') */
+	int binary;
+	unsigned char *map;
+	size_t map_size;
+	char **string_list;
+	long long num_strings;
+	unsigned char *index;
+	long long num_blocks;
+	long long last_cycle;
+
+	/* Uncompressed block and position of the next record in it */
+	long long block;
+	unsigned char *block_data;
+	int block_size;
+	int block_max_size;
+	int block_pos;
+
+	/* Last cycle record in the block, or -1 if none */
+	long long block_cycle;
+
+	/* Last integer value of each symbol name in the block, valid if
+	 * 'value_gen[id]' is equal to 'block_gen'. */
+	long long *value;
+	int *value_gen;
+	int block_gen;
 };
 
 
@@ -140,27 +174,15 @@ struct vi_trace_line_t *vi_trace_line_create_from_file(FILE *f)
 }
 
 
-struct vi_trace_line_t *vi_trace_line_create_from_trace(struct vi_trace_t *trace)
+/* Create a trace line from the text in 'buf', with the format 'command
+ * name=value name="value" ...'. Buffer 'buf' is modified. */
+static struct vi_trace_line_t *vi_trace_line_create_from_text(struct vi_trace_t *trace,
+	char *buf, long int offset)
 {
 	struct vi_trace_line_t *line;
 
-	long int offset;
-
-	char buf[4096];
 	char *buf_ptr;
 
-	/* Read line from trace file */
-	offset = gztell(trace->f);
-	buf_ptr = gzgets(trace->f, buf, sizeof buf);
-
-	/* Empty line */
-	if (!buf_ptr)
-		return NULL;
-
-	/* Line too long */
-	if (strlen(buf) == sizeof(buf) - 1)
-		fatal("%s: buffer too small", __FUNCTION__);
-
 	/* Initialize */
 	line = xcalloc(1, sizeof(struct vi_trace_line_t));
 	trace->line_num++;
@@ -169,6 +191,7 @@ struct vi_trace_line_t *vi_trace_line_create_from_trace(struct vi_trace_t *trace
 	line->symbol_table = hash_table_create(13, FALSE);
 
 	/* Read command */
+	buf_ptr = buf;
 	while (isspace(*buf_ptr))
 		buf_ptr++;
 	line->command = buf_ptr;
@@ -229,6 +252,38 @@ struct vi_trace_line_t *vi_trace_line_create_from_trace(struct vi_trace_t *trace
 }
 
 
+
+static struct vi_trace_line_t *vi_trace_bin_read_line(struct vi_trace_t *trace,
+	int create);
+
+struct vi_trace_line_t *vi_trace_line_create_from_trace(struct vi_trace_t *trace)
+{
+	long int offset;
+
+	char buf[4096];
+	char *buf_ptr;
+
+	/* Binary trace */
+	if (trace->binary)
+		return vi_trace_bin_read_line(trace, 1);
+
+	/* Read line from trace file */
+	offset = gztell(trace->f);
+	buf_ptr = gzgets(trace->f, buf, sizeof buf);
+
+	/* Empty line */
+	if (!buf_ptr)
+		return NULL;
+
+	/* Line too long */
+	if (strlen(buf) == sizeof(buf) - 1)
+		fatal("%s: buffer too small", __FUNCTION__);
+
+	/* Create line */
+	return vi_trace_line_create_from_text(trace, buf, offset);
+}
+
+
 void vi_trace_line_free(struct vi_trace_line_t *line)
 {
 	char *symbol_name;
@@ -353,6 +408,406 @@ unsigned int vi_trace_line_get_symbol_hex(struct vi_trace_line_t *line, char *sy
 
 
 
+/*
+ * Binary Trace
+ */
+
+static unsigned long long vi_trace_bin_fixed(unsigned char *buf, int size)
+{
+	unsigned long long value = 0;
+	int i;
+
+	for (i = 0; i < size; i++)
+		value |= (unsigned long long) buf[i] << (i * 8);
+	return value;
+}
+
+
+static unsigned long long vi_trace_bin_varint(struct vi_trace_t *trace,
+	unsigned char *buf, int size, int *pos_ptr)
+{
+	unsigned long long value = 0;
+	int shift = 0;
+	int pos = *pos_ptr;
+
+	do
+	{
+		if (pos >= size || shift > 63)
+			fatal("%s: invalid binary trace", trace->name);
+		value |= (unsigned long long) (buf[pos] & 0x7f) << shift;
+		shift += 7;
+	} while (buf[pos++] & 0x80);
+	*pos_ptr = pos;
+	return value;
+}
+
+
+static unsigned long long vi_trace_bin_read_varint(struct vi_trace_t *trace)
+{
+	return vi_trace_bin_varint(trace, trace->block_data, trace->block_size,
+		&trace->block_pos);
+}
+
+
+static char *vi_trace_bin_read_string(struct vi_trace_t *trace)
+{
+	unsigned long long id;
+
+	id = vi_trace_bin_read_varint(trace);
+	if (id >= trace->num_strings)
+		fatal("%s: invalid binary trace", trace->name);
+	return trace->string_list[id];
+}
+
+
+/* Read a symbol value encoded as a difference with the last value of symbol
+ * 'name' in the block. */
+static long long vi_trace_bin_read_value(struct vi_trace_t *trace, int name)
+{
+	unsigned long long zigzag;
+
+	zigzag = vi_trace_bin_read_varint(trace);
+	if (trace->value_gen[name] != trace->block_gen)
+	{
+		trace->value_gen[name] = trace->block_gen;
+		trace->value[name] = 0;
+	}
+	trace->value[name] += (long long) ((zigzag >> 1) ^ -(zigzag & 1));
+	return trace->value[name];
+}
+
+
+/* Uncompress block 'block', and set the position at its first record */
+static void vi_trace_bin_load_block(struct vi_trace_t *trace, long long block)
+{
+	unsigned char *buf;
+	unsigned long long offset;
+	uLongf size;
+	int zsize;
+
+	/* Block header */
+	offset = vi_trace_bin_fixed(trace->index + block * TRACE_BIN_INDEX_ENTRY_SIZE + 8, 8);
+	if (offset + 8 > trace->map_size)
+		fatal("%s: invalid binary trace", trace->name);
+	buf = trace->map + offset;
+	size = vi_trace_bin_fixed(buf, 4);
+	zsize = vi_trace_bin_fixed(buf + 4, 4);
+	if (offset + 8 + zsize > trace->map_size)
+		fatal("%s: invalid binary trace", trace->name);
+
+	/* Uncompress */
+	if (size > trace->block_max_size)
+	{
+		trace->block_max_size = size;
+		trace->block_data = xrealloc(trace->block_data, size);
+	}
+	if (uncompress(trace->block_data, &size, buf + 8, zsize) != Z_OK)
+		fatal("%s: invalid binary trace", trace->name);
+
+	/* Initialize */
+	trace->block = block;
+	trace->block_size = size;
+	trace->block_pos = 0;
+	trace->block_cycle = -1;
+	trace->block_gen++;
+}
+
+
+/* Read the next record of a binary trace. If 'create' is FALSE, the record is
+ * skipped and the function returns NULL. */
+static struct vi_trace_line_t *vi_trace_bin_read_line(struct vi_trace_t *trace,
+	int create)
+{
+	struct vi_trace_line_t *line;
+
+	long int offset;
+	long long cycle;
+	long long value;
+
+	char buf[4096];
+	char *command;
+	char *symbol_name;
+	char *symbol_value;
+
+	int num_symbols;
+	int name;
+	int kind;
+	int len;
+	int i;
+
+	/* Go to next block if needed */
+	while (trace->block_pos == trace->block_size)
+	{
+		if (trace->block + 1 >= trace->num_blocks)
+			return NULL;
+		vi_trace_bin_load_block(trace, trace->block + 1);
+	}
+	offset = vi_trace_tell(trace);
+
+	/* Record tag */
+	line = NULL;
+	value = vi_trace_bin_read_varint(trace);
+	switch (value)
+	{
+
+	case trace_bin_record_cycle:
+
+		cycle = vi_trace_bin_read_varint(trace);
+		trace->block_cycle = trace->block_cycle < 0 ? cycle :
+			trace->block_cycle + cycle;
+		if (!create)
+			break;
+		snprintf(buf, sizeof buf, "c clk=%lld", trace->block_cycle);
+		line = vi_trace_line_create_from_text(trace, buf, offset);
+		break;
+
+	case trace_bin_record_text:
+
+		len = vi_trace_bin_read_varint(trace);
+		if (len >= sizeof buf || trace->block_pos + len > trace->block_size)
+			fatal("%s: invalid binary trace", trace->name);
+		memcpy(buf, trace->block_data + trace->block_pos, len);
+		buf[len] = '\0';
+		trace->block_pos += len;
+		if (create)
+			line = vi_trace_line_create_from_text(trace, buf, offset);
+		break;
+
+	default:
+
+		/* Command */
+		value -= trace_bin_record_line;
+		if (value >= trace->num_strings)
+			fatal("%s: invalid binary trace", trace->name);
+		command = trace->string_list[value];
+		if (create)
+		{
+			line = xcalloc(1, sizeof(struct vi_trace_line_t));
+			trace->line_num++;
+			line->offset = offset;
+			line->line_num = trace->line_num;
+			line->command = xstrdup(command);
+			line->symbol_table = hash_table_create(13, FALSE);
+		}
+
+		/* Symbols */
+		num_symbols = vi_trace_bin_read_varint(trace);
+		for (i = 0; i < num_symbols; i++)
+		{
+			name = vi_trace_bin_read_varint(trace);
+			if (name >= trace->num_strings || trace->block_pos >= trace->block_size)
+				fatal("%s: invalid binary trace", trace->name);
+			symbol_name = trace->string_list[name];
+			kind = trace->block_data[trace->block_pos++];
+
+			symbol_value = buf;
+			switch (kind)
+			{
+
+			case trace_bin_value_string:
+
+				symbol_value = vi_trace_bin_read_string(trace);
+				break;
+
+			case trace_bin_value_literal:
+
+				len = vi_trace_bin_read_varint(trace);
+				if (len >= sizeof buf || trace->block_pos + len > trace->block_size)
+					fatal("%s: invalid binary trace", trace->name);
+				memcpy(buf, trace->block_data + trace->block_pos, len);
+				buf[len] = '\0';
+				trace->block_pos += len;
+				break;
+
+			case trace_bin_value_dec:
+
+				value = vi_trace_bin_read_value(trace, name);
+				snprintf(buf, sizeof buf, "%lld", value);
+				break;
+
+			case trace_bin_value_hex:
+
+				value = vi_trace_bin_read_value(trace, name);
+				snprintf(buf, sizeof buf, "0x%llx", value);
+				break;
+
+			case trace_bin_value_prefix_dec:
+
+				symbol_value = vi_trace_bin_read_string(trace);
+				value = vi_trace_bin_read_value(trace, name);
+				snprintf(buf, sizeof buf, "%s%lld", symbol_value, value);
+				symbol_value = buf;
+				break;
+
+			default:
+				fatal("%s: invalid binary trace", trace->name);
+			}
+
+			/* Insert in symbol table */
+			if (create)
+				hash_table_insert(line->symbol_table, symbol_name,
+					xstrdup(symbol_value));
+		}
+	}
+
+	/* Return */
+	return line;
+}
+
+
+static void vi_trace_bin_open(struct vi_trace_t *trace)
+{
+	struct stat st;
+
+	unsigned char *trailer;
+	unsigned long long string_table_offset;
+	unsigned long long index_offset;
+	int pos;
+	int len;
+	int fd;
+	int i;
+
+	/* Map file */
+	fd = open(trace->name, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st))
+		fatal("%s: cannot open trace file", trace->name);
+	trace->map_size = st.st_size;
+	if (trace->map_size < TRACE_BIN_MAGIC_SIZE + 4 + TRACE_BIN_TRAILER_SIZE)
+		fatal("%s: invalid binary trace", trace->name);
+	trace->map = mmap(NULL, trace->map_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (trace->map == MAP_FAILED)
+		fatal("%s: cannot map trace file", trace->name);
+
+	/* Header and trailer */
+	if (vi_trace_bin_fixed(trace->map + TRACE_BIN_MAGIC_SIZE, 4) != TRACE_BIN_VERSION)
+		fatal("%s: unsupported binary trace version", trace->name);
+	trailer = trace->map + trace->map_size - TRACE_BIN_TRAILER_SIZE;
+	if (memcmp(trailer + 40, TRACE_BIN_MAGIC, TRACE_BIN_MAGIC_SIZE))
+		fatal("%s: incomplete binary trace, simulation did not finish", trace->name);
+	string_table_offset = vi_trace_bin_fixed(trailer, 8);
+	trace->num_strings = vi_trace_bin_fixed(trailer + 8, 8);
+	index_offset = vi_trace_bin_fixed(trailer + 16, 8);
+	trace->num_blocks = vi_trace_bin_fixed(trailer + 24, 8);
+	trace->last_cycle = vi_trace_bin_fixed(trailer + 32, 8);
+	if (string_table_offset > index_offset || index_offset +
+		trace->num_blocks * TRACE_BIN_INDEX_ENTRY_SIZE > trace->map_size)
+		fatal("%s: invalid binary trace", trace->name);
+	trace->index = trace->map + index_offset;
+
+	/* String table, pointing to the strings in the mapped file */
+	trace->string_list = xcalloc(trace->num_strings + 1, sizeof(char *));
+	pos = 0;
+	for (i = 0; i < trace->num_strings; i++)
+	{
+		len = vi_trace_bin_varint(trace, trace->map + string_table_offset,
+			index_offset - string_table_offset, &pos);
+		if (pos + len >= index_offset - string_table_offset)
+			fatal("%s: invalid binary trace", trace->name);
+		trace->string_list[i] = (char *) trace->map + string_table_offset + pos;
+		pos += len + 1;
+	}
+	trace->value = xcalloc(trace->num_strings + 1, sizeof(long long));
+	trace->value_gen = xcalloc(trace->num_strings + 1, sizeof(int));
+
+	/* No block loaded */
+	trace->block = -1;
+}
+
+
+int vi_trace_is_binary(struct vi_trace_t *trace)
+{
+	return trace->binary;
+}
+
+
+long long vi_trace_get_num_cycles(struct vi_trace_t *trace)
+{
+	return trace->last_cycle;
+}
+
+
+/* Position of the next trace line. For binary traces, the position is the
+ * block number in the upper 32 bits, and the offset of the record in the
+ * uncompressed block in the lower 32 bits. */
+long int vi_trace_tell(struct vi_trace_t *trace)
+{
+	if (!trace->binary)
+		return gztell(trace->f);
+	if (trace->block < 0)
+		return 0;
+	return (trace->block << 32) | trace->block_pos;
+}
+
+
+/* Set the position of the next trace line to a value returned by
+ * 'vi_trace_tell' or 'vi_trace_find_cycle'. In a binary trace, the block is
+ * decoded from its beginning to restore the last values of integer symbols,
+ * unless the position is ahead in the current block. */
+void vi_trace_seek(struct vi_trace_t *trace, long int offset)
+{
+	long long block;
+	int pos;
+
+	/* Text trace */
+	if (!trace->binary)
+	{
+		gzseek(trace->f, offset, SEEK_SET);
+		return;
+	}
+
+	/* Binary trace */
+	block = offset >> 32;
+	pos = offset & 0xffffffff;
+	if (block >= trace->num_blocks)
+	{
+		trace->block = trace->num_blocks - 1;
+		trace->block_pos = trace->block_size = 0;
+		return;
+	}
+	if (block != trace->block || pos < trace->block_pos)
+		vi_trace_bin_load_block(trace, block);
+	while (trace->block_pos < pos && trace->block_pos < trace->block_size)
+		vi_trace_bin_read_line(trace, 0);
+}
+
+
+/* Return a position in a binary trace, to be passed to 'vi_trace_seek', of the
+ * beginning of the block containing cycle 'cycle'. The first trace line read
+ * after it is a header line or a cycle line not later than 'cycle'. */
+long int vi_trace_find_cycle(struct vi_trace_t *trace, long long cycle)
+{
+	long long min;
+	long long max;
+	long long mid;
+
+	/* Binary search in index, where the first block always starts at cycle 0 */
+	min = 0;
+	max = trace->num_blocks - 1;
+	while (min < max)
+	{
+		mid = (min + max + 1) / 2;
+		if ((long long) vi_trace_bin_fixed(trace->index +
+				mid * TRACE_BIN_INDEX_ENTRY_SIZE, 8) <= cycle)
+			min = mid;
+		else
+			max = mid - 1;
+	}
+	return MAX(min, 0) << 32;
+}
+
+
+/* Fraction of a binary trace read so far */
+double vi_trace_get_progress(struct vi_trace_t *trace)
+{
+	if (!trace->num_blocks || trace->block < 0)
+		return 0.0;
+	return (double) trace->block / trace->num_blocks;
+}
+
+
+
+
 /*
  * Trace file
  */
@@ -362,10 +817,26 @@ struct vi_trace_t *vi_trace_create(char *file_name)
 {
 	struct vi_trace_t *trace;
 
+	char magic[TRACE_BIN_MAGIC_SIZE];
+	FILE *f;
+
 	/* Initialize */
 	trace = xcalloc(1, sizeof(struct vi_trace_t));
 	trace->name = xstrdup(file_name);
 
+	/* Binary trace */
+	f = fopen(file_name, "rb");
+	if (!f)
+		fatal("%s: cannot open trace file", file_name);
+	trace->binary = fread(magic, 1, TRACE_BIN_MAGIC_SIZE, f) == TRACE_BIN_MAGIC_SIZE &&
+		!memcmp(magic, TRACE_BIN_MAGIC, TRACE_BIN_MAGIC_SIZE);
+	fclose(f);
+	if (trace->binary)
+	{
+		vi_trace_bin_open(trace);
+		return trace;
+	}
+
 	/* Open */
 	trace->f = gzopen(file_name, "r");
 	if (!trace->f)
@@ -378,7 +849,18 @@ struct vi_trace_t *vi_trace_create(char *file_name)
 
 void vi_trace_free(struct vi_trace_t *trace)
 {
-	gzclose(trace->f);
+	if (trace->binary)
+	{
+		munmap(trace->map, trace->map_size);
+		free(trace->string_list);
+		free(trace->value);
+		free(trace->value_gen);
+		free(trace->block_data);
+	}
+	else
+	{
+		gzclose(trace->f);
+	}
 	free(trace->name);
 	free(trace);
 }
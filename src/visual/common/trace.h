@@ -28,6 +28,14 @@ struct vi_trace_t;
 struct vi_trace_t *vi_trace_create(char *file_name);
 void vi_trace_free(struct vi_trace_t *trace);
 
+int vi_trace_is_binary(struct vi_trace_t *trace);
+long long vi_trace_get_num_cycles(struct vi_trace_t *trace);
+double vi_trace_get_progress(struct vi_trace_t *trace);
+
+long int vi_trace_tell(struct vi_trace_t *trace);
+void vi_trace_seek(struct vi_trace_t *trace, long int offset);
+long int vi_trace_find_cycle(struct vi_trace_t *trace, long long cycle);
+
 
 struct vi_trace_line_t;
 
@@ -0,0 +1,447 @@
+#!/usr/bin/python
+
+# Copyright (C) 2012 Rafael Ubal Tena
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+
+import math
+import multiprocessing
+import os
+import shlex
+import subprocess
+import sys
+import time
+
+
+# Syntax
+def syntax():
+	sys.stderr.write("""
+Syntax: m2s-batch.py [-n] [-a] <batch-file> <output-dir>
+
+Run one Multi2Sim simulation for every pair of checkpoint and configuration
+listed in <batch-file>, using a pool of local processes, and merge the results
+of all checkpoints of each configuration into one weighted result set.
+
+  -n  Print the commands that would be run, and exit.
+  -a  Do not run simulations, only merge the results already in <output-dir>.
+
+The batch file has the following sections:
+
+  [ General ]
+  Simulator = <path>         Multi2Sim executable (default 'm2s').
+  Arguments = <args>         Options passed to all simulations.
+  Processes = <num>          Simulations run at the same time (default: number
+                             of CPUs).
+  MemoryBudget = <MB>        Simulations are not started while the memory of
+                             the running ones would exceed this budget
+                             (default 0 = no limit).
+  JobMemory = <MB>           Memory reserved for a simulation until its actual
+                             peak resident size is larger (default 512).
+  SimPoint = <prefix>        Add one checkpoint '<prefix>.<cluster>.ckp' for
+                             each simulation point in '<prefix>.weights'.
+
+  [ Checkpoint <name> ]      Optional, one section per checkpoint.
+  File = <path>              Checkpoint loaded with '--x86-load-checkpoint'.
+  Weight = <num>             Weight in the merged results (default 1).
+  Memory = <MB>              Memory reserved instead of 'JobMemory'.
+
+  [ Config <name> ]          One section per configuration.
+  Arguments = <args>         Options specific to this configuration. Without
+                             checkpoints, they must include the program.
+
+Output directory:
+
+  <config>.<checkpoint>/     Reports directory of each simulation, with its
+                             statistics summary in 'summary' and its standard
+                             output in 'stdout'. Without checkpoints, the
+                             directory is '<config>.run'.
+  <config>/summary           Weighted statistics summary.
+  <config>/mem_report.out    Weighted memory hierarchy report, with the misses
+                             per thousand x86 instructions (MPKI) of each
+                             module.
+  <config>/interval_reports  Weighted interval reports, merged row by row.
+  jobs                       Status, run time and peak memory of each
+                             simulation.
+
+Values are averaged with the weights of the checkpoints. Values per cycle are
+averaged through their inverse, i.e. IPC is the inverse of the weighted CPI.
+
+""")
+	sys.exit(1)
+
+
+def fatal(msg):
+	sys.stderr.write("fatal: %s\n" % msg)
+	sys.exit(1)
+
+
+def warning(msg):
+	sys.stderr.write("warning: %s\n" % msg)
+
+
+# Read sections and variables of an INI file. Section names are normalized
+# to single spaces without brackets.
+def read_ini(file_name):
+	sections = {}
+	order = []
+	section = None
+	for line in open(file_name):
+		line = line.strip()
+		if not line or line[0] == ';' or line[0] == '#':
+			continue
+		if line[0] == '[' and line[-1] == ']':
+			section = ' '.join(line[1:-1].split())
+			if section not in sections:
+				sections[section] = {}
+				order.append(section)
+			continue
+		if section is None or '=' not in line:
+			continue
+		key, value = line.split('=', 1)
+		sections[section][key.strip()] = value.strip()
+	return sections, order
+
+
+def to_float(value):
+	try:
+		return float(value.split()[0])
+	except (ValueError, IndexError):
+		return None
+
+
+def to_int(value, name):
+	try:
+		return int(value)
+	except ValueError:
+		fatal("invalid value for '%s': %s" % (name, value))
+
+
+class Job:
+	def __init__(self, name, config, args, weight, memory):
+		self.name = name
+		self.config = config
+		self.args = args
+		self.weight = weight
+		self.memory = memory
+		self.reserved = memory
+		self.peak = 0
+		self.proc = None
+		self.stdout = None
+		self.summary = None
+		self.start = 0.0
+		self.time = 0.0
+		self.status = 'pending'
+
+
+# Batch file
+def read_batch(file_name, out_dir):
+	sections, order = read_ini(file_name)
+	general = sections.get('General', {})
+	simulator = general.get('Simulator', 'm2s')
+	common_args = shlex.split(general.get('Arguments', ''))
+	processes = to_int(general.get('Processes', str(multiprocessing.cpu_count())),
+		'Processes')
+	budget = to_int(general.get('MemoryBudget', '0'), 'MemoryBudget')
+	job_memory = to_int(general.get('JobMemory', '512'), 'JobMemory')
+	if processes < 1 or budget < 0 or job_memory < 0:
+		fatal("%s: invalid values in section 'General'" % file_name)
+
+	# Checkpoints
+	checkpoints = []
+	prefix = general.get('SimPoint')
+	if prefix:
+		for line in open(prefix + '.weights'):
+			tokens = line.split()
+			if len(tokens) == 2:
+				checkpoints.append(('sp%s' % tokens[1], '%s.%s.ckp' % (prefix, tokens[1]),
+					float(tokens[0]), job_memory))
+	for section in order:
+		if not section.startswith('Checkpoint '):
+			continue
+		values = sections[section]
+		if 'File' not in values:
+			fatal("%s: section '%s': missing 'File'" % (file_name, section))
+		weight = to_float(values.get('Weight', '1'))
+		if weight is None or weight < 0:
+			fatal("%s: section '%s': invalid weight" % (file_name, section))
+		checkpoints.append((section.split(' ', 1)[1], values['File'], weight,
+			to_int(values.get('Memory', str(job_memory)), 'Memory')))
+
+	# Jobs, one per checkpoint and configuration
+	jobs = []
+	configs = []
+	for section in order:
+		if not section.startswith('Config '):
+			continue
+		config = section.split(' ', 1)[1]
+		config_args = shlex.split(sections[section].get('Arguments', ''))
+		configs.append(config)
+		for name, path, weight, memory in checkpoints or [('run', None, 1.0, job_memory)]:
+			job_name = '%s.%s' % (config, name)
+			args = [simulator] + common_args + ['--reports-dir', os.path.join(out_dir, job_name)]
+			if path:
+				args += ['--x86-load-checkpoint', path]
+			jobs.append(Job(job_name, config, args + config_args, weight, memory))
+	if not jobs:
+		fatal("%s: no configurations" % file_name)
+	return jobs, configs, processes, budget
+
+
+# Peak resident memory of a process in MB, 0 if unknown
+def peak_memory(pid):
+	try:
+		for line in open('/proc/%d/status' % pid):
+			if line.startswith('VmHWM:'):
+				return int(line.split()[1]) // 1024
+	except (IOError, OSError, ValueError):
+		pass
+	return 0
+
+
+# Run jobs in a pool of 'processes' processes. A job is not started if the
+# memory reserved by the running ones plus its own exceeds 'budget', unless no
+# other job is running.
+def run_jobs(jobs, out_dir, processes, budget):
+	pending = list(jobs)
+	running = []
+	while pending or running:
+
+		# Start jobs
+		while pending and len(running) < processes:
+			job = pending[0]
+			reserved = sum([j.reserved for j in running])
+			if running and budget and reserved + job.memory > budget:
+				break
+			pending.pop(0)
+			job_dir = os.path.join(out_dir, job.name)
+			if not os.path.isdir(job_dir):
+				os.makedirs(job_dir)
+			job.stdout = open(os.path.join(job_dir, 'stdout'), 'w')
+			job.summary = open(os.path.join(job_dir, 'summary'), 'w')
+			job.proc = subprocess.Popen(job.args, stdout=job.stdout,
+				stderr=job.summary)
+			job.start = time.time()
+			job.status = 'running'
+			running.append(job)
+			sys.stderr.write("[%d/%d] %s started\n" % (len(jobs) - len(pending),
+				len(jobs), job.name))
+
+		# Wait
+		time.sleep(0.2)
+		for job in list(running):
+			job.peak = max(job.peak, peak_memory(job.proc.pid))
+			job.reserved = max(job.memory, job.peak)
+			if job.proc.poll() is None:
+				continue
+			job.time = time.time() - job.start
+			job.stdout.close()
+			job.summary.close()
+			job.status = 'ok' if job.proc.returncode == 0 else \
+				'failed (%d)' % job.proc.returncode
+			running.remove(job)
+			sys.stderr.write("%s: %s, %.1f s\n" % (job.name, job.status, job.time))
+
+
+# Weighted mean of a list of (weight, value). Values per cycle are averaged
+# through their inverse.
+def weighted_mean(key, values):
+	total = sum([w for w, v in values])
+	if not total:
+		return None
+	if key.endswith('PerCycle') or 'ipc' in key.split('-'):
+		if [v for w, v in values if not v]:
+			return 0.0
+		return total / sum([w / v for w, v in values])
+	return sum([w * v for w, v in values]) / total
+
+
+def format_value(value):
+	if value is None or math.isnan(value):
+		return 'nan'
+	if value == int(value) and abs(value) < 1e15:
+		return '%d' % value
+	return '%.6g' % value
+
+
+# Merge INI reports of several jobs into 'file_name'. 'reports' is a list of
+# (weight, sections, order).
+def merge_ini(file_name, reports):
+	sections = {}
+	order = []
+	for weight, job_sections, job_order in reports:
+		for section in job_order:
+			if section not in sections:
+				sections[section] = ([], {})
+				order.append(section)
+			keys, values = sections[section]
+			for key, value in job_sections[section].items():
+				value = to_float(value)
+				if value is None or math.isnan(value):
+					continue
+				if key not in values:
+					keys.append(key)
+					values[key] = []
+				values[key].append((weight, value))
+	f = open(file_name, 'w')
+	for section in order:
+		keys, values = sections[section]
+		if not keys:
+			continue
+		f.write("[ %s ]\n" % section)
+		for key in keys:
+			f.write("%s = %s\n" % (key, format_value(weighted_mean(key, values[key]))))
+		f.write("\n")
+	f.close()
+
+
+# Merge CSV interval reports row by row. The first column of each row is
+# replaced by the interval index.
+def merge_csv(file_name, reports):
+	header = None
+	rows = []
+	for weight, path in reports:
+		lines = open(path).read().split('\n')
+		if not lines or not lines[0]:
+			continue
+		if header is None:
+			header = lines[0]
+		elif header != lines[0]:
+			warning("%s: different columns, not merged" % path)
+			continue
+		for index, line in enumerate([l for l in lines[1:] if l]):
+			if index == len(rows):
+				rows.append([])
+			rows[index].append((weight, line.split(',')[1:]))
+	if header is None:
+		return
+	columns = header.split(',')[1:]
+	f = open(file_name, 'w')
+	f.write(','.join(['interval'] + columns) + '\n')
+	for index, row in enumerate(rows):
+		fields = [str(index)]
+		for column in range(len(columns)):
+			values = []
+			for weight, job_fields in row:
+				value = to_float(job_fields[column]) if column < len(job_fields) else None
+				if value is not None and not math.isnan(value):
+					values.append((weight, value))
+			fields.append(format_value(weighted_mean(columns[column], values)))
+		f.write(','.join(fields) + '\n')
+	f.close()
+
+
+# Merge the results of all successful jobs of a configuration
+def merge_results(jobs, config, out_dir):
+	config_jobs = []
+	for job in jobs:
+		if job.config != config:
+			continue
+		summary = os.path.join(out_dir, job.name, 'summary')
+		if job.status not in ('ok', 'pending') or not os.path.exists(summary):
+			warning("%s: simulation failed, not merged" % job.name)
+			continue
+		config_jobs.append(job)
+	if not config_jobs:
+		return
+	config_dir = os.path.join(out_dir, config)
+	if not os.path.isdir(config_dir):
+		os.makedirs(config_dir)
+
+	# Summary
+	summaries = {}
+	for job in config_jobs:
+		summaries[job.name] = read_ini(os.path.join(out_dir, job.name, 'summary'))
+	merge_ini(os.path.join(config_dir, 'summary'),
+		[(job.weight,) + summaries[job.name] for job in config_jobs])
+
+	# Memory report, with MPKI
+	reports = []
+	for job in config_jobs:
+		path = os.path.join(out_dir, job.name, 'global_reports', 'mem_report.out')
+		if not os.path.exists(path):
+			continue
+		sections, order = read_ini(path)
+		inst = to_float(summaries[job.name][0].get('x86', {}).get('CommittedInstructions', '0'))
+		for section in order:
+			misses = to_float(sections[section].get('Misses', ''))
+			if inst and misses is not None:
+				sections[section]['MPKI'] = str(misses * 1000.0 / inst)
+		reports.append((job.weight, sections, order))
+	if reports:
+		merge_ini(os.path.join(config_dir, 'mem_report.out'), reports)
+
+	# Interval reports
+	paths = []
+	for job in config_jobs:
+		job_dir = os.path.join(out_dir, job.name, 'interval_reports')
+		for root, dirs, files in os.walk(job_dir):
+			for name in files:
+				path = os.path.relpath(os.path.join(root, name), job_dir)
+				if name.endswith('.csv') and path not in paths:
+					paths.append(path)
+	for path in sorted(paths):
+		reports = []
+		for job in config_jobs:
+			job_path = os.path.join(out_dir, job.name, 'interval_reports', path)
+			if os.path.exists(job_path):
+				reports.append((job.weight, job_path))
+		merged = os.path.join(config_dir, 'interval_reports', path)
+		if not os.path.isdir(os.path.dirname(merged)):
+			os.makedirs(os.path.dirname(merged))
+		merge_csv(merged, reports)
+
+
+# Main program
+args = sys.argv[1:]
+dry_run = False
+merge_only = False
+while args and args[0].startswith('-'):
+	if args[0] == '-n':
+		dry_run = True
+	elif args[0] == '-a':
+		merge_only = True
+	else:
+		syntax()
+	args.pop(0)
+if len(args) != 2:
+	syntax()
+batch_file, out_dir = args
+jobs, configs, processes, budget = read_batch(batch_file, out_dir)
+
+# Dry run
+if dry_run:
+	for job in jobs:
+		print(' '.join(job.args))
+	sys.exit(0)
+
+# Run
+if not merge_only:
+	if not os.path.isdir(out_dir):
+		os.makedirs(out_dir)
+	run_jobs(jobs, out_dir, processes, budget)
+	f = open(os.path.join(out_dir, 'jobs'), 'w')
+	f.write("%-30s %-10s %-12s %-10s %s\n" % ("Job", "Weight", "Status", "Time", "PeakMB"))
+	for job in jobs:
+		f.write("%-30s %-10.4f %-12s %-10.1f %d\n" % (job.name, job.weight,
+			job.status, job.time, job.peak))
+	f.close()
+
+# Merge
+for config in configs:
+	merge_results(jobs, config, out_dir)
+failed = [job for job in jobs if job.status not in ('ok', 'pending')]
+if failed:
+	fatal("%d simulations failed" % len(failed))
@@ -0,0 +1,111 @@
+#!/usr/bin/python
+
+# Copyright (C) 2012 Rafael Ubal Tena
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+
+import os
+import sys
+
+
+# Syntax
+if len(sys.argv) != 2:
+	sys.stderr.write("""
+Syntax: simpoint.py <prefix>
+
+Combine the results of the detailed simulation of SimPoint simulation points
+into whole-program estimates. The following files are read:
+
+  <prefix>.weights
+	Weight of each simulation point, created by 'm2s --x86-bbv <prefix>'.
+
+  <prefix>.<cluster>.summary
+	Statistics summary printed by Multi2Sim on the standard error output for
+	the detailed simulation of checkpoint '<prefix>.<cluster>.ckp'.
+
+  <prefix>.<cluster>.mem (optional)
+	Memory hierarchy report, created with option '--mem-report'.
+
+CPI is averaged with the weights of the simulation points, and IPC is computed
+as its inverse. MPKI is averaged for each memory module.
+
+""")
+	sys.exit(1)
+
+
+# Read sections and variables of an INI file
+def read_ini(file_name):
+	sections = {}
+	section = None
+	for line in open(file_name):
+		line = line.strip()
+		if not line or line[0] == ';':
+			continue
+		if line[0] == '[' and line[-1] == ']':
+			section = line[1:-1].strip()
+			sections[section] = {}
+			continue
+		if section is None or '=' not in line:
+			continue
+		key, value = line.split('=', 1)
+		sections[section][key.strip()] = value.split()[0] if value.split() else ''
+	return sections
+
+
+# Weights
+prefix = sys.argv[1]
+weights = []
+for line in open(prefix + '.weights'):
+	tokens = line.split()
+	if len(tokens) == 2:
+		weights.append((float(tokens[0]), int(tokens[1])))
+if not weights:
+	sys.stderr.write("%s.weights: no simulation points\n" % prefix)
+	sys.exit(1)
+
+# Simulation points
+cpi = 0.0
+mpki = {}
+print("%-10s %-10s %-10s %-10s" % ("Cluster", "Weight", "Inst", "IPC"))
+for weight, cluster in weights:
+	file_name = "%s.%d.summary" % (prefix, cluster)
+	summary = read_ini(file_name)
+	if 'x86' not in summary:
+		sys.stderr.write("%s: no x86 statistics\n" % file_name)
+		sys.exit(1)
+	inst = int(summary['x86']['CommittedInstructions'])
+	ipc = float(summary['x86']['CommittedInstructionsPerCycle'])
+	if not ipc:
+		sys.stderr.write("%s: no committed instructions\n" % file_name)
+		sys.exit(1)
+	cpi += weight / ipc
+	print("%-10d %-10.4f %-10d %-10.4f" % (cluster, weight, inst, ipc))
+
+	# Memory modules
+	file_name = "%s.%d.mem" % (prefix, cluster)
+	if not os.path.exists(file_name):
+		continue
+	for name, section in read_ini(file_name).items():
+		if 'Misses' in section:
+			mpki[name] = mpki.get(name, 0.0) + weight * \
+				int(section['Misses']) * 1000.0 / inst
+
+# Estimates
+print("")
+print("CPI = %.4f" % cpi)
+print("IPC = %.4f" % (1.0 / cpi))
+for name in sorted(mpki):
+	print("%s.MPKI = %.4f" % (name, mpki[name]))